@@ -68,3 +68,5 @@
 ; --- Other
 
 ;; #CONFIG# COMPRESSION_LVL_2          NO
+;; #CONFIG# COMPRESSION_LVL_3          NO
+;; #CONFIG# COMPRESSION_CROSS_LIST     NO
@@ -265,6 +265,18 @@
 
 
 
+; Check that string compression configuration is correct
+
+!ifdef CONFIG_COMPRESSION_LVL_2 { !ifdef CONFIG_COMPRESSION_LVL_3 {
+	!error "Please select at most one CONFIG_COMPRESSION_LVL_* option"
+}}
+!ifdef CONFIG_COMPRESSION_LVL_3 { !error "CONFIG_COMPRESSION_LVL_3 is not supported by the ROM code yet" }
+!ifdef CONFIG_COMPRESSION_CROSS_LIST { !ifndef CONFIG_COMPRESSION_LVL_2 {
+	!error "CONFIG_COMPRESSION_CROSS_LIST requires CONFIG_COMPRESSION_LVL_2"
+}}
+
+
+
 ;
 ; Define some macros depending on the configuration
 ;
@@ -17,7 +17,7 @@ helper_INDEX_up_A:                     ; .A - bytes to increase INDEX, uses DSCP
 	adc DSCPNT+0 
 	sta INDEX+0
 	bcc @1
-	dec INDEX+1
+	inc INDEX+1
 @1:
 	rts
 }
@@ -34,7 +34,6 @@ print_dict_packed_string:
 	lda (FRESPC), y
 	beq print_dict_packed_string_end   ; branch if everything displayed
 	tax
-	dex
 
 	; Call 'print_freq_packed_string' - but preserve all the data needed to progress further
 
@@ -44,11 +43,26 @@ print_dict_packed_string:
 	lda FRESPC+1
 	pha
 
+!ifdef CONFIG_COMPRESSION_CROSS_LIST {
+
+	; Byte-codes from $80 refer to BASIC V2 keywords, by token
+
+	txa
+	bpl @2
+	and #$7F
+	tax
+
+	jsr print_packed_keyword_V2
+	+bra @3
+@2:
+}
+	dex
+
 	lda #<packed_dictionary
 	ldy #>packed_dictionary
 
 	jsr print_freq_packed_string
-
+@3:
 	pla
 	sta FRESPC+1
 	pla
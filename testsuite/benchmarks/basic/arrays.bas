@@ -0,0 +1,56 @@
+#
+# Array handling - DIM of several arrays (one per statement), then string element
+# assignment and fetch over single dimension arrays
+#
+10 DIM A$(200):DIM B$(200):DIM C%(100):DIM D(20,20)
+100 A$(0)="ELEMENT":A$(1)=A$(0)+"X":B$(200)=A$(1):B$(199)=A$(0)+B$(200)
+110 A$(4)="ELEMENT":A$(5)=A$(4)+"X":B$(196)=A$(5):B$(195)=A$(4)+B$(196)
+120 A$(8)="ELEMENT":A$(9)=A$(8)+"X":B$(192)=A$(9):B$(191)=A$(8)+B$(192)
+130 A$(12)="ELEMENT":A$(13)=A$(12)+"X":B$(188)=A$(13):B$(187)=A$(12)+B$(188)
+140 A$(16)="ELEMENT":A$(17)=A$(16)+"X":B$(184)=A$(17):B$(183)=A$(16)+B$(184)
+150 A$(20)="ELEMENT":A$(21)=A$(20)+"X":B$(180)=A$(21):B$(179)=A$(20)+B$(180)
+160 A$(24)="ELEMENT":A$(25)=A$(24)+"X":B$(176)=A$(25):B$(175)=A$(24)+B$(176)
+170 A$(28)="ELEMENT":A$(29)=A$(28)+"X":B$(172)=A$(29):B$(171)=A$(28)+B$(172)
+180 A$(32)="ELEMENT":A$(33)=A$(32)+"X":B$(168)=A$(33):B$(167)=A$(32)+B$(168)
+190 A$(36)="ELEMENT":A$(37)=A$(36)+"X":B$(164)=A$(37):B$(163)=A$(36)+B$(164)
+200 A$(40)="ELEMENT":A$(41)=A$(40)+"X":B$(160)=A$(41):B$(159)=A$(40)+B$(160)
+210 A$(44)="ELEMENT":A$(45)=A$(44)+"X":B$(156)=A$(45):B$(155)=A$(44)+B$(156)
+220 A$(48)="ELEMENT":A$(49)=A$(48)+"X":B$(152)=A$(49):B$(151)=A$(48)+B$(152)
+230 A$(52)="ELEMENT":A$(53)=A$(52)+"X":B$(148)=A$(53):B$(147)=A$(52)+B$(148)
+240 A$(56)="ELEMENT":A$(57)=A$(56)+"X":B$(144)=A$(57):B$(143)=A$(56)+B$(144)
+250 A$(60)="ELEMENT":A$(61)=A$(60)+"X":B$(140)=A$(61):B$(139)=A$(60)+B$(140)
+260 A$(64)="ELEMENT":A$(65)=A$(64)+"X":B$(136)=A$(65):B$(135)=A$(64)+B$(136)
+270 A$(68)="ELEMENT":A$(69)=A$(68)+"X":B$(132)=A$(69):B$(131)=A$(68)+B$(132)
+280 A$(72)="ELEMENT":A$(73)=A$(72)+"X":B$(128)=A$(73):B$(127)=A$(72)+B$(128)
+290 A$(76)="ELEMENT":A$(77)=A$(76)+"X":B$(124)=A$(77):B$(123)=A$(76)+B$(124)
+300 A$(80)="ELEMENT":A$(81)=A$(80)+"X":B$(120)=A$(81):B$(119)=A$(80)+B$(120)
+310 A$(84)="ELEMENT":A$(85)=A$(84)+"X":B$(116)=A$(85):B$(115)=A$(84)+B$(116)
+320 A$(88)="ELEMENT":A$(89)=A$(88)+"X":B$(112)=A$(89):B$(111)=A$(88)+B$(112)
+330 A$(92)="ELEMENT":A$(93)=A$(92)+"X":B$(108)=A$(93):B$(107)=A$(92)+B$(108)
+340 A$(96)="ELEMENT":A$(97)=A$(96)+"X":B$(104)=A$(97):B$(103)=A$(96)+B$(104)
+350 A$(100)="ELEMENT":A$(101)=A$(100)+"X":B$(100)=A$(101):B$(99)=A$(100)+B$(100)
+360 A$(104)="ELEMENT":A$(105)=A$(104)+"X":B$(96)=A$(105):B$(95)=A$(104)+B$(96)
+370 A$(108)="ELEMENT":A$(109)=A$(108)+"X":B$(92)=A$(109):B$(91)=A$(108)+B$(92)
+380 A$(112)="ELEMENT":A$(113)=A$(112)+"X":B$(88)=A$(113):B$(87)=A$(112)+B$(88)
+390 A$(116)="ELEMENT":A$(117)=A$(116)+"X":B$(84)=A$(117):B$(83)=A$(116)+B$(84)
+400 A$(120)="ELEMENT":A$(121)=A$(120)+"X":B$(80)=A$(121):B$(79)=A$(120)+B$(80)
+410 A$(124)="ELEMENT":A$(125)=A$(124)+"X":B$(76)=A$(125):B$(75)=A$(124)+B$(76)
+420 A$(128)="ELEMENT":A$(129)=A$(128)+"X":B$(72)=A$(129):B$(71)=A$(128)+B$(72)
+430 A$(132)="ELEMENT":A$(133)=A$(132)+"X":B$(68)=A$(133):B$(67)=A$(132)+B$(68)
+440 A$(136)="ELEMENT":A$(137)=A$(136)+"X":B$(64)=A$(137):B$(63)=A$(136)+B$(64)
+450 A$(140)="ELEMENT":A$(141)=A$(140)+"X":B$(60)=A$(141):B$(59)=A$(140)+B$(60)
+460 A$(144)="ELEMENT":A$(145)=A$(144)+"X":B$(56)=A$(145):B$(55)=A$(144)+B$(56)
+470 A$(148)="ELEMENT":A$(149)=A$(148)+"X":B$(52)=A$(149):B$(51)=A$(148)+B$(52)
+480 A$(152)="ELEMENT":A$(153)=A$(152)+"X":B$(48)=A$(153):B$(47)=A$(152)+B$(48)
+490 A$(156)="ELEMENT":A$(157)=A$(156)+"X":B$(44)=A$(157):B$(43)=A$(156)+B$(44)
+500 A$(160)="ELEMENT":A$(161)=A$(160)+"X":B$(40)=A$(161):B$(39)=A$(160)+B$(40)
+510 A$(164)="ELEMENT":A$(165)=A$(164)+"X":B$(36)=A$(165):B$(35)=A$(164)+B$(36)
+520 A$(168)="ELEMENT":A$(169)=A$(168)+"X":B$(32)=A$(169):B$(31)=A$(168)+B$(32)
+530 A$(172)="ELEMENT":A$(173)=A$(172)+"X":B$(28)=A$(173):B$(27)=A$(172)+B$(28)
+540 A$(176)="ELEMENT":A$(177)=A$(176)+"X":B$(24)=A$(177):B$(23)=A$(176)+B$(24)
+550 A$(180)="ELEMENT":A$(181)=A$(180)+"X":B$(20)=A$(181):B$(19)=A$(180)+B$(20)
+560 A$(184)="ELEMENT":A$(185)=A$(184)+"X":B$(16)=A$(185):B$(15)=A$(184)+B$(16)
+570 A$(188)="ELEMENT":A$(189)=A$(188)+"X":B$(12)=A$(189):B$(11)=A$(188)+B$(12)
+580 A$(192)="ELEMENT":A$(193)=A$(192)+"X":B$(8)=A$(193):B$(7)=A$(192)+B$(8)
+590 A$(196)="ELEMENT":A$(197)=A$(196)+"X":B$(4)=A$(197):B$(3)=A$(196)+B$(4)
+600 END
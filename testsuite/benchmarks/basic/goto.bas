@@ -0,0 +1,104 @@
+#
+# Line number search - GOTO jumping forwards and backwards between both ends of
+# a long program, so that each jump scans many lines
+#
+1000 GOTO 1990:REM JUMP ACROSS THE PROGRAM
+1010 GOTO 1980:REM JUMP ACROSS THE PROGRAM
+1020 GOTO 1970:REM JUMP ACROSS THE PROGRAM
+1030 GOTO 1960:REM JUMP ACROSS THE PROGRAM
+1040 GOTO 1950:REM JUMP ACROSS THE PROGRAM
+1050 GOTO 1940:REM JUMP ACROSS THE PROGRAM
+1060 GOTO 1930:REM JUMP ACROSS THE PROGRAM
+1070 GOTO 1920:REM JUMP ACROSS THE PROGRAM
+1080 GOTO 1910:REM JUMP ACROSS THE PROGRAM
+1090 GOTO 1900:REM JUMP ACROSS THE PROGRAM
+1100 GOTO 1890:REM JUMP ACROSS THE PROGRAM
+1110 GOTO 1880:REM JUMP ACROSS THE PROGRAM
+1120 GOTO 1870:REM JUMP ACROSS THE PROGRAM
+1130 GOTO 1860:REM JUMP ACROSS THE PROGRAM
+1140 GOTO 1850:REM JUMP ACROSS THE PROGRAM
+1150 GOTO 1840:REM JUMP ACROSS THE PROGRAM
+1160 GOTO 1830:REM JUMP ACROSS THE PROGRAM
+1170 GOTO 1820:REM JUMP ACROSS THE PROGRAM
+1180 GOTO 1810:REM JUMP ACROSS THE PROGRAM
+1190 GOTO 1800:REM JUMP ACROSS THE PROGRAM
+1200 GOTO 1790:REM JUMP ACROSS THE PROGRAM
+1210 GOTO 1780:REM JUMP ACROSS THE PROGRAM
+1220 GOTO 1770:REM JUMP ACROSS THE PROGRAM
+1230 GOTO 1760:REM JUMP ACROSS THE PROGRAM
+1240 GOTO 1750:REM JUMP ACROSS THE PROGRAM
+1250 GOTO 1740:REM JUMP ACROSS THE PROGRAM
+1260 GOTO 1730:REM JUMP ACROSS THE PROGRAM
+1270 GOTO 1720:REM JUMP ACROSS THE PROGRAM
+1280 GOTO 1710:REM JUMP ACROSS THE PROGRAM
+1290 GOTO 1700:REM JUMP ACROSS THE PROGRAM
+1300 GOTO 1690:REM JUMP ACROSS THE PROGRAM
+1310 GOTO 1680:REM JUMP ACROSS THE PROGRAM
+1320 GOTO 1670:REM JUMP ACROSS THE PROGRAM
+1330 GOTO 1660:REM JUMP ACROSS THE PROGRAM
+1340 GOTO 1650:REM JUMP ACROSS THE PROGRAM
+1350 GOTO 1640:REM JUMP ACROSS THE PROGRAM
+1360 GOTO 1630:REM JUMP ACROSS THE PROGRAM
+1370 GOTO 1620:REM JUMP ACROSS THE PROGRAM
+1380 GOTO 1610:REM JUMP ACROSS THE PROGRAM
+1390 GOTO 1600:REM JUMP ACROSS THE PROGRAM
+1400 GOTO 1590:REM JUMP ACROSS THE PROGRAM
+1410 GOTO 1580:REM JUMP ACROSS THE PROGRAM
+1420 GOTO 1570:REM JUMP ACROSS THE PROGRAM
+1430 GOTO 1560:REM JUMP ACROSS THE PROGRAM
+1440 GOTO 1550:REM JUMP ACROSS THE PROGRAM
+1450 GOTO 1540:REM JUMP ACROSS THE PROGRAM
+1460 GOTO 1530:REM JUMP ACROSS THE PROGRAM
+1470 GOTO 1520:REM JUMP ACROSS THE PROGRAM
+1480 GOTO 1510:REM JUMP ACROSS THE PROGRAM
+1490 GOTO 1500:REM JUMP ACROSS THE PROGRAM
+1500 END
+1510 GOTO 1490:REM JUMP ACROSS THE PROGRAM
+1520 GOTO 1480:REM JUMP ACROSS THE PROGRAM
+1530 GOTO 1470:REM JUMP ACROSS THE PROGRAM
+1540 GOTO 1460:REM JUMP ACROSS THE PROGRAM
+1550 GOTO 1450:REM JUMP ACROSS THE PROGRAM
+1560 GOTO 1440:REM JUMP ACROSS THE PROGRAM
+1570 GOTO 1430:REM JUMP ACROSS THE PROGRAM
+1580 GOTO 1420:REM JUMP ACROSS THE PROGRAM
+1590 GOTO 1410:REM JUMP ACROSS THE PROGRAM
+1600 GOTO 1400:REM JUMP ACROSS THE PROGRAM
+1610 GOTO 1390:REM JUMP ACROSS THE PROGRAM
+1620 GOTO 1380:REM JUMP ACROSS THE PROGRAM
+1630 GOTO 1370:REM JUMP ACROSS THE PROGRAM
+1640 GOTO 1360:REM JUMP ACROSS THE PROGRAM
+1650 GOTO 1350:REM JUMP ACROSS THE PROGRAM
+1660 GOTO 1340:REM JUMP ACROSS THE PROGRAM
+1670 GOTO 1330:REM JUMP ACROSS THE PROGRAM
+1680 GOTO 1320:REM JUMP ACROSS THE PROGRAM
+1690 GOTO 1310:REM JUMP ACROSS THE PROGRAM
+1700 GOTO 1300:REM JUMP ACROSS THE PROGRAM
+1710 GOTO 1290:REM JUMP ACROSS THE PROGRAM
+1720 GOTO 1280:REM JUMP ACROSS THE PROGRAM
+1730 GOTO 1270:REM JUMP ACROSS THE PROGRAM
+1740 GOTO 1260:REM JUMP ACROSS THE PROGRAM
+1750 GOTO 1250:REM JUMP ACROSS THE PROGRAM
+1760 GOTO 1240:REM JUMP ACROSS THE PROGRAM
+1770 GOTO 1230:REM JUMP ACROSS THE PROGRAM
+1780 GOTO 1220:REM JUMP ACROSS THE PROGRAM
+1790 GOTO 1210:REM JUMP ACROSS THE PROGRAM
+1800 GOTO 1200:REM JUMP ACROSS THE PROGRAM
+1810 GOTO 1190:REM JUMP ACROSS THE PROGRAM
+1820 GOTO 1180:REM JUMP ACROSS THE PROGRAM
+1830 GOTO 1170:REM JUMP ACROSS THE PROGRAM
+1840 GOTO 1160:REM JUMP ACROSS THE PROGRAM
+1850 GOTO 1150:REM JUMP ACROSS THE PROGRAM
+1860 GOTO 1140:REM JUMP ACROSS THE PROGRAM
+1870 GOTO 1130:REM JUMP ACROSS THE PROGRAM
+1880 GOTO 1120:REM JUMP ACROSS THE PROGRAM
+1890 GOTO 1110:REM JUMP ACROSS THE PROGRAM
+1900 GOTO 1100:REM JUMP ACROSS THE PROGRAM
+1910 GOTO 1090:REM JUMP ACROSS THE PROGRAM
+1920 GOTO 1080:REM JUMP ACROSS THE PROGRAM
+1930 GOTO 1070:REM JUMP ACROSS THE PROGRAM
+1940 GOTO 1060:REM JUMP ACROSS THE PROGRAM
+1950 GOTO 1050:REM JUMP ACROSS THE PROGRAM
+1960 GOTO 1040:REM JUMP ACROSS THE PROGRAM
+1970 GOTO 1030:REM JUMP ACROSS THE PROGRAM
+1980 GOTO 1020:REM JUMP ACROSS THE PROGRAM
+1990 GOTO 1010:REM JUMP ACROSS THE PROGRAM
@@ -0,0 +1,125 @@
+#
+# LIST of a large program - detokenization and screen output with scrolling
+#
+# command: LIST
+#
+1000 PRINT "LINE";I;TAB(10);CHR$(65+I AND 7)
+1010 IF A>B THEN GOSUB 100:REM COMPARE AND BRANCH
+1020 FOR J=1 TO 10:A(J)=J*J+SQR(J):NEXT J
+1030 A$=LEFT$(B$,3)+MID$(C$,2,2)+RIGHT$(D$,1)
+1040 ON X GOTO 100,200,300:DATA 1,2,3,"FOUR"
+1050 POKE 53280,PEEK(53281) AND 15:SYS 64738
+1060 PRINT "LINE";I;TAB(10);CHR$(65+I AND 7)
+1070 IF A>B THEN GOSUB 100:REM COMPARE AND BRANCH
+1080 FOR J=1 TO 10:A(J)=J*J+SQR(J):NEXT J
+1090 A$=LEFT$(B$,3)+MID$(C$,2,2)+RIGHT$(D$,1)
+1100 ON X GOTO 100,200,300:DATA 1,2,3,"FOUR"
+1110 POKE 53280,PEEK(53281) AND 15:SYS 64738
+1120 PRINT "LINE";I;TAB(10);CHR$(65+I AND 7)
+1130 IF A>B THEN GOSUB 100:REM COMPARE AND BRANCH
+1140 FOR J=1 TO 10:A(J)=J*J+SQR(J):NEXT J
+1150 A$=LEFT$(B$,3)+MID$(C$,2,2)+RIGHT$(D$,1)
+1160 ON X GOTO 100,200,300:DATA 1,2,3,"FOUR"
+1170 POKE 53280,PEEK(53281) AND 15:SYS 64738
+1180 PRINT "LINE";I;TAB(10);CHR$(65+I AND 7)
+1190 IF A>B THEN GOSUB 100:REM COMPARE AND BRANCH
+1200 FOR J=1 TO 10:A(J)=J*J+SQR(J):NEXT J
+1210 A$=LEFT$(B$,3)+MID$(C$,2,2)+RIGHT$(D$,1)
+1220 ON X GOTO 100,200,300:DATA 1,2,3,"FOUR"
+1230 POKE 53280,PEEK(53281) AND 15:SYS 64738
+1240 PRINT "LINE";I;TAB(10);CHR$(65+I AND 7)
+1250 IF A>B THEN GOSUB 100:REM COMPARE AND BRANCH
+1260 FOR J=1 TO 10:A(J)=J*J+SQR(J):NEXT J
+1270 A$=LEFT$(B$,3)+MID$(C$,2,2)+RIGHT$(D$,1)
+1280 ON X GOTO 100,200,300:DATA 1,2,3,"FOUR"
+1290 POKE 53280,PEEK(53281) AND 15:SYS 64738
+1300 PRINT "LINE";I;TAB(10);CHR$(65+I AND 7)
+1310 IF A>B THEN GOSUB 100:REM COMPARE AND BRANCH
+1320 FOR J=1 TO 10:A(J)=J*J+SQR(J):NEXT J
+1330 A$=LEFT$(B$,3)+MID$(C$,2,2)+RIGHT$(D$,1)
+1340 ON X GOTO 100,200,300:DATA 1,2,3,"FOUR"
+1350 POKE 53280,PEEK(53281) AND 15:SYS 64738
+1360 PRINT "LINE";I;TAB(10);CHR$(65+I AND 7)
+1370 IF A>B THEN GOSUB 100:REM COMPARE AND BRANCH
+1380 FOR J=1 TO 10:A(J)=J*J+SQR(J):NEXT J
+1390 A$=LEFT$(B$,3)+MID$(C$,2,2)+RIGHT$(D$,1)
+1400 ON X GOTO 100,200,300:DATA 1,2,3,"FOUR"
+1410 POKE 53280,PEEK(53281) AND 15:SYS 64738
+1420 PRINT "LINE";I;TAB(10);CHR$(65+I AND 7)
+1430 IF A>B THEN GOSUB 100:REM COMPARE AND BRANCH
+1440 FOR J=1 TO 10:A(J)=J*J+SQR(J):NEXT J
+1450 A$=LEFT$(B$,3)+MID$(C$,2,2)+RIGHT$(D$,1)
+1460 ON X GOTO 100,200,300:DATA 1,2,3,"FOUR"
+1470 POKE 53280,PEEK(53281) AND 15:SYS 64738
+1480 PRINT "LINE";I;TAB(10);CHR$(65+I AND 7)
+1490 IF A>B THEN GOSUB 100:REM COMPARE AND BRANCH
+1500 FOR J=1 TO 10:A(J)=J*J+SQR(J):NEXT J
+1510 A$=LEFT$(B$,3)+MID$(C$,2,2)+RIGHT$(D$,1)
+1520 ON X GOTO 100,200,300:DATA 1,2,3,"FOUR"
+1530 POKE 53280,PEEK(53281) AND 15:SYS 64738
+1540 PRINT "LINE";I;TAB(10);CHR$(65+I AND 7)
+1550 IF A>B THEN GOSUB 100:REM COMPARE AND BRANCH
+1560 FOR J=1 TO 10:A(J)=J*J+SQR(J):NEXT J
+1570 A$=LEFT$(B$,3)+MID$(C$,2,2)+RIGHT$(D$,1)
+1580 ON X GOTO 100,200,300:DATA 1,2,3,"FOUR"
+1590 POKE 53280,PEEK(53281) AND 15:SYS 64738
+1600 PRINT "LINE";I;TAB(10);CHR$(65+I AND 7)
+1610 IF A>B THEN GOSUB 100:REM COMPARE AND BRANCH
+1620 FOR J=1 TO 10:A(J)=J*J+SQR(J):NEXT J
+1630 A$=LEFT$(B$,3)+MID$(C$,2,2)+RIGHT$(D$,1)
+1640 ON X GOTO 100,200,300:DATA 1,2,3,"FOUR"
+1650 POKE 53280,PEEK(53281) AND 15:SYS 64738
+1660 PRINT "LINE";I;TAB(10);CHR$(65+I AND 7)
+1670 IF A>B THEN GOSUB 100:REM COMPARE AND BRANCH
+1680 FOR J=1 TO 10:A(J)=J*J+SQR(J):NEXT J
+1690 A$=LEFT$(B$,3)+MID$(C$,2,2)+RIGHT$(D$,1)
+1700 ON X GOTO 100,200,300:DATA 1,2,3,"FOUR"
+1710 POKE 53280,PEEK(53281) AND 15:SYS 64738
+1720 PRINT "LINE";I;TAB(10);CHR$(65+I AND 7)
+1730 IF A>B THEN GOSUB 100:REM COMPARE AND BRANCH
+1740 FOR J=1 TO 10:A(J)=J*J+SQR(J):NEXT J
+1750 A$=LEFT$(B$,3)+MID$(C$,2,2)+RIGHT$(D$,1)
+1760 ON X GOTO 100,200,300:DATA 1,2,3,"FOUR"
+1770 POKE 53280,PEEK(53281) AND 15:SYS 64738
+1780 PRINT "LINE";I;TAB(10);CHR$(65+I AND 7)
+1790 IF A>B THEN GOSUB 100:REM COMPARE AND BRANCH
+1800 FOR J=1 TO 10:A(J)=J*J+SQR(J):NEXT J
+1810 A$=LEFT$(B$,3)+MID$(C$,2,2)+RIGHT$(D$,1)
+1820 ON X GOTO 100,200,300:DATA 1,2,3,"FOUR"
+1830 POKE 53280,PEEK(53281) AND 15:SYS 64738
+1840 PRINT "LINE";I;TAB(10);CHR$(65+I AND 7)
+1850 IF A>B THEN GOSUB 100:REM COMPARE AND BRANCH
+1860 FOR J=1 TO 10:A(J)=J*J+SQR(J):NEXT J
+1870 A$=LEFT$(B$,3)+MID$(C$,2,2)+RIGHT$(D$,1)
+1880 ON X GOTO 100,200,300:DATA 1,2,3,"FOUR"
+1890 POKE 53280,PEEK(53281) AND 15:SYS 64738
+1900 PRINT "LINE";I;TAB(10);CHR$(65+I AND 7)
+1910 IF A>B THEN GOSUB 100:REM COMPARE AND BRANCH
+1920 FOR J=1 TO 10:A(J)=J*J+SQR(J):NEXT J
+1930 A$=LEFT$(B$,3)+MID$(C$,2,2)+RIGHT$(D$,1)
+1940 ON X GOTO 100,200,300:DATA 1,2,3,"FOUR"
+1950 POKE 53280,PEEK(53281) AND 15:SYS 64738
+1960 PRINT "LINE";I;TAB(10);CHR$(65+I AND 7)
+1970 IF A>B THEN GOSUB 100:REM COMPARE AND BRANCH
+1980 FOR J=1 TO 10:A(J)=J*J+SQR(J):NEXT J
+1990 A$=LEFT$(B$,3)+MID$(C$,2,2)+RIGHT$(D$,1)
+2000 ON X GOTO 100,200,300:DATA 1,2,3,"FOUR"
+2010 POKE 53280,PEEK(53281) AND 15:SYS 64738
+2020 PRINT "LINE";I;TAB(10);CHR$(65+I AND 7)
+2030 IF A>B THEN GOSUB 100:REM COMPARE AND BRANCH
+2040 FOR J=1 TO 10:A(J)=J*J+SQR(J):NEXT J
+2050 A$=LEFT$(B$,3)+MID$(C$,2,2)+RIGHT$(D$,1)
+2060 ON X GOTO 100,200,300:DATA 1,2,3,"FOUR"
+2070 POKE 53280,PEEK(53281) AND 15:SYS 64738
+2080 PRINT "LINE";I;TAB(10);CHR$(65+I AND 7)
+2090 IF A>B THEN GOSUB 100:REM COMPARE AND BRANCH
+2100 FOR J=1 TO 10:A(J)=J*J+SQR(J):NEXT J
+2110 A$=LEFT$(B$,3)+MID$(C$,2,2)+RIGHT$(D$,1)
+2120 ON X GOTO 100,200,300:DATA 1,2,3,"FOUR"
+2130 POKE 53280,PEEK(53281) AND 15:SYS 64738
+2140 PRINT "LINE";I;TAB(10);CHR$(65+I AND 7)
+2150 IF A>B THEN GOSUB 100:REM COMPARE AND BRANCH
+2160 FOR J=1 TO 10:A(J)=J*J+SQR(J):NEXT J
+2170 A$=LEFT$(B$,3)+MID$(C$,2,2)+RIGHT$(D$,1)
+2180 ON X GOTO 100,200,300:DATA 1,2,3,"FOUR"
+2190 POKE 53280,PEEK(53281) AND 15:SYS 64738
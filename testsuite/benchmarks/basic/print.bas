@@ -0,0 +1,35 @@
+#
+# Screen output - PRINT of string literals and variables, with scrolling
+#
+10 A$="VARIABLE":B$="CONTENT"
+20 PRINT "LINE OF OUTPUT, SCROLLING THE SCREEN":PRINT A$+" "+B$
+30 PRINT "LINE OF OUTPUT, SCROLLING THE SCREEN":PRINT A$+" "+B$
+40 PRINT "LINE OF OUTPUT, SCROLLING THE SCREEN":PRINT A$+" "+B$
+50 PRINT "LINE OF OUTPUT, SCROLLING THE SCREEN":PRINT A$+" "+B$
+60 PRINT "LINE OF OUTPUT, SCROLLING THE SCREEN":PRINT A$+" "+B$
+70 PRINT "LINE OF OUTPUT, SCROLLING THE SCREEN":PRINT A$+" "+B$
+80 PRINT "LINE OF OUTPUT, SCROLLING THE SCREEN":PRINT A$+" "+B$
+90 PRINT "LINE OF OUTPUT, SCROLLING THE SCREEN":PRINT A$+" "+B$
+100 PRINT "LINE OF OUTPUT, SCROLLING THE SCREEN":PRINT A$+" "+B$
+110 PRINT "LINE OF OUTPUT, SCROLLING THE SCREEN":PRINT A$+" "+B$
+120 PRINT "LINE OF OUTPUT, SCROLLING THE SCREEN":PRINT A$+" "+B$
+130 PRINT "LINE OF OUTPUT, SCROLLING THE SCREEN":PRINT A$+" "+B$
+140 PRINT "LINE OF OUTPUT, SCROLLING THE SCREEN":PRINT A$+" "+B$
+150 PRINT "LINE OF OUTPUT, SCROLLING THE SCREEN":PRINT A$+" "+B$
+160 PRINT "LINE OF OUTPUT, SCROLLING THE SCREEN":PRINT A$+" "+B$
+170 PRINT "LINE OF OUTPUT, SCROLLING THE SCREEN":PRINT A$+" "+B$
+180 PRINT "LINE OF OUTPUT, SCROLLING THE SCREEN":PRINT A$+" "+B$
+190 PRINT "LINE OF OUTPUT, SCROLLING THE SCREEN":PRINT A$+" "+B$
+200 PRINT "LINE OF OUTPUT, SCROLLING THE SCREEN":PRINT A$+" "+B$
+210 PRINT "LINE OF OUTPUT, SCROLLING THE SCREEN":PRINT A$+" "+B$
+220 PRINT "LINE OF OUTPUT, SCROLLING THE SCREEN":PRINT A$+" "+B$
+230 PRINT "LINE OF OUTPUT, SCROLLING THE SCREEN":PRINT A$+" "+B$
+240 PRINT "LINE OF OUTPUT, SCROLLING THE SCREEN":PRINT A$+" "+B$
+250 PRINT "LINE OF OUTPUT, SCROLLING THE SCREEN":PRINT A$+" "+B$
+260 PRINT "LINE OF OUTPUT, SCROLLING THE SCREEN":PRINT A$+" "+B$
+270 PRINT "LINE OF OUTPUT, SCROLLING THE SCREEN":PRINT A$+" "+B$
+280 PRINT "LINE OF OUTPUT, SCROLLING THE SCREEN":PRINT A$+" "+B$
+290 PRINT "LINE OF OUTPUT, SCROLLING THE SCREEN":PRINT A$+" "+B$
+300 PRINT "LINE OF OUTPUT, SCROLLING THE SCREEN":PRINT A$+" "+B$
+310 PRINT "LINE OF OUTPUT, SCROLLING THE SCREEN":PRINT A$+" "+B$
+320 END
@@ -0,0 +1,56 @@
+#
+# String handling - concatenation of long strings, every statement allocates
+# a new string (garbage collection is exercised separately, by gc_stress)
+#
+10 A$="0123456789":A$=A$+A$:A$=A$+A$:A$=A$+A$
+20 B$=A$+"ABCDEFGHIJKLMNOP":C$=B$+A$:B$=C$+"QRSTUVWXYZ"
+30 B$=A$+"ABCDEFGHIJKLMNOP":C$=B$+A$:B$=C$+"QRSTUVWXYZ"
+40 B$=A$+"ABCDEFGHIJKLMNOP":C$=B$+A$:B$=C$+"QRSTUVWXYZ"
+50 B$=A$+"ABCDEFGHIJKLMNOP":C$=B$+A$:B$=C$+"QRSTUVWXYZ"
+60 B$=A$+"ABCDEFGHIJKLMNOP":C$=B$+A$:B$=C$+"QRSTUVWXYZ"
+70 B$=A$+"ABCDEFGHIJKLMNOP":C$=B$+A$:B$=C$+"QRSTUVWXYZ"
+80 B$=A$+"ABCDEFGHIJKLMNOP":C$=B$+A$:B$=C$+"QRSTUVWXYZ"
+90 B$=A$+"ABCDEFGHIJKLMNOP":C$=B$+A$:B$=C$+"QRSTUVWXYZ"
+100 B$=A$+"ABCDEFGHIJKLMNOP":C$=B$+A$:B$=C$+"QRSTUVWXYZ"
+110 B$=A$+"ABCDEFGHIJKLMNOP":C$=B$+A$:B$=C$+"QRSTUVWXYZ"
+120 B$=A$+"ABCDEFGHIJKLMNOP":C$=B$+A$:B$=C$+"QRSTUVWXYZ"
+130 B$=A$+"ABCDEFGHIJKLMNOP":C$=B$+A$:B$=C$+"QRSTUVWXYZ"
+140 B$=A$+"ABCDEFGHIJKLMNOP":C$=B$+A$:B$=C$+"QRSTUVWXYZ"
+150 B$=A$+"ABCDEFGHIJKLMNOP":C$=B$+A$:B$=C$+"QRSTUVWXYZ"
+160 B$=A$+"ABCDEFGHIJKLMNOP":C$=B$+A$:B$=C$+"QRSTUVWXYZ"
+170 B$=A$+"ABCDEFGHIJKLMNOP":C$=B$+A$:B$=C$+"QRSTUVWXYZ"
+180 B$=A$+"ABCDEFGHIJKLMNOP":C$=B$+A$:B$=C$+"QRSTUVWXYZ"
+190 B$=A$+"ABCDEFGHIJKLMNOP":C$=B$+A$:B$=C$+"QRSTUVWXYZ"
+200 B$=A$+"ABCDEFGHIJKLMNOP":C$=B$+A$:B$=C$+"QRSTUVWXYZ"
+210 B$=A$+"ABCDEFGHIJKLMNOP":C$=B$+A$:B$=C$+"QRSTUVWXYZ"
+220 B$=A$+"ABCDEFGHIJKLMNOP":C$=B$+A$:B$=C$+"QRSTUVWXYZ"
+230 B$=A$+"ABCDEFGHIJKLMNOP":C$=B$+A$:B$=C$+"QRSTUVWXYZ"
+240 B$=A$+"ABCDEFGHIJKLMNOP":C$=B$+A$:B$=C$+"QRSTUVWXYZ"
+250 B$=A$+"ABCDEFGHIJKLMNOP":C$=B$+A$:B$=C$+"QRSTUVWXYZ"
+260 B$=A$+"ABCDEFGHIJKLMNOP":C$=B$+A$:B$=C$+"QRSTUVWXYZ"
+270 B$=A$+"ABCDEFGHIJKLMNOP":C$=B$+A$:B$=C$+"QRSTUVWXYZ"
+280 B$=A$+"ABCDEFGHIJKLMNOP":C$=B$+A$:B$=C$+"QRSTUVWXYZ"
+290 B$=A$+"ABCDEFGHIJKLMNOP":C$=B$+A$:B$=C$+"QRSTUVWXYZ"
+300 B$=A$+"ABCDEFGHIJKLMNOP":C$=B$+A$:B$=C$+"QRSTUVWXYZ"
+310 B$=A$+"ABCDEFGHIJKLMNOP":C$=B$+A$:B$=C$+"QRSTUVWXYZ"
+320 B$=A$+"ABCDEFGHIJKLMNOP":C$=B$+A$:B$=C$+"QRSTUVWXYZ"
+330 B$=A$+"ABCDEFGHIJKLMNOP":C$=B$+A$:B$=C$+"QRSTUVWXYZ"
+340 B$=A$+"ABCDEFGHIJKLMNOP":C$=B$+A$:B$=C$+"QRSTUVWXYZ"
+350 B$=A$+"ABCDEFGHIJKLMNOP":C$=B$+A$:B$=C$+"QRSTUVWXYZ"
+360 B$=A$+"ABCDEFGHIJKLMNOP":C$=B$+A$:B$=C$+"QRSTUVWXYZ"
+370 B$=A$+"ABCDEFGHIJKLMNOP":C$=B$+A$:B$=C$+"QRSTUVWXYZ"
+380 B$=A$+"ABCDEFGHIJKLMNOP":C$=B$+A$:B$=C$+"QRSTUVWXYZ"
+390 B$=A$+"ABCDEFGHIJKLMNOP":C$=B$+A$:B$=C$+"QRSTUVWXYZ"
+400 B$=A$+"ABCDEFGHIJKLMNOP":C$=B$+A$:B$=C$+"QRSTUVWXYZ"
+410 B$=A$+"ABCDEFGHIJKLMNOP":C$=B$+A$:B$=C$+"QRSTUVWXYZ"
+420 B$=A$+"ABCDEFGHIJKLMNOP":C$=B$+A$:B$=C$+"QRSTUVWXYZ"
+430 B$=A$+"ABCDEFGHIJKLMNOP":C$=B$+A$:B$=C$+"QRSTUVWXYZ"
+440 B$=A$+"ABCDEFGHIJKLMNOP":C$=B$+A$:B$=C$+"QRSTUVWXYZ"
+450 B$=A$+"ABCDEFGHIJKLMNOP":C$=B$+A$:B$=C$+"QRSTUVWXYZ"
+460 B$=A$+"ABCDEFGHIJKLMNOP":C$=B$+A$:B$=C$+"QRSTUVWXYZ"
+470 B$=A$+"ABCDEFGHIJKLMNOP":C$=B$+A$:B$=C$+"QRSTUVWXYZ"
+480 B$=A$+"ABCDEFGHIJKLMNOP":C$=B$+A$:B$=C$+"QRSTUVWXYZ"
+490 B$=A$+"ABCDEFGHIJKLMNOP":C$=B$+A$:B$=C$+"QRSTUVWXYZ"
+500 B$=A$+"ABCDEFGHIJKLMNOP":C$=B$+A$:B$=C$+"QRSTUVWXYZ"
+510 B$=A$+"ABCDEFGHIJKLMNOP":C$=B$+A$:B$=C$+"QRSTUVWXYZ"
+520 END
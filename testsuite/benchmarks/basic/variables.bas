@@ -0,0 +1,70 @@
+#
+# Variable lookup with many variables - the most used ones are created last,
+# so that each lookup walks the whole variable table
+#
+10 A0$="0":A1$="1":A2$="2":A3$="3":A4$="4":A5$="5":A6$="6":A7$="7":A8$="8":A9$="9"
+20 B0$="0":B1$="1":B2$="2":B3$="3":B4$="4":B5$="5":B6$="6":B7$="7":B8$="8":B9$="9"
+30 C0$="0":C1$="1":C2$="2":C3$="3":C4$="4":C5$="5":C6$="6":C7$="7":C8$="8":C9$="9"
+40 D0$="0":D1$="1":D2$="2":D3$="3":D4$="4":D5$="5":D6$="6":D7$="7":D8$="8":D9$="9"
+50 E0$="0":E1$="1":E2$="2":E3$="3":E4$="4":E5$="5":E6$="6":E7$="7":E8$="8":E9$="9"
+100 Z$=E9$:Y$=E8$:X$=E7$+D9$
+110 Z$=E9$:Y$=E8$:X$=E7$+D9$
+120 Z$=E9$:Y$=E8$:X$=E7$+D9$
+130 Z$=E9$:Y$=E8$:X$=E7$+D9$
+140 Z$=E9$:Y$=E8$:X$=E7$+D9$
+150 Z$=E9$:Y$=E8$:X$=E7$+D9$
+160 Z$=E9$:Y$=E8$:X$=E7$+D9$
+170 Z$=E9$:Y$=E8$:X$=E7$+D9$
+180 Z$=E9$:Y$=E8$:X$=E7$+D9$
+190 Z$=E9$:Y$=E8$:X$=E7$+D9$
+200 Z$=E9$:Y$=E8$:X$=E7$+D9$
+210 Z$=E9$:Y$=E8$:X$=E7$+D9$
+220 Z$=E9$:Y$=E8$:X$=E7$+D9$
+230 Z$=E9$:Y$=E8$:X$=E7$+D9$
+240 Z$=E9$:Y$=E8$:X$=E7$+D9$
+250 Z$=E9$:Y$=E8$:X$=E7$+D9$
+260 Z$=E9$:Y$=E8$:X$=E7$+D9$
+270 Z$=E9$:Y$=E8$:X$=E7$+D9$
+280 Z$=E9$:Y$=E8$:X$=E7$+D9$
+290 Z$=E9$:Y$=E8$:X$=E7$+D9$
+300 Z$=E9$:Y$=E8$:X$=E7$+D9$
+310 Z$=E9$:Y$=E8$:X$=E7$+D9$
+320 Z$=E9$:Y$=E8$:X$=E7$+D9$
+330 Z$=E9$:Y$=E8$:X$=E7$+D9$
+340 Z$=E9$:Y$=E8$:X$=E7$+D9$
+350 Z$=E9$:Y$=E8$:X$=E7$+D9$
+360 Z$=E9$:Y$=E8$:X$=E7$+D9$
+370 Z$=E9$:Y$=E8$:X$=E7$+D9$
+380 Z$=E9$:Y$=E8$:X$=E7$+D9$
+390 Z$=E9$:Y$=E8$:X$=E7$+D9$
+400 Z$=E9$:Y$=E8$:X$=E7$+D9$
+410 Z$=E9$:Y$=E8$:X$=E7$+D9$
+420 Z$=E9$:Y$=E8$:X$=E7$+D9$
+430 Z$=E9$:Y$=E8$:X$=E7$+D9$
+440 Z$=E9$:Y$=E8$:X$=E7$+D9$
+450 Z$=E9$:Y$=E8$:X$=E7$+D9$
+460 Z$=E9$:Y$=E8$:X$=E7$+D9$
+470 Z$=E9$:Y$=E8$:X$=E7$+D9$
+480 Z$=E9$:Y$=E8$:X$=E7$+D9$
+490 Z$=E9$:Y$=E8$:X$=E7$+D9$
+500 Z$=E9$:Y$=E8$:X$=E7$+D9$
+510 Z$=E9$:Y$=E8$:X$=E7$+D9$
+520 Z$=E9$:Y$=E8$:X$=E7$+D9$
+530 Z$=E9$:Y$=E8$:X$=E7$+D9$
+540 Z$=E9$:Y$=E8$:X$=E7$+D9$
+550 Z$=E9$:Y$=E8$:X$=E7$+D9$
+560 Z$=E9$:Y$=E8$:X$=E7$+D9$
+570 Z$=E9$:Y$=E8$:X$=E7$+D9$
+580 Z$=E9$:Y$=E8$:X$=E7$+D9$
+590 Z$=E9$:Y$=E8$:X$=E7$+D9$
+600 Z$=E9$:Y$=E8$:X$=E7$+D9$
+610 Z$=E9$:Y$=E8$:X$=E7$+D9$
+620 Z$=E9$:Y$=E8$:X$=E7$+D9$
+630 Z$=E9$:Y$=E8$:X$=E7$+D9$
+640 Z$=E9$:Y$=E8$:X$=E7$+D9$
+650 Z$=E9$:Y$=E8$:X$=E7$+D9$
+660 Z$=E9$:Y$=E8$:X$=E7$+D9$
+670 Z$=E9$:Y$=E8$:X$=E7$+D9$
+680 Z$=E9$:Y$=E8$:X$=E7$+D9$
+690 Z$=E9$:Y$=E8$:X$=E7$+D9$
+700 END
@@ -0,0 +1,347 @@
+//
+// BASIC V2 programs for the headless machine model - tokenizes plain text
+// listings, injects them into the emulated RAM and runs them
+//
+
+#ifndef BASIC_PROGRAM_H
+#define BASIC_PROGRAM_H
+
+#include "headless_c64.h"
+
+#include <algorithm>
+#include <fstream>
+#include <vector>
+
+// Memory locations, compatible with the original ROMs
+
+const uint16_t ADDR_VARTAB = 0x2D;
+const uint16_t ADDR_ARYTAB = 0x2F;
+const uint16_t ADDR_STREND = 0x31;
+const uint16_t ADDR_FRETOP = 0x33;
+const uint16_t ADDR_MEMSIZ = 0x37;
+const uint16_t ADDR_FAC1   = 0x61;       // exponent, 4 mantissa bytes, sign
+const uint16_t ADDR_FAC2   = 0x69;
+const uint16_t ADDR_ARISGN = 0x6F;
+const uint16_t ADDR_FACOV  = 0x70;
+const uint16_t ADDR_EAL    = 0xAE;       // end address of the loaded data
+const uint16_t ADDR_STAL   = 0xC1;       // start address of the loaded data
+const uint16_t ADDR_STUB   = 0x0334;     // cassette buffer, free for the tools' machine code
+
+//
+// ROM set named on the command line - either '<name>' (ROMs 'basic_<name>.rom' and
+// 'kernal_<name>.rom' from the given directory), or '<name>:<BASIC ROM>:<KERNAL ROM>'
+//
+
+typedef struct
+{
+    std::string name;
+    std::string basicFile;
+    std::string kernalFile;
+
+} RomTarget;
+
+inline bool parseRomTarget(const std::string &target, const std::string &inDir, RomTarget &result)
+{
+    const auto sep1 = target.find(':');
+    const auto sep2 = (sep1 == std::string::npos) ? sep1 : target.find(':', sep1 + 1);
+
+    if (sep1 == std::string::npos)
+    {
+        result = { target, inDir + "/basic_" + target + ".rom", inDir + "/kernal_" + target + ".rom" };
+        return true;
+    }
+
+    if (sep2 == std::string::npos) return false;
+
+    result = { target.substr(0, sep1), target.substr(sep1 + 1, sep2 - sep1 - 1), target.substr(sep2 + 1) };
+    return true;
+}
+
+//
+// BASIC programs
+//
+
+class BasicProgram
+{
+public:
+
+    // Listing - one '<line number> <statements>' per line, empty lines and lines starting
+    // with '#' are skipped; '# command: <text>' sets the command starting the program
+
+    bool loadListing(const std::string &fileName, std::string &error)
+    {
+        std::ifstream file(fileName);
+        if (!file.good()) { error = "unable to open '" + fileName + "'"; return false; }
+
+        std::vector<std::string> lines;
+        std::string line;
+        while (std::getline(file, line))
+        {
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+
+            if (line.compare(0, 10, "# command:") == 0)
+            {
+                command = line.substr(10);
+                command.erase(0, command.find_first_not_of(' '));
+                continue;
+            }
+
+            if (line.empty() || line[0] == '#') continue;
+            lines.push_back(line);
+        }
+
+        return tokenize(lines, error);
+    }
+
+    bool tokenize(const std::vector<std::string> &lines, std::string &error)
+    {
+        tokenized.clear();
+        unsigned prevNumber = 0;
+
+        for (const auto &line : lines)
+        {
+            size_t pos = 0;
+            while (pos < line.size() && line[pos] == ' ') pos++;
+
+            if (pos >= line.size() || !isdigit(line[pos])) { error = "no line number: '" + line + "'"; return false; }
+
+            unsigned number = 0;
+            while (pos < line.size() && isdigit(line[pos])) number = number * 10 + (line[pos++] - '0');
+            while (pos < line.size() && line[pos] == ' ') pos++;
+
+            if (number > 63999 || (!tokenized.empty() && number <= prevNumber))
+            {
+                error = "bad line number: '" + line + "'";
+                return false;
+            }
+            prevNumber = number;
+
+            // Link is filled in by 'inject', once the load address is known
+
+            tokenized.push_back(0);
+            tokenized.push_back(0);
+            tokenized.push_back(number & 0xFF);
+            tokenized.push_back(number >> 8);
+            crunch(line.substr(pos));
+            tokenized.push_back(0);
+        }
+
+        return true;
+    }
+
+    // Place the program in memory the way LOAD does; returns the end address (VARTAB)
+
+    uint16_t inject(C64Machine &machine, uint16_t address = 0x0801) const
+    {
+        machine.poke(address - 1, 0);
+
+        size_t   pos     = 0;
+        uint16_t current = address;
+        while (pos < tokenized.size())
+        {
+            size_t lineEnd = pos + 4;
+            while (tokenized[lineEnd] != 0) lineEnd++;
+
+            const uint16_t next = current + (lineEnd + 1 - pos);
+            machine.poke(current,     next & 0xFF);
+            machine.poke(current + 1, next >> 8);
+            for (size_t idx = pos + 2; idx <= lineEnd; idx++) machine.poke(current + (idx - pos), tokenized[idx]);
+
+            pos     = lineEnd + 1;
+            current = next;
+        }
+
+        machine.poke(current++, 0);
+        machine.poke(current++, 0);
+
+        // TXTTAB, then VARTAB / ARYTAB / STREND - as after LOAD, before CLR
+
+        machine.poke(0x2B, address & 0xFF);
+        machine.poke(0x2C, address >> 8);
+        for (uint16_t zp = 0x2D; zp <= 0x31; zp += 2)
+        {
+            machine.poke(zp,     current & 0xFF);
+            machine.poke(zp + 1, current >> 8);
+        }
+
+        return current;
+    }
+
+    size_t size() const { return tokenized.size() + 2; }
+
+    std::string command = "RUN";
+
+private:
+
+    // Keywords, in token order - the first one matching wins, as in the original ROM
+
+    static const std::vector<std::string> &keywords()
+    {
+        static const std::vector<std::string> KEYWORDS_V2 =
+        {
+            "END",   "FOR",   "NEXT",  "DATA",  "INPUT#", "INPUT", "DIM",  "READ",
+            "LET",   "GOTO",  "RUN",   "IF",    "RESTORE", "GOSUB", "RETURN", "REM",
+            "STOP",  "ON",    "WAIT",  "LOAD",  "SAVE",  "VERIFY", "DEF",  "POKE",
+            "PRINT#", "PRINT", "CONT", "LIST",  "CLR",   "CMD",   "SYS",   "OPEN",
+            "CLOSE", "GET",   "NEW",   "TAB(",  "TO",    "FN",    "SPC(",  "THEN",
+            "NOT",   "STEP",  "+",     "-",     "*",     "/",     "^",     "AND",
+            "OR",    ">",     "=",     "<",     "SGN",   "INT",   "ABS",   "USR",
+            "FRE",   "POS",   "SQR",   "RND",   "LOG",   "EXP",   "COS",   "SIN",
+            "TAN",   "ATN",   "PEEK",  "LEN",   "STR$",  "VAL",   "ASC",   "CHR$",
+            "LEFT$", "RIGHT$", "MID$", "GO",
+        };
+
+        return KEYWORDS_V2;
+    }
+
+    void crunch(const std::string &text)
+    {
+        const uint8_t TOKEN_DATA = 0x83;
+        const uint8_t TOKEN_REM  = 0x8F;
+
+        bool inQuotes = false;
+        bool inData   = false;
+        bool inRem    = false;
+
+        size_t pos = 0;
+        while (pos < text.size())
+        {
+            const char c = text[pos];
+
+            if (c == '"') inQuotes = !inQuotes;
+            if (c == ':' && !inQuotes) inData = false;
+
+            if (inQuotes || inData || inRem || c == ' ' || c == '"')
+            {
+                tokenized.push_back(uint8_t(c));
+                pos++;
+                continue;
+            }
+
+            if (c == '?')
+            {
+                tokenized.push_back(0x99);  // PRINT
+                pos++;
+                continue;
+            }
+
+            uint8_t token = 0;
+            for (size_t idx = 0; idx < keywords().size(); idx++)
+            {
+                if (text.compare(pos, keywords()[idx].size(), keywords()[idx]) != 0) continue;
+
+                token = uint8_t(0x80 + idx);
+                pos  += keywords()[idx].size();
+                break;
+            }
+
+            if (token == 0)
+            {
+                tokenized.push_back(uint8_t(c));
+                pos++;
+                continue;
+            }
+
+            tokenized.push_back(token);
+            if (token == TOKEN_DATA) inData = true;
+            if (token == TOKEN_REM)  inRem  = true;
+        }
+    }
+
+    std::vector<uint8_t> tokenized;   // lines with empty links, without the terminating 0x0000
+};
+
+//
+// Screen based interaction with the BASIC interpreter
+//
+
+class BasicSession
+{
+public:
+
+    BasicSession(C64Machine &machine) : machine(machine) {}
+
+    // Resets the machine (ROMs have to be loaded already) and runs until the READY. prompt
+
+    bool boot()
+    {
+        machine.reset();
+        if (waitReady(MAX_BOOT_SECONDS) && !failed()) return true;
+
+        error = "READY. prompt not reached after boot (" + (error.empty() ? std::string("timeout") : error) + ")";
+        return false;
+    }
+
+    // Runs until 'READY.' is visible, or until an error message appears; returns false on timeout
+
+    bool waitReady(double maxSeconds)
+    {
+        const uint64_t maxCycles = machine.cycles + uint64_t(maxSeconds * machine.clockHz());
+
+        error.clear();
+        while (machine.cycles < maxCycles && !machine.cpu.jammed)
+        {
+            machine.run(POLL_CYCLES);
+
+            if (screenContains(STR_ERROR))
+            {
+                // Report the line with the error message
+
+                const std::string text = machine.screenText();
+                const auto found = text.find(" ERROR");
+                const auto start = text.rfind('\n', found);
+                error = text.substr(start + 1, text.find('\n', found) - start - 1);
+                return true;
+            }
+
+            if (screenContains(STR_READY)) return true;
+        }
+
+        error = machine.cpu.jammed ? "CPU jammed" : "timeout";
+        return false;
+    }
+
+    // Clears the screen memory - so that the next 'READY.' comes from the command typed later
+
+    void clearScreen()
+    {
+        for (uint16_t idx = 0; idx < 1000; idx++) machine.poke(machine.screenAddress() + idx, 0x20);
+    }
+
+    // Types a command and runs until the interpreter is ready again; returns the cycles taken
+
+    uint64_t execute(const std::string &command, double maxSeconds)
+    {
+        clearScreen();
+        machine.typeText(command + "\n");
+
+        const uint64_t start = machine.cycles;
+        waitReady(maxSeconds);
+        return machine.cycles - start;
+    }
+
+    bool failed() const { return !error.empty(); }
+
+    std::string error;
+
+    static const unsigned POLL_CYCLES = 32;    // resolution of the READY. detection
+
+    static constexpr double MAX_BOOT_SECONDS = 10.0;
+
+private:
+
+    bool screenContains(const std::string &codes) const
+    {
+        const char *screen = (const char *) &machine.ram[machine.screenAddress()];
+        return std::search(screen, screen + 1000, codes.begin(), codes.end()) != screen + 1000;
+    }
+
+    // 'READY.' and ' ERROR' in screen codes
+
+    const std::string STR_READY = { 0x12, 0x05, 0x01, 0x04, 0x19, 0x2E };
+    const std::string STR_ERROR = { 0x20, 0x05, 0x12, 0x12, 0x0F, 0x12 };
+
+    C64Machine &machine;
+};
+
+#endif // BASIC_PROGRAM_H
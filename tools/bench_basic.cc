@@ -0,0 +1,230 @@
+//
+// Utility to benchmark the BASIC interpreter - runs a set of BASIC programs
+// on a headless machine model, for each ROM target, and measures the time
+// each of them takes
+//
+
+#include "common.h"
+#include "basic_program.h"
+#include "bench_results.h"
+#include "headless_c64.h"
+
+#include <dirent.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <list>
+
+//
+// Command line settings
+//
+
+std::string CMD_inDir   = "./build";
+std::string CMD_prgDir  = "./testsuite/benchmarks/basic";
+std::string CMD_bchFile = "";
+std::string CMD_basFile = "";
+bool        CMD_ntsc    = false;
+
+std::list<std::string> CMD_targetList;
+
+const double MAX_BENCH_SECONDS = 120.0;
+
+//
+// Common helper functions
+//
+
+void printUsage()
+{
+    std::cout << "\n" <<
+        "usage: bench_basic [-i <input (build) directory>] [-d <benchmark programs directory>]" << "\n" <<
+        "                   [-b <results file>] [-p <baseline file>] [-n] <target list>" << "\n\n" <<
+        "  target is either a name (ROMs 'basic_<name>.rom', 'kernal_<name>.rom' are taken from" << "\n" <<
+        "  the input directory), or '<name>:<BASIC ROM>:<KERNAL ROM>'" << "\n\n" <<
+        "  -d  directory with '*.bas' program listings, see 'basic_program.h' for the format" << "\n" <<
+        "  -n  NTSC machine (default is PAL)" << "\n\n";
+}
+
+void parseCommandLine(int argc, char **argv)
+{
+    int opt;
+
+    while ((opt = getopt(argc, argv, "i:d:b:p:n")) != -1)
+    {
+        switch(opt)
+        {
+            case 'i': CMD_inDir   = optarg; break;
+            case 'd': CMD_prgDir  = optarg; break;
+            case 'b': CMD_bchFile = optarg; break;
+            case 'p': CMD_basFile = optarg; break;
+            case 'n': CMD_ntsc    = true;   break;
+            default: printUsage(); ERROR();
+        }
+    }
+
+    for (int idx = optind; idx < argc; idx++)
+    {
+        CMD_targetList.push_back(argv[idx]);
+    }
+
+    if (CMD_targetList.empty()) { printUsage(); ERROR("empty target list"); }
+}
+
+void printBanner()
+{
+    printBannerLineTop();
+    std::cout << "// Benchmarking BASIC interpreter" << "\n";
+    printBannerLineBottom();
+}
+
+//
+// Benchmark programs
+//
+
+typedef struct
+{
+    std::string  name;
+    BasicProgram program;
+
+} Benchmark;
+
+std::vector<Benchmark> GLOBAL_benchmarks;
+
+void loadBenchmarks()
+{
+    std::vector<std::string> fileNames;
+
+    DIR *dir = opendir(CMD_prgDir.c_str());
+    if (dir == nullptr) ERROR(std::string("unable to read directory '") + CMD_prgDir + "'");
+
+    struct dirent *dirEntry;
+    while ((dirEntry = readdir(dir)) != nullptr)
+    {
+        const std::string fileName = dirEntry->d_name;
+        if (fileName.size() > 4 && fileName.compare(fileName.size() - 4, 4, ".bas") == 0)
+        {
+            fileNames.push_back(fileName);
+        }
+    }
+    closedir(dir);
+
+    std::sort(fileNames.begin(), fileNames.end());
+    for (const auto &fileName : fileNames)
+    {
+        Benchmark benchmark;
+        std::string error;
+
+        benchmark.name = fileName.substr(0, fileName.size() - 4);
+        if (!benchmark.program.loadListing(CMD_prgDir + DIR_SEPARATOR + fileName, error))
+        {
+            ERROR(std::string("benchmark '") + benchmark.name + "': " + error);
+        }
+
+        GLOBAL_benchmarks.push_back(std::move(benchmark));
+    }
+
+    if (GLOBAL_benchmarks.empty()) ERROR(std::string("no benchmark programs in '") + CMD_prgDir + "'");
+}
+
+//
+// Measurement
+//
+
+typedef struct
+{
+    bool        ok;
+    uint64_t    cycles;
+    double      clockHz;
+    std::string error;
+
+} BenchResult;
+
+BenchResult runProgram(const std::string &basicFile, const std::string &kernalFile, const BasicProgram &program)
+{
+    C64Machine   machine(CMD_ntsc ? C64Machine::VideoSystem::NTSC : C64Machine::VideoSystem::PAL);
+    BasicSession session(machine);
+
+    std::string error;
+    if (!machine.loadRoms(basicFile, kernalFile, error)) ERROR(error);
+    if (!session.boot()) return { false, 0, 0.0, session.error };
+
+    program.inject(machine);
+
+    const uint64_t cycles = session.execute(program.command, MAX_BENCH_SECONDS);
+    return { !session.failed(), cycles, machine.clockHz(), session.error };
+}
+
+//
+// Main function
+//
+
+int main(int argc, char **argv)
+{
+    parseCommandLine(argc, argv);
+    printBanner();
+    loadBenchmarks();
+
+    BenchResults results;
+
+    // Command typing and the interpreter main loop are measured too - calibrate with an empty program
+
+    BasicProgram emptyProgram;
+    std::string  dummy;
+    emptyProgram.tokenize({ "10 END" }, dummy);
+
+    for (const auto &target : CMD_targetList)
+    {
+        RomTarget romTarget;
+        if (!parseRomTarget(target, CMD_inDir, romTarget))
+        {
+            printUsage();
+            ERROR(std::string("malformed target '") + target + "'");
+        }
+
+        const std::string &name       = romTarget.name;
+        const std::string &basicFile  = romTarget.basicFile;
+        const std::string &kernalFile = romTarget.kernalFile;
+
+        std::cout << "Target '" << name << "', " << (CMD_ntsc ? "NTSC" : "PAL") << "\n\n";
+
+        const BenchResult overhead = runProgram(basicFile, kernalFile, emptyProgram);
+        if (!overhead.ok)
+        {
+            std::cout << "    unable to run empty program: " << overhead.error << "\n\n";
+        }
+
+        for (const auto &benchmark : GLOBAL_benchmarks)
+        {
+            const BenchResult result = runProgram(basicFile, kernalFile, benchmark.program);
+            const std::string key    = name + "." + benchmark.name + ".cycles";
+
+            char buf[256];
+            if (!result.ok)
+            {
+                snprintf(buf, sizeof(buf), "    %-20s FAILED: %s\n", benchmark.name.c_str(), result.error.c_str());
+                results.set(key, UINT32_MAX);
+            }
+            else
+            {
+                const uint64_t net = result.cycles - std::min(result.cycles, overhead.ok ? overhead.cycles : 0);
+                snprintf(buf, sizeof(buf), "    %-20s %12llu cycles %10.2f ms   (%s, %u bytes)\n",
+                         benchmark.name.c_str(), (unsigned long long) net, net * 1000.0 / result.clockHz,
+                         benchmark.program.command.c_str(), unsigned(benchmark.program.size()));
+                results.set(key, net);
+            }
+            std::cout << buf;
+        }
+        std::cout << "\n";
+    }
+
+    // Save and check the results
+
+    std::string error;
+    if (!results.saveAndCompare(CMD_bchFile, CMD_basFile,
+                                "bench_basic results, format: <target>.<benchmark>.cycles <value>",
+                                "BASIC performance", error))
+    {
+        ERROR(error);
+    }
+
+    return 0;
+}
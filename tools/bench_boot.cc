@@ -0,0 +1,264 @@
+//
+// Utility to measure the cold start time - from the reset vector
+// to the READY. prompt - of the ROMs, on a headless machine model
+//
+
+#include "common.h"
+#include "basic_program.h"
+#include "bench_results.h"
+#include "headless_c64.h"
+#include "symbols.h"
+
+#include <unistd.h>
+
+#include <cstdio>
+#include <list>
+
+//
+// Command line settings
+//
+
+std::string CMD_inDir   = "./build";
+std::string CMD_bchFile = "";
+std::string CMD_basFile = "";
+
+std::list<std::string> CMD_targetList;
+
+//
+// Boot milestones - top level initialization routines, in the order they are
+// normally called; the time between two consecutive milestones is attributed
+// to the earlier one. Addresses are taken from the symbol files, with KERNAL
+// jump table / vector based fallbacks when symbols are not available.
+//
+
+const uint16_t FALLBACK_NONE        = 0x0000;
+const uint16_t FALLBACK_RESET       = 0x0001;   // reset vector
+const uint16_t FALLBACK_BASIC_COLD  = 0x0002;   // BASIC cold start vector
+
+const std::vector<std::pair<std::string, uint16_t>> BOOT_MILESTONES =
+{
+    { "hw_entry_reset",   FALLBACK_RESET      },
+    { "cartridge_check",  FALLBACK_NONE       },
+    { "IOINIT",           0xFF84              },
+    { "RAMTAS",           0xFF87              },
+    { "RESTOR",           0xFF8A              },
+    { "CINT",             0xFF81              },
+    { "basic_cold_start", FALLBACK_BASIC_COLD },
+    { "INITMSG",          FALLBACK_NONE       },
+    { "basic_warm_start", FALLBACK_NONE       },
+};
+
+//
+// Common helper functions
+//
+
+void printUsage()
+{
+    std::cout << "\n" <<
+        "usage: bench_boot [-i <input (build) directory>] [-b <results file>] [-p <baseline file>]" << "\n" <<
+        "                  <target list>" << "\n\n" <<
+        "  target is either a name (ROMs 'basic_<name>.rom', 'kernal_<name>.rom' and symbols" << "\n" <<
+        "  from 'target_<name>' are taken from the input directory), or '<name>:<BASIC ROM>:<KERNAL ROM>'" << "\n\n";
+}
+
+void parseCommandLine(int argc, char **argv)
+{
+    int opt;
+
+    while ((opt = getopt(argc, argv, "i:b:p:")) != -1)
+    {
+        switch(opt)
+        {
+            case 'i': CMD_inDir   = optarg; break;
+            case 'b': CMD_bchFile = optarg; break;
+            case 'p': CMD_basFile = optarg; break;
+            default: printUsage(); ERROR();
+        }
+    }
+
+    for (int idx = optind; idx < argc; idx++)
+    {
+        CMD_targetList.push_back(argv[idx]);
+    }
+
+    if (CMD_targetList.empty()) { printUsage(); ERROR("empty target list"); }
+}
+
+void printBanner()
+{
+    printBannerLineTop();
+    std::cout << "// Measuring ROM boot time" << "\n";
+    printBannerLineBottom();
+}
+
+std::string formatLine(const char *format, const std::string &str, uint64_t cycles, double ms)
+{
+    char buf[256];
+    snprintf(buf, sizeof(buf), format, str.c_str(), (unsigned long long) cycles, ms);
+    return buf;
+}
+
+//
+// Boot measurement
+//
+
+typedef struct
+{
+    bool     ready;
+    uint64_t cycles;
+    double   ms;
+
+    std::vector<std::pair<std::string, uint64_t>> phases;
+
+} BootResult;
+
+BootResult measureBoot(const std::string &basicFile, const std::string &kernalFile,
+                       const SymbolTable &symbols, C64Machine::VideoSystem videoSystem)
+{
+    C64Machine   machine(videoSystem);
+    BasicSession session(machine);
+
+    std::string error;
+    if (!machine.loadRoms(basicFile, kernalFile, error)) ERROR(error);
+
+    machine.reset();
+
+    // Resolve milestone addresses, trap on their first execution
+
+    std::map<uint16_t, std::string> milestones;
+    for (const auto &milestone : BOOT_MILESTONES)
+    {
+        uint16_t address = milestone.second;
+
+        if (!symbols.find(milestone.first, address))
+        {
+            if (address == FALLBACK_RESET)      address = machine.peek16(0xFFFC);
+            if (address == FALLBACK_BASIC_COLD) address = machine.peek16(0xA000);
+        }
+
+        if (address <= FALLBACK_BASIC_COLD || milestones.count(address) != 0) continue;
+
+        milestones[address] = milestone.first;
+        machine.setTrap(address);
+    }
+
+    std::vector<std::pair<uint64_t, std::string>> hits;
+
+    machine.trapHandler = [&](uint16_t pc) -> bool
+    {
+        hits.emplace_back(machine.cycles, milestones[pc]);
+        machine.setTrap(pc, false);  // only the first call matters
+        return true;
+    };
+
+    // Run until 'READY.' appears on the screen
+
+    BootResult result = { false, 0, 0.0, {} };
+
+    result.ready  = session.waitReady(BasicSession::MAX_BOOT_SECONDS) && !session.failed();
+    result.cycles = machine.cycles;
+    result.ms     = machine.cycles * 1000.0 / machine.clockHz();
+
+    // Time spent between the consecutive milestones
+
+    for (size_t idx = 0; idx < hits.size(); idx++)
+    {
+        const uint64_t end = (idx + 1 < hits.size()) ? hits[idx + 1].first : machine.cycles;
+        result.phases.emplace_back(hits[idx].second, end - hits[idx].first);
+    }
+
+    if (!hits.empty() && hits.front().first != 0)
+    {
+        result.phases.insert(result.phases.begin(), std::make_pair(std::string("(reset)"), hits.front().first));
+    }
+
+    return result;
+}
+
+//
+// Main function
+//
+
+int main(int argc, char **argv)
+{
+    parseCommandLine(argc, argv);
+    printBanner();
+
+    BenchResults results;
+
+    const std::vector<std::pair<std::string, C64Machine::VideoSystem>> VIDEO_SYSTEMS =
+    {
+        { "PAL",  C64Machine::VideoSystem::PAL  },
+        { "NTSC", C64Machine::VideoSystem::NTSC },
+    };
+
+    std::string summary = "    target                PAL cycles     PAL ms  NTSC cycles    NTSC ms\n";
+
+    for (const auto &target : CMD_targetList)
+    {
+        // Determine ROM files and symbol directory
+
+        RomTarget romTarget;
+        if (!parseRomTarget(target, CMD_inDir, romTarget))
+        {
+            printUsage();
+            ERROR(std::string("malformed target '") + target + "'");
+        }
+
+        const std::string &name = romTarget.name;
+
+        SymbolTable symbols;
+        symbols.loadDir(CMD_inDir + DIR_SEPARATOR + "target_" + name);
+
+        summary += formatLine("    %-20s", name, 0, 0);
+
+        for (const auto &videoSystem : VIDEO_SYSTEMS)
+        {
+            const BootResult result = measureBoot(romTarget.basicFile, romTarget.kernalFile, symbols, videoSystem.second);
+            const double     cyclesToMs = result.cycles ? result.ms / result.cycles : 0.0;
+            const std::string keyBase   = name + "." + videoSystem.first + ".";
+
+            std::cout << "Target '" << name << "', " << videoSystem.first << ": ";
+            if (!result.ready)
+            {
+                std::cout << "READY. prompt not reached after " << result.cycles << " cycles\n\n";
+                summary += "           -          -";
+                results.set(keyBase + "boot.cycles", UINT32_MAX);
+                continue;
+            }
+
+            std::cout << formatLine("%s%llu cycles, %.2f ms", "", result.cycles, result.ms) <<
+                         (symbols.empty() ? " (no symbols, using KERNAL jump table)" : "") << "\n\n";
+
+            for (const auto &phase : result.phases)
+            {
+                std::cout << formatLine("    %-24s %10llu cycles %10.2f ms\n", phase.first, phase.second,
+                                        phase.second * cyclesToMs);
+                results.set(keyBase + "phase." + phase.first + ".cycles", phase.second);
+            }
+            std::cout << "\n";
+
+            results.set(keyBase + "boot.cycles", result.cycles);
+
+            char buf[64];
+            snprintf(buf, sizeof(buf), "%12llu %10.2f", (unsigned long long) result.cycles, result.ms);
+            summary += buf;
+        }
+
+        summary += "\n";
+    }
+
+    std::cout << summary << "\n";
+
+    // Save and check the results
+
+    std::string error;
+    if (!results.saveAndCompare(CMD_bchFile, CMD_basFile,
+                                "bench_boot results, format: <target>.<video system>.<metric> <value>",
+                                "boot time", error))
+    {
+        ERROR(error);
+    }
+
+    return 0;
+}
@@ -0,0 +1,354 @@
+//
+// Utility to verify and benchmark the host-side model of the Commodore floating
+// point format ('cbm_float.h') - checks the conversions round-trip, checks the
+// arithmetic model against the host 'long double' arithmetic, and measures the
+// throughput of all the operations
+//
+
+#include "common.h"
+#include "cbm_float.h"
+
+#include <unistd.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+
+//
+// Command line settings
+//
+
+unsigned CMD_count    = 1000000;
+int      CMD_exponent = -1;
+uint32_t CMD_seed     = 1;
+
+// Largest error of the arithmetic model, in ULPs - half for the final rounding,
+// plus the bits truncated from below the rounding byte
+
+const double MAX_MODEL_ULP = 0.5 + 1.0 / 128;
+
+//
+// Compile time checks - the whole model has to work in constant expressions
+//
+
+constexpr CbmFloat CONST_ONE  = CbmFloat::fromParts(0x81, 0x80000000, false);
+constexpr CbmFloat CONST_TWO  = CbmFloat::fromParts(0x82, 0x80000000, false);
+constexpr CbmFloat CONST_TEN  = CbmFloat::fromParts(0x84, 0xA0000000, false);
+constexpr CbmFloat CONST_HALF = CbmFloat::fromParts(0x80, 0x80000000, false);
+
+static_assert(CbmFloat::fromHost(1.0L)  == CONST_ONE,                                  "encoding 1");
+static_assert(CbmFloat::fromHost(-0.5L) == CONST_HALF.negated(),                       "encoding -0.5");
+static_assert(CbmFloat::fromHost(3.14159265358979323846L) ==
+              CbmFloat::fromParts(0x82, 0xC90FDAA2, false),                             "encoding PI");
+static_assert(CbmFloat::fromHost(1.0e39L) == CbmFloat::maxValue(),                      "saturation");
+static_assert(CbmFloat::fromHost(1.0e-39L).isZero(),                                    "underflow");
+static_assert(CONST_TEN.toHost() == 10.0L,                                              "decoding 10");
+static_assert(CbmFloat::add(CONST_ONE, CONST_ONE) == CONST_TWO,                         "1 + 1");
+static_assert(CbmFloat::sub(CONST_ONE, CONST_ONE).isZero(),                             "1 - 1");
+static_assert(CbmFloat::mul(CONST_TEN, CONST_HALF) == CbmFloat::fromHost(5.0L),         "10 * 0.5");
+static_assert(CbmFloat::div(CONST_ONE, CONST_TEN) == CbmFloat::fromHost(0.1L),          "1 / 10");
+static_assert(CbmFloat::mul(CbmFloat::maxValue(), CONST_TWO) == CbmFloat::maxValue(),   "overflow");
+
+//
+// Common helper functions
+//
+
+void printUsage()
+{
+    std::cout << "\n" <<
+        "usage: bench_float [-n <random operations>] [-e <exponent>] [-s <seed>]" << "\n\n" <<
+        "  -e  exhaustive round-trip check of all the mantissas, for the given exponent (hex)" << "\n\n";
+}
+
+void parseCommandLine(int argc, char **argv)
+{
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:e:s:")) != -1)
+    {
+        switch(opt)
+        {
+            case 'n': CMD_count    = strtoul(optarg, nullptr, 10); break;
+            case 'e': CMD_exponent = strtoul(optarg, nullptr, 16); break;
+            case 's': CMD_seed     = strtoul(optarg, nullptr, 10); break;
+            default: printUsage(); ERROR();
+        }
+    }
+
+    if (optind != argc) { printUsage(); ERROR("unexpected parameters"); }
+    if (CMD_exponent == 0 || CMD_exponent > 0xFF) { printUsage(); ERROR("exponent out of range"); }
+}
+
+void printBanner()
+{
+    printBannerLineTop();
+    std::cout << "// Checking and benchmarking CBM floating point model" << "\n";
+    printBannerLineBottom();
+}
+
+std::string formatFloat(const CbmFloat &value)
+{
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%02X %02X %02X %02X %02X (%.12Lg)", value.bytes[0], value.bytes[1],
+             value.bytes[2], value.bytes[3], value.bytes[4], value.toHost());
+    return buf;
+}
+
+uint32_t GLOBAL_seed = 0;
+
+uint32_t random32()
+{
+    GLOBAL_seed = GLOBAL_seed * 1103515245 + 12345;
+    const uint32_t high = GLOBAL_seed >> 16;
+    GLOBAL_seed = GLOBAL_seed * 1103515245 + 12345;
+    return (high << 16) | (GLOBAL_seed >> 16);
+}
+
+CbmFloat randomFloat(int expMin = 0x01, int expMax = 0xFF)
+{
+    const uint8_t exponent = uint8_t(expMin + random32() % (expMax - expMin + 1));
+    return CbmFloat::fromParts(exponent, 0x80000000 | random32(), random32() & 1);
+}
+
+//
+// Conversion checks
+//
+
+void checkRoundTrip(const CbmFloat &value, uint64_t &errors)
+{
+    CbmFloat result;
+    if (!CbmFloat::fromHost(value.toHost(), result) || result != value)
+    {
+        if (errors++ < 10) std::cout << "    round-trip failed: " << formatFloat(value) << "\n";
+    }
+}
+
+void checkConversions()
+{
+    uint64_t checked = 0;
+    uint64_t errors  = 0;
+
+    if (CMD_exponent > 0)
+    {
+        // Every mantissa, both signs
+
+        std::cout << "Exhaustive round-trip, exponent $" << std::hex << CMD_exponent << std::dec << " ..." << "\n";
+        for (uint64_t mantissa = 0x80000000; mantissa <= 0xFFFFFFFF; mantissa++)
+        {
+            checkRoundTrip(CbmFloat::fromParts(CMD_exponent, mantissa, false), errors);
+            checkRoundTrip(CbmFloat::fromParts(CMD_exponent, mantissa, true),  errors);
+            checked += 2;
+        }
+    }
+    else
+    {
+        // Every exponent, mantissas at the boundaries and random ones
+
+        for (unsigned exponent = 0x01; exponent <= 0xFF; exponent++)
+        {
+            for (bool negative : { false, true })
+            {
+                for (uint32_t low = 0; low < 256; low++)
+                {
+                    checkRoundTrip(CbmFloat::fromParts(exponent, 0x80000000 | low, negative), errors);
+                    checkRoundTrip(CbmFloat::fromParts(exponent, 0xFFFFFFFF - low, negative), errors);
+                    checked += 2;
+                }
+            }
+        }
+
+        for (unsigned idx = 0; idx < CMD_count; idx++)
+        {
+            checkRoundTrip(randomFloat(), errors);
+            checked++;
+        }
+    }
+
+    std::cout << "Round-trip (decode / encode): " << checked << " values, " << errors << " errors" << "\n";
+
+    // Encoding must round to nearest - check host values between the representable ones
+
+    uint64_t roundErrors = 0;
+    for (unsigned idx = 0; idx < CMD_count; idx++)
+    {
+        const CbmFloat    base   = randomFloat(0x02, 0xFE);
+        const long double offset = CbmFloat::ulp(base.exponent()) * (random32() / 4294967296.0L - 0.5L);
+        const long double value  = base.toHost() + offset;
+
+        CbmFloat result;
+        if (!CbmFloat::fromHost(value, result) ||
+            std::fabs(result.toHost() - value) > CbmFloat::ulp(result.exponent()) / 2)
+        {
+            if (roundErrors++ < 10) std::cout << "    rounding failed: " << formatFloat(base) << "\n";
+        }
+    }
+
+    std::cout << "Rounding (encode):            " << CMD_count << " values, " << roundErrors << " errors" << "\n\n";
+
+    if (errors != 0 || roundErrors != 0) ERROR("conversion errors found");
+}
+
+//
+// Arithmetic model checks
+//
+
+typedef struct
+{
+    std::string name;
+
+    std::function<CbmFloat(const CbmFloat &, const CbmFloat &, bool *)> model;
+    std::function<long double(long double, long double)>               reference;
+
+} ModelOperation;
+
+const std::vector<ModelOperation> GLOBAL_operations =
+{
+    { "add", [](const CbmFloat &a, const CbmFloat &b, bool *o) { return CbmFloat::add(a, b, o); },
+             [](long double a, long double b) { return a + b; } },
+    { "sub", [](const CbmFloat &a, const CbmFloat &b, bool *o) { return CbmFloat::sub(a, b, o); },
+             [](long double a, long double b) { return a - b; } },
+    { "mul", [](const CbmFloat &a, const CbmFloat &b, bool *o) { return CbmFloat::mul(a, b, o); },
+             [](long double a, long double b) { return a * b; } },
+    { "div", [](const CbmFloat &a, const CbmFloat &b, bool *o) { return CbmFloat::div(a, b, o); },
+             [](long double a, long double b) { return a / b; } },
+};
+
+void checkArithmetic()
+{
+    std::cout << "    op       checked    exact %    max ULP" << "\n";
+
+    bool failed = false;
+    for (const auto &operation : GLOBAL_operations)
+    {
+        GLOBAL_seed = CMD_seed;
+
+        uint64_t checked = 0;
+        uint64_t exact   = 0;
+        double   maxUlp  = 0.0;
+
+        for (unsigned idx = 0; idx < CMD_count; idx++)
+        {
+            const CbmFloat a = randomFloat(0x40, 0xC0);
+            const CbmFloat b = (idx & 1) ? randomFloat(0x40, 0xC0) :
+                               randomFloat(std::max(0x01, a.exponent() - 34), std::min(0xFF, a.exponent() + 34));
+
+            const long double reference = operation.reference(a.toHost(), b.toHost());
+
+            CbmFloat expected;
+            if (!CbmFloat::fromHost(reference, expected)) continue;
+
+            bool overflow = false;
+            const CbmFloat result = operation.model(a, b, &overflow);
+            if (overflow) continue;
+
+            const double ulp = double(std::fabs(result.toHost() - reference) / CbmFloat::ulp(expected.exponent()));
+
+            checked++;
+            if (result == expected) exact++;
+            if (ulp > maxUlp) maxUlp = ulp;
+
+            if (ulp > MAX_MODEL_ULP && !failed)
+            {
+                std::cout << "    " << operation.name << " error " << ulp << " ULP: " << formatFloat(a) << ", " <<
+                             formatFloat(b) << " -> " << formatFloat(result) << "\n";
+                failed = true;
+            }
+        }
+
+        char buf[128];
+        snprintf(buf, sizeof(buf), "    %-6s %10llu   %8.3f %10.4f\n", operation.name.c_str(),
+                 (unsigned long long) checked, checked ? exact * 100.0 / checked : 0.0, maxUlp);
+        std::cout << buf;
+    }
+    std::cout << "\n";
+
+    if (failed) ERROR("arithmetic model errors found");
+}
+
+//
+// Throughput
+//
+
+void measure(const std::string &name, const std::function<unsigned(unsigned)> &benchmark)
+{
+    const auto     start  = std::chrono::steady_clock::now();
+    const unsigned result = benchmark(CMD_count);
+    const double   time   = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    char buf[128];
+    snprintf(buf, sizeof(buf), "    %-8s %10.2f Mops/s  %8.2f ns/op   (check %08X)\n", name.c_str(),
+             time > 0.0 ? CMD_count / time / 1e6 : 0.0, time * 1e9 / CMD_count, result);
+    std::cout << buf;
+}
+
+void measureThroughput()
+{
+    // Operands prepared upfront, so that only the operations are measured; the check
+    // values keep the compiler from optimizing the loops away
+
+    const unsigned          OPERANDS = 4096;
+    std::vector<CbmFloat>    floats(OPERANDS);
+    std::vector<long double> hosts(OPERANDS);
+
+    GLOBAL_seed = CMD_seed;
+    for (unsigned idx = 0; idx < OPERANDS; idx++)
+    {
+        floats[idx] = randomFloat(0x60, 0xA0);
+        hosts[idx]  = floats[idx].toHost();
+    }
+
+    auto binary = [&](CbmFloat (*op)(const CbmFloat &, const CbmFloat &, bool *))
+    {
+        return [&floats, op](unsigned count)
+        {
+            unsigned check = 0;
+            for (unsigned idx = 0; idx < count; idx++)
+            {
+                check += op(floats[idx % OPERANDS], floats[(idx * 7 + 1) % OPERANDS], nullptr).bytes[4];
+            }
+            return check;
+        };
+    };
+
+    std::cout << "Throughput:" << "\n";
+
+    measure("encode", [&](unsigned count)
+    {
+        unsigned check = 0;
+        for (unsigned idx = 0; idx < count; idx++) check += CbmFloat::fromHost(hosts[idx % OPERANDS]).bytes[4];
+        return check;
+    });
+    measure("decode", [&](unsigned count)
+    {
+        long double check = 0.0;
+        for (unsigned idx = 0; idx < count; idx++) check += floats[idx % OPERANDS].toHost();
+        return unsigned(check != 0.0);
+    });
+    measure("add", binary(CbmFloat::add));
+    measure("sub", binary(CbmFloat::sub));
+    measure("mul", binary(CbmFloat::mul));
+    measure("div", binary(CbmFloat::div));
+
+    std::cout << "\n";
+}
+
+//
+// Main function
+//
+
+int main(int argc, char **argv)
+{
+    parseCommandLine(argc, argv);
+    printBanner();
+
+    GLOBAL_seed = CMD_seed;
+
+    checkConversions();
+    if (CMD_exponent > 0) return 0;
+
+    checkArithmetic();
+    measureThroughput();
+
+    return 0;
+}
@@ -0,0 +1,498 @@
+//
+// Utility to check the accuracy and speed of the BASIC floating point math
+// routines - calls the entry points on a headless machine model with random
+// and edge case operands, compares the results with the host 'long double'
+// arithmetic, reports the worst error (in units of the last mantissa place)
+// and the average cycle count
+//
+
+#include "common.h"
+#include "basic_program.h"
+#include "bench_results.h"
+#include "cbm_float.h"
+#include "headless_c64.h"
+
+#include <unistd.h>
+
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <list>
+
+//
+// Command line settings
+//
+
+std::string CMD_basic     = "./build/basic_generic.rom";
+std::string CMD_kernal    = "./build/kernal_generic.rom";
+std::string CMD_bchFile   = "";
+std::string CMD_basFile   = "";
+unsigned    CMD_count     = 100000;
+uint32_t    CMD_seed      = 1;
+unsigned    CMD_worst     = 0;
+
+std::list<std::string> CMD_opList;
+
+const uint64_t MAX_OP_CYCLES = 1000000;
+
+//
+// Math routines under test
+//
+
+typedef struct
+{
+    std::string name;
+    uint16_t    address;    // entry point compatible with the original ROM
+    bool        binary;     // true = FAC2 <op> FAC1, false = <op> FAC1
+    int         expRange;   // random operand exponents are within 0x80 +/- this value
+    bool        positive;   // operands must be positive
+
+    std::function<long double(long double fac2, long double fac1)>        reference;
+    std::function<CbmFloat(const CbmFloat &fac2, const CbmFloat &fac1)> model;       // optional
+
+} MathOperation;
+
+constexpr CbmFloat CONST_TEN = CbmFloat::fromHost(10.0L);
+
+const std::vector<MathOperation> GLOBAL_operations =
+{
+    { "add",   0xB86A, true,  40,  false, [](long double a, long double b) { return a + b;             },
+                                          [](const CbmFloat &a, const CbmFloat &b) { return CbmFloat::add(a, b); } },
+    { "sub",   0xB853, true,  40,  false, [](long double a, long double b) { return a - b;             },
+                                          [](const CbmFloat &a, const CbmFloat &b) { return CbmFloat::sub(a, b); } },
+    { "mul",   0xBA2B, true,  60,  false, [](long double a, long double b) { return a * b;             },
+                                          [](const CbmFloat &a, const CbmFloat &b) { return CbmFloat::mul(a, b); } },
+    { "div",   0xBB12, true,  60,  false, [](long double a, long double b) { return a / b;             },
+                                          [](const CbmFloat &a, const CbmFloat &b) { return CbmFloat::div(a, b); } },
+    { "mul10", 0xBAE2, false, 120, false, [](long double, long double b)  { return b * 10;            },
+                                          [](const CbmFloat &, const CbmFloat &b) { return CbmFloat::mul(b, CONST_TEN); } },
+    { "div10", 0xBAFE, false, 120, false, [](long double, long double b)  { return std::fabs(b) / 10; },
+                                          [](const CbmFloat &, const CbmFloat &b) { return CbmFloat::div(b.absolute(), CONST_TEN); } },
+    { "sqr",   0xBF71, false, 127, true,  [](long double, long double b)  { return std::sqrt(b);      }, nullptr },
+    { "pwr",   0xBF7B, true,  4,   true,  [](long double a, long double b) { return std::pow(a, b);    }, nullptr },
+};
+
+//
+// Common helper functions
+//
+
+void printUsage()
+{
+    std::cout << "\n" <<
+        "usage: bench_math [-b <BASIC ROM>] [-k <KERNAL ROM>] [-n <random operations>] [-s <seed>]" << "\n" <<
+        "                  [-w <worst cases to show>] [-o <results file>] [-p <baseline file>] [<operation>...]" << "\n\n" <<
+        "  operations:";
+    for (const auto &operation : GLOBAL_operations) std::cout << " " << operation.name;
+    std::cout << " (default: all)" << "\n\n" <<
+        "  -n  number of random operand sets per operation, edge cases are always checked" << "\n\n";
+}
+
+void parseCommandLine(int argc, char **argv)
+{
+    int opt;
+
+    while ((opt = getopt(argc, argv, "b:k:n:s:w:o:p:")) != -1)
+    {
+        switch(opt)
+        {
+            case 'b': CMD_basic   = optarg;                        break;
+            case 'k': CMD_kernal  = optarg;                        break;
+            case 'n': CMD_count   = strtoul(optarg, nullptr, 10);  break;
+            case 's': CMD_seed    = strtoul(optarg, nullptr, 10);  break;
+            case 'w': CMD_worst   = strtoul(optarg, nullptr, 10);  break;
+            case 'o': CMD_bchFile = optarg;                        break;
+            case 'p': CMD_basFile = optarg;                        break;
+            default: printUsage(); ERROR();
+        }
+    }
+
+    for (int idx = optind; idx < argc; idx++)
+    {
+        CMD_opList.push_back(argv[idx]);
+    }
+}
+
+void printBanner()
+{
+    printBannerLineTop();
+    std::cout << "// Checking BASIC floating point math routines" << "\n";
+    printBannerLineBottom();
+}
+
+std::string formatFloat(const CbmFloat &value)
+{
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%02X %02X %02X %02X %02X (%.12Lg)", value.bytes[0], value.bytes[1],
+             value.bytes[2], value.bytes[3], value.bytes[4], value.toHost());
+    return buf;
+}
+
+//
+// Calling the routines on the machine model
+//
+
+class MathRunner
+{
+public:
+
+    MathRunner()
+    {
+        BasicSession session(machine);
+
+        std::string error;
+        if (!machine.loadRoms(CMD_basic, CMD_kernal, error)) ERROR(error);
+        if (!session.boot()) ERROR(session.error);
+
+        machine.setTrap(ADDR_STUB + STUB_END);
+        machine.trapHandler = [](uint16_t) -> bool { return false; };
+    }
+
+    // Calls the routine; returns false if it did not come back
+
+    bool call(const MathOperation &operation, const CbmFloat &fac2, const CbmFloat &fac1,
+              CbmFloat &result, uint64_t &cycles)
+    {
+        // Stub: SEI, LDA FAC1 exponent (routines expect the flags set), JSR <routine>, trap
+
+        const uint8_t stub[] = { 0x78, 0xA5, uint8_t(ADDR_FAC1), 0x20,
+                                 uint8_t(operation.address & 0xFF), uint8_t(operation.address >> 8), 0xEA };
+        for (unsigned idx = 0; idx < sizeof(stub); idx++) machine.poke(ADDR_STUB + idx, stub[idx]);
+
+        setFac(ADDR_FAC1, fac1);
+        setFac(ADDR_FAC2, fac2);
+        machine.poke(ADDR_ARISGN, machine.peek(ADDR_FAC1 + 5) ^ machine.peek(ADDR_FAC2 + 5));
+        machine.poke(ADDR_FACOV,  0);
+
+        machine.cpu.pc = ADDR_STUB;
+        machine.cpu.s  = 0xFA;
+
+        const uint64_t start = machine.cycles;
+        machine.run(MAX_OP_CYCLES);
+        cycles = machine.cycles - start - 5;   // SEI and LDA excluded, JSR/RTS pair included
+
+        if (machine.cpu.pc != ADDR_STUB + STUB_END) return false;
+
+        result = getFac1();
+        return true;
+    }
+
+private:
+
+    static const uint16_t STUB_END = 6;
+
+    void setFac(uint16_t addr, const CbmFloat &value)
+    {
+        const uint32_t mantissa = value.isZero() ? 0 : value.mantissa();
+
+        machine.poke(addr + 0, value.exponent());
+        machine.poke(addr + 1, mantissa >> 24);
+        machine.poke(addr + 2, mantissa >> 16);
+        machine.poke(addr + 3, mantissa >> 8);
+        machine.poke(addr + 4, mantissa);
+        machine.poke(addr + 5, value.negative() ? 0xFF : 0x00);
+    }
+
+    // Retrieves FAC1 rounded the way 'round_FAC1' does it, before storing the value in memory
+
+    CbmFloat getFac1() const
+    {
+        uint8_t  exponent = machine.peek(ADDR_FAC1);
+        uint32_t mantissa = (uint32_t(machine.peek(ADDR_FAC1 + 1)) << 24) | (uint32_t(machine.peek(ADDR_FAC1 + 2)) << 16) |
+                            (uint32_t(machine.peek(ADDR_FAC1 + 3)) << 8)  |  uint32_t(machine.peek(ADDR_FAC1 + 4));
+
+        if (exponent != 0 && (machine.peek(ADDR_FACOV) & 0x80))
+        {
+            if (++mantissa == 0)
+            {
+                mantissa = 0x80000000;
+                if (exponent != 0xFF) exponent++;
+            }
+        }
+
+        return CbmFloat::fromParts(exponent, mantissa, (machine.peek(ADDR_FAC1 + 5) & 0x80) != 0);
+    }
+
+    C64Machine machine;
+};
+
+//
+// Operands
+//
+
+class OperandGenerator
+{
+public:
+
+    OperandGenerator(const MathOperation &operation, uint32_t seed) : operation(operation), seed(seed) {}
+
+    CbmFloat random(int expBase = 0x80)
+    {
+        const int      exponent = std::max(1, std::min(0xFF, expBase + int(next() % (2 * operation.expRange + 1)) -
+                                                                operation.expRange));
+        const uint32_t mantissa = 0x80000000 | (next() << 16) | next();
+
+        return CbmFloat::fromParts(uint8_t(exponent), mantissa, operation.positive ? false : (next() & 1));
+    }
+
+    // Operand pairs - for additions keep the exponents close enough for the mantissas to overlap
+
+    void randomPair(CbmFloat &fac2, CbmFloat &fac1)
+    {
+        fac1 = random();
+        if (operation.name == "add" || operation.name == "sub")
+        {
+            const int expBase = std::max(1, std::min(0xFF, int(fac1.exponent()) + int(next() % 71) - 35));
+            fac2 = CbmFloat::fromParts(uint8_t(expBase), 0x80000000 | (next() << 16) | next(), next() & 1);
+        }
+        else
+        {
+            fac2 = operation.binary ? random() : CbmFloat();
+        }
+    }
+
+    // Edge cases - zero, smallest / largest values, mantissa all ones, values close to 1
+
+    static std::vector<CbmFloat> edgeValues(bool positive)
+    {
+        std::vector<CbmFloat> values;
+
+        for (const auto &base : { CbmFloat::fromParts(0x81, 0x80000000, false),   // 1
+                                  CbmFloat::fromParts(0x80, 0xFFFFFFFF, false),   // 1 - ulp
+                                  CbmFloat::fromParts(0x81, 0x80000001, false),   // 1 + ulp
+                                  CbmFloat::fromParts(0x84, 0xA0000000, false),   // 10
+                                  CbmFloat::fromParts(0x7D, 0xCCCCCCCD, false),   // 0.1
+                                  CbmFloat::fromParts(0x82, 0xC90FDAA2, false),   // PI
+                                  CbmFloat::fromParts(0x90, 0xFFFFFFFF, false),
+                                  CbmFloat::fromParts(0x01, 0x80000000, false),
+                                  CbmFloat::fromParts(0x01, 0xFFFFFFFF, false),
+                                  CbmFloat::fromParts(0xFF, 0x80000000, false),
+                                  CbmFloat::fromParts(0xFF, 0xFFFFFFFF, false) })
+        {
+            values.push_back(base);
+            if (!positive) values.push_back(CbmFloat::fromParts(base.exponent(), base.mantissa(), true));
+        }
+
+        values.push_back(CbmFloat());
+        return values;
+    }
+
+private:
+
+    uint32_t next()
+    {
+        seed = seed * 1103515245 + 12345;
+        return seed >> 16;
+    }
+
+    const MathOperation &operation;
+    uint32_t             seed;
+};
+
+//
+// Accuracy and speed statistics
+//
+
+typedef struct
+{
+    double   ulp;
+    CbmFloat fac2;
+    CbmFloat fac1;
+    CbmFloat result;
+    CbmFloat expected;
+
+} WorstCase;
+
+class OperationStats
+{
+public:
+
+    void add(const CbmFloat &fac2, const CbmFloat &fac1, const CbmFloat &result,
+             long double reference, const CbmFloat *modelled, uint64_t cycles)
+    {
+        CbmFloat expected;
+        CbmFloat::fromHost(reference, expected);
+
+        const double ulp = double(std::fabs(result.toHost() - reference) / CbmFloat::ulp(expected.exponent()));
+
+        count++;
+        if (result == expected) exact++;
+        if (modelled != nullptr && result == *modelled) modelMatch++;
+
+        sumUlp    += ulp;
+        maxUlp     = std::max(maxUlp, ulp);
+        sumCycles += cycles;
+        minCycles  = std::min(minCycles, cycles);
+        maxCycles  = std::max(maxCycles, cycles);
+
+        if (CMD_worst != 0 && (worst.size() < CMD_worst || ulp > worst.back().ulp))
+        {
+            WorstCase entry = { ulp, fac2, fac1, result, expected };
+            worst.insert(std::upper_bound(worst.begin(), worst.end(), entry,
+                         [](const WorstCase &a, const WorstCase &b) { return a.ulp > b.ulp; }), entry);
+            if (worst.size() > CMD_worst) worst.pop_back();
+        }
+    }
+
+    uint64_t count      = 0;
+    uint64_t exact      = 0;     // bit-identical to the correctly rounded result
+    uint64_t modelMatch = 0;     // bit-identical to the 'cbm_float.h' arithmetic model
+    uint64_t skipped    = 0;     // result not representable, or operation undefined
+    uint64_t failed     = 0;     // routine did not return
+
+    double   sumUlp     = 0.0;
+    double   maxUlp     = 0.0;
+    uint64_t sumCycles  = 0;
+    uint64_t minCycles  = UINT64_MAX;
+    uint64_t maxCycles  = 0;
+
+    std::vector<WorstCase> worst;
+
+    uint64_t avgCycles() const { return count ? sumCycles / count : 0; }
+};
+
+//
+// Checking the operations
+//
+
+bool isDefined(const MathOperation &operation, const CbmFloat &fac2, const CbmFloat &fac1)
+{
+    if (operation.name == "div") return !fac1.isZero();
+    if (operation.name == "sqr") return !fac1.negative();
+    if (operation.name == "pwr") return !fac2.isZero() && !fac2.negative();
+    return true;
+}
+
+void checkOne(MathRunner &runner, const MathOperation &operation, OperationStats &stats,
+              const CbmFloat &fac2, const CbmFloat &fac1)
+{
+    // Skip the operand sets which would end with an error, or with a result out of range
+
+    const long double reference = operation.reference(fac2.toHost(), fac1.toHost());
+
+    CbmFloat expected;
+    if (!isDefined(operation, fac2, fac1) || !std::isfinite(reference) || !CbmFloat::fromHost(reference, expected))
+    {
+        stats.skipped++;
+        return;
+    }
+
+    CbmFloat result;
+    uint64_t cycles;
+    if (!runner.call(operation, fac2, fac1, result, cycles))
+    {
+        stats.failed++;
+        return;
+    }
+
+    if (operation.model)
+    {
+        const CbmFloat modelled = operation.model(fac2, fac1);
+        stats.add(fac2, fac1, result, reference, &modelled, cycles);
+    }
+    else
+    {
+        stats.add(fac2, fac1, result, reference, nullptr, cycles);
+    }
+}
+
+OperationStats checkOperation(MathRunner &runner, const MathOperation &operation)
+{
+    OperationStats   stats;
+    OperandGenerator generator(operation, CMD_seed);
+
+    const auto edgeValues = OperandGenerator::edgeValues(operation.positive);
+    for (const auto &fac1 : edgeValues)
+    {
+        if (!operation.binary)
+        {
+            checkOne(runner, operation, stats, CbmFloat(), fac1);
+            continue;
+        }
+
+        for (const auto &fac2 : edgeValues) checkOne(runner, operation, stats, fac2, fac1);
+    }
+
+    for (unsigned idx = 0; idx < CMD_count; idx++)
+    {
+        CbmFloat fac2, fac1;
+        generator.randomPair(fac2, fac1);
+        checkOne(runner, operation, stats, fac2, fac1);
+    }
+
+    return stats;
+}
+
+//
+// Main function
+//
+
+int main(int argc, char **argv)
+{
+    parseCommandLine(argc, argv);
+    printBanner();
+
+    std::vector<const MathOperation *> selected;
+    for (const auto &operation : GLOBAL_operations)
+    {
+        if (CMD_opList.empty() ||
+            std::find(CMD_opList.begin(), CMD_opList.end(), operation.name) != CMD_opList.end())
+        {
+            selected.push_back(&operation);
+        }
+    }
+    if (selected.size() != (CMD_opList.empty() ? GLOBAL_operations.size() : CMD_opList.size()))
+    {
+        printUsage();
+        ERROR("unknown operation");
+    }
+
+    MathRunner   runner;
+    BenchResults results;
+
+    std::cout << "    op      addr     checked   skipped  failed   exact %   model %    max ULP   avg ULP    cycles: avg    min    max" << "\n";
+
+    for (const auto operation : selected)
+    {
+        const OperationStats stats = checkOperation(runner, *operation);
+
+        char model[16] = "      -";
+        if (operation->model) snprintf(model, sizeof(model), "%7.3f", stats.count ? stats.modelMatch * 100.0 / stats.count : 0.0);
+
+        char buf[256];
+        snprintf(buf, sizeof(buf), "    %-6s  $%04X %11llu %9llu %7llu   %7.3f   %s %10.4g %9.4g         %6llu %6llu %6llu\n",
+                 operation->name.c_str(), operation->address, (unsigned long long) stats.count,
+                 (unsigned long long) stats.skipped, (unsigned long long) stats.failed,
+                 stats.count ? stats.exact * 100.0 / stats.count : 0.0, model, stats.maxUlp,
+                 stats.count ? stats.sumUlp / stats.count : 0.0, (unsigned long long) stats.avgCycles(),
+                 (unsigned long long) (stats.count ? stats.minCycles : 0), (unsigned long long) stats.maxCycles);
+        std::cout << buf;
+
+        for (const auto &entry : stats.worst)
+        {
+            snprintf(buf, sizeof(buf), "        %10.4g ULP:  ", entry.ulp);
+            std::cout << buf << formatFloat(entry.fac2) << "  " <<
+                         operation->name << "  " << formatFloat(entry.fac1) << "\n" <<
+                         "            got " << formatFloat(entry.result) << ", expected " <<
+                         formatFloat(entry.expected) << "\n";
+        }
+
+        // Results are integers - keep the error in thousandths of ULP
+
+        const std::string key = "math." + operation->name;
+        results.set(key + ".cycles", stats.failed ? UINT32_MAX : stats.avgCycles());
+        results.set(key + ".ulp1000", stats.failed ? UINT32_MAX : uint64_t(std::min(stats.maxUlp * 1000.0, double(UINT32_MAX))));
+    }
+    std::cout << "\n";
+
+    // Save and check the results
+
+    std::string error;
+    if (!results.saveAndCompare(CMD_bchFile, CMD_basFile,
+                                "bench_math results, format: math.<op>.cycles / math.<op>.ulp1000 <value>",
+                                "floating point math", error))
+    {
+        ERROR(error);
+    }
+
+    return 0;
+}
@@ -0,0 +1,128 @@
+//
+// Benchmark results files, shared by the benchmarking tools; the format is
+// one '<key> <value>' pair per line, lines starting with '#' are comments
+//
+
+#ifndef BENCH_RESULTS_H
+#define BENCH_RESULTS_H
+
+#include <stdint.h>
+
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+
+class BenchResults
+{
+public:
+
+    void set(const std::string &key, uint64_t value) { values[key] = value; }
+
+    bool save(const std::string &fileName, const std::string &header) const
+    {
+        std::ofstream outFile(fileName, std::ios::out | std::ios::trunc);
+        if (!outFile.good()) return false;
+
+        outFile << "# " << header << "\n";
+        for (const auto &entry : values) outFile << entry.first << " " << entry.second << "\n";
+
+        return outFile.good();
+    }
+
+    bool load(const std::string &fileName)
+    {
+        std::ifstream inFile(fileName);
+        if (!inFile.good()) return false;
+
+        std::string line;
+        while (std::getline(inFile, line))
+        {
+            if (line.empty() || line[0] == '#') continue;
+
+            std::istringstream lineStream(line);
+            std::string key;
+            uint64_t    value;
+            if (!(lineStream >> key >> value)) return false;
+
+            values[key] = value;
+        }
+
+        return true;
+    }
+
+    // Compare against the baseline - a value growing by more than 'tolerance' (relative)
+    // is a regression, so is a missing result. Returns the number of regressions.
+
+    unsigned compare(const BenchResults &baseline, double tolerance = 0.0) const
+    {
+        unsigned regressions  = 0;
+        unsigned improvements = 0;
+
+        for (const auto &entry : baseline.values)
+        {
+            auto current = values.find(entry.first);
+            if (current == values.end())
+            {
+                std::cout << "missing result: " << entry.first << "\n";
+                regressions++;
+                continue;
+            }
+
+            if (current->second > entry.second * (1.0 + tolerance))
+            {
+                std::cout << "REGRESSION: " << entry.first << " " << entry.second << " -> " << current->second << "\n";
+                regressions++;
+            }
+            else if (current->second < entry.second)
+            {
+                improvements++;
+            }
+        }
+
+        if (improvements != 0)
+        {
+            std::cout << improvements << " results improved, consider updating the baseline" << "\n";
+        }
+
+        return regressions;
+    }
+
+    // Saves the results (if 'bchFile' is given) and compares them against the baseline
+    // (if 'basFile' is given); 'what' names the measured thing in the messages.
+    // Returns false, with the message in 'error', on failure or regression.
+
+    bool saveAndCompare(const std::string &bchFile, const std::string &basFile, const std::string &header,
+                        const std::string &what, std::string &error) const
+    {
+        if (!bchFile.empty() && !save(bchFile, header))
+        {
+            error = "unable to write results file '" + bchFile + "'";
+            return false;
+        }
+
+        if (basFile.empty()) return true;
+
+        BenchResults baseline;
+        if (!baseline.load(basFile))
+        {
+            error = "unable to read baseline file '" + basFile + "'";
+            if (!bchFile.empty()) error += " - to create one, copy the results file '" + bchFile + "'";
+            return false;
+        }
+
+        if (compare(baseline) != 0)
+        {
+            error = what + " regressions found";
+            return false;
+        }
+
+        std::cout << "no " << what << " regressions" << "\n\n";
+        return true;
+    }
+
+    std::map<std::string, uint64_t> values;
+};
+
+#endif // BENCH_RESULTS_H
@@ -0,0 +1,397 @@
+//
+// Utility to benchmark the tape loaders - plays '.tap' images into the Datasette
+// of a headless machine model, runs LOAD, and measures the load time, the data
+// rate, and how the loader copes with tape speed deviations and pulse jitter
+//
+// TAP format: 'C64-TAPE-RAW', version byte, platform, video standard, reserved
+// byte, 32-bit data size; then one byte per pulse (length / 8 cycles). Byte 0
+// marks an overflow in version 0, in version 1 it is followed by the exact
+// length in cycles (24-bit, little endian). Version 2 (half-waves) is for C16
+// and Plus/4 only, it is not supported.
+//
+
+#include "common.h"
+#include "basic_program.h"
+#include "bench_results.h"
+#include "headless_c64.h"
+
+#include <unistd.h>
+
+#include <cstdio>
+#include <list>
+#include <sstream>
+
+//
+// Command line settings
+//
+
+std::string CMD_basic      = "./build/basic_generic.rom";
+std::string CMD_kernal     = "./build/kernal_generic.rom";
+std::string CMD_bchFile    = "";
+std::string CMD_basFile    = "";
+bool        CMD_ntsc       = false;
+double      CMD_drift      = 0.0;
+uint32_t    CMD_seed       = 1;
+double      CMD_maxSeconds = 600.0;
+
+std::vector<double> CMD_speeds  = { 0.0 };
+std::vector<double> CMD_jitters = { 0.0 };
+
+std::list<std::string> CMD_tapList;
+
+const double   TAPE_END_SECONDS = 5.0;     // how long to wait for the loader once the tape is over
+const unsigned POLL_CYCLES      = 10000;
+
+//
+// Common helper functions
+//
+
+void printUsage()
+{
+    std::cout << "\n" <<
+        "usage: bench_tape [-b <BASIC ROM>] [-k <KERNAL ROM>] [-n] [-s <speed %>[,...]] [-j <jitter %>[,...]]" << "\n" <<
+        "                  [-d <drift %>] [-r <seed>] [-t <max seconds>] [-o <results file>] [-p <baseline file>]" << "\n" <<
+        "                  <TAP file>..." << "\n\n" <<
+        "  -n  NTSC machine (default is PAL)" << "\n" <<
+        "  -s  tape speed deviation, positive is faster; list - each value is tried" << "\n" <<
+        "  -j  random pulse length deviation, up to the given percentage; list - each value is tried" << "\n" <<
+        "  -d  speed change over the whole tape, on top of '-s' (a slowly stretching tape, weak motor)" << "\n" <<
+        "  -o, -p  results / baseline file, only runs without speed deviations and jitter are recorded" << "\n\n";
+}
+
+std::vector<double> parseList(const char *text)
+{
+    std::vector<double> values;
+    std::stringstream   stream(text);
+    std::string         item;
+
+    while (std::getline(stream, item, ','))
+    {
+        char *end = nullptr;
+        values.push_back(strtod(item.c_str(), &end));
+        if (item.empty() || *end != 0) { printUsage(); ERROR(std::string("malformed value list '") + text + "'"); }
+    }
+
+    return values;
+}
+
+void parseCommandLine(int argc, char **argv)
+{
+    int opt;
+
+    while ((opt = getopt(argc, argv, "b:k:ns:j:d:r:t:o:p:")) != -1)
+    {
+        switch(opt)
+        {
+            case 'b': CMD_basic      = optarg;                        break;
+            case 'k': CMD_kernal     = optarg;                        break;
+            case 'n': CMD_ntsc       = true;                          break;
+            case 's': CMD_speeds     = parseList(optarg);             break;
+            case 'j': CMD_jitters    = parseList(optarg);             break;
+            case 'd': CMD_drift      = strtod(optarg, nullptr);       break;
+            case 'r': CMD_seed       = strtoul(optarg, nullptr, 10);  break;
+            case 't': CMD_maxSeconds = strtod(optarg, nullptr);       break;
+            case 'o': CMD_bchFile    = optarg;                        break;
+            case 'p': CMD_basFile    = optarg;                        break;
+            default: printUsage(); ERROR();
+        }
+    }
+
+    for (int idx = optind; idx < argc; idx++)
+    {
+        CMD_tapList.push_back(argv[idx]);
+    }
+
+    if (CMD_tapList.empty()) { printUsage(); ERROR("no TAP files given"); }
+}
+
+void printBanner()
+{
+    printBannerLineTop();
+    std::cout << "// Benchmarking tape loaders" << "\n";
+    printBannerLineBottom();
+}
+
+//
+// TAP images
+//
+
+class TapImage
+{
+public:
+
+    bool load(const std::string &fileName, std::string &error)
+    {
+        std::ifstream file(fileName, std::ios::in | std::ios::binary);
+        if (!file.good()) { error = "unable to open '" + fileName + "'"; return false; }
+
+        const std::vector<uint8_t> content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        if (content.size() < 20 || memcmp(content.data(), "C64-TAPE-RAW", 12) != 0)
+        {
+            error = "not a TAP file";
+            return false;
+        }
+
+        version = content[12];
+        ntsc    = content[14] == 1;
+
+        if (version > 1)     { error = "TAP version " + std::to_string(version) + " not supported"; return false; }
+        if (content[13] != 0) { error = "not a C64 tape (platform " + std::to_string(content[13]) + ")"; return false; }
+
+        const size_t dataSize = content[16] | (content[17] << 8) | (content[18] << 16) | (size_t(content[19]) << 24);
+        if (dataSize > content.size() - 20) { error = "truncated data"; return false; }
+
+        pulses.clear();
+        for (size_t pos = 20; pos < 20 + dataSize; pos++)
+        {
+            if (content[pos] != 0)
+            {
+                pulses.push_back(content[pos] * 8);
+            }
+            else if (version == 0)
+            {
+                pulses.push_back(256 * 8);
+            }
+            else
+            {
+                if (pos + 3 >= 20 + dataSize) { error = "truncated long pulse"; return false; }
+                pulses.push_back(content[pos + 1] | (content[pos + 2] << 8) | (content[pos + 3] << 16));
+                pos += 3;
+            }
+        }
+
+        return true;
+    }
+
+    double clockHz() const { return ntsc ? 1022727.0 : 985248.0; }
+
+    double seconds() const
+    {
+        uint64_t total = 0;
+        for (const auto pulse : pulses) total += pulse;
+        return total / clockHz();
+    }
+
+    unsigned              version = 0;
+    bool                  ntsc    = false;
+    std::vector<uint32_t> pulses;           // in the cycles of the tape video standard
+};
+
+// Pulses as seen by the given machine, with tape speed deviations and jitter applied
+
+std::vector<uint32_t> preparePulses(const TapImage &tap, double machineHz, double speed, double drift, double jitter,
+                                    uint32_t seed)
+{
+    std::vector<uint32_t> result;
+    result.reserve(tap.pulses.size());
+
+    const double clockRatio = machineHz / tap.clockHz();
+    const size_t count      = tap.pulses.size();
+
+    for (size_t idx = 0; idx < count; idx++)
+    {
+        seed = seed * 1103515245 + 12345;
+        const double random = ((seed >> 8) & 0xFFFF) / 32767.5 - 1.0;    // -1.0 ... 1.0
+
+        const double speedNow = 1.0 + (speed + drift * idx / count) / 100.0;
+        const double length   = tap.pulses[idx] * clockRatio / speedNow * (1.0 + random * jitter / 100.0);
+
+        result.push_back(std::max(uint32_t(1), uint32_t(length + 0.5)));
+    }
+
+    return result;
+}
+
+//
+// Loading
+//
+
+typedef struct
+{
+    bool        ok           = false;
+    std::string status;
+    std::string fileName;
+    uint64_t    cycles       = 0;       // from typing LOAD till READY.
+    uint64_t    searchCycles = 0;       // till the header was found, the rest is the data phase
+    uint16_t    start        = 0;
+    uint16_t    end          = 0;
+    uint32_t    checksum     = 0;
+    size_t      pulsesUsed   = 0;
+    double      clockHz      = 0.0;
+
+    unsigned bytes() const { return end > start ? end - start : 0; }
+
+} LoadResult;
+
+LoadResult runLoad(const std::vector<uint32_t> &pulses)
+{
+    LoadResult   result;
+    C64Machine   machine(CMD_ntsc ? C64Machine::VideoSystem::NTSC : C64Machine::VideoSystem::PAL);
+    BasicSession session(machine);
+
+    std::string error;
+    if (!machine.loadRoms(CMD_basic, CMD_kernal, error)) ERROR(error);
+    if (!session.boot()) ERROR(session.error);
+
+    result.clockHz = machine.clockHz();
+
+    // Insert the tape (presses PLAY) and start loading; once the header is found,
+    // press SPACE, so that the loader does not wait for the user decision
+
+    machine.tapeInsert(pulses);
+    session.clearScreen();
+    machine.typeText("LOAD\"\",1\n");
+
+    const uint64_t start     = machine.cycles;
+    const uint64_t maxCycles = uint64_t(CMD_maxSeconds * machine.clockHz());
+    uint64_t       tapeEnd   = 0;
+    bool           spaceDown = false;
+
+    result.status = "timeout";
+    while (machine.cycles - start < maxCycles)
+    {
+        machine.run(POLL_CYCLES);
+        if (machine.cpu.jammed) { result.status = "CPU jammed"; break; }
+
+        const std::string text = machine.screenText();
+
+        if (result.searchCycles == 0 && text.find("FOUND") != std::string::npos)
+        {
+            result.searchCycles = machine.cycles - start;
+            machine.setKey(7, 4, true);     // SPACE
+            spaceDown = true;
+        }
+        if (spaceDown && machine.motorOn())
+        {
+            machine.setKey(7, 4, false);
+            spaceDown = false;
+        }
+
+        const auto errorPos = text.find(" ERROR");
+        if (errorPos != std::string::npos)
+        {
+            const auto lineStart = text.rfind('\n', errorPos);
+            result.status = text.substr(lineStart + 1, text.find('\n', errorPos) - lineStart - 1);
+            break;
+        }
+
+        // A loader which lost the sync keeps searching - there is nothing more to read
+
+        if (tapeEnd == 0 && machine.tapeEnd()) tapeEnd = machine.cycles;
+        if (tapeEnd != 0 && text.find("READY.") == std::string::npos &&
+            machine.cycles - tapeEnd > uint64_t(TAPE_END_SECONDS * machine.clockHz()))
+        {
+            result.status = "tape end";
+            break;
+        }
+
+        if (text.find("READY.") != std::string::npos)
+        {
+            const auto found = text.find("FOUND ");
+            if (found != std::string::npos)
+            {
+                result.fileName = text.substr(found + 6, text.find('\n', found) - found - 6);
+                result.fileName.erase(result.fileName.find_last_not_of(' ') + 1);
+            }
+
+            result.ok     = true;
+            result.status = "OK";
+            break;
+        }
+    }
+
+    result.cycles     = machine.cycles - start;
+    result.pulsesUsed = machine.tapePosition();
+
+    if (result.ok)
+    {
+        result.start = machine.peek16(ADDR_STAL);
+        result.end   = machine.peek16(ADDR_EAL);
+
+        // FNV-1a over the loaded data, to tell a successful load from a silently damaged one
+
+        result.checksum = 2166136261u;
+        for (unsigned addr = result.start; addr < result.end; addr++)
+        {
+            result.checksum = (result.checksum ^ machine.ram[addr]) * 16777619u;
+        }
+    }
+
+    return result;
+}
+
+//
+// Main function
+//
+
+int main(int argc, char **argv)
+{
+    parseCommandLine(argc, argv);
+    printBanner();
+
+    BenchResults results;
+    const double machineHz = C64Machine(CMD_ntsc ? C64Machine::VideoSystem::NTSC : C64Machine::VideoSystem::PAL).clockHz();
+
+    for (const auto &tapFile : CMD_tapList)
+    {
+        TapImage    tap;
+        std::string error;
+        if (!tap.load(tapFile, error)) ERROR(std::string("TAP file '") + tapFile + "': " + error);
+
+        const auto        slash = tapFile.find_last_of("/\\");
+        const std::string name  = tapFile.substr(slash == std::string::npos ? 0 : slash + 1);
+
+        char buf[256];
+        snprintf(buf, sizeof(buf), "Tape '%s' (version %u, %s, %zu pulses, %.1f s), %s machine\n\n", name.c_str(),
+                 tap.version, tap.ntsc ? "NTSC" : "PAL", tap.pulses.size(), tap.seconds(), CMD_ntsc ? "NTSC" : "PAL");
+        std::cout << buf;
+
+        // The unperturbed run gives the reference checksum - a load with wrong data is a failure
+        // too - and the result to record
+
+        const LoadResult nominal = runLoad(preparePulses(tap, machineHz, 0.0, 0.0, 0.0, CMD_seed));
+        results.set("tape." + name + ".cycles", nominal.ok ? nominal.cycles : UINT32_MAX);
+
+        std::cout << "    speed %  jitter %  status            name               bytes  search s    data s   total s   bytes/s  pulses used" << "\n";
+
+        for (const double speed : CMD_speeds)
+        {
+            for (const double jitter : CMD_jitters)
+            {
+                const bool       isNominal = (speed == 0.0 && CMD_drift == 0.0 && jitter == 0.0);
+                const LoadResult result    = isNominal ? nominal :
+                                             runLoad(preparePulses(tap, machineHz, speed, CMD_drift, jitter, CMD_seed));
+
+                std::string status = result.status;
+                if (result.ok && nominal.ok && result.checksum != nominal.checksum) status = "DATA MISMATCH";
+
+                // Data rate is measured from the header found till the end, the search time
+                // depends mostly on the leader length
+
+                const double searchSeconds = result.searchCycles / result.clockHz;
+                const double totalSeconds  = result.cycles / result.clockHz;
+                const double dataSeconds   = totalSeconds - searchSeconds;
+
+                snprintf(buf, sizeof(buf), "    %+7.1f  %8.1f  %-16.16s  %-16.16s  %6u  %8.2f  %8.2f  %8.2f  %8.1f  %6zu/%zu\n",
+                         speed, jitter, status.c_str(), result.fileName.c_str(), result.bytes(),
+                         searchSeconds, result.ok ? dataSeconds : 0.0, totalSeconds,
+                         (result.ok && dataSeconds > 0.0) ? result.bytes() / dataSeconds : 0.0,
+                         result.pulsesUsed, tap.pulses.size());
+                std::cout << buf;
+            }
+        }
+        std::cout << "\n";
+    }
+
+    // Save and check the results
+
+    std::string error;
+    if (!results.saveAndCompare(CMD_bchFile, CMD_basFile,
+                                "bench_tape results, format: tape.<TAP file>.cycles <value>",
+                                "tape loading performance", error))
+    {
+        ERROR(error);
+    }
+
+    return 0;
+}
@@ -0,0 +1,210 @@
+/*
+  VICE binary monitor protocol (x64 -binarymonitor) - constants and packet
+  framing, shared by collect_data and its mock server, mock_monitor.
+
+  Request:  STX, API version, body length (u32), request ID (u32), command (u8), body
+  Response: STX, API version, body length (u32), type (u8), error (u8), request ID (u32), body
+
+  All the multi-byte values are little endian. Events (checkpoint hit, CPU
+  stopped/resumed, etc.) are responses with request ID 0xffffffff.
+*/
+
+#ifndef BINMON_H
+#define BINMON_H
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define BINMON_STX                 0x02
+#define BINMON_API_VERSION         0x02
+#define BINMON_EVENT_ID            0xffffffffu
+
+#define BINMON_REQ_HEADER_SIZE     11
+#define BINMON_RSP_HEADER_SIZE     12
+#define BINMON_BUF_SIZE            0x20000
+
+/* Commands */
+
+#define BINMON_CMD_MEM_GET              0x01
+#define BINMON_CMD_MEM_SET              0x02
+#define BINMON_CMD_CHECKPOINT_SET       0x12
+#define BINMON_CMD_CHECKPOINT_DELETE    0x13
+#define BINMON_CMD_CHECKPOINT_TOGGLE    0x15
+#define BINMON_CMD_REGISTERS_GET        0x31
+#define BINMON_CMD_KEYBOARD_FEED        0x72
+#define BINMON_CMD_REGISTERS_AVAILABLE  0x83
+#define BINMON_CMD_EXIT                 0xaa
+#define BINMON_CMD_QUIT                 0xbb
+#define BINMON_CMD_RESET                0xcc
+
+/* Responses and events */
+
+#define BINMON_RSP_MEM_GET              0x01
+#define BINMON_RSP_MEM_SET              0x02
+#define BINMON_RSP_CHECKPOINT_INFO      0x11
+#define BINMON_RSP_CHECKPOINT_DELETE    0x13
+#define BINMON_RSP_CHECKPOINT_TOGGLE    0x15
+#define BINMON_RSP_REGISTER_INFO        0x31
+#define BINMON_RSP_JAM                  0x61
+#define BINMON_RSP_STOPPED              0x62
+#define BINMON_RSP_RESUMED              0x63
+#define BINMON_RSP_KEYBOARD_FEED        0x72
+#define BINMON_RSP_REGISTERS_AVAILABLE  0x83
+#define BINMON_RSP_EXIT                 0xaa
+#define BINMON_RSP_QUIT                 0xbb
+#define BINMON_RSP_RESET                0xcc
+
+#define BINMON_MEMSPACE_MAIN            0x00
+#define BINMON_OP_EXEC                  0x04
+
+typedef struct binmon_conn {
+  int            fd;
+
+  unsigned char *out;             /* pending output */
+  size_t         out_len;
+  size_t         out_size;
+
+  unsigned char  in[BINMON_BUF_SIZE];
+  size_t         in_len;
+} binmon_conn;
+
+typedef struct binmon_packet {
+  uint8_t        type;            /* command for requests, response type for responses */
+  uint8_t        error;
+  uint32_t       id;
+  uint32_t       length;
+  unsigned char  body[BINMON_BUF_SIZE];
+} binmon_packet;
+
+static inline void binmon_put16(unsigned char *p, unsigned v)
+{
+  p[0] = v & 0xff;
+  p[1] = (v >> 8) & 0xff;
+}
+
+static inline void binmon_put32(unsigned char *p, uint32_t v)
+{
+  binmon_put16(p, v & 0xffff);
+  binmon_put16(p + 2, v >> 16);
+}
+
+static inline unsigned binmon_get16(const unsigned char *p)
+{
+  return p[0] | (p[1] << 8);
+}
+
+static inline uint32_t binmon_get32(const unsigned char *p)
+{
+  return binmon_get16(p) | ((uint32_t) binmon_get16(p + 2) << 16);
+}
+
+static inline void binmon_init(binmon_conn *c, int fd)
+{
+  memset(c, 0, sizeof(*c));
+  c->fd = fd;
+}
+
+static inline void binmon_queue(binmon_conn *c, const unsigned char *data, size_t len)
+{
+  if (c->out_len + len > c->out_size) {
+    c->out_size = (c->out_len + len) * 2;
+    c->out = realloc(c->out, c->out_size);
+    if (!c->out) { perror("realloc"); exit(-1); }
+  }
+  memcpy(c->out + c->out_len, data, len);
+  c->out_len += len;
+}
+
+/* Write out as much of the pending output as possible; returns bytes still pending, or -1 */
+
+static inline long binmon_flush(binmon_conn *c)
+{
+  while (c->out_len) {
+    ssize_t n = write(c->fd, c->out, c->out_len);
+    if (n < 0) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+      if (errno == EINTR) continue;
+      return -1;
+    }
+    memmove(c->out, c->out + n, c->out_len - n);
+    c->out_len -= n;
+  }
+  return c->out_len;
+}
+
+/* Read once; returns bytes read, 0 on end of stream, -1 on error, -2 if there is nothing to read yet */
+
+static inline long binmon_fill(binmon_conn *c)
+{
+  for (;;) {
+    ssize_t n = read(c->fd, c->in + c->in_len, sizeof(c->in) - c->in_len);
+    if (n >= 0) {
+      c->in_len += n;
+      return n;
+    }
+    if (errno == EAGAIN || errno == EWOULDBLOCK) return -2;
+    if (errno != EINTR) return -1;
+  }
+}
+
+static inline void binmon_send_request(binmon_conn *c, uint32_t id, uint8_t cmd,
+                                       const unsigned char *body, uint32_t len)
+{
+  unsigned char hdr[BINMON_REQ_HEADER_SIZE];
+  hdr[0] = BINMON_STX;
+  hdr[1] = BINMON_API_VERSION;
+  binmon_put32(hdr + 2, len);
+  binmon_put32(hdr + 6, id);
+  hdr[10] = cmd;
+  binmon_queue(c, hdr, sizeof(hdr));
+  if (len) binmon_queue(c, body, len);
+}
+
+static inline void binmon_send_response(binmon_conn *c, uint8_t type, uint8_t error, uint32_t id,
+                                        const unsigned char *body, uint32_t len)
+{
+  unsigned char hdr[BINMON_RSP_HEADER_SIZE];
+  hdr[0] = BINMON_STX;
+  hdr[1] = BINMON_API_VERSION;
+  binmon_put32(hdr + 2, len);
+  hdr[6] = type;
+  hdr[7] = error;
+  binmon_put32(hdr + 8, id);
+  binmon_queue(c, hdr, sizeof(hdr));
+  if (len) binmon_queue(c, body, len);
+}
+
+/* Extract one packet from the input buffer; returns 1 if done, 0 if incomplete, -1 if malformed */
+
+static inline int binmon_take(binmon_conn *c, binmon_packet *p, int is_request)
+{
+  const size_t hdr_size = is_request ? BINMON_REQ_HEADER_SIZE : BINMON_RSP_HEADER_SIZE;
+
+  if (c->in_len < hdr_size) return 0;
+  if (c->in[0] != BINMON_STX) return -1;
+
+  p->length = binmon_get32(c->in + 2);
+  if (p->length > sizeof(c->in) - hdr_size) return -1;
+  if (c->in_len < hdr_size + p->length) return 0;
+
+  if (is_request) {
+    p->id    = binmon_get32(c->in + 6);
+    p->type  = c->in[10];
+    p->error = 0;
+  } else {
+    p->type  = c->in[6];
+    p->error = c->in[7];
+    p->id    = binmon_get32(c->in + 8);
+  }
+  memcpy(p->body, c->in + hdr_size, p->length);
+
+  c->in_len -= hdr_size + p->length;
+  memmove(c->in, c->in + hdr_size + p->length, c->in_len);
+  return 1;
+}
+
+#endif /* BINMON_H */
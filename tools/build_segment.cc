@@ -18,6 +18,8 @@
 #include <list>
 #include <map>
 #include <set>
+#include <sstream>
+#include <tuple>
 #include <vector>
 
 const std::string LAB_OUT_START = "__routine_START_";
@@ -35,6 +37,7 @@ std::string CMD_outDir    = "./out";
 std::string CMD_segName   = "MAIN";
 std::string CMD_segInfo   = "(unnamed)";
 std::string CMD_romLayout = "STD";
+std::string CMD_profile   = "";
 int         CMD_loAddress = 0xC000;
 int         CMD_hiAddress = 0xCFFF;
 
@@ -50,7 +53,7 @@ void printUsage()
         "usage: build_segment [-a <assembler command>] [-o <out file>] [-d <out dir>]" << "\n" <<
         "                     [-l <start/low address>] [-h <end/high address>]" << "\n" <<
         "                     [-s <segment name>] [-i <segment display info>]" << "\n" <<
-        "                     [-r <rom layout>]" << "\n" <<
+        "                     [-r <rom layout>] [-p <placement profile>]" << "\n" <<
         "                     <input dir/file list>" << "\n\n";
 }
 
@@ -149,6 +152,35 @@ public:
     int statWasted;
 };
 
+class PlacementProfile
+{
+public:
+
+    void load(const std::string &fileName, const std::string &segName);
+
+    bool empty() const { return routines.empty(); }
+    bool contains(const SourceFile *routine) const { return routines.count(routineName(routine)) != 0; }
+
+    uint64_t penalty(const SourceFile *routine, int startAddr) const;
+    uint64_t callCount(const SourceFile *caller, const SourceFile *callee) const;
+
+    static std::string routineName(const SourceFile *routine);
+
+private:
+
+    typedef struct RoutineProfile {
+        uint64_t cycles;
+        uint64_t calls;
+
+        // Instructions taking an extra cycle if the two offsets (relative to the routine
+        // start) are on different pages - taken branches and indexed reads
+        std::vector<std::tuple<int, int, uint64_t>> crossings;
+    } RoutineProfile;
+
+    std::map<std::string, RoutineProfile>                   routines;
+    std::map<std::pair<std::string, std::string>, uint64_t> pairs;
+};
+
 class Solver
 {
 public:
@@ -158,11 +190,14 @@ public:
 
     int selectGapToFill();
     void findPartialSolution(int gapSize, std::list<SourceFile *> &partialSolution);
+    void orderByProfile(int gapAddr, std::list<SourceFile *> &partialSolution);
 
 private:
 
     BinningProblem &problem;
 
+    uint64_t statCyclesSaved = 0;
+
     std::ofstream dbgOutput;
     DualStream    logOutput;
 };
@@ -176,6 +211,7 @@ std::list<SourceFile> GLOBAL_sourceFiles_noCode;
 size_t                GLOBAL_maxFileNameLen    = 0;
 size_t                GLOBAL_totalRoutinesSize = 0;
 BinningProblem        GLOBAL_binningProblem;
+PlacementProfile      GLOBAL_placementProfile;
 
 //
 // Top-level functions
@@ -187,7 +223,7 @@ void parseCommandLine(int argc, char **argv)
 
     // Retrieve command line options
 
-    while ((opt = getopt(argc, argv, "a:o:d:s:i:r:l:h:")) != -1)
+    while ((opt = getopt(argc, argv, "a:o:d:s:i:r:l:h:p:")) != -1)
     {
         switch(opt)
         {
@@ -197,6 +233,7 @@ void parseCommandLine(int argc, char **argv)
             case 's': CMD_segName   = optarg; break;
             case 'i': CMD_segInfo   = optarg; break;
             case 'r': CMD_romLayout = optarg; break;
+            case 'p': CMD_profile   = optarg; break;
             case 'l': CMD_loAddress = strtol(optarg, nullptr, 16); break;
             case 'h': CMD_hiAddress = strtol(optarg, nullptr, 16); break;
             default: printUsage(); ERROR();
@@ -430,6 +467,13 @@ void calcRoutineSizes()
     }
 }
 
+void readPlacementProfile()
+{
+    if (CMD_profile.empty()) return;
+
+    GLOBAL_placementProfile.load(CMD_profile, CMD_segName);
+}
+
 void prepareBinningProblem()
 {
     // Prepare the log file
@@ -555,8 +599,10 @@ void compileSegment()
         outFile << ";--- Source file " << routine.second->fileName << "\n\n";
         outFile << "!zone " << toLabel(routine.second->fileName) << "\n\n";
         outFile << "\t* = $" << std::hex << routine.first << "\n\n";
+        outFile << LAB_OUT_START << routine.second->label << ":" << "\n\n";
         outFile << std::string(routine.second->content.begin(), routine.second->content.end());
-        outFile << "\n";
+        outFile << "\n\n";
+        outFile << LAB_OUT_END << routine.second->label << ":" << "\n";
     }
 
     outFile << "\n\n";
@@ -593,6 +639,7 @@ int main(int argc, char **argv)
     readSourceFiles();
     checkInputFileLabels();
     calcRoutineSizes();
+    readPlacementProfile();
 
     prepareBinningProblem();
     solveBinningProblem();
@@ -1111,11 +1158,26 @@ void BinningProblem::addToProblem(SourceFile *routine)
 
 void BinningProblem::fillGap(std::ofstream &dbgOutput, int gapAddress, const std::list<SourceFile *> &routines)
 {
+    // A 'nullptr' on the list marks the place for the unused bytes (up to a page),
+    // by default they are left at the end of the gap
+
+    int usedBytes = 0;
+    for (auto &routine : routines) if (routine != nullptr) usedBytes += routine->codeLength;
+    const int unusedBytes = (gaps[gapAddress] - usedBytes) % 0x100;
+
     int offset = 0;
     std::string spacing;
 
     for (auto &routine : routines)
     {
+        if (routine == nullptr)
+        {
+            dbgOutput << "    $" << std::hex << gapAddress + offset << std::dec << ": " <<
+                         "(left unused: " << unusedBytes << ")" << "\n";
+            offset += unusedBytes;
+            continue;
+        }
+
         int targetAddr = gapAddress + offset;
 
         spacing.resize(GLOBAL_maxFileNameLen + 4 - routine->fileName.length(), ' ');
@@ -1133,6 +1195,7 @@ void BinningProblem::fillGap(std::ofstream &dbgOutput, int gapAddress, const std
 
     // Get rid of the gap, it's useless now
 
+    offset = usedBytes;
     if (offset == gaps[gapAddress])
     {
         dbgOutput << "filled to the last byte" << "\n";
@@ -1321,6 +1384,103 @@ void BinningProblem::sortFloatingRoutinesBySize()
     std::sort (floatingRoutines.begin(), floatingRoutines.end(), compare);
 }
 
+//
+// Class 'PlacementProfile'
+//
+
+void PlacementProfile::load(const std::string &fileName, const std::string &segName)
+{
+    // Profile is written by the 'profiler' tool; only take lines for our segment
+
+    std::ifstream inFile(fileName);
+    if (!inFile.good()) ERROR(std::string("unable to open placement profile '") + fileName + "'");
+
+    std::string line;
+    while (std::getline(inFile, line))
+    {
+        if (line.empty() || line[0] == '#') continue;
+
+        std::istringstream lineStream(line);
+        std::string kind, segment;
+        lineStream >> kind >> segment;
+
+        if (segment != segName) continue;
+
+        bool lineOK = false;
+        if (kind == "routine")
+        {
+            std::string name;
+            uint64_t    selfCycles, inclCycles, calls;
+            lineOK = bool(lineStream >> name >> selfCycles >> inclCycles >> calls);
+            if (lineOK)
+            {
+                routines[name].cycles = inclCycles;
+                routines[name].calls  = calls;
+            }
+        }
+        else if (kind == "pair")
+        {
+            std::string caller, callee;
+            uint64_t    calls;
+            lineOK = bool(lineStream >> caller >> callee >> calls);
+            if (lineOK) pairs[std::make_pair(caller, callee)] += calls;
+        }
+        else if (kind == "cross")
+        {
+            std::string name;
+            int         offset1, offset2;
+            uint64_t    count;
+            lineOK = bool(lineStream >> name >> offset1 >> offset2 >> count);
+            if (lineOK) routines[name].crossings.emplace_back(offset1, offset2, count);
+        }
+
+        if (!lineOK) ERROR(std::string("malformed placement profile line '") + line + "'");
+    }
+}
+
+uint64_t PlacementProfile::penalty(const SourceFile *routine, int startAddr) const
+{
+    auto iter = routines.find(routineName(routine));
+    if (iter == routines.end()) return 0;
+
+    uint64_t retVal = 0;
+    for (const auto &crossing : iter->second.crossings)
+    {
+        // Profile might be older than the code - ignore offsets which make no sense: the first one
+        // (branch source or table base) has to be within the routine, the second one (branch target
+        // or the address read) within the branch / index range from it - indexed reads can legally
+        // go past the routine end
+
+        const int offset1 = std::get<0>(crossing);
+        const int offset2 = std::get<1>(crossing);
+
+        if (offset1 > routine->codeLength || offset2 < std::max(0, offset1 - 128) || offset2 > offset1 + 255) continue;
+
+        if (((startAddr + offset1) >> 8) != ((startAddr + offset2) >> 8))
+        {
+            retVal += std::get<2>(crossing);
+        }
+    }
+
+    return retVal;
+}
+
+uint64_t PlacementProfile::callCount(const SourceFile *caller, const SourceFile *callee) const
+{
+    auto iter = pairs.find(std::make_pair(routineName(caller), routineName(callee)));
+    return (iter == pairs.end()) ? 0 : iter->second;
+}
+
+std::string PlacementProfile::routineName(const SourceFile *routine)
+{
+    // Profiler names routines after the labels, without the '_s' suffix
+
+    const std::string &label = routine->label;
+    if (label.length() > 2 && label.compare(label.length() - 2, 2, "_s") == 0) return label.substr(0, label.length() - 2);
+
+    return label;
+}
+
 //
 // Class 'Solver'
 //
@@ -1356,6 +1516,7 @@ void Solver::run()
 
         std::list<SourceFile *> partialSolution;
         findPartialSolution(problem.gaps[gapAddr], partialSolution);
+        if (!GLOBAL_placementProfile.empty()) orderByProfile(gapAddr, partialSolution);
         problem.fillGap(dbgOutput, gapAddr, partialSolution);
     }
 
@@ -1370,6 +1531,20 @@ void Solver::run()
         // logOutput << "    - total size:   " << problem.statSize << "\n"; - for BASIC contains filling gap too
         logOutput << "    - wasted bytes: " << problem.statWasted << "\n";
         logOutput << "    - still free:   " << problem.statFree - problem.statWasted << "\n";
+
+        if (!GLOBAL_placementProfile.empty())
+        {
+            uint64_t cyclesLost = 0;
+            for (const auto &routine : problem.fixedRoutines)
+            {
+                cyclesLost += GLOBAL_placementProfile.penalty(routine.second, routine.first);
+            }
+
+            logOutput << "profile guided placement, estimated page crossing cycles:" << "\n";
+            logOutput << "    - size-only:    " << cyclesLost + statCyclesSaved << "\n";
+            logOutput << "    - this layout:  " << cyclesLost << "\n";
+            logOutput << "    - saved:        " << statCyclesSaved << "\n";
+        }
     }
 
     // Close the log file
@@ -1542,3 +1717,116 @@ void Solver::findPartialSolution(int gapSize, std::list<SourceFile *> &partialSo
 
     return;
 }
+
+void Solver::orderByProfile(int gapAddr, std::list<SourceFile *> &partialSolution)
+{
+    // The knapsack solution only tells which routines fill the gap; their order (and
+    // the place of the unused bytes) is free. Choose it to avoid page crossings in the
+    // profiled code, as a secondary goal keep the frequently calling routines close.
+    // Only the routines present in the profile are moved.
+
+    std::vector<SourceFile *> order(partialSolution.begin(), partialSolution.end());
+
+    int usedBytes = 0;
+    for (const auto &routine : order) usedBytes += routine->codeLength;
+    const int unusedBytes = (problem.gaps[gapAddr] - usedBytes) % 0x100;
+
+    if (unusedBytes != 0) order.push_back(nullptr);
+
+    std::vector<std::tuple<SourceFile *, SourceFile *, uint64_t>> pairs;
+    for (const auto &caller : order)
+    {
+        for (const auto &callee : order)
+        {
+            if (caller == nullptr || callee == nullptr || caller == callee) continue;
+
+            const uint64_t calls = GLOBAL_placementProfile.callCount(caller, callee);
+            if (calls != 0) pairs.emplace_back(caller, callee, calls);
+        }
+    }
+
+    auto evaluate = [&](const std::vector<SourceFile *> &order) -> std::pair<uint64_t, uint64_t>
+    {
+        std::map<const SourceFile *, int> addresses;
+        uint64_t cycles   = 0;
+        uint64_t distance = 0;
+
+        int address = gapAddr;
+        for (const auto &routine : order)
+        {
+            if (routine == nullptr) { address += unusedBytes; continue; }
+
+            cycles += GLOBAL_placementProfile.penalty(routine, address);
+            addresses[routine] = address;
+            address += routine->codeLength;
+        }
+
+        for (const auto &pair : pairs)
+        {
+            distance += std::get<2>(pair) * std::abs(addresses[std::get<0>(pair)] - addresses[std::get<1>(pair)]);
+        }
+
+        return std::make_pair(cycles, distance);
+    };
+
+    std::vector<SourceFile *> movable;
+    for (const auto &routine : order)
+    {
+        if (routine == nullptr || GLOBAL_placementProfile.contains(routine)) movable.push_back(routine);
+    }
+
+    if (movable.empty() || (movable.size() == 1 && movable.front() == nullptr)) return;
+
+    // Local search - try to move each profiled routine (or the unused bytes) to every
+    // other position, accept whenever it helps; repeat until no improvement is found
+
+    const auto sizeOnlyCost = evaluate(order);
+    auto       bestCost     = sizeOnlyCost;
+
+    const unsigned MAX_PASSES = 16;
+    for (unsigned pass = 0; pass < MAX_PASSES; pass++)
+    {
+        bool improved = false;
+
+        for (const auto &routine : movable)
+        {
+            const auto iterRoutine = std::find(order.begin(), order.end(), routine);
+            const size_t position  = iterRoutine - order.begin();
+
+            std::vector<SourceFile *> candidate = order;
+            candidate.erase(candidate.begin() + position);
+
+            bool moved = false;
+            for (size_t newPosition = 0; newPosition <= candidate.size() && !moved; newPosition++)
+            {
+                if (newPosition == position) continue;
+
+                candidate.insert(candidate.begin() + newPosition, routine);
+                const auto cost = evaluate(candidate);
+                if (cost < bestCost)
+                {
+                    bestCost = cost;
+                    order    = candidate;
+                    moved    = true;
+                    improved = true;
+                }
+                candidate.erase(candidate.begin() + newPosition);
+            }
+        }
+
+        if (!improved) break;
+    }
+
+    if (bestCost.first < sizeOnlyCost.first)
+    {
+        dbgOutput << "profile guided order - estimated page crossing cycles: " << sizeOnlyCost.first <<
+                     " -> " << bestCost.first << "\n";
+        statCyclesSaved += sizeOnlyCost.first - bestCost.first;
+    }
+
+    // Unused bytes at the end are the default, no need to mark them
+
+    if (order.back() == nullptr) order.pop_back();
+
+    partialSolution.assign(order.begin(), order.end());
+}
@@ -0,0 +1,300 @@
+//
+// Commodore 5-byte floating point format - conversion from/to the host floating point
+// and a model of the BASIC ROM arithmetic; everything is usable in constant expressions
+//
+// Byte 0 is the exponent, biased by 0x80 (0 means the number is 0), bytes 1-4 are
+// the mantissa, big endian; the always set top mantissa bit is replaced by the sign
+//
+// The arithmetic works the way the ROM does it with FAC1 / FAC2: on the 32-bit mantissa
+// extended by the 8-bit rounding byte (FACOV), intermediate results are truncated, the
+// final one is rounded to nearest (as by 'round_FAC1', when storing the number). Results
+// which are too large saturate to the largest value, too small ones become 0.
+//
+
+#ifndef CBM_FLOAT_H
+#define CBM_FLOAT_H
+
+#include <cstdint>
+
+class CbmFloat
+{
+public:
+
+    uint8_t bytes[5] = { 0 };
+
+    // Unpacked access, as used by the FAC1 / FAC2 accumulators
+
+    constexpr bool     isZero()   const { return bytes[0] == 0; }
+    constexpr bool     negative() const { return (bytes[1] & 0x80) != 0; }
+    constexpr uint8_t  exponent() const { return bytes[0]; }
+    constexpr uint32_t mantissa() const
+    {
+        return 0x80000000 | (uint32_t(bytes[1]) << 24) | (uint32_t(bytes[2]) << 16) |
+                            (uint32_t(bytes[3]) << 8)  |  uint32_t(bytes[4]);
+    }
+
+    constexpr bool operator==(const CbmFloat &other) const
+    {
+        return bytes[0] == other.bytes[0] && bytes[1] == other.bytes[1] && bytes[2] == other.bytes[2] &&
+               bytes[3] == other.bytes[3] && bytes[4] == other.bytes[4];
+    }
+    constexpr bool operator!=(const CbmFloat &other) const { return !(*this == other); }
+
+    static constexpr CbmFloat fromParts(uint8_t exponent, uint32_t mantissa, bool negative)
+    {
+        CbmFloat result;
+        if (exponent == 0) return result;
+
+        result.bytes[0] = exponent;
+        result.bytes[1] = uint8_t(((mantissa >> 24) & 0x7F) | (negative ? 0x80 : 0x00));
+        result.bytes[2] = uint8_t(mantissa >> 16);
+        result.bytes[3] = uint8_t(mantissa >> 8);
+        result.bytes[4] = uint8_t(mantissa);
+        return result;
+    }
+
+    constexpr CbmFloat negated() const { return isZero() ? *this : fromParts(exponent(), mantissa(), !negative()); }
+    constexpr CbmFloat absolute() const { return fromParts(exponent(), mantissa(), false); }
+
+    // Conversion from the host format, mantissa rounded to nearest (ties away from zero);
+    // returns false if the absolute value is too large or too small to be represented
+
+    static constexpr bool fromHost(long double value, CbmFloat &result)
+    {
+        result = CbmFloat();
+        if (value == 0.0) return true;
+
+        // Bring the absolute value to 0.5 <= fraction < 1, as 'frexp' would do
+
+        long double fraction = (value < 0.0) ? -value : value;
+        int         exp2     = 0;
+
+        while (fraction >= 4294967296.0 && exp2 <= 0x80)
+        {
+            fraction /= 4294967296.0;
+            exp2 += 32;
+        }
+        while (fraction < 1.0 / 4294967296.0 && exp2 >= -0x80)
+        {
+            fraction *= 4294967296.0;
+            exp2 -= 32;
+        }
+        while (fraction >= 1.0)
+        {
+            if (exp2 > 0x80) return false;
+            fraction /= 2.0;
+            exp2++;
+        }
+        while (fraction < 0.5)
+        {
+            if (exp2 < -0x80) return false;
+            fraction *= 2.0;
+            exp2--;
+        }
+
+        const long double scaled  = fraction * 4294967296.0;
+        uint64_t          intPart = uint64_t(scaled);
+        if (scaled - intPart >= 0.5) intPart++;
+
+        if (intPart > 0xFFFFFFFF)
+        {
+            intPart = 0x80000000;
+            exp2++;
+        }
+
+        exp2 += 0x80;
+        if (exp2 > 0xFF || exp2 <= 0) return false;
+
+        result = fromParts(uint8_t(exp2), uint32_t(intPart), value < 0.0);
+        return true;
+    }
+
+    // As above, but saturating - too large values become the largest one, too small become 0
+
+    static constexpr CbmFloat fromHost(long double value)
+    {
+        CbmFloat result;
+        if (fromHost(value, result)) return result;
+
+        const long double absValue = (value < 0.0) ? -value : value;
+        return (absValue > 1.0) ? fromParts(0xFF, 0xFFFFFFFF, value < 0.0) : CbmFloat();
+    }
+
+    constexpr long double toHost() const
+    {
+        if (isZero()) return 0.0;
+
+        const long double value = scale2(mantissa(), int(exponent()) - 0x80 - 32);
+        return negative() ? -value : value;
+    }
+
+    // Value of the least significant mantissa bit, for the given exponent
+
+    static constexpr long double ulp(uint8_t exponent) { return scale2(1.0, int(exponent) - 0x80 - 32); }
+
+    // Largest and smallest representable absolute values
+
+    static constexpr CbmFloat maxValue() { return fromParts(0xFF, 0xFFFFFFFF, false); }
+    static constexpr CbmFloat minValue() { return fromParts(0x01, 0x80000000, false); }
+
+    //
+    // Arithmetic model; 'overflow' (optional) is set if the ROM would report an error
+    //
+
+    static constexpr CbmFloat add(const CbmFloat &a, const CbmFloat &b, bool *overflow = nullptr)
+    {
+        if (b.isZero()) return a;
+        if (a.isZero()) return b;
+
+        // Align the mantissas - bits shifted out of the rounding byte are lost
+
+        Fac big   = Fac::unpack(a);
+        Fac small = Fac::unpack(b);
+        if (small.exponent > big.exponent || (small.exponent == big.exponent && small.extended > big.extended))
+        {
+            const Fac tmp = big;
+            big   = small;
+            small = tmp;
+        }
+
+        const int shift = big.exponent - small.exponent;
+        small.extended  = (shift >= 40) ? 0 : (small.extended >> shift);
+
+        if (big.negative == small.negative)
+        {
+            big.extended += small.extended;
+            if (big.extended >= EXT_OVERFLOW)
+            {
+                big.extended >>= 1;
+                big.exponent++;
+            }
+        }
+        else
+        {
+            big.extended -= small.extended;
+        }
+
+        return big.normalized().rounded(overflow);
+    }
+
+    static constexpr CbmFloat sub(const CbmFloat &a, const CbmFloat &b, bool *overflow = nullptr)
+    {
+        return add(a, b.negated(), overflow);
+    }
+
+    static constexpr CbmFloat mul(const CbmFloat &a, const CbmFloat &b, bool *overflow = nullptr)
+    {
+        if (a.isZero() || b.isZero()) return CbmFloat();
+
+        // Keep the upper 40 bits of the 64-bit mantissa product
+
+        Fac result;
+        result.negative = a.negative() != b.negative();
+        result.exponent = int(a.exponent()) + int(b.exponent()) - 0x80;
+        result.extended = (uint64_t(a.mantissa()) * b.mantissa()) >> 24;
+
+        return result.normalized().rounded(overflow);
+    }
+
+    static constexpr CbmFloat div(const CbmFloat &a, const CbmFloat &b, bool *overflow = nullptr)
+    {
+        if (b.isZero())
+        {
+            if (overflow != nullptr) *overflow = true;      // DIVISION BY ZERO
+            return fromParts(0xFF, 0xFFFFFFFF, a.negative());
+        }
+        if (a.isZero()) return CbmFloat();
+
+        // Quotient with the rounding byte, truncated - the same bits the ROM shift-and-subtract
+        // loop produces, but computed in two steps, 32 + 8 bits
+
+        const uint64_t upper     = (uint64_t(a.mantissa()) << 32) / b.mantissa();
+        const uint64_t remainder = (uint64_t(a.mantissa()) << 32) % b.mantissa();
+        const uint64_t quotient  = (upper << 8) | ((remainder << 8) / b.mantissa());
+
+        Fac result;
+        result.negative = a.negative() != b.negative();
+        result.exponent = int(a.exponent()) - int(b.exponent()) + 0x80;
+        result.extended = quotient;
+        if (result.extended >= EXT_OVERFLOW)
+        {
+            result.extended >>= 1;
+            result.exponent++;
+        }
+
+        return result.normalized().rounded(overflow);
+    }
+
+private:
+
+    static constexpr uint64_t EXT_TOP_BIT  = uint64_t(1) << 39;
+    static constexpr uint64_t EXT_OVERFLOW = uint64_t(1) << 40;
+
+    // Multiplies by a power of 2; exact, unlike repeated scaling by other factors
+
+    static constexpr long double scale2(long double value, int exp2)
+    {
+        while (exp2 >= 32)  { value *= 4294967296.0; exp2 -= 32; }
+        while (exp2 <= -32) { value /= 4294967296.0; exp2 += 32; }
+        while (exp2 > 0)    { value *= 2.0;          exp2--;     }
+        while (exp2 < 0)    { value /= 2.0;          exp2++;     }
+        return value;
+    }
+
+    // Accumulator - the mantissa extended by the rounding byte, the exponent not limited to 8 bits
+
+    struct Fac
+    {
+        int      exponent = 0;
+        uint64_t extended = 0;      // 40 bits, normalized if bit 39 is set
+        bool     negative = false;
+
+        static constexpr Fac unpack(const CbmFloat &value)
+        {
+            Fac result;
+            result.exponent = value.exponent();
+            result.extended = uint64_t(value.mantissa()) << 8;
+            result.negative = value.negative();
+            return result;
+        }
+
+        constexpr Fac normalized() const
+        {
+            Fac result = *this;
+            if (result.extended == 0) return Fac();
+
+            while (result.extended < EXT_TOP_BIT)
+            {
+                result.extended <<= 1;
+                result.exponent--;
+            }
+            return result;
+        }
+
+        constexpr CbmFloat rounded(bool *overflow) const
+        {
+            if (extended == 0 || exponent <= 0) return CbmFloat();
+
+            uint64_t mantissa = extended >> 8;
+            int      exp2     = exponent;
+            if (extended & 0x80)
+            {
+                if (++mantissa > 0xFFFFFFFF)
+                {
+                    mantissa = 0x80000000;
+                    exp2++;
+                }
+            }
+
+            if (exp2 > 0xFF)
+            {
+                if (overflow != nullptr) *overflow = true;  // OVERFLOW
+                return fromParts(0xFF, 0xFFFFFFFF, negative);
+            }
+
+            return fromParts(uint8_t(exp2), uint32_t(mantissa), negative);
+        }
+    };
+};
+
+#endif // CBM_FLOAT_H
@@ -15,10 +15,35 @@ along with this program; if not, write to the Free Software
 Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 */
 
+/*
+  Collects the ROM entries (calls and interrupts) made by a program running
+  in VICE, talking to its binary monitor (x64 -binarymonitor).
+
+  Instead of single stepping, execution checkpoints are used: while the CPU
+  is outside the ROM range, checkpoints covering the ROM are enabled - when
+  one hits, the entry is reported and checkpoints covering the rest of the
+  memory are enabled instead, to catch the return. The interrupt handlers
+  have checkpoints of their own, so each ROM call costs two stops.
+
+  The caller reported for an entry is the JSR instruction address; if the
+  ROM was entered otherwise (JMP, RTS, RTI), there is no single step history
+  to find the instruction which jumped in - the last PC seen outside the ROM
+  (normally where the CPU came back from the ROM) is reported instead, see
+  trace_format.h.
+
+  Cycle numbers are reconstructed from the raster position (LIN and CYC
+  registers) - the binary monitor does not provide the CPU clock. This needs
+  at least one stop per frame, which is normally guaranteed by the KERNAL IRQ;
+  if the interrupt handler stops come too early for the interrupt period, some
+  frames had no stop at all - such gaps are reported on stderr and marked by
+  a '#' comment line in the text trace, the cycle numbers after the gap are
+  too low by a whole number of frames.
+*/
+
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/epoll.h>
 #include <netinet/in.h>
-#include <arpa/inet.h>
 #include <netdb.h>
 #include <stdio.h>
 #include <unistd.h>
@@ -27,60 +52,451 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include <fcntl.h>
 #include <getopt.h>
 
-//file found = 1
-//file not found = 0
-
-//write and overwrite =1
-//apend =0
-
-//tcpclient IP port
-//argc1, argv0: tcpclient.exe
-//argc2, argv1: IP address TCP Server
-//argv3, argv2: TCP Server port
+#include "binmon.h"
+#include "trace_format.h"
 
 int set_nonblock(int fd)
 {
-  int retVal=0;
-
-
-  do {
-    if (fd==-1) break;
-      
-    int flags;
-    if ((flags = fcntl(fd, F_GETFL, NULL)) == -1)
-      {
-        perror("fcntl");
-//        LOG_ERROR("set_nonblock: fcntl(%d,F_GETFL,NULL)",fd);
-        retVal=-1;
-        break;
-      }
-    if (fcntl(fd, F_SETFL, flags | O_NONBLOCK | O_NDELAY) == -1)
-    {
-      perror("fcntl");
-//      LOG_ERROR("set_nonblock: fcntl(%d,F_SETFL,n|O_NONBLOCK)",fd);
-      return -1;
-    }
-  } while (0);
-  return retVal;
+  int flags;
+
+  if (fd == -1) return -1;
+  if ((flags = fcntl(fd, F_GETFL, NULL)) == -1) {
+    perror("fcntl");
+    return -1;
+  }
+  if (fcntl(fd, F_SETFL, flags | O_NONBLOCK | O_NDELAY) == -1) {
+    perror("fcntl");
+    return -1;
+  }
+  return 0;
 }
 
 #define MAX_KEYS 1024
-int key_times[MAX_KEYS];
+unsigned long long key_times[MAX_KEYS];
 char key_sequences[MAX_KEYS][1024];
-int key_count=0;
+int key_count = 0;
 
-int main (int argc, char *argv[]) {
+/* Checkpoints */
+
+enum { CP_ENTRY, CP_EXIT, CP_IRQ, CP_NMI, CP_LOAD };
+
+#define MAX_CHECKPOINTS 16
+
+typedef struct checkpoint {
+  int      kind;
+  unsigned start, end;
+  int      enabled;
+  uint32_t request_id;    /* of the CHECKPOINT_SET request */
+  uint32_t number;        /* assigned by the monitor */
+  int      valid;
+} checkpoint;
+
+checkpoint checkpoints[MAX_CHECKPOINTS];
+int checkpoint_count = 0;
+
+/* Session state */
+
+binmon_conn conn;
+binmon_packet packet;
+uint32_t next_id = 1;
+
+unsigned long long collect_cycles = 5000000;
+unsigned rom_bottom = 0xa000;
+unsigned rom_top = 0xffff;
+unsigned load_trigger = 0xe5cd;
+char *filename = NULL;
+
+trace_stream text_trace, binary_trace;
+FILE *binary_trace_file = NULL;
+
+unsigned cycles_per_line = 63, lines_per_frame = 312;
+
+int reg_id_pc = -1, reg_id_sp = -1, reg_id_lin = -1, reg_id_cyc = -1;
+unsigned reg_pc, reg_sp, reg_lin, reg_cyc;
+
+uint32_t vectors_req = 0, initial_regs_req = 0, stack_req = 0, caller_req = 0, quit_req = 0;
+
+int in_rom = 0;
+int running = 0;
+int hits = 0;
+int current_key = 0;
+unsigned last_outside_pc = 0;
+unsigned entry_pc = 0, entry_caller = 0;
+
+unsigned long long frames = 0, cycles = 0;
+unsigned last_raster_pos = 0;
+
+#define IRQ_JITTER 64               /* interrupt latency differences, in cycles */
+
+unsigned long long last_irq_cycles = 0, irq_period = 0;
+int irq_seen = 0;
+unsigned frame_gaps = 0;
+
+uint32_t request(uint8_t cmd, const unsigned char *body, uint32_t len)
+{
+  uint32_t id = next_id++;
+  binmon_send_request(&conn, id, cmd, body, len);
+  return id;
+}
+
+int is_rom(unsigned addr)
+{
+  if (addr >= 0xc000 && addr < 0xe000) return 0;
+  return addr >= rom_bottom && addr <= rom_top;
+}
+
+void add_checkpoint(int kind, unsigned start, unsigned end)
+{
+  if (start > end) return;
+  if (checkpoint_count >= MAX_CHECKPOINTS) {
+    fprintf(stderr, "Too many checkpoints\n");
+    exit(-1);
+  }
+  checkpoints[checkpoint_count].kind = kind;
+  checkpoints[checkpoint_count].start = start;
+  checkpoints[checkpoint_count].end = end;
+  checkpoint_count++;
+}
+
+int checkpoint_wanted(const checkpoint *cp)
+{
+  switch (cp->kind) {
+  case CP_ENTRY: return !in_rom;
+  case CP_EXIT:  return in_rom;
+  case CP_LOAD:  return filename != NULL;
+  default:       return 1;
+  }
+}
+
+void set_checkpoints(void)
+{
+  // Ranges, which have to be split around $C000-$DFFF (RAM and I/O area)
+
+  unsigned rom_lo = rom_bottom, rom_hi = rom_top;
+  if (rom_lo < 0xc000) add_checkpoint(CP_ENTRY, rom_lo, rom_hi < 0xc000 ? rom_hi : 0xbfff);
+  if (rom_hi >= 0xe000) add_checkpoint(CP_ENTRY, rom_lo > 0xe000 ? rom_lo : 0xe000, rom_hi);
+
+  if (rom_lo > 0) add_checkpoint(CP_EXIT, 0x0000, rom_lo - 1);
+  if (rom_lo < 0xe000 && rom_hi >= 0xc000) add_checkpoint(CP_EXIT, 0xc000, 0xdfff);
+  if (rom_hi < 0xffff) add_checkpoint(CP_EXIT, rom_hi + 1, 0xffff);
+
+  for (int i = 0; i < checkpoint_count; i++) {
+    checkpoint *cp = &checkpoints[i];
+    unsigned char body[9];
+
+    cp->enabled = checkpoint_wanted(cp);
+
+    binmon_put16(body, cp->start);
+    binmon_put16(body + 2, cp->end);
+    body[4] = 1;                    /* stop when hit */
+    body[5] = cp->enabled;
+    body[6] = BINMON_OP_EXEC;
+    body[7] = 0;                    /* not temporary */
+    body[8] = BINMON_MEMSPACE_MAIN;
+    cp->request_id = request(BINMON_CMD_CHECKPOINT_SET, body, sizeof(body));
+  }
+}
+
+void update_checkpoints(void)
+{
+  // Toggle checkpoints to follow the CPU - they are all batched before the next 'exit'
+
+  for (int i = 0; i < checkpoint_count; i++) {
+    checkpoint *cp = &checkpoints[i];
+    int wanted = checkpoint_wanted(cp);
+    unsigned char body[5];
+
+    if (!cp->valid || cp->enabled == wanted) continue;
+
+    binmon_put32(body, cp->number);
+    body[4] = wanted;
+    request(BINMON_CMD_CHECKPOINT_TOGGLE, body, sizeof(body));
+    cp->enabled = wanted;
+  }
+}
+
+void mem_get(unsigned start, unsigned end, uint32_t *req)
+{
+  unsigned char body[8];
+
+  body[0] = 0;                      /* no side effects */
+  binmon_put16(body + 1, start);
+  binmon_put16(body + 3, end);
+  body[5] = BINMON_MEMSPACE_MAIN;
+  binmon_put16(body + 6, 0);        /* default bank */
+  *req = request(BINMON_CMD_MEM_GET, body, sizeof(body));
+}
+
+void mem_set(unsigned start, const unsigned char *data, unsigned len)
+{
+  static unsigned char body[8 + 0x10000];
+
+  body[0] = 0;
+  binmon_put16(body + 1, start);
+  binmon_put16(body + 3, start + len - 1);
+  body[5] = BINMON_MEMSPACE_MAIN;
+  binmon_put16(body + 6, 0);
+  memcpy(body + 8, data, len);
+  request(BINMON_CMD_MEM_SET, body, 8 + len);
+}
+
+void resume(void)
+{
+  update_checkpoints();
+  request(BINMON_CMD_EXIT, NULL, 0);
+  running = 1;
+  hits = 0;
+}
+
+void keyboard_feed(const char *keys)
+{
+  // Keys are given in the VICE 'keybuf' syntax, with '\xNN' escapes
+
+  unsigned char body[256];
+  unsigned len = 0;
+
+  while (*keys && len < sizeof(body) - 1) {
+    unsigned value;
+    if (keys[0] == '\\' && keys[1] == 'x' && sscanf(keys + 2, "%2x", &value) == 1) {
+      body[1 + len++] = value;
+      keys += 4;
+    } else {
+      body[1 + len++] = *keys++;
+    }
+  }
+  body[0] = len;
+  request(BINMON_CMD_KEYBOARD_FEED, body, len + 1);
+}
+
+void load_program(void)
+{
+  // Put the program in memory the way LOAD does, then RUN it
+
+  static unsigned char data[0x10000];
+  unsigned char ptr[2];
+
+  FILE *f = fopen(filename, "rb");
+  if (!f) {
+    perror(filename);
+    exit(-1);
+  }
+  size_t len = fread(data, 1, sizeof(data), f);
+  fclose(f);
+  if (len < 3) {
+    fprintf(stderr, "File '%s' is too short\n", filename);
+    exit(-1);
+  }
+
+  unsigned start = binmon_get16(data);
+  unsigned end = start + len - 2;
+  if (end > 0x10000) end = 0x10000;
+
+  mem_set(start, data + 2, end - start);
+  if (start == 0x0801) {
+    ptr[0] = 0;
+    mem_set(0x0800, ptr, 1);
+  }
+  binmon_put16(ptr, end);
+  mem_set(0x002d, ptr, 2);          /* VARTAB */
+
+  keyboard_feed("run\\x0d");
+  fprintf(stderr, ">>> Loaded '%s' at $%04x-$%04x\n", filename, start, end - 1);
+
+  filename = NULL;
+}
+
+void report_entry(int kind, unsigned pc, unsigned from)
+{
+  trace_entry entry = { kind, pc, from, cycles };
+
+  trace_write(&text_trace, &entry);
+  if (binary_trace_file) trace_write(&binary_trace, &entry);
+}
+
+void update_cycles(void)
+{
+  unsigned raster_pos = reg_lin * cycles_per_line + reg_cyc;
+
+  if (raster_pos < last_raster_pos) frames++;
+  last_raster_pos = raster_pos;
+  cycles = frames * cycles_per_line * lines_per_frame + raster_pos;
+}
+
+void check_frame_gap(void)
+{
+  // Interrupt handler stops come once per interrupt period, or later if the interrupt was
+  // delayed; a delay over (frame - period) cycles could lose a frame. An interval shorter
+  // than (period - that delay) can only be measured if frames were lost in between
+
+  unsigned long long frame = cycles_per_line * lines_per_frame;
+  unsigned long long interval = cycles - last_irq_cycles;
+  int regular = irq_period == 0 || (interval + IRQ_JITTER >= irq_period && interval <= irq_period + IRQ_JITTER);
+
+  if (irq_seen && irq_period != 0 && interval + frame < 2 * irq_period) {
+    frame_gaps++;
+    printf("# frames lost between cycle %llu and %llu\n", last_irq_cycles, cycles);
+    fprintf(stderr, ">>> Frames lost between cycle %llu and %llu, later cycle numbers are too low\n",
+            last_irq_cycles, cycles);
+  } else if (irq_seen && regular) {
+    irq_period = interval;
+  }
+
+  irq_seen = 1;
+  last_irq_cycles = cycles;
+}
+
+void handle_stop(void)
+{
+  update_cycles();
+  if (hits & (1 << CP_IRQ)) check_frame_gap();
+
+  if (current_key < key_count && cycles > key_times[current_key]) {
+    keyboard_feed(key_sequences[current_key]);
+    fprintf(stderr, ">>> Keyboard injection: %s\n", key_sequences[current_key]);
+    current_key++;
+  }
+
+  // Terminate emulator when done
+
+  if (cycles >= collect_cycles) {
+    quit_req = request(BINMON_CMD_QUIT, NULL, 0);
+    return;
+  }
+
+  if (hits & (1 << CP_LOAD)) load_program();
+
+  if (hits & ((1 << CP_IRQ) | (1 << CP_NMI))) {
+    if (is_rom(reg_pc)) report_entry(TRACE_KIND_INTERRUPT, reg_pc, 0);
+    in_rom = is_rom(reg_pc);
+    resume();
+  } else if (hits & (1 << CP_ENTRY)) {
+    // Find out the caller - a JSR leaves its address + 2 on the stack
+
+    in_rom = 1;
+    entry_pc = reg_pc;
+    mem_get(0x0100, 0x01ff, &stack_req);
+  } else if (hits & (1 << CP_EXIT)) {
+    in_rom = 0;
+    last_outside_pc = reg_pc;
+    resume();
+  } else {
+    in_rom = is_rom(reg_pc);
+    resume();
+  }
+}
+
+void handle_response(const binmon_packet *p)
+{
+  if (p->error) {
+    fprintf(stderr, "Monitor error $%02x, response type $%02x, request %u\n", p->error, p->type, p->id);
+    exit(-1);
+  }
+
+  switch (p->type) {
+  case BINMON_RSP_REGISTERS_AVAILABLE: {
+    unsigned count = binmon_get16(p->body), pos = 2;
+    for (unsigned i = 0; i < count && pos < p->length; i++) {
+      unsigned item_size = p->body[pos];
+      unsigned id = p->body[pos + 1];
+      unsigned name_len = p->body[pos + 3];
+      char name[256];
+      memcpy(name, p->body + pos + 4, name_len);
+      name[name_len] = 0;
+      if (!strcmp(name, "PC")) reg_id_pc = id;
+      if (!strcmp(name, "SP")) reg_id_sp = id;
+      if (!strcmp(name, "LIN")) reg_id_lin = id;
+      if (!strcmp(name, "CYC")) reg_id_cyc = id;
+      pos += item_size + 1;
+    }
+    if (reg_id_pc < 0 || reg_id_sp < 0 || reg_id_lin < 0 || reg_id_cyc < 0) {
+      fprintf(stderr, "Monitor does not provide PC, SP, LIN and CYC registers\n");
+      exit(-1);
+    }
+    break;
+  }
 
-  int collect_cycles=5000000;
-  
-  // KERNAL part is actually just under 7KB
-  int rom_bottom=0xa000;
-  int rom_top=0xffff;
-  char *filename=NULL;
+  case BINMON_RSP_REGISTER_INFO: {
+    unsigned count = binmon_get16(p->body), pos = 2;
+    for (unsigned i = 0; i < count && pos < p->length; i++) {
+      unsigned item_size = p->body[pos];
+      int id = p->body[pos + 1];
+      unsigned value = binmon_get16(p->body + pos + 2);
+      if (id == reg_id_pc) reg_pc = value;
+      if (id == reg_id_sp) reg_sp = value;
+      if (id == reg_id_lin) reg_lin = value;
+      if (id == reg_id_cyc) reg_cyc = value;
+      pos += item_size + 1;
+    }
+    if (p->id == initial_regs_req) {
+      // Machine is reset, start collecting
+
+      in_rom = is_rom(reg_pc);
+      update_cycles();
+      set_checkpoints();
+      resume();
+    }
+    break;
+  }
+
+  case BINMON_RSP_MEM_GET: {
+    const unsigned char *data = p->body + 2;
+    if (p->id == vectors_req) {
+      unsigned nmi = binmon_get16(data), irq = binmon_get16(data + 4);
+      add_checkpoint(CP_NMI, nmi, nmi);
+      add_checkpoint(CP_IRQ, irq, irq);
+      if (filename) add_checkpoint(CP_LOAD, load_trigger, load_trigger);
+
+      unsigned char body[1] = { BINMON_MEMSPACE_MAIN };
+      initial_regs_req = request(BINMON_CMD_REGISTERS_GET, body, sizeof(body));
+    } else if (p->id == stack_req) {
+      unsigned ret = data[(reg_sp + 1) & 0xff] | (data[(reg_sp + 2) & 0xff] << 8);
+      entry_caller = (ret - 2) & 0xffff;
+      mem_get(entry_caller, (entry_caller + 2) & 0xffff, &caller_req);
+    } else if (p->id == caller_req) {
+      // If not a JSR (JMP, RTS, etc.) - report where the CPU was last seen outside the ROM
+
+      if (data[0] == 0x20 && binmon_get16(data + 1) == entry_pc) report_entry(TRACE_KIND_CALL, entry_pc, entry_caller);
+      else report_entry(TRACE_KIND_CALL, entry_pc, last_outside_pc);
+      resume();
+    }
+    break;
+  }
+
+  case BINMON_RSP_CHECKPOINT_INFO:
+    for (int i = 0; i < checkpoint_count; i++) {
+      checkpoint *cp = &checkpoints[i];
+      if (p->id == BINMON_EVENT_ID && cp->valid && cp->number == binmon_get32(p->body)) hits |= 1 << cp->kind;
+      if (p->id == cp->request_id) {
+        cp->number = binmon_get32(p->body);
+        cp->valid = 1;
+      }
+    }
+    break;
 
+  case BINMON_RSP_STOPPED:
+    if (running) {
+      running = 0;
+      handle_stop();
+    }
+    break;
+
+  case BINMON_RSP_JAM:
+    fprintf(stderr, "CPU JAM at $%04x\n", binmon_get16(p->body));
+    quit_req = request(BINMON_CMD_QUIT, NULL, 0);
+    break;
+
+  default:
+    break;
+  }
+}
+
+int main (int argc, char *argv[]) {
+
+  const char *host = "localhost";
+  const char *port = "6502";
   int opt;
-  
-  while ((opt = getopt(argc, argv, "f:b:t:c:k:v:")) != -1) {
+
+  while ((opt = getopt(argc, argv, "f:b:t:c:k:v:l:no:")) != -1) {
     switch (opt) {
     case 'b':
       rom_bottom=strtoll(optarg,NULL,16);
@@ -92,10 +508,24 @@ int main (int argc, char *argv[]) {
       filename=optarg;
       break;
     case 'c':
-      collect_cycles=atoi(optarg);
+      collect_cycles=strtoull(optarg,NULL,10);
+      break;
+    case 'l':
+      load_trigger=strtoll(optarg,NULL,16);
+      break;
+    case 'o':
+      binary_trace_file = fopen(optarg, "wb");
+      if (!binary_trace_file) {
+        perror(optarg);
+        exit(-1);
+      }
+      break;
+    case 'n':
+      cycles_per_line = 65;
+      lines_per_frame = 263;
       break;
     case 'v':
-      system(optarg);
+      if (system(optarg) != 0) fprintf(stderr,"Warning: VICE command line returned an error\n");
       sleep(3);
       break;
     case 'k':
@@ -104,7 +534,7 @@ int main (int argc, char *argv[]) {
 	fprintf(stderr,"Too many -k arguments. Increase MAX_KEYS?\n");
 	exit(-1);
       }
-      if (sscanf(optarg,"%d:%[^~]",&key_times[key_count],key_sequences[key_count])<2) {
+      if (sscanf(optarg,"%llu:%1023[^~]",&key_times[key_count],key_sequences[key_count])<2) {
 	fprintf(stderr,"Malformed argument to -k. Must be <cycle number>:<VICE compatible key sequence>\n"
 		"  RETURN should be written \\x0d\n"
 		"\n");
@@ -113,150 +543,122 @@ int main (int argc, char *argv[]) {
       key_count++;
       break;
     default: /* '?' */
-      fprintf(stderr, "Usage: %s [-v <vice command line>] [-b <ROM bottom hex>] [-t <ROM top hex>] [-f <file to load and run>] [-c <cycles to collect data>] [[-k <time>:<key sequence> ] ...]\n",
+      fprintf(stderr, "Usage: %s [-v <vice command line>] [-b <ROM bottom hex>] [-t <ROM top hex>] [-f <file to load and run>]\n"
+              "       [-l <load trigger address hex>] [-c <cycles to collect data>] [-n] [-o <binary trace file>]\n"
+              "       [[-k <time>:<key sequence> ] ...]\n"
+              "       [<binary monitor host> [<port>]]\n"
+              "  -n  NTSC machine (default is PAL)\n"
+              "  -o  write the trace in binary format too (see trace_format.h)\n",
 	      argv[0]);
       exit(-1);
     }
   }
 
-    int sockfd, rc, serverPort, nBytes;
-    struct sockaddr_in localAddr, servAddr;
-    struct hostent *h;
+  trace_init(&text_trace, stdout, 0);
+  if (binary_trace_file) {
+    trace_init(&binary_trace, binary_trace_file, 1);
+    trace_write_header(&binary_trace);
+  }
 
-    /* Check parameters from command line */
+  if (optind < argc) host = argv[optind++];
+  if (optind < argc) port = argv[optind++];
 
-    serverPort = 6510;
-    if(serverPort<=0 || serverPort>65535)//check number of TCP server port
-    {
-        fprintf(stderr, "The port number given is wrong.\n");
-        return -1;
-    }
+  /* Connect to the binary monitor */
 
-    h = gethostbyname("localhost");
-    if(h==NULL)//check assigment of TCP server host
-    {
-        perror("Unknown host ");
-        return -1;
-    }
+  struct addrinfo hints, *addrs;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  if (getaddrinfo(host, port, &hints, &addrs) != 0) {
+    fprintf(stderr, "Unknown host '%s'\n", host);
+    return -1;
+  }
 
-    /* Create TCP socket */
-    
-    servAddr.sin_family = h->h_addrtype;
-    memcpy((char *) &servAddr.sin_addr.s_addr, h->h_addr_list[0], h->h_length);
-    servAddr.sin_port = htons(serverPort);
-
-    sockfd = socket(AF_INET, SOCK_STREAM, 0);
-    if(sockfd < 0)//check TCP socket is created correctly
-    {
-        perror("Cannot open socket ");
-        return -1;
-    }
+  int sockfd = -1;
+  for (struct addrinfo *addr = addrs; addr; addr = addr->ai_next) {
+    sockfd = socket(addr->ai_family, addr->ai_socktype, addr->ai_protocol);
+    if (sockfd < 0) continue;
+    if (connect(sockfd, addr->ai_addr, addr->ai_addrlen) == 0) break;
+    close(sockfd);
+    sockfd = -1;
+  }
+  freeaddrinfo(addrs);
 
-    /* Bind any port number */
+  if (sockfd < 0) {
+    perror("Cannot connect ");
+    return -1;
+  }
+
+  printf("Starting TCP client...\n");
+
+  set_nonblock(sockfd);
+  binmon_init(&conn, sockfd);
+
+  int epfd = epoll_create1(0);
+  struct epoll_event ev;
+  memset(&ev, 0, sizeof(ev));
+  ev.events = EPOLLIN;
+  ev.data.fd = sockfd;
+  if (epfd < 0 || epoll_ctl(epfd, EPOLL_CTL_ADD, sockfd, &ev) < 0) {
+    perror("epoll");
+    return -1;
+  }
 
-    localAddr.sin_family = AF_INET;
-    localAddr.sin_addr.s_addr = htonl(INADDR_ANY);
-    localAddr.sin_port = htons(0);
+  /* Reset the machine, find out register IDs and interrupt handlers */
 
-    rc = bind(sockfd, (struct sockaddr *) &localAddr, sizeof(localAddr));
-    if(rc < 0)//check TCP socket is bind correctly
-    {
-        perror("Cannot bind on TCP port ");
-        close(sockfd);
-        return -1;
+  unsigned char body[1] = { BINMON_MEMSPACE_MAIN };
+  request(BINMON_CMD_REGISTERS_AVAILABLE, body, sizeof(body));
+  body[0] = 0;                      /* soft reset */
+  request(BINMON_CMD_RESET, body, sizeof(body));
+  mem_get(0xfffa, 0xffff, &vectors_req);
+
+  /* Event loop */
+
+  int done = 0;
+  while (!done) {
+    // Only wait for the socket to become writable if there is something to write
+
+    long pending = binmon_flush(&conn);
+    if (pending < 0) {
+      perror("write");
+      break;
     }
 
-    /* Connect to TCP server */
+    uint32_t wanted = EPOLLIN | (pending ? EPOLLOUT : 0);
+    if (ev.events != wanted) {
+      ev.events = wanted;
+      epoll_ctl(epfd, EPOLL_CTL_MOD, sockfd, &ev);
+    }
 
-    rc = connect(sockfd, (struct sockaddr *) &servAddr, sizeof(servAddr));
-    if(rc < 0)//check TCP socket is connected correctly
-    {
-        perror("Cannot connect ");
-        close(sockfd);
-        return -1;
+    struct epoll_event events[1];
+    int n = epoll_wait(epfd, events, 1, -1);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      perror("epoll_wait");
+      break;
     }
 
-    printf("Starting TCP client...\n");
-
-    set_nonblock(sockfd);
-
-    write(sockfd,"reset 0\r",strlen("reset 0\n"));
-
-    int current_key=0;
-    
-    int last_pc=0, last_sp=0xff;
-
-    int max_cycles=0;
-
-    unsigned char buffer[65536];
-    while(1) {
-      nBytes = read(sockfd, buffer, sizeof(buffer));
-      if (nBytes >= 1) {
-	write(sockfd,"step\rstep\rstep\rstep\r",5*1);
-	// fprintf(stdout,"%d: %s\n",nBytes,buffer);
-	int pc,sp,cycles;
-	int nf=sscanf((char *)buffer,".C:%x%*[^:]:%*x X:%*x Y:%*x SP:%x %*[^ ] %d",&pc,&sp,&cycles);
-	if (nf==3) {
-	  // fprintf(stdout,"%x %x %d\n",pc,sp,cycles);
-	  // Detect entry into ROM via code
-	  if (pc<0xc000||pc>=0xe000)
-	    if (pc>=rom_bottom&&pc<=rom_top) {
-	      if (last_pc<rom_bottom||last_pc>rom_top) {
-		// PC has just entered the ROM
-		fprintf(stdout,"$%04x called from $%04x @ cycle %d\n",pc,last_pc,cycles);
-	      }
-	    }
-	  // Detect entry into ROM via interrupt
-	  if (pc>=rom_bottom&&pc<=rom_top)
-	    if (sp==(last_sp-3)) {
-	      // PC has just entered the ROM
-	      fprintf(stdout,"$%04x called from via interrupt @ cycle %d\n",pc,cycles);
-	    }
-	  last_pc=pc; last_sp=sp;
-	}
-
-	// LOAD only after BASIC has started
-	if (last_pc==0xe5cd&&filename) {
-	  /*
-	    To load and a program in VICE via the monitor interface:
-	    bload "filename" 0 07ff
-	    > 07ff 0 0
-	    keybuf run\x0d
-	    
-	  */
-	  char cmd[1024];
-	  snprintf(cmd,1024,"bload \"%s\" 0 07ff\r",filename);
-	  write(sockfd,cmd,strlen(cmd));
-	  usleep(1000000);
-	  write(sockfd,"> 07ff 0 0\r",11);
-	  usleep(100000);
-	  write(sockfd,"keybuf run\\x0d\r",15);
-
-	  filename=NULL;
-	}
-
-	if (current_key<key_count&&cycles>key_times[current_key]) {
-	  char cmd[1024];
-	  snprintf(cmd,1024,"keybuf %s\r",key_sequences[current_key]);
-	  write(sockfd,cmd,strlen(cmd));
-	  fprintf(stderr,">>> Keyboard injection: %s\n\r",cmd);
-	  current_key++;
-	}
-	
-	if (cycles>(max_cycles+10000)) {
-	  max_cycles=cycles;
-	  //	  fprintf(stderr,"%d cycles\n",cycles);
-	}
-
-	// Terminate emulator when done
-	if (cycles>=collect_cycles) {
-	  write(sockfd,"\rquit\r",6);
-	  usleep(1000000);
-	  break;
-	}
-	
-      }  else usleep(1);
+    if (events[0].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+      long nbytes = binmon_fill(&conn);
+      if (nbytes == 0 || nbytes == -1) done = 1;
+
+      int status;
+      while ((status = binmon_take(&conn, &packet, 0)) == 1) {
+        handle_response(&packet);
+        if (packet.type == BINMON_RSP_QUIT && packet.id == quit_req) done = 1;
+      }
+      if (status < 0) {
+        fprintf(stderr, "Malformed data from the monitor\n");
+        break;
+      }
     }
-    close(sockfd);
-    return 0;
+  }
+
+  if (frame_gaps) fprintf(stderr, ">>> %u gaps in the cycle numbers, see the text trace\n", frame_gaps);
+
+  fflush(stdout);
+  if (binary_trace_file) fclose(binary_trace_file);
+  close(epfd);
+  close(sockfd);
+  return 0;
 }
@@ -0,0 +1,515 @@
+//
+// Host-side NMOS 6502 CPU core, for running the ROMs headless.
+//
+// Instruction-granular, but with exact cycle counts (page crossing and branch
+// penalties included). Memory is accessed through the 'Bus' template parameter,
+// which has to provide:
+//
+//     uint8_t read(uint16_t addr);
+//     void    write(uint16_t addr, uint8_t value);
+//     bool    irqLine();                              // level triggered IRQ
+//
+// Undocumented opcodes are implemented too (the unstable ones in their most
+// common variant), JAM opcodes stop the CPU.
+//
+
+#ifndef CPU_6502_H
+#define CPU_6502_H
+
+#include <stdint.h>
+
+template <class Bus> class CPU6502
+{
+public:
+
+    CPU6502(Bus &bus) : pc(0), bus(bus) { resetRegisters(); }
+
+    // Registers
+
+    uint16_t pc;
+    uint8_t  a, x, y, s;
+
+    // Processor status, kept unpacked for speed
+
+    bool     flagC, flagV, flagD, flagI;
+    uint8_t  flagN, flagZ;             // N = bit 7 of flagN, Z = (flagZ == 0)
+
+    bool     jammed;
+
+    void reset()
+    {
+        resetRegisters();
+        pc = read16(0xFFFC);
+    }
+
+    void resetRegisters()
+    {
+        a = x = y = 0;
+        s = 0xFD;
+        flagC = flagV = flagD = false;
+        flagI = true;
+        flagN = 0;
+        flagZ = 1;
+        jammed = false;
+        nmiPending = false;
+    }
+
+    void nmi() { nmiPending = true; }
+
+    uint8_t getP() const
+    {
+        return (flagN & 0x80) | (flagV ? 0x40 : 0) | 0x20 | (flagD ? 0x08 : 0) |
+               (flagI ? 0x04 : 0) | (flagZ == 0 ? 0x02 : 0) | (flagC ? 0x01 : 0);
+    }
+
+    void setP(uint8_t p)
+    {
+        flagN = p;
+        flagV = (p & 0x40) != 0;
+        flagD = (p & 0x08) != 0;
+        flagI = (p & 0x04) != 0;
+        flagZ = (p & 0x02) ? 0 : 1;
+        flagC = (p & 0x01) != 0;
+    }
+
+    // Execute a single instruction (or interrupt entry), returns number of cycles taken
+
+    unsigned step();
+
+private:
+
+    Bus  &bus;
+    bool  nmiPending;
+
+    uint8_t  read(uint16_t addr)               { return bus.read(addr); }
+    void     write(uint16_t addr, uint8_t val) { bus.write(addr, val); }
+    uint16_t read16(uint16_t addr)             { return read(addr) | (read(addr + 1) << 8); }
+    uint16_t read16zp(uint8_t addr)            { return read(addr) | (read(uint8_t(addr + 1)) << 8); }
+
+    uint8_t  fetch()   { return read(pc++); }
+    uint16_t fetch16() { uint16_t val = read16(pc); pc += 2; return val; }
+
+    void    push(uint8_t val) { write(0x100 | s--, val); }
+    uint8_t pull()            { return read(0x100 | ++s); }
+
+    void setNZ(uint8_t val) { flagN = flagZ = val; }
+
+    void interrupt(uint16_t vector, bool brk)
+    {
+        push(pc >> 8);
+        push(pc & 0xFF);
+        push(getP() | (brk ? 0x10 : 0));
+        flagI = true;
+        pc = read16(vector);
+    }
+
+    // Arithmetic, decimal mode behaves like the NMOS 6502
+
+    void adc(uint8_t val)
+    {
+        if (!flagD)
+        {
+            unsigned sum = a + val + (flagC ? 1 : 0);
+            flagV = (~(a ^ val) & (a ^ sum) & 0x80) != 0;
+            flagC = sum > 0xFF;
+            setNZ(sum);
+            a = sum;
+            return;
+        }
+
+        unsigned lo = (a & 0x0F) + (val & 0x0F) + (flagC ? 1 : 0);
+        if (lo > 0x09) lo += 0x06;
+        unsigned hi = (a >> 4) + (val >> 4) + (lo > 0x0F ? 1 : 0);
+
+        flagZ = uint8_t(a + val + (flagC ? 1 : 0));
+        flagN = uint8_t(hi << 4);
+        flagV = (~(a ^ val) & (a ^ (hi << 4)) & 0x80) != 0;
+        if (hi > 0x09) hi += 0x06;
+        flagC = hi > 0x0F;
+        a = (hi << 4) | (lo & 0x0F);
+    }
+
+    void sbc(uint8_t val)
+    {
+        const unsigned borrow = flagC ? 0 : 1;
+        const unsigned diff   = a - val - borrow;
+
+        flagV = ((a ^ val) & (a ^ diff) & 0x80) != 0;
+        setNZ(diff);
+
+        if (flagD)
+        {
+            unsigned lo = (a & 0x0F) - (val & 0x0F) - borrow;
+            unsigned hi = (a >> 4) - (val >> 4) - ((lo & 0x10) ? 1 : 0);
+            if (lo & 0x10) lo -= 0x06;
+            if (hi & 0x10) hi -= 0x06;
+            a = (hi << 4) | (lo & 0x0F);
+        }
+        else
+        {
+            a = diff;
+        }
+
+        flagC = diff < 0x100;
+    }
+
+    void compare(uint8_t reg, uint8_t val)
+    {
+        flagC = reg >= val;
+        setNZ(reg - val);
+    }
+
+    uint8_t asl(uint8_t val) { flagC = (val & 0x80) != 0; val <<= 1; setNZ(val); return val; }
+    uint8_t lsr(uint8_t val) { flagC = (val & 0x01) != 0; val >>= 1; setNZ(val); return val; }
+    uint8_t rol(uint8_t val)
+    {
+        const bool carry = (val & 0x80) != 0;
+        val = (val << 1) | (flagC ? 1 : 0);
+        flagC = carry;
+        setNZ(val);
+        return val;
+    }
+    uint8_t ror(uint8_t val)
+    {
+        const bool carry = (val & 0x01) != 0;
+        val = (val >> 1) | (flagC ? 0x80 : 0);
+        flagC = carry;
+        setNZ(val);
+        return val;
+    }
+
+    // Addressing modes; 'extra' gets incremented on page crossing, for read instructions
+
+    uint16_t addrZPX() { return uint8_t(fetch() + x); }
+    uint16_t addrZPY() { return uint8_t(fetch() + y); }
+    uint16_t addrIZX() { return read16zp(fetch() + x); }
+
+    uint16_t addrIndexed(uint16_t base, uint8_t index, unsigned &extra)
+    {
+        const uint16_t addr = base + index;
+        if ((addr ^ base) & 0xFF00) extra++;
+        return addr;
+    }
+
+    uint16_t addrABX(unsigned &extra) { return addrIndexed(fetch16(), x, extra); }
+    uint16_t addrABY(unsigned &extra) { return addrIndexed(fetch16(), y, extra); }
+    uint16_t addrIZY(unsigned &extra) { return addrIndexed(read16zp(fetch()), y, extra); }
+
+    unsigned branch(bool condition)
+    {
+        const int8_t offset = int8_t(fetch());
+        if (!condition) return 0;
+
+        const uint16_t target = pc + offset;
+        const unsigned extra  = ((target ^ pc) & 0xFF00) ? 2 : 1;
+        pc = target;
+        return extra;
+    }
+
+    static const uint8_t CYCLES[256];
+};
+
+template <class Bus> const uint8_t CPU6502<Bus>::CYCLES[256] =
+{
+    7, 6, 0, 8, 3, 3, 5, 5, 3, 2, 2, 2, 4, 4, 6, 6,  // $0x
+    2, 5, 0, 8, 4, 4, 6, 6, 2, 4, 2, 7, 4, 4, 7, 7,  // $1x
+    6, 6, 0, 8, 3, 3, 5, 5, 4, 2, 2, 2, 4, 4, 6, 6,  // $2x
+    2, 5, 0, 8, 4, 4, 6, 6, 2, 4, 2, 7, 4, 4, 7, 7,  // $3x
+    6, 6, 0, 8, 3, 3, 5, 5, 3, 2, 2, 2, 3, 4, 6, 6,  // $4x
+    2, 5, 0, 8, 4, 4, 6, 6, 2, 4, 2, 7, 4, 4, 7, 7,  // $5x
+    6, 6, 0, 8, 3, 3, 5, 5, 4, 2, 2, 2, 5, 4, 6, 6,  // $6x
+    2, 5, 0, 8, 4, 4, 6, 6, 2, 4, 2, 7, 4, 4, 7, 7,  // $7x
+    2, 6, 2, 6, 3, 3, 3, 3, 2, 2, 2, 2, 4, 4, 4, 4,  // $8x
+    2, 6, 0, 6, 4, 4, 4, 4, 2, 5, 2, 5, 5, 5, 5, 5,  // $9x
+    2, 6, 2, 6, 3, 3, 3, 3, 2, 2, 2, 2, 4, 4, 4, 4,  // $Ax
+    2, 5, 0, 5, 4, 4, 4, 4, 2, 4, 2, 4, 4, 4, 4, 4,  // $Bx
+    2, 6, 2, 8, 3, 3, 5, 5, 2, 2, 2, 2, 4, 4, 6, 6,  // $Cx
+    2, 5, 0, 8, 4, 4, 6, 6, 2, 4, 2, 7, 4, 4, 7, 7,  // $Dx
+    2, 6, 2, 8, 3, 3, 5, 5, 2, 2, 2, 2, 4, 4, 6, 6,  // $Ex
+    2, 5, 0, 8, 4, 4, 6, 6, 2, 4, 2, 7, 4, 4, 7, 7   // $Fx
+};
+
+template <class Bus> unsigned CPU6502<Bus>::step()
+{
+    if (jammed) return 1;
+
+    // Interrupts are checked between instructions
+
+    if (nmiPending)
+    {
+        nmiPending = false;
+        interrupt(0xFFFA, false);
+        return 7;
+    }
+
+    if (!flagI && bus.irqLine())
+    {
+        interrupt(0xFFFE, false);
+        return 7;
+    }
+
+    const uint8_t opcode = fetch();
+    unsigned extra = 0;
+    uint16_t addr;
+    uint8_t  val;
+
+    // Helpers for the instruction groups sharing the ALU operations
+
+#define CPU_READ_OPS(OP, LABEL)                                                             \
+        case OP + 0x09: val = fetch();                      goto LABEL;              \
+        case OP + 0x05: val = read(fetch());                goto LABEL;              \
+        case OP + 0x15: val = read(addrZPX());              goto LABEL;              \
+        case OP + 0x0D: val = read(fetch16());              goto LABEL;              \
+        case OP + 0x1D: val = read(addrABX(extra));         goto LABEL;              \
+        case OP + 0x19: val = read(addrABY(extra));         goto LABEL;              \
+        case OP + 0x01: val = read(addrIZX());              goto LABEL;              \
+        case OP + 0x11: val = read(addrIZY(extra));         goto LABEL; 
+
+#define CPU_RMW_OPS(OP, LABEL)                                                              \
+        case OP + 0x06: addr = fetch();                     goto LABEL;              \
+        case OP + 0x16: addr = addrZPX();                   goto LABEL;              \
+        case OP + 0x0E: addr = fetch16();                   goto LABEL;              \
+        case OP + 0x1E: addr = addrABX(extra); extra = 0;   goto LABEL; 
+
+#define CPU_UNDOC_RMW_OPS(OP, LABEL)                                                        \
+        case OP + 0x07: addr = fetch();                     goto LABEL;              \
+        case OP + 0x17: addr = addrZPX();                   goto LABEL;              \
+        case OP + 0x0F: addr = fetch16();                   goto LABEL;              \
+        case OP + 0x1F: addr = addrABX(extra); extra = 0;   goto LABEL;              \
+        case OP + 0x1B: addr = addrABY(extra); extra = 0;   goto LABEL;              \
+        case OP + 0x03: addr = addrIZX();                   goto LABEL;              \
+        case OP + 0x13: addr = addrIZY(extra); extra = 0;   goto LABEL; 
+
+    switch (opcode)
+    {
+        // ALU operations
+
+        CPU_READ_OPS(0x00, op_0x00) op_0x00: a |= val;            setNZ(a); break;  // ORA
+        CPU_READ_OPS(0x20, op_0x20) op_0x20: a &= val;            setNZ(a); break;  // AND
+        CPU_READ_OPS(0x40, op_0x40) op_0x40: a ^= val;            setNZ(a); break;  // EOR
+        CPU_READ_OPS(0x60, op_0x60) op_0x60: adc(val);                      break;  // ADC
+        CPU_READ_OPS(0xC0, op_0xC0) op_0xC0: compare(a, val);               break;  // CMP
+        CPU_READ_OPS(0xE0, op_0xE0) op_0xE0: sbc(val);                      break;  // SBC
+        case 0xEB:                  sbc(fetch());                  break;  // SBC (undocumented)
+
+        // Loads
+
+        case 0xA9: a = fetch();                     setNZ(a); break;
+        case 0xA5: a = read(fetch());               setNZ(a); break;
+        case 0xB5: a = read(addrZPX());             setNZ(a); break;
+        case 0xAD: a = read(fetch16());             setNZ(a); break;
+        case 0xBD: a = read(addrABX(extra));        setNZ(a); break;
+        case 0xB9: a = read(addrABY(extra));        setNZ(a); break;
+        case 0xA1: a = read(addrIZX());             setNZ(a); break;
+        case 0xB1: a = read(addrIZY(extra));        setNZ(a); break;
+
+        case 0xA2: x = fetch();                     setNZ(x); break;
+        case 0xA6: x = read(fetch());               setNZ(x); break;
+        case 0xB6: x = read(addrZPY());             setNZ(x); break;
+        case 0xAE: x = read(fetch16());             setNZ(x); break;
+        case 0xBE: x = read(addrABY(extra));        setNZ(x); break;
+
+        case 0xA0: y = fetch();                     setNZ(y); break;
+        case 0xA4: y = read(fetch());               setNZ(y); break;
+        case 0xB4: y = read(addrZPX());             setNZ(y); break;
+        case 0xAC: y = read(fetch16());             setNZ(y); break;
+        case 0xBC: y = read(addrABX(extra));        setNZ(y); break;
+
+        // Stores
+
+        case 0x85: write(fetch(), a);               break;
+        case 0x95: write(addrZPX(), a);             break;
+        case 0x8D: write(fetch16(), a);             break;
+        case 0x9D: write(addrABX(extra), a);        extra = 0; break;
+        case 0x99: write(addrABY(extra), a);        extra = 0; break;
+        case 0x81: write(addrIZX(), a);             break;
+        case 0x91: write(addrIZY(extra), a);        extra = 0; break;
+
+        case 0x86: write(fetch(), x);               break;
+        case 0x96: write(addrZPY(), x);             break;
+        case 0x8E: write(fetch16(), x);             break;
+
+        case 0x84: write(fetch(), y);               break;
+        case 0x94: write(addrZPX(), y);             break;
+        case 0x8C: write(fetch16(), y);             break;
+
+        // Compare X/Y, BIT
+
+        case 0xE0: compare(x, fetch());             break;
+        case 0xE4: compare(x, read(fetch()));       break;
+        case 0xEC: compare(x, read(fetch16()));     break;
+        case 0xC0: compare(y, fetch());             break;
+        case 0xC4: compare(y, read(fetch()));       break;
+        case 0xCC: compare(y, read(fetch16()));     break;
+
+        case 0x24: val = read(fetch());   goto op_bit;
+        case 0x2C: val = read(fetch16()); goto op_bit;
+        op_bit:
+            flagN = val;
+            flagV = (val & 0x40) != 0;
+            flagZ = a & val;
+            break;
+
+        // Read-modify-write
+
+        case 0x0A: a = asl(a); break;
+        case 0x4A: a = lsr(a); break;
+        case 0x2A: a = rol(a); break;
+        case 0x6A: a = ror(a); break;
+
+        CPU_RMW_OPS(0x00, op_0x00_rmw) op_0x00_rmw: write(addr, asl(read(addr))); break;
+        CPU_RMW_OPS(0x20, op_0x20_rmw) op_0x20_rmw: write(addr, rol(read(addr))); break;
+        CPU_RMW_OPS(0x40, op_0x40_rmw) op_0x40_rmw: write(addr, lsr(read(addr))); break;
+        CPU_RMW_OPS(0x60, op_0x60_rmw) op_0x60_rmw: write(addr, ror(read(addr))); break;
+        CPU_RMW_OPS(0xC0, op_0xC0_rmw) op_0xC0_rmw: val = read(addr) - 1; write(addr, val); setNZ(val); break;  // DEC
+        CPU_RMW_OPS(0xE0, op_0xE0_rmw) op_0xE0_rmw: val = read(addr) + 1; write(addr, val); setNZ(val); break;  // INC
+
+        // Register transfers, increments and decrements
+
+        case 0xAA: x = a;  setNZ(x); break;
+        case 0xA8: y = a;  setNZ(y); break;
+        case 0x8A: a = x;  setNZ(a); break;
+        case 0x98: a = y;  setNZ(a); break;
+        case 0xBA: x = s;  setNZ(x); break;
+        case 0x9A: s = x;            break;
+        case 0xE8: x++;    setNZ(x); break;
+        case 0xC8: y++;    setNZ(y); break;
+        case 0xCA: x--;    setNZ(x); break;
+        case 0x88: y--;    setNZ(y); break;
+
+        // Stack
+
+        case 0x48: push(a);                    break;
+        case 0x68: a = pull(); setNZ(a);       break;
+        case 0x08: push(getP() | 0x10);        break;
+        case 0x28: setP(pull());               break;
+
+        // Flags
+
+        case 0x18: flagC = false; break;
+        case 0x38: flagC = true;  break;
+        case 0x58: flagI = false; break;
+        case 0x78: flagI = true;  break;
+        case 0xB8: flagV = false; break;
+        case 0xD8: flagD = false; break;
+        case 0xF8: flagD = true;  break;
+
+        // Branches
+
+        case 0x10: extra = branch(!(flagN & 0x80)); break;
+        case 0x30: extra = branch(flagN & 0x80);    break;
+        case 0x50: extra = branch(!flagV);          break;
+        case 0x70: extra = branch(flagV);           break;
+        case 0x90: extra = branch(!flagC);          break;
+        case 0xB0: extra = branch(flagC);           break;
+        case 0xD0: extra = branch(flagZ != 0);      break;
+        case 0xF0: extra = branch(flagZ == 0);      break;
+
+        // Jumps, subroutines, interrupts
+
+        case 0x4C: pc = fetch16(); break;
+        case 0x6C:
+            addr = fetch16();
+            pc = read(addr) | (read((addr & 0xFF00) | uint8_t(addr + 1)) << 8);  // page wrap bug
+            break;
+        case 0x20:
+            addr = fetch16();
+            pc--;
+            push(pc >> 8);
+            push(pc & 0xFF);
+            pc = addr;
+            break;
+        case 0x60:
+            pc = pull();
+            pc |= pull() << 8;
+            pc++;
+            break;
+        case 0x40:
+            setP(pull());
+            pc = pull();
+            pc |= pull() << 8;
+            break;
+        case 0x00:
+            pc++;
+            interrupt(0xFFFE, true);
+            break;
+
+        case 0xEA: break;
+
+        // Undocumented - combined read-modify-write and ALU operations
+
+        CPU_UNDOC_RMW_OPS(0x00, op_0x00_undoc) op_0x00_undoc: val = asl(read(addr)); write(addr, val); a |= val; setNZ(a); break;  // SLO
+        CPU_UNDOC_RMW_OPS(0x20, op_0x20_undoc) op_0x20_undoc: val = rol(read(addr)); write(addr, val); a &= val; setNZ(a); break;  // RLA
+        CPU_UNDOC_RMW_OPS(0x40, op_0x40_undoc) op_0x40_undoc: val = lsr(read(addr)); write(addr, val); a ^= val; setNZ(a); break;  // SRE
+        CPU_UNDOC_RMW_OPS(0x60, op_0x60_undoc) op_0x60_undoc: val = ror(read(addr)); write(addr, val); adc(val);          break;  // RRA
+        CPU_UNDOC_RMW_OPS(0xC0, op_0xC0_undoc) op_0xC0_undoc: val = read(addr) - 1;  write(addr, val); compare(a, val);   break;  // DCP
+        CPU_UNDOC_RMW_OPS(0xE0, op_0xE0_undoc) op_0xE0_undoc: val = read(addr) + 1;  write(addr, val); sbc(val);          break;  // ISC
+
+        // Undocumented - LAX / SAX
+
+        case 0xA7: a = x = read(fetch());               setNZ(a); break;
+        case 0xB7: a = x = read(addrZPY());             setNZ(a); break;
+        case 0xAF: a = x = read(fetch16());             setNZ(a); break;
+        case 0xBF: a = x = read(addrABY(extra));        setNZ(a); break;
+        case 0xA3: a = x = read(addrIZX());             setNZ(a); break;
+        case 0xB3: a = x = read(addrIZY(extra));        setNZ(a); break;
+        case 0xAB: a = x = (a | 0xEE) & fetch();        setNZ(a); break;  // LXA, unstable
+
+        case 0x87: write(fetch(), a & x);               break;
+        case 0x97: write(addrZPY(), a & x);             break;
+        case 0x8F: write(fetch16(), a & x);             break;
+        case 0x83: write(addrIZX(), a & x);             break;
+
+        // Undocumented - immediate operations
+
+        case 0x0B: case 0x2B: a &= fetch(); setNZ(a); flagC = (a & 0x80) != 0;                       break;  // ANC
+        case 0x4B: a &= fetch(); a = lsr(a);                                                          break;  // ALR
+        case 0x6B:                                                                                           // ARR
+            a &= fetch();
+            a = (a >> 1) | (flagC ? 0x80 : 0);
+            setNZ(a);
+            flagC = (a & 0x40) != 0;
+            flagV = ((a >> 6) ^ (a >> 5)) & 1;
+            break;
+        case 0xCB:                                                                                           // SBX
+            val = fetch();
+            flagC = (a & x) >= val;
+            x = (a & x) - val;
+            setNZ(x);
+            break;
+        case 0x8B: a = (a | 0xEE) & x & fetch(); setNZ(a);                                            break;  // XAA, unstable
+
+        // Undocumented - unstable stores, using the common 'AND with high byte + 1' behaviour
+
+        case 0x93: addr = addrIZY(extra); extra = 0; write(addr, a & x & ((addr >> 8) + 1)); break;  // SHA
+        case 0x9F: addr = addrABY(extra); extra = 0; write(addr, a & x & ((addr >> 8) + 1)); break;  // SHA
+        case 0x9E: addr = addrABY(extra); extra = 0; write(addr, x & ((addr >> 8) + 1));     break;  // SHX
+        case 0x9C: addr = addrABX(extra); extra = 0; write(addr, y & ((addr >> 8) + 1));     break;  // SHY
+        case 0x9B: addr = addrABY(extra); extra = 0; s = a & x; write(addr, s & ((addr >> 8) + 1)); break;  // TAS
+        case 0xBB: a = x = s = read(addrABY(extra)) & s; setNZ(a); break;                                  // LAS
+
+        // Undocumented - NOPs
+
+        case 0x1A: case 0x3A: case 0x5A: case 0x7A: case 0xDA: case 0xFA: break;
+        case 0x80: case 0x82: case 0x89: case 0xC2: case 0xE2: pc++; break;
+        case 0x04: case 0x44: case 0x64: read(fetch()); break;
+        case 0x14: case 0x34: case 0x54: case 0x74: case 0xD4: case 0xF4: read(addrZPX()); break;
+        case 0x0C: read(fetch16()); break;
+        case 0x1C: case 0x3C: case 0x5C: case 0x7C: case 0xDC: case 0xFC: read(addrABX(extra)); break;
+
+        // Undocumented - JAM
+
+        default:
+            pc--;
+            jammed = true;
+            return 1;
+    }
+
+#undef CPU_READ_OPS
+#undef CPU_RMW_OPS
+#undef CPU_UNDOC_RMW_OPS
+
+    return CYCLES[opcode] + extra;
+}
+
+#endif // CPU_6502_H
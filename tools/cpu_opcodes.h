@@ -0,0 +1,588 @@
+/*
+  Opcode tables for the 6502 (NMOS, including the undocumented opcodes)
+  and 45GS02 (MEGA65) CPUs - mnemonics and addressing modes, together with
+  instruction length decoders. Usable from both C and C++ tools.
+*/
+
+#ifndef CPU_OPCODES_H
+#define CPU_OPCODES_H
+
+typedef enum cpu_mode {
+  CPU_MODE_IMP,         // implied or accumulator
+  CPU_MODE_IMM,         // #$nn
+  CPU_MODE_IMW,         // #$nnnn
+  CPU_MODE_ZP,          // $nn
+  CPU_MODE_ZPX,         // $nn,X
+  CPU_MODE_ZPY,         // $nn,Y
+  CPU_MODE_ABS,         // $nnnn
+  CPU_MODE_ABX,         // $nnnn,X
+  CPU_MODE_ABY,         // $nnnn,Y
+  CPU_MODE_IND,         // ($nnnn)
+  CPU_MODE_IAX,         // ($nnnn,X)
+  CPU_MODE_IZX,         // ($nn,X)
+  CPU_MODE_IZY,         // ($nn),Y
+  CPU_MODE_IZZ,         // ($nn),Z
+  CPU_MODE_ISY,         // ($nn,SP),Y
+  CPU_MODE_REL,         // 8-bit relative branch
+  CPU_MODE_RLW,         // 16-bit relative branch
+  CPU_MODE_ZPR,         // $nn,rel - BBR/BBS
+  CPU_MODE_COUNT
+} cpu_mode;
+
+// Instruction length, in bytes, for each addressing mode
+static const unsigned char CPU_MODE_LENGTH[CPU_MODE_COUNT] = {
+  1, 2, 3, 2, 2, 2, 3, 3, 3, 3, 3, 2, 2, 2, 2, 2, 3, 3
+};
+
+typedef struct cpu_opcode {
+  const char    *mnemonic;
+  unsigned char  mode;
+  unsigned char  undocumented;
+} cpu_opcode;
+
+static const cpu_opcode CPU_OPCODES_6502[256] = {
+  { "BRK",  CPU_MODE_IMP, 0 }, // $00
+  { "ORA",  CPU_MODE_IZX, 0 }, // $01
+  { "JAM",  CPU_MODE_IMP, 1 }, // $02
+  { "SLO",  CPU_MODE_IZX, 1 }, // $03
+  { "NOP",  CPU_MODE_ZP,  1 }, // $04
+  { "ORA",  CPU_MODE_ZP,  0 }, // $05
+  { "ASL",  CPU_MODE_ZP,  0 }, // $06
+  { "SLO",  CPU_MODE_ZP,  1 }, // $07
+  { "PHP",  CPU_MODE_IMP, 0 }, // $08
+  { "ORA",  CPU_MODE_IMM, 0 }, // $09
+  { "ASL",  CPU_MODE_IMP, 0 }, // $0A
+  { "ANC",  CPU_MODE_IMM, 1 }, // $0B
+  { "NOP",  CPU_MODE_ABS, 1 }, // $0C
+  { "ORA",  CPU_MODE_ABS, 0 }, // $0D
+  { "ASL",  CPU_MODE_ABS, 0 }, // $0E
+  { "SLO",  CPU_MODE_ABS, 1 }, // $0F
+  { "BPL",  CPU_MODE_REL, 0 }, // $10
+  { "ORA",  CPU_MODE_IZY, 0 }, // $11
+  { "JAM",  CPU_MODE_IMP, 1 }, // $12
+  { "SLO",  CPU_MODE_IZY, 1 }, // $13
+  { "NOP",  CPU_MODE_ZPX, 1 }, // $14
+  { "ORA",  CPU_MODE_ZPX, 0 }, // $15
+  { "ASL",  CPU_MODE_ZPX, 0 }, // $16
+  { "SLO",  CPU_MODE_ZPX, 1 }, // $17
+  { "CLC",  CPU_MODE_IMP, 0 }, // $18
+  { "ORA",  CPU_MODE_ABY, 0 }, // $19
+  { "NOP",  CPU_MODE_IMP, 1 }, // $1A
+  { "SLO",  CPU_MODE_ABY, 1 }, // $1B
+  { "NOP",  CPU_MODE_ABX, 1 }, // $1C
+  { "ORA",  CPU_MODE_ABX, 0 }, // $1D
+  { "ASL",  CPU_MODE_ABX, 0 }, // $1E
+  { "SLO",  CPU_MODE_ABX, 1 }, // $1F
+  { "JSR",  CPU_MODE_ABS, 0 }, // $20
+  { "AND",  CPU_MODE_IZX, 0 }, // $21
+  { "JAM",  CPU_MODE_IMP, 1 }, // $22
+  { "RLA",  CPU_MODE_IZX, 1 }, // $23
+  { "BIT",  CPU_MODE_ZP,  0 }, // $24
+  { "AND",  CPU_MODE_ZP,  0 }, // $25
+  { "ROL",  CPU_MODE_ZP,  0 }, // $26
+  { "RLA",  CPU_MODE_ZP,  1 }, // $27
+  { "PLP",  CPU_MODE_IMP, 0 }, // $28
+  { "AND",  CPU_MODE_IMM, 0 }, // $29
+  { "ROL",  CPU_MODE_IMP, 0 }, // $2A
+  { "ANC",  CPU_MODE_IMM, 1 }, // $2B
+  { "BIT",  CPU_MODE_ABS, 0 }, // $2C
+  { "AND",  CPU_MODE_ABS, 0 }, // $2D
+  { "ROL",  CPU_MODE_ABS, 0 }, // $2E
+  { "RLA",  CPU_MODE_ABS, 1 }, // $2F
+  { "BMI",  CPU_MODE_REL, 0 }, // $30
+  { "AND",  CPU_MODE_IZY, 0 }, // $31
+  { "JAM",  CPU_MODE_IMP, 1 }, // $32
+  { "RLA",  CPU_MODE_IZY, 1 }, // $33
+  { "NOP",  CPU_MODE_ZPX, 1 }, // $34
+  { "AND",  CPU_MODE_ZPX, 0 }, // $35
+  { "ROL",  CPU_MODE_ZPX, 0 }, // $36
+  { "RLA",  CPU_MODE_ZPX, 1 }, // $37
+  { "SEC",  CPU_MODE_IMP, 0 }, // $38
+  { "AND",  CPU_MODE_ABY, 0 }, // $39
+  { "NOP",  CPU_MODE_IMP, 1 }, // $3A
+  { "RLA",  CPU_MODE_ABY, 1 }, // $3B
+  { "NOP",  CPU_MODE_ABX, 1 }, // $3C
+  { "AND",  CPU_MODE_ABX, 0 }, // $3D
+  { "ROL",  CPU_MODE_ABX, 0 }, // $3E
+  { "RLA",  CPU_MODE_ABX, 1 }, // $3F
+  { "RTI",  CPU_MODE_IMP, 0 }, // $40
+  { "EOR",  CPU_MODE_IZX, 0 }, // $41
+  { "JAM",  CPU_MODE_IMP, 1 }, // $42
+  { "SRE",  CPU_MODE_IZX, 1 }, // $43
+  { "NOP",  CPU_MODE_ZP,  1 }, // $44
+  { "EOR",  CPU_MODE_ZP,  0 }, // $45
+  { "LSR",  CPU_MODE_ZP,  0 }, // $46
+  { "SRE",  CPU_MODE_ZP,  1 }, // $47
+  { "PHA",  CPU_MODE_IMP, 0 }, // $48
+  { "EOR",  CPU_MODE_IMM, 0 }, // $49
+  { "LSR",  CPU_MODE_IMP, 0 }, // $4A
+  { "ALR",  CPU_MODE_IMM, 1 }, // $4B
+  { "JMP",  CPU_MODE_ABS, 0 }, // $4C
+  { "EOR",  CPU_MODE_ABS, 0 }, // $4D
+  { "LSR",  CPU_MODE_ABS, 0 }, // $4E
+  { "SRE",  CPU_MODE_ABS, 1 }, // $4F
+  { "BVC",  CPU_MODE_REL, 0 }, // $50
+  { "EOR",  CPU_MODE_IZY, 0 }, // $51
+  { "JAM",  CPU_MODE_IMP, 1 }, // $52
+  { "SRE",  CPU_MODE_IZY, 1 }, // $53
+  { "NOP",  CPU_MODE_ZPX, 1 }, // $54
+  { "EOR",  CPU_MODE_ZPX, 0 }, // $55
+  { "LSR",  CPU_MODE_ZPX, 0 }, // $56
+  { "SRE",  CPU_MODE_ZPX, 1 }, // $57
+  { "CLI",  CPU_MODE_IMP, 0 }, // $58
+  { "EOR",  CPU_MODE_ABY, 0 }, // $59
+  { "NOP",  CPU_MODE_IMP, 1 }, // $5A
+  { "SRE",  CPU_MODE_ABY, 1 }, // $5B
+  { "NOP",  CPU_MODE_ABX, 1 }, // $5C
+  { "EOR",  CPU_MODE_ABX, 0 }, // $5D
+  { "LSR",  CPU_MODE_ABX, 0 }, // $5E
+  { "SRE",  CPU_MODE_ABX, 1 }, // $5F
+  { "RTS",  CPU_MODE_IMP, 0 }, // $60
+  { "ADC",  CPU_MODE_IZX, 0 }, // $61
+  { "JAM",  CPU_MODE_IMP, 1 }, // $62
+  { "RRA",  CPU_MODE_IZX, 1 }, // $63
+  { "NOP",  CPU_MODE_ZP,  1 }, // $64
+  { "ADC",  CPU_MODE_ZP,  0 }, // $65
+  { "ROR",  CPU_MODE_ZP,  0 }, // $66
+  { "RRA",  CPU_MODE_ZP,  1 }, // $67
+  { "PLA",  CPU_MODE_IMP, 0 }, // $68
+  { "ADC",  CPU_MODE_IMM, 0 }, // $69
+  { "ROR",  CPU_MODE_IMP, 0 }, // $6A
+  { "ARR",  CPU_MODE_IMM, 1 }, // $6B
+  { "JMP",  CPU_MODE_IND, 0 }, // $6C
+  { "ADC",  CPU_MODE_ABS, 0 }, // $6D
+  { "ROR",  CPU_MODE_ABS, 0 }, // $6E
+  { "RRA",  CPU_MODE_ABS, 1 }, // $6F
+  { "BVS",  CPU_MODE_REL, 0 }, // $70
+  { "ADC",  CPU_MODE_IZY, 0 }, // $71
+  { "JAM",  CPU_MODE_IMP, 1 }, // $72
+  { "RRA",  CPU_MODE_IZY, 1 }, // $73
+  { "NOP",  CPU_MODE_ZPX, 1 }, // $74
+  { "ADC",  CPU_MODE_ZPX, 0 }, // $75
+  { "ROR",  CPU_MODE_ZPX, 0 }, // $76
+  { "RRA",  CPU_MODE_ZPX, 1 }, // $77
+  { "SEI",  CPU_MODE_IMP, 0 }, // $78
+  { "ADC",  CPU_MODE_ABY, 0 }, // $79
+  { "NOP",  CPU_MODE_IMP, 1 }, // $7A
+  { "RRA",  CPU_MODE_ABY, 1 }, // $7B
+  { "NOP",  CPU_MODE_ABX, 1 }, // $7C
+  { "ADC",  CPU_MODE_ABX, 0 }, // $7D
+  { "ROR",  CPU_MODE_ABX, 0 }, // $7E
+  { "RRA",  CPU_MODE_ABX, 1 }, // $7F
+  { "NOP",  CPU_MODE_IMM, 1 }, // $80
+  { "STA",  CPU_MODE_IZX, 0 }, // $81
+  { "NOP",  CPU_MODE_IMM, 1 }, // $82
+  { "SAX",  CPU_MODE_IZX, 1 }, // $83
+  { "STY",  CPU_MODE_ZP,  0 }, // $84
+  { "STA",  CPU_MODE_ZP,  0 }, // $85
+  { "STX",  CPU_MODE_ZP,  0 }, // $86
+  { "SAX",  CPU_MODE_ZP,  1 }, // $87
+  { "DEY",  CPU_MODE_IMP, 0 }, // $88
+  { "NOP",  CPU_MODE_IMM, 1 }, // $89
+  { "TXA",  CPU_MODE_IMP, 0 }, // $8A
+  { "ANE",  CPU_MODE_IMM, 1 }, // $8B
+  { "STY",  CPU_MODE_ABS, 0 }, // $8C
+  { "STA",  CPU_MODE_ABS, 0 }, // $8D
+  { "STX",  CPU_MODE_ABS, 0 }, // $8E
+  { "SAX",  CPU_MODE_ABS, 1 }, // $8F
+  { "BCC",  CPU_MODE_REL, 0 }, // $90
+  { "STA",  CPU_MODE_IZY, 0 }, // $91
+  { "JAM",  CPU_MODE_IMP, 1 }, // $92
+  { "SHA",  CPU_MODE_IZY, 1 }, // $93
+  { "STY",  CPU_MODE_ZPX, 0 }, // $94
+  { "STA",  CPU_MODE_ZPX, 0 }, // $95
+  { "STX",  CPU_MODE_ZPY, 0 }, // $96
+  { "SAX",  CPU_MODE_ZPY, 1 }, // $97
+  { "TYA",  CPU_MODE_IMP, 0 }, // $98
+  { "STA",  CPU_MODE_ABY, 0 }, // $99
+  { "TXS",  CPU_MODE_IMP, 0 }, // $9A
+  { "TAS",  CPU_MODE_ABY, 1 }, // $9B
+  { "SHY",  CPU_MODE_ABX, 1 }, // $9C
+  { "STA",  CPU_MODE_ABX, 0 }, // $9D
+  { "SHX",  CPU_MODE_ABY, 1 }, // $9E
+  { "SHA",  CPU_MODE_ABY, 1 }, // $9F
+  { "LDY",  CPU_MODE_IMM, 0 }, // $A0
+  { "LDA",  CPU_MODE_IZX, 0 }, // $A1
+  { "LDX",  CPU_MODE_IMM, 0 }, // $A2
+  { "LAX",  CPU_MODE_IZX, 1 }, // $A3
+  { "LDY",  CPU_MODE_ZP,  0 }, // $A4
+  { "LDA",  CPU_MODE_ZP,  0 }, // $A5
+  { "LDX",  CPU_MODE_ZP,  0 }, // $A6
+  { "LAX",  CPU_MODE_ZP,  1 }, // $A7
+  { "TAY",  CPU_MODE_IMP, 0 }, // $A8
+  { "LDA",  CPU_MODE_IMM, 0 }, // $A9
+  { "TAX",  CPU_MODE_IMP, 0 }, // $AA
+  { "LXA",  CPU_MODE_IMM, 1 }, // $AB
+  { "LDY",  CPU_MODE_ABS, 0 }, // $AC
+  { "LDA",  CPU_MODE_ABS, 0 }, // $AD
+  { "LDX",  CPU_MODE_ABS, 0 }, // $AE
+  { "LAX",  CPU_MODE_ABS, 1 }, // $AF
+  { "BCS",  CPU_MODE_REL, 0 }, // $B0
+  { "LDA",  CPU_MODE_IZY, 0 }, // $B1
+  { "JAM",  CPU_MODE_IMP, 1 }, // $B2
+  { "LAX",  CPU_MODE_IZY, 1 }, // $B3
+  { "LDY",  CPU_MODE_ZPX, 0 }, // $B4
+  { "LDA",  CPU_MODE_ZPX, 0 }, // $B5
+  { "LDX",  CPU_MODE_ZPY, 0 }, // $B6
+  { "LAX",  CPU_MODE_ZPY, 1 }, // $B7
+  { "CLV",  CPU_MODE_IMP, 0 }, // $B8
+  { "LDA",  CPU_MODE_ABY, 0 }, // $B9
+  { "TSX",  CPU_MODE_IMP, 0 }, // $BA
+  { "LAS",  CPU_MODE_ABY, 1 }, // $BB
+  { "LDY",  CPU_MODE_ABX, 0 }, // $BC
+  { "LDA",  CPU_MODE_ABX, 0 }, // $BD
+  { "LDX",  CPU_MODE_ABY, 0 }, // $BE
+  { "LAX",  CPU_MODE_ABY, 1 }, // $BF
+  { "CPY",  CPU_MODE_IMM, 0 }, // $C0
+  { "CMP",  CPU_MODE_IZX, 0 }, // $C1
+  { "NOP",  CPU_MODE_IMM, 1 }, // $C2
+  { "DCP",  CPU_MODE_IZX, 1 }, // $C3
+  { "CPY",  CPU_MODE_ZP,  0 }, // $C4
+  { "CMP",  CPU_MODE_ZP,  0 }, // $C5
+  { "DEC",  CPU_MODE_ZP,  0 }, // $C6
+  { "DCP",  CPU_MODE_ZP,  1 }, // $C7
+  { "INY",  CPU_MODE_IMP, 0 }, // $C8
+  { "CMP",  CPU_MODE_IMM, 0 }, // $C9
+  { "DEX",  CPU_MODE_IMP, 0 }, // $CA
+  { "SBX",  CPU_MODE_IMM, 1 }, // $CB
+  { "CPY",  CPU_MODE_ABS, 0 }, // $CC
+  { "CMP",  CPU_MODE_ABS, 0 }, // $CD
+  { "DEC",  CPU_MODE_ABS, 0 }, // $CE
+  { "DCP",  CPU_MODE_ABS, 1 }, // $CF
+  { "BNE",  CPU_MODE_REL, 0 }, // $D0
+  { "CMP",  CPU_MODE_IZY, 0 }, // $D1
+  { "JAM",  CPU_MODE_IMP, 1 }, // $D2
+  { "DCP",  CPU_MODE_IZY, 1 }, // $D3
+  { "NOP",  CPU_MODE_ZPX, 1 }, // $D4
+  { "CMP",  CPU_MODE_ZPX, 0 }, // $D5
+  { "DEC",  CPU_MODE_ZPX, 0 }, // $D6
+  { "DCP",  CPU_MODE_ZPX, 1 }, // $D7
+  { "CLD",  CPU_MODE_IMP, 0 }, // $D8
+  { "CMP",  CPU_MODE_ABY, 0 }, // $D9
+  { "NOP",  CPU_MODE_IMP, 1 }, // $DA
+  { "DCP",  CPU_MODE_ABY, 1 }, // $DB
+  { "NOP",  CPU_MODE_ABX, 1 }, // $DC
+  { "CMP",  CPU_MODE_ABX, 0 }, // $DD
+  { "DEC",  CPU_MODE_ABX, 0 }, // $DE
+  { "DCP",  CPU_MODE_ABX, 1 }, // $DF
+  { "CPX",  CPU_MODE_IMM, 0 }, // $E0
+  { "SBC",  CPU_MODE_IZX, 0 }, // $E1
+  { "NOP",  CPU_MODE_IMM, 1 }, // $E2
+  { "ISC",  CPU_MODE_IZX, 1 }, // $E3
+  { "CPX",  CPU_MODE_ZP,  0 }, // $E4
+  { "SBC",  CPU_MODE_ZP,  0 }, // $E5
+  { "INC",  CPU_MODE_ZP,  0 }, // $E6
+  { "ISC",  CPU_MODE_ZP,  1 }, // $E7
+  { "INX",  CPU_MODE_IMP, 0 }, // $E8
+  { "SBC",  CPU_MODE_IMM, 0 }, // $E9
+  { "NOP",  CPU_MODE_IMP, 0 }, // $EA
+  { "SBC",  CPU_MODE_IMM, 1 }, // $EB
+  { "CPX",  CPU_MODE_ABS, 0 }, // $EC
+  { "SBC",  CPU_MODE_ABS, 0 }, // $ED
+  { "INC",  CPU_MODE_ABS, 0 }, // $EE
+  { "ISC",  CPU_MODE_ABS, 1 }, // $EF
+  { "BEQ",  CPU_MODE_REL, 0 }, // $F0
+  { "SBC",  CPU_MODE_IZY, 0 }, // $F1
+  { "JAM",  CPU_MODE_IMP, 1 }, // $F2
+  { "ISC",  CPU_MODE_IZY, 1 }, // $F3
+  { "NOP",  CPU_MODE_ZPX, 1 }, // $F4
+  { "SBC",  CPU_MODE_ZPX, 0 }, // $F5
+  { "INC",  CPU_MODE_ZPX, 0 }, // $F6
+  { "ISC",  CPU_MODE_ZPX, 1 }, // $F7
+  { "SED",  CPU_MODE_IMP, 0 }, // $F8
+  { "SBC",  CPU_MODE_ABY, 0 }, // $F9
+  { "NOP",  CPU_MODE_IMP, 1 }, // $FA
+  { "ISC",  CPU_MODE_ABY, 1 }, // $FB
+  { "NOP",  CPU_MODE_ABX, 1 }, // $FC
+  { "SBC",  CPU_MODE_ABX, 0 }, // $FD
+  { "INC",  CPU_MODE_ABX, 0 }, // $FE
+  { "ISC",  CPU_MODE_ABX, 1 }  // $FF
+};
+
+static const cpu_opcode CPU_OPCODES_45GS02[256] = {
+  { "BRK",  CPU_MODE_IMP, 0 }, // $00
+  { "ORA",  CPU_MODE_IZX, 0 }, // $01
+  { "CLE",  CPU_MODE_IMP, 0 }, // $02
+  { "SEE",  CPU_MODE_IMP, 0 }, // $03
+  { "TSB",  CPU_MODE_ZP,  0 }, // $04
+  { "ORA",  CPU_MODE_ZP,  0 }, // $05
+  { "ASL",  CPU_MODE_ZP,  0 }, // $06
+  { "RMB0", CPU_MODE_ZP,  0 }, // $07
+  { "PHP",  CPU_MODE_IMP, 0 }, // $08
+  { "ORA",  CPU_MODE_IMM, 0 }, // $09
+  { "ASL",  CPU_MODE_IMP, 0 }, // $0A
+  { "TSY",  CPU_MODE_IMP, 0 }, // $0B
+  { "TSB",  CPU_MODE_ABS, 0 }, // $0C
+  { "ORA",  CPU_MODE_ABS, 0 }, // $0D
+  { "ASL",  CPU_MODE_ABS, 0 }, // $0E
+  { "BBR0", CPU_MODE_ZPR, 0 }, // $0F
+  { "BPL",  CPU_MODE_REL, 0 }, // $10
+  { "ORA",  CPU_MODE_IZY, 0 }, // $11
+  { "ORA",  CPU_MODE_IZZ, 0 }, // $12
+  { "BPL",  CPU_MODE_RLW, 0 }, // $13
+  { "TRB",  CPU_MODE_ZP,  0 }, // $14
+  { "ORA",  CPU_MODE_ZPX, 0 }, // $15
+  { "ASL",  CPU_MODE_ZPX, 0 }, // $16
+  { "RMB1", CPU_MODE_ZP,  0 }, // $17
+  { "CLC",  CPU_MODE_IMP, 0 }, // $18
+  { "ORA",  CPU_MODE_ABY, 0 }, // $19
+  { "INC",  CPU_MODE_IMP, 0 }, // $1A
+  { "INZ",  CPU_MODE_IMP, 0 }, // $1B
+  { "TRB",  CPU_MODE_ABS, 0 }, // $1C
+  { "ORA",  CPU_MODE_ABX, 0 }, // $1D
+  { "ASL",  CPU_MODE_ABX, 0 }, // $1E
+  { "BBR1", CPU_MODE_ZPR, 0 }, // $1F
+  { "JSR",  CPU_MODE_ABS, 0 }, // $20
+  { "AND",  CPU_MODE_IZX, 0 }, // $21
+  { "JSR",  CPU_MODE_IND, 0 }, // $22
+  { "JSR",  CPU_MODE_IAX, 0 }, // $23
+  { "BIT",  CPU_MODE_ZP,  0 }, // $24
+  { "AND",  CPU_MODE_ZP,  0 }, // $25
+  { "ROL",  CPU_MODE_ZP,  0 }, // $26
+  { "RMB2", CPU_MODE_ZP,  0 }, // $27
+  { "PLP",  CPU_MODE_IMP, 0 }, // $28
+  { "AND",  CPU_MODE_IMM, 0 }, // $29
+  { "ROL",  CPU_MODE_IMP, 0 }, // $2A
+  { "TYS",  CPU_MODE_IMP, 0 }, // $2B
+  { "BIT",  CPU_MODE_ABS, 0 }, // $2C
+  { "AND",  CPU_MODE_ABS, 0 }, // $2D
+  { "ROL",  CPU_MODE_ABS, 0 }, // $2E
+  { "BBR2", CPU_MODE_ZPR, 0 }, // $2F
+  { "BMI",  CPU_MODE_REL, 0 }, // $30
+  { "AND",  CPU_MODE_IZY, 0 }, // $31
+  { "AND",  CPU_MODE_IZZ, 0 }, // $32
+  { "BMI",  CPU_MODE_RLW, 0 }, // $33
+  { "BIT",  CPU_MODE_ZPX, 0 }, // $34
+  { "AND",  CPU_MODE_ZPX, 0 }, // $35
+  { "ROL",  CPU_MODE_ZPX, 0 }, // $36
+  { "RMB3", CPU_MODE_ZP,  0 }, // $37
+  { "SEC",  CPU_MODE_IMP, 0 }, // $38
+  { "AND",  CPU_MODE_ABY, 0 }, // $39
+  { "DEC",  CPU_MODE_IMP, 0 }, // $3A
+  { "DEZ",  CPU_MODE_IMP, 0 }, // $3B
+  { "BIT",  CPU_MODE_ABX, 0 }, // $3C
+  { "AND",  CPU_MODE_ABX, 0 }, // $3D
+  { "ROL",  CPU_MODE_ABX, 0 }, // $3E
+  { "BBR3", CPU_MODE_ZPR, 0 }, // $3F
+  { "RTI",  CPU_MODE_IMP, 0 }, // $40
+  { "EOR",  CPU_MODE_IZX, 0 }, // $41
+  { "NEG",  CPU_MODE_IMP, 0 }, // $42
+  { "ASR",  CPU_MODE_IMP, 0 }, // $43
+  { "ASR",  CPU_MODE_ZP,  0 }, // $44
+  { "EOR",  CPU_MODE_ZP,  0 }, // $45
+  { "LSR",  CPU_MODE_ZP,  0 }, // $46
+  { "RMB4", CPU_MODE_ZP,  0 }, // $47
+  { "PHA",  CPU_MODE_IMP, 0 }, // $48
+  { "EOR",  CPU_MODE_IMM, 0 }, // $49
+  { "LSR",  CPU_MODE_IMP, 0 }, // $4A
+  { "TAZ",  CPU_MODE_IMP, 0 }, // $4B
+  { "JMP",  CPU_MODE_ABS, 0 }, // $4C
+  { "EOR",  CPU_MODE_ABS, 0 }, // $4D
+  { "LSR",  CPU_MODE_ABS, 0 }, // $4E
+  { "BBR4", CPU_MODE_ZPR, 0 }, // $4F
+  { "BVC",  CPU_MODE_REL, 0 }, // $50
+  { "EOR",  CPU_MODE_IZY, 0 }, // $51
+  { "EOR",  CPU_MODE_IZZ, 0 }, // $52
+  { "BVC",  CPU_MODE_RLW, 0 }, // $53
+  { "ASR",  CPU_MODE_ZPX, 0 }, // $54
+  { "EOR",  CPU_MODE_ZPX, 0 }, // $55
+  { "LSR",  CPU_MODE_ZPX, 0 }, // $56
+  { "RMB5", CPU_MODE_ZP,  0 }, // $57
+  { "CLI",  CPU_MODE_IMP, 0 }, // $58
+  { "EOR",  CPU_MODE_ABY, 0 }, // $59
+  { "PHY",  CPU_MODE_IMP, 0 }, // $5A
+  { "TAB",  CPU_MODE_IMP, 0 }, // $5B
+  { "MAP",  CPU_MODE_IMP, 0 }, // $5C
+  { "EOR",  CPU_MODE_ABX, 0 }, // $5D
+  { "LSR",  CPU_MODE_ABX, 0 }, // $5E
+  { "BBR5", CPU_MODE_ZPR, 0 }, // $5F
+  { "RTS",  CPU_MODE_IMP, 0 }, // $60
+  { "ADC",  CPU_MODE_IZX, 0 }, // $61
+  { "RTN",  CPU_MODE_IMM, 0 }, // $62
+  { "BSR",  CPU_MODE_RLW, 0 }, // $63
+  { "STZ",  CPU_MODE_ZP,  0 }, // $64
+  { "ADC",  CPU_MODE_ZP,  0 }, // $65
+  { "ROR",  CPU_MODE_ZP,  0 }, // $66
+  { "RMB6", CPU_MODE_ZP,  0 }, // $67
+  { "PLA",  CPU_MODE_IMP, 0 }, // $68
+  { "ADC",  CPU_MODE_IMM, 0 }, // $69
+  { "ROR",  CPU_MODE_IMP, 0 }, // $6A
+  { "TZA",  CPU_MODE_IMP, 0 }, // $6B
+  { "JMP",  CPU_MODE_IND, 0 }, // $6C
+  { "ADC",  CPU_MODE_ABS, 0 }, // $6D
+  { "ROR",  CPU_MODE_ABS, 0 }, // $6E
+  { "BBR6", CPU_MODE_ZPR, 0 }, // $6F
+  { "BVS",  CPU_MODE_REL, 0 }, // $70
+  { "ADC",  CPU_MODE_IZY, 0 }, // $71
+  { "ADC",  CPU_MODE_IZZ, 0 }, // $72
+  { "BVS",  CPU_MODE_RLW, 0 }, // $73
+  { "STZ",  CPU_MODE_ZPX, 0 }, // $74
+  { "ADC",  CPU_MODE_ZPX, 0 }, // $75
+  { "ROR",  CPU_MODE_ZPX, 0 }, // $76
+  { "RMB7", CPU_MODE_ZP,  0 }, // $77
+  { "SEI",  CPU_MODE_IMP, 0 }, // $78
+  { "ADC",  CPU_MODE_ABY, 0 }, // $79
+  { "PLY",  CPU_MODE_IMP, 0 }, // $7A
+  { "TBA",  CPU_MODE_IMP, 0 }, // $7B
+  { "JMP",  CPU_MODE_IAX, 0 }, // $7C
+  { "ADC",  CPU_MODE_ABX, 0 }, // $7D
+  { "ROR",  CPU_MODE_ABX, 0 }, // $7E
+  { "BBR7", CPU_MODE_ZPR, 0 }, // $7F
+  { "BRA",  CPU_MODE_REL, 0 }, // $80
+  { "STA",  CPU_MODE_IZX, 0 }, // $81
+  { "STA",  CPU_MODE_ISY, 0 }, // $82
+  { "BRA",  CPU_MODE_RLW, 0 }, // $83
+  { "STY",  CPU_MODE_ZP,  0 }, // $84
+  { "STA",  CPU_MODE_ZP,  0 }, // $85
+  { "STX",  CPU_MODE_ZP,  0 }, // $86
+  { "SMB0", CPU_MODE_ZP,  0 }, // $87
+  { "DEY",  CPU_MODE_IMP, 0 }, // $88
+  { "BIT",  CPU_MODE_IMM, 0 }, // $89
+  { "TXA",  CPU_MODE_IMP, 0 }, // $8A
+  { "STY",  CPU_MODE_ABX, 0 }, // $8B
+  { "STY",  CPU_MODE_ABS, 0 }, // $8C
+  { "STA",  CPU_MODE_ABS, 0 }, // $8D
+  { "STX",  CPU_MODE_ABS, 0 }, // $8E
+  { "BBS0", CPU_MODE_ZPR, 0 }, // $8F
+  { "BCC",  CPU_MODE_REL, 0 }, // $90
+  { "STA",  CPU_MODE_IZY, 0 }, // $91
+  { "STA",  CPU_MODE_IZZ, 0 }, // $92
+  { "BCC",  CPU_MODE_RLW, 0 }, // $93
+  { "STY",  CPU_MODE_ZPX, 0 }, // $94
+  { "STA",  CPU_MODE_ZPX, 0 }, // $95
+  { "STX",  CPU_MODE_ZPY, 0 }, // $96
+  { "SMB1", CPU_MODE_ZP,  0 }, // $97
+  { "TYA",  CPU_MODE_IMP, 0 }, // $98
+  { "STA",  CPU_MODE_ABY, 0 }, // $99
+  { "TXS",  CPU_MODE_IMP, 0 }, // $9A
+  { "STX",  CPU_MODE_ABY, 0 }, // $9B
+  { "STZ",  CPU_MODE_ABS, 0 }, // $9C
+  { "STA",  CPU_MODE_ABX, 0 }, // $9D
+  { "STZ",  CPU_MODE_ABX, 0 }, // $9E
+  { "BBS1", CPU_MODE_ZPR, 0 }, // $9F
+  { "LDY",  CPU_MODE_IMM, 0 }, // $A0
+  { "LDA",  CPU_MODE_IZX, 0 }, // $A1
+  { "LDX",  CPU_MODE_IMM, 0 }, // $A2
+  { "LDZ",  CPU_MODE_IMM, 0 }, // $A3
+  { "LDY",  CPU_MODE_ZP,  0 }, // $A4
+  { "LDA",  CPU_MODE_ZP,  0 }, // $A5
+  { "LDX",  CPU_MODE_ZP,  0 }, // $A6
+  { "SMB2", CPU_MODE_ZP,  0 }, // $A7
+  { "TAY",  CPU_MODE_IMP, 0 }, // $A8
+  { "LDA",  CPU_MODE_IMM, 0 }, // $A9
+  { "TAX",  CPU_MODE_IMP, 0 }, // $AA
+  { "LDZ",  CPU_MODE_ABS, 0 }, // $AB
+  { "LDY",  CPU_MODE_ABS, 0 }, // $AC
+  { "LDA",  CPU_MODE_ABS, 0 }, // $AD
+  { "LDX",  CPU_MODE_ABS, 0 }, // $AE
+  { "BBS2", CPU_MODE_ZPR, 0 }, // $AF
+  { "BCS",  CPU_MODE_REL, 0 }, // $B0
+  { "LDA",  CPU_MODE_IZY, 0 }, // $B1
+  { "LDA",  CPU_MODE_IZZ, 0 }, // $B2
+  { "BCS",  CPU_MODE_RLW, 0 }, // $B3
+  { "LDY",  CPU_MODE_ZPX, 0 }, // $B4
+  { "LDA",  CPU_MODE_ZPX, 0 }, // $B5
+  { "LDX",  CPU_MODE_ZPY, 0 }, // $B6
+  { "SMB3", CPU_MODE_ZP,  0 }, // $B7
+  { "CLV",  CPU_MODE_IMP, 0 }, // $B8
+  { "LDA",  CPU_MODE_ABY, 0 }, // $B9
+  { "TSX",  CPU_MODE_IMP, 0 }, // $BA
+  { "LDZ",  CPU_MODE_ABX, 0 }, // $BB
+  { "LDY",  CPU_MODE_ABX, 0 }, // $BC
+  { "LDA",  CPU_MODE_ABX, 0 }, // $BD
+  { "LDX",  CPU_MODE_ABY, 0 }, // $BE
+  { "BBS3", CPU_MODE_ZPR, 0 }, // $BF
+  { "CPY",  CPU_MODE_IMM, 0 }, // $C0
+  { "CMP",  CPU_MODE_IZX, 0 }, // $C1
+  { "CPZ",  CPU_MODE_IMM, 0 }, // $C2
+  { "DEW",  CPU_MODE_ZP,  0 }, // $C3
+  { "CPY",  CPU_MODE_ZP,  0 }, // $C4
+  { "CMP",  CPU_MODE_ZP,  0 }, // $C5
+  { "DEC",  CPU_MODE_ZP,  0 }, // $C6
+  { "SMB4", CPU_MODE_ZP,  0 }, // $C7
+  { "INY",  CPU_MODE_IMP, 0 }, // $C8
+  { "CMP",  CPU_MODE_IMM, 0 }, // $C9
+  { "DEX",  CPU_MODE_IMP, 0 }, // $CA
+  { "ASW",  CPU_MODE_ABS, 0 }, // $CB
+  { "CPY",  CPU_MODE_ABS, 0 }, // $CC
+  { "CMP",  CPU_MODE_ABS, 0 }, // $CD
+  { "DEC",  CPU_MODE_ABS, 0 }, // $CE
+  { "BBS4", CPU_MODE_ZPR, 0 }, // $CF
+  { "BNE",  CPU_MODE_REL, 0 }, // $D0
+  { "CMP",  CPU_MODE_IZY, 0 }, // $D1
+  { "CMP",  CPU_MODE_IZZ, 0 }, // $D2
+  { "BNE",  CPU_MODE_RLW, 0 }, // $D3
+  { "CPZ",  CPU_MODE_ZP,  0 }, // $D4
+  { "CMP",  CPU_MODE_ZPX, 0 }, // $D5
+  { "DEC",  CPU_MODE_ZPX, 0 }, // $D6
+  { "SMB5", CPU_MODE_ZP,  0 }, // $D7
+  { "CLD",  CPU_MODE_IMP, 0 }, // $D8
+  { "CMP",  CPU_MODE_ABY, 0 }, // $D9
+  { "PHX",  CPU_MODE_IMP, 0 }, // $DA
+  { "PHZ",  CPU_MODE_IMP, 0 }, // $DB
+  { "CPZ",  CPU_MODE_ABS, 0 }, // $DC
+  { "CMP",  CPU_MODE_ABX, 0 }, // $DD
+  { "DEC",  CPU_MODE_ABX, 0 }, // $DE
+  { "BBS5", CPU_MODE_ZPR, 0 }, // $DF
+  { "CPX",  CPU_MODE_IMM, 0 }, // $E0
+  { "SBC",  CPU_MODE_IZX, 0 }, // $E1
+  { "LDA",  CPU_MODE_ISY, 0 }, // $E2
+  { "INW",  CPU_MODE_ZP,  0 }, // $E3
+  { "CPX",  CPU_MODE_ZP,  0 }, // $E4
+  { "SBC",  CPU_MODE_ZP,  0 }, // $E5
+  { "INC",  CPU_MODE_ZP,  0 }, // $E6
+  { "SMB6", CPU_MODE_ZP,  0 }, // $E7
+  { "INX",  CPU_MODE_IMP, 0 }, // $E8
+  { "SBC",  CPU_MODE_IMM, 0 }, // $E9
+  { "EOM",  CPU_MODE_IMP, 0 }, // $EA
+  { "ROW",  CPU_MODE_ABS, 0 }, // $EB
+  { "CPX",  CPU_MODE_ABS, 0 }, // $EC
+  { "SBC",  CPU_MODE_ABS, 0 }, // $ED
+  { "INC",  CPU_MODE_ABS, 0 }, // $EE
+  { "BBS6", CPU_MODE_ZPR, 0 }, // $EF
+  { "BEQ",  CPU_MODE_REL, 0 }, // $F0
+  { "SBC",  CPU_MODE_IZY, 0 }, // $F1
+  { "SBC",  CPU_MODE_IZZ, 0 }, // $F2
+  { "BEQ",  CPU_MODE_RLW, 0 }, // $F3
+  { "PHW",  CPU_MODE_IMW, 0 }, // $F4
+  { "SBC",  CPU_MODE_ZPX, 0 }, // $F5
+  { "INC",  CPU_MODE_ZPX, 0 }, // $F6
+  { "SMB7", CPU_MODE_ZP,  0 }, // $F7
+  { "SED",  CPU_MODE_IMP, 0 }, // $F8
+  { "SBC",  CPU_MODE_ABY, 0 }, // $F9
+  { "PLX",  CPU_MODE_IMP, 0 }, // $FA
+  { "PLZ",  CPU_MODE_IMP, 0 }, // $FB
+  { "PHW",  CPU_MODE_ABS, 0 }, // $FC
+  { "SBC",  CPU_MODE_ABX, 0 }, // $FD
+  { "INC",  CPU_MODE_ABX, 0 }, // $FE
+  { "BBS7", CPU_MODE_ZPR, 0 }  // $FF
+};
+
+
+// 45GS02 prefixes, turning the next instruction into a 32-bit one
+#define CPU_45GS02_PREFIX_NEG 0x42 // twice - operations on the Q register
+#define CPU_45GS02_PREFIX_NOP 0xEA // before ($nn),Z - 32-bit pointer, [$nn],Z
+
+// Length of the 6502 instruction at 'code', 0 if it does not fit in 'size' bytes
+static inline int cpu_6502_length(const unsigned char *code, int size)
+{
+  if (size < 1) return 0;
+  int length = CPU_MODE_LENGTH[CPU_OPCODES_6502[code[0]].mode];
+  return (length <= size) ? length : 0;
+}
+
+// Length of the 45GS02 instruction at 'code', including prefixes, 0 if it does not fit in 'size' bytes
+static inline int cpu_45gs02_length(const unsigned char *code, int size)
+{
+  int prefix = 0;
+
+  if (size >= 2 && code[0] == CPU_45GS02_PREFIX_NEG && code[1] == CPU_45GS02_PREFIX_NEG) prefix = 2;
+  if (size >= prefix + 2 && code[prefix] == CPU_45GS02_PREFIX_NOP &&
+      CPU_OPCODES_45GS02[code[prefix + 1]].mode == CPU_MODE_IZZ) prefix++;
+
+  if (size < prefix + 1) return 0;
+  int length = prefix + CPU_MODE_LENGTH[CPU_OPCODES_45GS02[code[prefix]].mode];
+  return (length <= size) ? length : 0;
+}
+
+#endif // CPU_OPCODES_H
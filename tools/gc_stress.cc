@@ -0,0 +1,596 @@
+//
+// Utility to stress the BASIC string garbage collector on a headless machine
+// model - measures the cycles each 'varstr_garbage_collect' invocation takes,
+// against the number of live / unused strings and the string heap size, and
+// dumps the string heap before and after the collection
+//
+// String heap layout (top-down, from MEMSIZ to FRETOP) - each string is followed
+// by a 2-byte back-pointer to its descriptor; for unused strings the back-pointer
+// is 0 and the last string byte contains the string length - 1
+//
+
+#include "common.h"
+#include "basic_program.h"
+#include "bench_results.h"
+#include "headless_c64.h"
+#include "symbols.h"
+
+#include <unistd.h>
+
+#include <cstdio>
+#include <list>
+
+//
+// Command line settings
+//
+
+std::string CMD_basic     = "./build/basic_generic.rom";
+std::string CMD_kernal    = "./build/kernal_generic.rom";
+std::string CMD_prgFile   = "";
+std::string CMD_bchFile   = "";
+std::string CMD_basFile   = "";
+std::string CMD_csvFile   = "";
+uint16_t    CMD_gcAddress = 0;
+unsigned    CMD_dumpLines = 0;
+
+std::list<std::string> CMD_symDirs;
+std::list<std::string> CMD_vsFiles;
+
+std::vector<std::pair<unsigned, unsigned>> CMD_workloads;
+
+const std::string GC_ROUTINE = "varstr_garbage_collect";
+
+// Default synthetic workloads - numbers of live strings, unused strings per live one
+
+const std::vector<unsigned> SWEEP_LIVE  = { 16, 64, 256, 1024 };
+const std::vector<unsigned> SWEEP_RATIO = { 0, 1, 4 };
+
+const unsigned SWEEP_MAX_STRINGS = 2048;   // more would not fit into memory (live 1024, ratio 4)
+
+const unsigned MAX_STRING_LEN = 32;
+
+const double   MAX_RUN_SECONDS  = 120.0;
+const uint64_t MAX_GC_CYCLES    = 100000000;
+
+//
+// Common helper functions
+//
+
+void printUsage()
+{
+    std::cout << "\n" <<
+        "usage: gc_stress [-b <BASIC ROM>] [-k <KERNAL ROM>] [-y <symbol dir>]... [-v <VICE label file>]..." << "\n" <<
+        "                 [-a <GC routine address>] [-f <BASIC program>] [-d <heap dump lines>] [-c <CSV file>]" << "\n" <<
+        "                 [-w <live>:<unused>]... [-o <results file>] [-p <baseline file>]" << "\n\n" <<
+        "  -y, -v  symbol sources, used to find '" << GC_ROUTINE << "'" << "\n" <<
+        "  -a      GC routine address (hex), for ROMs without symbols" << "\n" <<
+        "  -f      measure the GC runs of a BASIC program (listing format as for 'bench_basic')," << "\n" <<
+        "          default is a sweep over synthetic string heaps, calling the GC directly" << "\n" <<
+        "  -w      synthetic workload - number of live and unused strings, replaces the default sweep" << "\n" <<
+        "  -d      number of heap entries to dump before and after the first collection" << "\n" <<
+        "  -c      write per-invocation measurements in CSV format" << "\n" <<
+        "  -o, -p  results / baseline file, synthetic workloads only" << "\n\n";
+}
+
+void parseCommandLine(int argc, char **argv)
+{
+    int opt;
+
+    while ((opt = getopt(argc, argv, "b:k:y:v:a:f:d:c:w:o:p:")) != -1)
+    {
+        switch(opt)
+        {
+            case 'b': CMD_basic     = optarg;                        break;
+            case 'k': CMD_kernal    = optarg;                        break;
+            case 'y': CMD_symDirs.push_back(optarg);                 break;
+            case 'v': CMD_vsFiles.push_back(optarg);                 break;
+            case 'a': CMD_gcAddress = strtoul(optarg, nullptr, 16);  break;
+            case 'f': CMD_prgFile   = optarg;                        break;
+            case 'd': CMD_dumpLines = atoi(optarg);                  break;
+            case 'c': CMD_csvFile   = optarg;                        break;
+            case 'w':
+            {
+                unsigned live, dead;
+                if (sscanf(optarg, "%u:%u", &live, &dead) != 2) { printUsage(); ERROR("malformed workload"); }
+                CMD_workloads.emplace_back(live, dead);
+                break;
+            }
+            case 'o': CMD_bchFile   = optarg;                        break;
+            case 'p': CMD_basFile   = optarg;                        break;
+            default: printUsage(); ERROR();
+        }
+    }
+
+    if (optind != argc) { printUsage(); ERROR("unexpected parameters"); }
+}
+
+void printBanner()
+{
+    printBannerLineTop();
+    std::cout << "// Stressing BASIC string garbage collector" << "\n";
+    printBannerLineBottom();
+}
+
+//
+// String heap inspection
+//
+
+typedef struct
+{
+    bool        valid      = true;
+    std::string error;
+
+    uint16_t    memsiz     = 0;
+    uint16_t    fretop     = 0;
+    unsigned    liveCount  = 0;
+    unsigned    liveBytes  = 0;   // including back-pointers
+    unsigned    deadCount  = 0;
+    unsigned    deadBytes  = 0;
+
+    unsigned heapBytes() const { return memsiz - fretop; }
+
+} HeapStats;
+
+// Walks the heap from MEMSIZ down to FRETOP; optionally prints the entries
+
+HeapStats walkHeap(const C64Machine &machine, unsigned dumpLines = 0, const char *title = "")
+{
+    HeapStats stats;
+
+    stats.memsiz = machine.peek16(ADDR_MEMSIZ);
+    stats.fretop = machine.peek16(ADDR_FRETOP);
+
+    // RAM is read directly - strings can be placed under the ROMs
+
+    auto ram16 = [&](uint16_t addr) -> uint16_t { return machine.ram[addr] | (machine.ram[uint16_t(addr + 1)] << 8); };
+
+    if (dumpLines != 0)
+    {
+        char buf[128];
+        snprintf(buf, sizeof(buf), "%s - MEMSIZ $%04X, FRETOP $%04X, STREND $%04X\n\n", title, stats.memsiz, stats.fretop,
+                 machine.peek16(ADDR_STREND));
+        std::cout << buf << "    address  back-ptr  length  content" << "\n";
+    }
+
+    unsigned lines = 0;
+    uint16_t top   = stats.memsiz;
+    while (top > stats.fretop)
+    {
+        if (top - stats.fretop < 3)
+        {
+            stats.valid = false;
+            stats.error = "truncated entry at the heap bottom";
+            break;
+        }
+
+        const uint16_t backPtr = ram16(top - 2);
+        unsigned       length;
+        bool           live    = (backPtr != 0);
+
+        if (live)
+        {
+            length = machine.ram[backPtr];
+
+            const uint16_t start = ram16(backPtr + 1);
+            if (length == 0 || uint16_t(start + length) != uint16_t(top - 2))
+            {
+                char buf[128];
+                snprintf(buf, sizeof(buf), "back-pointer $%04X at $%04X does not point to a matching descriptor",
+                         backPtr, top - 2);
+                stats.valid = false;
+                stats.error = buf;
+                break;
+            }
+        }
+        else
+        {
+            length = machine.ram[top - 3] + 1;
+        }
+
+        const uint16_t start = top - 2 - length;
+        if (start < stats.fretop)
+        {
+            stats.valid = false;
+            stats.error = "string crosses FRETOP";
+            break;
+        }
+
+        if (live) { stats.liveCount++; stats.liveBytes += length + 2; }
+        else      { stats.deadCount++; stats.deadBytes += length + 2; }
+
+        if (dumpLines != 0 && lines++ < dumpLines)
+        {
+            std::string content;
+            for (unsigned idx = 0; idx < std::min(length, 24u) && live; idx++)
+            {
+                const uint8_t c = machine.ram[start + idx];
+                content += (c >= 0x20 && c < 0x60) ? char(c) : '.';
+            }
+
+            char backPtrText[8] = "-----";
+            if (live) snprintf(backPtrText, sizeof(backPtrText), "$%04X", backPtr);
+
+            char buf[128];
+            snprintf(buf, sizeof(buf), "    $%04X    %s     %3u    %s\n", start, backPtrText, length,
+                     live ? ("'" + content + (length > 24 ? "...'" : "'")).c_str() : "(unused)");
+            std::cout << buf;
+        }
+
+        top = start;
+    }
+
+    if (dumpLines != 0)
+    {
+        if (lines > dumpLines) std::cout << "    ... " << lines - dumpLines << " more" << "\n";
+        std::cout << "\n";
+    }
+
+    return stats;
+}
+
+std::string formatStats(const HeapStats &stats)
+{
+    char buf[128];
+    snprintf(buf, sizeof(buf), "%6u %6u %7u %7u %7u", stats.liveCount, stats.deadCount,
+             stats.liveBytes, stats.deadBytes, stats.heapBytes());
+    return buf;
+}
+
+//
+// Machine setup
+//
+
+void bootMachine(C64Machine &machine)
+{
+    BasicSession session(machine);
+
+    std::string error;
+    if (!machine.loadRoms(CMD_basic, CMD_kernal, error)) ERROR(error);
+    if (!session.boot()) ERROR(session.error);
+}
+
+uint16_t findGcRoutine()
+{
+    if (CMD_gcAddress != 0) return CMD_gcAddress;
+
+    SymbolTable symbols;
+    for (const auto &symDir : CMD_symDirs)
+    {
+        if (symbols.loadDir(symDir) == 0) ERROR(std::string("no symbol files found in '") + symDir + "'");
+    }
+    for (const auto &vsFile : CMD_vsFiles)
+    {
+        if (!symbols.loadViceFile(vsFile)) ERROR(std::string("unable to read VICE label file '") + vsFile + "'");
+    }
+
+    uint16_t address;
+    if (!symbols.find(GC_ROUTINE, address))
+    {
+        printUsage();
+        ERROR(std::string("address of '") + GC_ROUTINE + "' not known, provide symbols or use '-a'");
+    }
+
+    return address;
+}
+
+//
+// Synthetic workloads - heap built directly in memory, GC called from a stub
+//
+
+typedef struct
+{
+    unsigned  live;
+    unsigned  dead;
+    bool      ok;
+    std::string error;
+    uint64_t  cycles;
+    HeapStats before;
+    HeapStats after;
+
+} SweepResult;
+
+SweepResult runSynthetic(uint16_t gcAddress, unsigned live, unsigned dead, bool dump)
+{
+    SweepResult result = { live, dead, false, "", 0, {}, {} };
+
+    C64Machine machine;
+    bootMachine(machine);
+
+    // Deterministic pseudo-random generator, so that results are comparable between runs
+
+    uint32_t seed = live * 7919 + dead;
+    auto random = [&seed](unsigned range) -> unsigned
+    {
+        seed = seed * 1103515245 + 12345;
+        return (seed >> 16) % range;
+    };
+
+    // Descriptors - simple string variables right after the program, 7 bytes each
+
+    const uint16_t varStart = machine.peek16(ADDR_VARTAB);
+    const uint16_t varEnd   = varStart + live * 7;
+    const uint16_t memsiz   = machine.peek16(ADDR_MEMSIZ);
+
+    std::vector<uint8_t> order(live + dead, false);
+    for (unsigned idx = 0; idx < live; idx++) order[idx] = true;
+    for (unsigned idx = order.size() - 1; idx > 0; idx--) std::swap(order[idx], order[random(idx + 1)]);
+
+    std::vector<std::pair<uint16_t, std::string>> expected;   // descriptor, content
+
+    uint16_t top     = memsiz;
+    unsigned liveIdx = 0;
+    for (const uint8_t isLive : order)
+    {
+        const unsigned length = 1 + random(MAX_STRING_LEN);
+        if (top < varEnd + length + 2 + 0x100)
+        {
+            result.error = "workload does not fit into memory";
+            return result;
+        }
+
+        top -= 2;
+        const uint16_t start = top - length;
+
+        std::string content;
+        for (unsigned idx = 0; idx < length; idx++)
+        {
+            content += char('A' + random(26));
+            machine.ram[start + idx] = uint8_t(content.back());
+        }
+
+        if (isLive)
+        {
+            const uint16_t descriptor = varStart + liveIdx * 7;
+
+            machine.ram[descriptor + 0] = 'A' + liveIdx % 26;
+            machine.ram[descriptor + 1] = 0x80 | ('A' + (liveIdx / 26) % 26);
+            machine.ram[descriptor + 2] = length;
+            machine.ram[descriptor + 3] = start & 0xFF;
+            machine.ram[descriptor + 4] = start >> 8;
+            machine.ram[descriptor + 5] = 0;
+            machine.ram[descriptor + 6] = 0;
+
+            machine.ram[top + 0] = (descriptor + 2) & 0xFF;
+            machine.ram[top + 1] = (descriptor + 2) >> 8;
+
+            expected.emplace_back(descriptor + 2, content);
+            liveIdx++;
+        }
+        else
+        {
+            machine.ram[top - 1] = length - 1;
+            machine.ram[top + 0] = 0;
+            machine.ram[top + 1] = 0;
+        }
+
+        top = start;
+    }
+
+    for (uint16_t zp : { ADDR_ARYTAB, ADDR_STREND })
+    {
+        machine.poke(zp, varEnd & 0xFF);
+        machine.poke(zp + 1, varEnd >> 8);
+    }
+    machine.poke(ADDR_FRETOP, top & 0xFF);
+    machine.poke(ADDR_FRETOP + 1, top >> 8);
+
+    result.before = walkHeap(machine, dump ? CMD_dumpLines : 0, "Heap before GC");
+    if (!result.before.valid)
+    {
+        result.error = "synthetic heap not recognized: " + result.before.error;
+        return result;
+    }
+
+    // Stub: SEI, JSR <GC routine>, and a trap to stop there
+
+    const uint8_t stub[] = { 0x78, 0x20, uint8_t(gcAddress & 0xFF), uint8_t(gcAddress >> 8), 0xEA };
+    for (unsigned idx = 0; idx < sizeof(stub); idx++) machine.poke(ADDR_STUB + idx, stub[idx]);
+
+    const uint16_t stubEnd = ADDR_STUB + 4;
+    machine.setTrap(stubEnd);
+    machine.trapHandler = [&](uint16_t pc) -> bool { return pc != stubEnd; };
+
+    machine.cpu.pc = ADDR_STUB;
+
+    const uint64_t start = machine.cycles;
+    machine.run(MAX_GC_CYCLES);
+    result.cycles = machine.cycles - start - 2;   // SEI excluded, JSR/RTS pair included
+
+    if (machine.cpu.pc != stubEnd)
+    {
+        result.error = machine.cpu.jammed ? "CPU jammed" : "GC did not return";
+        return result;
+    }
+
+    // Check the outcome - all the live strings intact, no unused ones
+
+    result.after = walkHeap(machine, dump ? CMD_dumpLines : 0, "Heap after GC");
+    if (!result.after.valid)                     { result.error = "heap corrupted: " + result.after.error; return result; }
+    if (result.after.deadCount != 0)             { result.error = "unused strings left";                   return result; }
+    if (result.after.liveCount != live)          { result.error = "live strings lost";                     return result; }
+
+    for (const auto &item : expected)
+    {
+        const uint16_t strAddr = machine.ram[item.first + 1] | (machine.ram[item.first + 2] << 8);
+        if (std::string((const char *) &machine.ram[strAddr], item.second.size()) != item.second)
+        {
+            result.error = "string content damaged";
+            return result;
+        }
+    }
+
+    result.ok = true;
+    return result;
+}
+
+void runSweep(uint16_t gcAddress, std::ostream *csv)
+{
+    BenchResults results;
+
+    std::cout << "      live   dead  live B  dead B  heap B   ->  heap B        cycles   cycles/KB  status" << "\n";
+    if (csv) *csv << "live,dead,live_bytes,dead_bytes,heap_bytes_before,heap_bytes_after,cycles" << "\n";
+
+    if (CMD_workloads.empty())
+    {
+        for (const unsigned live : SWEEP_LIVE)
+        {
+            for (const unsigned ratio : SWEEP_RATIO)
+            {
+                if (live + live * ratio <= SWEEP_MAX_STRINGS) CMD_workloads.emplace_back(live, live * ratio);
+            }
+        }
+    }
+
+    bool     first    = true;
+    unsigned failures = 0;
+    for (const auto &workload : CMD_workloads)
+    {
+        const unsigned live = workload.first;
+        const unsigned dead = workload.second;
+
+        const SweepResult result = runSynthetic(gcAddress, live, dead, first && CMD_dumpLines != 0);
+        first = false;
+
+        const std::string key = "gc.live" + std::to_string(live) + ".dead" + std::to_string(dead) + ".cycles";
+
+        char buf[256];
+        if (!result.ok)
+        {
+            // Not stored - a missing result is reported as a regression by the comparison
+
+            snprintf(buf, sizeof(buf), "    %6u %6u  FAILED: %s\n", live, dead, result.error.c_str());
+            failures++;
+        }
+        else
+        {
+            const unsigned heapBytes = result.before.heapBytes();
+            snprintf(buf, sizeof(buf), "    %s   -> %7u  %12llu  %10.1f  ok\n", formatStats(result.before).c_str(),
+                     result.after.heapBytes(), (unsigned long long) result.cycles,
+                     heapBytes ? result.cycles * 1024.0 / heapBytes : 0.0);
+            results.set(key, result.cycles);
+
+            if (csv)
+            {
+                *csv << live << "," << dead << "," << result.before.liveBytes << "," <<
+                        result.before.deadBytes << "," << heapBytes << "," << result.after.heapBytes() << "," <<
+                        result.cycles << "\n";
+            }
+        }
+        std::cout << buf;
+    }
+    std::cout << "\n";
+
+    std::string error;
+    if (!results.saveAndCompare(CMD_bchFile, CMD_basFile,
+                                "gc_stress results, format: gc.live<N>.dead<M>.cycles <value>",
+                                "garbage collector performance", error))
+    {
+        ERROR(error);
+    }
+
+    if (failures != 0) ERROR(std::to_string(failures) + " workload(s) failed");
+}
+
+//
+// BASIC program workload - every GC invocation during the run is measured
+//
+
+void runProgram(uint16_t gcAddress, std::ostream *csv)
+{
+    BasicProgram program;
+    std::string  error;
+    if (!program.loadListing(CMD_prgFile, error)) ERROR(error);
+
+    C64Machine   machine;
+    BasicSession session(machine);
+    bootMachine(machine);
+    program.inject(machine);
+
+    std::cout << "        #   live   dead  live B  dead B  heap B   ->  heap B        cycles   cycles/KB" << "\n";
+    if (csv) *csv << "invocation,live,dead,live_bytes,dead_bytes,heap_bytes_before,heap_bytes_after,cycles" << "\n";
+
+    // Entry trap records the state, trap at the return address completes the measurement
+
+    unsigned  invocations = 0;
+    uint64_t  totalCycles = 0;
+    uint64_t  entryCycles = 0;
+    uint8_t   entryS      = 0;
+    uint16_t  returnAddr  = 0;
+    HeapStats before;
+
+    machine.setTrap(gcAddress);
+    machine.trapHandler = [&](uint16_t pc) -> bool
+    {
+        if (pc == gcAddress && returnAddr == 0)
+        {
+            entryCycles = machine.cycles;
+            entryS      = machine.cpu.s;
+            returnAddr  = machine.peek16(0x0100 + uint8_t(entryS + 1)) + 1;
+            before      = walkHeap(machine, invocations == 0 ? CMD_dumpLines : 0, "Heap before the first GC");
+            machine.setTrap(returnAddr);
+        }
+        else if (pc == returnAddr && machine.cpu.s == uint8_t(entryS + 2))
+        {
+            const uint64_t  cycles = machine.cycles - entryCycles;
+            const HeapStats after  = walkHeap(machine, invocations == 0 ? CMD_dumpLines : 0, "Heap after the first GC");
+
+            invocations++;
+            totalCycles += cycles;
+            if (returnAddr != gcAddress) machine.setTrap(returnAddr, false);
+            returnAddr = 0;
+
+            char buf[256];
+            snprintf(buf, sizeof(buf), "    %5u %s   -> %7u  %12llu  %10.1f%s\n", invocations, formatStats(before).c_str(),
+                     after.heapBytes(), (unsigned long long) cycles,
+                     before.heapBytes() ? cycles * 1024.0 / before.heapBytes() : 0.0,
+                     (before.valid && after.valid) ? "" : "  (heap not recognized)");
+            std::cout << buf;
+
+            if (csv)
+            {
+                *csv << invocations << "," << before.liveCount << "," << before.deadCount << "," << before.liveBytes <<
+                        "," << before.deadBytes << "," << before.heapBytes() << "," << after.heapBytes() << "," <<
+                        cycles << "\n";
+            }
+        }
+        return true;
+    };
+
+    const uint64_t cycles = session.execute(program.command, MAX_RUN_SECONDS);
+
+    std::cout << "\n" << "Program: " << cycles << " cycles, " << invocations << " GC invocations, " <<
+                 totalCycles << " cycles in GC";
+    if (cycles != 0) std::cout << " (" << (totalCycles * 100 / cycles) << "%)";
+    std::cout << "\n";
+    if (session.failed()) std::cout << "Program failed: " << session.error << "\n";
+    std::cout << "\n";
+}
+
+//
+// Main function
+//
+
+int main(int argc, char **argv)
+{
+    parseCommandLine(argc, argv);
+    printBanner();
+
+    const uint16_t gcAddress = findGcRoutine();
+
+    std::ofstream csvFile;
+    if (!CMD_csvFile.empty())
+    {
+        csvFile.open(CMD_csvFile, std::ios::out | std::ios::trunc);
+        if (!csvFile.good()) ERROR(std::string("unable to write CSV file '") + CMD_csvFile + "'");
+    }
+    std::ostream *csv = CMD_csvFile.empty() ? nullptr : &csvFile;
+
+    char buf[64];
+    snprintf(buf, sizeof(buf), "GC routine at $%04X\n\n", gcAddress);
+    std::cout << buf;
+
+    if (CMD_prgFile.empty()) runSweep(gcAddress, csv);
+    else                     runProgram(gcAddress, csv);
+
+    return 0;
+}
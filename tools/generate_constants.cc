@@ -4,6 +4,7 @@
 //
 
 #include "common.h"
+#include "cbm_float.h"
 
 #include <unistd.h>
 
@@ -118,88 +119,28 @@ void parseCommandLine(int argc, char **argv)
 
 std::string toAssemblerString(const std::string &constName, double constValue)
 {
-	uint8_t outFloat[5] = { 0 };
+	// Convert, with the mantissa rounded to output format precission
 
-	// Retrieve mantissa nad exponent
-
-	int    exponent = -0x80;
-	double mantissa = frexp(std::abs(constValue), &exponent);
-	
-	// Round the mantissa to output format precission
-
-	const double coeff = 256.0 * 256.0 * 256.0 * 256.0;
-
-	double intPart;
-	if (modf(mantissa * coeff, &intPart) >= 0.5)
-	{
-		mantissa = (intPart + 1.0) / coeff;
-	}
-	else
-	{
-		mantissa = intPart / coeff;
-	}
-
-	if (mantissa >= 1.0)
-	{
-		mantissa = 0.5;
-		exponent++;
-	}
-
-	// Add a bias to exponent
-
-	exponent += 0x80;
-
-	// Check if output format can contain such a number
-
-	if (exponent > 0xFF)
-	{
-		ERROR(std::string("const '")  + constName + "' abs value too large");
-	}
-	else if (exponent <= 0)
-	{
-		ERROR(std::string("const '")  + constName + "' abs value too small");
-	}
-
-	// Set output constant exponent
-
-	outFloat[0] = exponent;
-
-	// Set output constant mantissa
-
-	for (uint8_t idxByte = 1; idxByte <= 4; idxByte++)
+	CbmFloat outFloat;
+	if (!CbmFloat::fromHost(constValue, outFloat))
 	{
-		for (uint8_t idxBit = 0; idxBit <= 7; idxBit++)
-		{
-			outFloat[idxByte] = outFloat[idxByte] << 1;
-			if (mantissa >= 0.5)
-			{
-				outFloat[idxByte]++;
-				mantissa -= 0.5;
-			}
-
-			mantissa *= 2;
-		}
+		ERROR(std::string("const '")  + constName + "' abs value too " + (std::abs(constValue) > 1.0 ? "large" : "small"));
 	}
 
-	if (mantissa > 0.0)     ERROR(std::string("const '")  + constName + "' export error");
-	if (outFloat[1] < 0x80) ERROR(std::string("const '")  + constName + "' not normalized");
-
-	// Set output constant sign
-
-	if (constValue >= 0.0)
+	if (std::abs(outFloat.toHost() - constValue) > CbmFloat::ulp(outFloat.exponent()) / 2)
 	{
-		outFloat[1] = outFloat[1] & 0x7F;
+		ERROR(std::string("const '")  + constName + "' export error");
 	}
 
 	// Return the output constant as string for assembler
 
 	char buf[256] = { 0 };
 	snprintf(buf, sizeof(buf), "$%02X, $%02X, $%02X, $%02X, $%02X    // %22.10f",
-		outFloat[0],
-		outFloat[1],
-		outFloat[2],
-		outFloat[3],
-		outFloat[4],
+		outFloat.bytes[0],
+		outFloat.bytes[1],
+		outFloat.bytes[2],
+		outFloat.bytes[3],
+		outFloat.bytes[4],
 		constValue);
 
 	std::string outDef = std::string("\n!macro PUT_CONST_") + constName + " {\n\t!byte " + buf + "\n}\n";
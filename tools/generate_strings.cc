@@ -7,11 +7,14 @@
 #include <unistd.h>
 
 #include <algorithm>
+#include <chrono>
 #include <fstream>
 #include <iomanip>
 #include <regex>
 #include <sstream>
 #include <map>
+#include <memory>
+#include <random>
 #include <vector>
 
 //
@@ -20,6 +23,10 @@
 
 std::string CMD_outFile = "out.s";
 std::string CMD_cnfFile = "";
+std::string CMD_catFile = "";
+std::string CMD_bchFile = "";
+std::string CMD_basFile = "";
+bool        CMD_report  = false;
 
 //
 // Type definition for strings/keywords to generate
@@ -44,11 +51,18 @@ enum class ListType
     DICTIONARY                  // for internal use only
 };
 
+typedef struct StringEntryAlias
+{
+    std::string alias;          // additional alias, for the assembler
+    std::string target;         // alias of the string entry it refers to
+} StringEntryAlias;
+
 typedef struct StringEntryList
 {
-    ListType                 type;
-    std::string              name;
-    std::vector<StringEntry> list;
+    ListType                      type;
+    std::string                   name;
+    std::vector<StringEntry>      list;
+    std::vector<StringEntryAlias> aliases = {};
 } StringEntryList;
 
 typedef std::vector<uint8_t>       StringEncoded;
@@ -467,6 +481,23 @@ const StringEntryList GLOBAL_MiscStrings =  { ListType::STRINGS_BASIC, "misc",
 */
 
 std::map<std::string, bool> GLOBAL_ConfigOptions;
+std::vector<StringEntryList> GLOBAL_Catalogue;
+
+//
+// Canonical Huffman encoding parameters
+//
+
+const uint8_t HUFF_MAX_CODE_LEN = 8;    // so that every code fits into a single 6502 register
+
+//
+// Rough estimations of the 6502 decoding cost, in cycles, JCHROUT call excluded
+//
+
+const double CYCLES_1N          = 27.0; // character encoded as 1 nibble, average of low and high one
+const double CYCLES_3N          = 48.0; // character encoded as 3 nibbles
+const double CYCLES_DICT_WORD   = 64.0; // extra cost of every dictionary reference
+const double CYCLES_HUFF_BIT    = 24.0; // canonical Huffman decoder, per single bit
+const double CYCLES_HUFF_SYMBOL = 18.0; // canonical Huffman decoder, per decoded symbol
 
 //
 // Work class definitions
@@ -478,11 +509,17 @@ class DictEncoder
 public:
 
     void addString(const std::string &inString, StringEncoded *outPtr);
+    void addFragment(const std::string &fragment, uint8_t code);
 
     void process(StringEntryList &outDictionary);
 
 private:
 
+    bool isFragment(const std::string &str) const { return fragments.find(str) != fragments.end(); }
+    uint32_t fragmentsInDictionary() const;
+
+    void createDictionary();
+
     bool optimizeSplit();
     bool optimizeJoin();
     void optimizeOrder();
@@ -492,8 +529,43 @@ private:
     void extractWords(std::vector<std::string> &candidateList);
     int32_t evaluateCandidate(std::string &candidate);
 
-    std::vector<StringEncoded *> encodings;
-    std::vector<std::string>     dictionary;
+    std::vector<StringEncoded *>   encodings;
+    std::vector<std::string>       plainStrings;
+    std::vector<std::string>       dictionary;
+
+    std::map<std::string, uint8_t> fragments; // strings stored elsewhere in the ROM, with their codes
+};
+
+// This class encapsulates the optional canonical Huffman encoding of selected string lists
+class HuffEncoder
+{
+public:
+
+    void addString(const std::string &inString, StringEncoded *outPtr);
+
+    void process();
+
+    bool empty() const { return encodings.empty(); }
+    size_t tablesSize() const;
+    double bitsPerSymbol() const;
+
+    void prepareOutput(std::ostringstream &stream) const;
+
+private:
+
+    void calculateCodeLengths();
+    void limitCodeLengths();
+    void assignCodes();
+
+    std::vector<StringEncoded *>   encodings;
+    std::vector<std::string>       plainStrings;
+
+    std::map<char, uint32_t>       freqMap;
+    std::map<char, uint8_t>        codeLen;
+    std::map<char, uint8_t>        code;
+
+    std::vector<char>              symbols;  // all the symbols, in canonical order
+    std::vector<uint8_t>           lenCount; // number of codes of the given length
 };
 
 // Main class to encode strings based on character frequency
@@ -501,18 +573,33 @@ class DataSet
 {
 public:
 
+    void setCompressionLvl(uint8_t level) { compressionLvl = level; }
+    void setCrossList(bool enabled)       { crossList = enabled; }
+
     void addStrings(const StringEntryList &stringList);
+    void addCatalogue(const std::vector<StringEntryList> &catalogue);
 
     const std::string &getOutput();
 
+    void printStatistics() const;
+
+    size_t packedSize() const;
+    void   packedListSizes(std::vector<std::pair<std::string, size_t>> &listSizes) const;
+    double decodeCyclesPerChar() const;
+
+    virtual std::string layoutName() const = 0;
+
 private:
 
+    size_t listPackedSize(size_t idx) const;
+
     void process();
 
     void generateConfigDepStrings();
     void validateLists();
     void calculateFrequencies();
     void encodeStringsDict();
+    void encodeStringsHuff();
     void encodeStringsFreq();
 
     void encodeByFreq(const std::string &plain, StringEncoded &encoded) const;
@@ -529,9 +616,12 @@ private:
     void putCharEncoding(std::ostringstream &stream, uint8_t idx, char character, bool is3n);
 
     bool isCompressionLvl2(const StringEntryList &list) const;
+    bool isCompressionLvl3(const StringEntryList &list) const;
 
     virtual bool isRelevant(const StringEntry &entry) const = 0;
-    virtual std::string layoutName() const = 0;
+
+    uint8_t                               compressionLvl = 1;
+    bool                                  crossList      = false;
 
     std::vector<StringEntryList>          stringEntryLists;
     std::vector<StringEncodedList>        stringEncodedLists;
@@ -539,6 +629,8 @@ private:
     std::vector<char>                     as1n; // list of bytes to be encoded as 1 nibble
     std::vector<char>                     as3n; // list of bytes to be encoded as 3 nibbles
 
+    HuffEncoder                           huffEncoder;
+
     uint8_t                               tk__packed_as_3n    = 0;
     uint8_t                               tk__max_keyword_len = 0;
 
@@ -582,32 +674,25 @@ class DataSetX16 : public DataSet
 
 void DictEncoder::addString(const std::string &inString, StringEncoded *outPtr)
 {
-    // Store the pointer to encoding
+    // Store the pointer to encoding, initial dictionary is created once all the strings are known
 
     encodings.push_back(outPtr);
+    plainStrings.push_back(inString);
+}
 
-    // Check if string is already present in the dictionary
-
-    auto pos = std::find(dictionary.begin(), dictionary.end(), inString);
-
-    // Create initial encoding
-
-    if (pos != dictionary.end())
-    {
-        encodings.back()->push_back(pos - dictionary.begin());
-    }
-    else
-    {
-        if (dictionary.size() > 255)
-        {
-            ERROR("max 255 strings allowed for dictionary compression");
-        }
+void DictEncoder::addFragment(const std::string &fragment, uint8_t code)
+{
+    // Fragments are already stored in some other list - they can be referenced by code,
+    // without occupying the dictionary space
 
-        dictionary.push_back(inString);
-        encodings.back()->push_back(dictionary.size() - 1);
-    }
+    if (code < 0x80) ERROR("internal error in 'addFragment'");
+    if (!fragment.empty() && !isFragment(fragment)) fragments[fragment] = code;
 }
 
+uint32_t DictEncoder::fragmentsInDictionary() const
+{
+    return std::count_if(dictionary.begin(), dictionary.end(), [this](const std::string &str) { return isFragment(str); });
+}
 
 void DictEncoder::extractWords(std::vector<std::string> &candidateList)
 {
@@ -648,6 +733,16 @@ void DictEncoder::extractWords(std::vector<std::string> &candidateList)
             addToList(word_3);
             addToList(word_4);
         }
+
+        // External fragments are candidates too, even if they are not separate words
+
+        for (const auto &fragment : fragments)
+        {
+            if (dictionaryEntry == fragment.first || dictionaryEntry.find(fragment.first) == std::string::npos) continue;
+            if (std::find(candidateList.begin(), candidateList.end(), fragment.first) != candidateList.end()) continue;
+
+            candidateList.push_back(fragment.first);
+        }
     }
 }
 
@@ -658,16 +753,20 @@ int32_t DictEncoder::evaluateCandidate(std::string &candidate)
     // Build the score - find how much bytes can be spared by extracting this particular candidate
     // Limited size of the dictionary is taken into consideration
    
-    int32_t  score      = -(candidate.size() + 1);
-    uint32_t targetSize = dictionary.size() + 1;
+    // External fragments do not have to be stored in the dictionary, they are free
+
+    const bool fragment   = isFragment(candidate);
+    int32_t    score      = fragment ? 0 : -(candidate.size() + 1);
+    uint32_t   targetSize = dictionary.size() - fragmentsInDictionary() + (fragment ? 0 : 1);
 
     // First check for situation when the candidate equals the currently existing dictionary entry
 
     for (const auto &dictionaryEntry : dictionary)
     {   
-        if (dictionaryEntry == candidate)
+        if (dictionaryEntry == candidate && !fragment)
         {
-            // Candidate equals the string
+            // Candidate equals the string (for external fragments this brings no change,
+            // such strings are always referenced by the fragment code)
 
             score += candidate.size() + 1;
             targetSize--;
@@ -701,7 +800,7 @@ int32_t DictEncoder::evaluateCandidate(std::string &candidate)
             // For the substring before the first occurence we need to create a separate entry
             // in the dictionary - unless it is already there, it brings some additional cost
 
-            std::string otherStr = std::string(dictionaryEntry.begin(), dictionaryEntry.end() + occurences[0]);
+            std::string otherStr = std::string(dictionaryEntry.begin(), dictionaryEntry.begin() + occurences[0]);
 
             if (std::find(dictionary.begin(), dictionary.end(), otherStr) != dictionary.end())
             {
@@ -757,9 +856,9 @@ int32_t DictEncoder::evaluateCandidate(std::string &candidate)
         }
        
         // We crossed the maximum number of strings (leave one free for the work buffer),
-        // do not consider this candidate
+        // do not consider this candidate; codes from 0x80 are reserved for external fragments
        
-        if (targetSize > 254) return -1;
+        if (targetSize > (fragments.empty() ? 254 : 127)) return -1;
     }
    
     return score;
@@ -871,10 +970,12 @@ bool DictEncoder::optimizeSplit()
     {
         nexIteration = false;
 
-        for (auto iter = dictionary.begin(); iter < dictionary.end(); iter++)
+        // Iterate using index - adding new dictionary entries invalidates the iterators
+
+        for (size_t idxDict = 0; idxDict < dictionary.size(); idxDict++)
         {
-            auto    &currentStr     = *iter;
-            uint8_t currentStrIdx   = iter - dictionary.begin();   
+            auto    &currentStr     = dictionary[idxDict];
+            uint8_t currentStrIdx   = idxDict;
             auto    selectedStrIter = std::find(dictionary.begin(), dictionary.end(), selectedStr);
             selectedStrIdx          = selectedStrIter - dictionary.begin();
 
@@ -906,7 +1007,7 @@ bool DictEncoder::optimizeSplit()
                     uint8_t pos2 = currentStrIdx;
                     for (auto iter2 = dictionary.begin(); iter2 < dictionary.end(); iter2++)
                     {
-                        if (iter2 == iter) continue;
+                        if (iter2 == dictionary.begin() + idxDict) continue;
                         if (currentStr == *iter2)
                         {
                             dictionary[pos2].clear();
@@ -1062,37 +1163,356 @@ void DictEncoder::optimizeOrder()
     for (uint8_t idx = 0; idx < dictionary.size(); idx++) dictionary[idx] = optimizedOrder[idx].word;
 }
 
+void DictEncoder::createDictionary()
+{
+    // Start from every string being a separate dictionary entry; if there are more distinct strings
+    // than the dictionary can hold, start from separate words instead
+
+    const size_t maxEntries = fragments.empty() ? 255 : 127;
+
+    auto addEntry = [this](const std::string &entry, StringEncoded &encoding)
+    {
+        auto pos = std::find(dictionary.begin(), dictionary.end(), entry);
+        if (pos == dictionary.end()) pos = dictionary.insert(dictionary.end(), entry);
+
+        encoding.push_back(pos - dictionary.begin());
+    };
+
+    std::vector<std::string> distinctStrings = plainStrings;
+    std::sort(distinctStrings.begin(), distinctStrings.end());
+    distinctStrings.erase(std::unique(distinctStrings.begin(), distinctStrings.end()), distinctStrings.end());
+
+    const bool splitWords = distinctStrings.size() - std::count_if(distinctStrings.begin(), distinctStrings.end(),
+                            [this](const std::string &str) { return isFragment(str); }) > maxEntries;
+
+    for (size_t idx = 0; idx < plainStrings.size(); idx++)
+    {
+        const auto &plainString = plainStrings[idx];
+        auto       &encoding    = *encodings[idx];
+
+        if (!splitWords)
+        {
+            addEntry(plainString, encoding);
+            continue;
+        }
+
+        // Word is followed by a space, if there is one; line breaks are separate entries
+
+        std::string word;
+        for (const auto &character : plainString)
+        {
+            if (character == '\r')
+            {
+                if (!word.empty()) addEntry(word, encoding);
+                addEntry("\r", encoding);
+                word.clear();
+                continue;
+            }
+
+            word += character;
+            if (character != ' ') continue;
+
+            addEntry(word, encoding);
+            word.clear();
+        }
+        if (!word.empty()) addEntry(word, encoding);
+
+        if (dictionary.size() - fragmentsInDictionary() > maxEntries)
+        {
+            ERROR("too many distinct words for dictionary compression");
+        }
+    }
+}
+
 void DictEncoder::process(StringEntryList &outDictionary)
 {
+    createDictionary();
+
     if (dictionary.empty()) return;
     // Optimize as long as it brings any improvement
 
     while (optimizeSplit() || optimizeJoin()) ;
     optimizeOrder();
 
-    // Export the dictionary to external format
+    // Entries equal to external fragments are not exported - they are referenced by fragment code;
+    // adapt the encoding to external format (0 = end of string, 1 = first dictionary entry)
 
-    outDictionary.type = ListType::DICTIONARY;
-    outDictionary.name = "DICTIONARY";
+    std::vector<uint8_t>     remapTable;
+    std::vector<std::string> exportedDictionary;
 
     for (const auto &dictionaryStr : dictionary)
     {
-        StringEntry newEntry = { true, true, true, true, "", dictionaryStr };
-        outDictionary.list.push_back(newEntry);
+        if (isFragment(dictionaryStr))
+        {
+            remapTable.push_back(fragments[dictionaryStr]);
+        }
+        else
+        {
+            exportedDictionary.push_back(dictionaryStr);
+            remapTable.push_back(exportedDictionary.size());
+        }
     }
 
-    // Adapt the encoding to external format (0 = end of string)
+    if (exportedDictionary.size() > (fragments.empty() ? 255 : 127)) ERROR("too many strings in the dictionary");
 
     for (auto &encoding : encodings)
     {
-        for (auto &byte : *encoding) byte++;
+        for (auto &byte : *encoding) byte = remapTable[byte];
         encoding->push_back(0);
     }
+
+    // Export the dictionary to external format
+
+    outDictionary.type = ListType::DICTIONARY;
+    outDictionary.name = "dictionary";
+
+    for (const auto &dictionaryStr : exportedDictionary)
+    {
+        StringEntry newEntry = { true, true, true, true, true, "", dictionaryStr };
+        outDictionary.list.push_back(newEntry);
+    }
+}
+
+void HuffEncoder::addString(const std::string &inString, StringEncoded *outPtr)
+{
+    // Byte 0 is reserved as the end of string mark
+
+    if (inString.find('\0') != std::string::npos) ERROR("character 0x00 not allowed for Huffman compression");
+
+    encodings.push_back(outPtr);
+    plainStrings.push_back(inString);
+
+    for (const auto &character : inString) freqMap[character]++;
+    freqMap['\0']++;
+}
+
+void HuffEncoder::calculateCodeLengths()
+{
+    // Standard Huffman tree construction; ties are resolved by node creation order,
+    // so that the result does not depend on the standard library implementation
+
+    typedef struct Node
+    {
+        uint32_t weight;
+        uint32_t order;
+        int32_t  parent;
+    } Node;
+
+    std::vector<Node> nodes;
+    for (const auto &freqEntry : freqMap) nodes.push_back({ freqEntry.second, (uint32_t) nodes.size(), -1 });
+
+    auto cmpNodes = [&nodes](uint32_t n1, uint32_t n2)
+    {
+        if (nodes[n1].weight != nodes[n2].weight) return nodes[n1].weight > nodes[n2].weight;
+        return nodes[n1].order > nodes[n2].order;
+    };
+
+    std::vector<uint32_t> heap;
+    for (uint32_t idx = 0; idx < nodes.size(); idx++) heap.push_back(idx);
+    std::make_heap(heap.begin(), heap.end(), cmpNodes);
+
+    while (heap.size() > 1)
+    {
+        std::pop_heap(heap.begin(), heap.end(), cmpNodes);
+        const uint32_t node1 = heap.back();
+        heap.pop_back();
+        std::pop_heap(heap.begin(), heap.end(), cmpNodes);
+        const uint32_t node2 = heap.back();
+        heap.pop_back();
+
+        nodes.push_back({ nodes[node1].weight + nodes[node2].weight, (uint32_t) nodes.size(), -1 });
+        nodes[node1].parent = nodes[node2].parent = nodes.size() - 1;
+
+        heap.push_back(nodes.size() - 1);
+        std::push_heap(heap.begin(), heap.end(), cmpNodes);
+    }
+
+    // Code length is the depth of the leaf; a single symbol still needs 1 bit
+
+    uint32_t idx = 0;
+    for (const auto &freqEntry : freqMap)
+    {
+        uint8_t depth = 0;
+        for (int32_t node = idx++; nodes[node].parent >= 0; node = nodes[node].parent) depth++;
+
+        codeLen[freqEntry.first] = std::max(depth, (uint8_t) 1);
+    }
+}
+
+void HuffEncoder::limitCodeLengths()
+{
+    // Clamp the code lengths to the maximum supported, then restore the Kraft inequality
+    // by making the longest codes (below the maximum) one bit longer
+
+    const uint32_t kraftMax = 1 << HUFF_MAX_CODE_LEN;
+    uint32_t       kraft    = 0;
+
+    for (auto &codeLenEntry : codeLen)
+    {
+        codeLenEntry.second = std::min(codeLenEntry.second, HUFF_MAX_CODE_LEN);
+        kraft += 1 << (HUFF_MAX_CODE_LEN - codeLenEntry.second);
+    }
+
+    if (codeLen.size() > kraftMax) ERROR("too many distinct characters for Huffman compression");
+
+    while (kraft > kraftMax)
+    {
+        auto selected = codeLen.end();
+        for (auto iter = codeLen.begin(); iter != codeLen.end(); ++iter)
+        {
+            if (iter->second >= HUFF_MAX_CODE_LEN) continue;
+            if (selected == codeLen.end() ||
+                iter->second > selected->second ||
+                (iter->second == selected->second && freqMap[iter->first] < freqMap[selected->first])) selected = iter;
+        }
+
+        selected->second++;
+        kraft -= 1 << (HUFF_MAX_CODE_LEN - selected->second);
+    }
+}
+
+void HuffEncoder::assignCodes()
+{
+    // Canonical order - sorted by code length, then by character
+
+    symbols.clear();
+    for (const auto &codeLenEntry : codeLen) symbols.push_back(codeLenEntry.first);
+
+    std::stable_sort(symbols.begin(), symbols.end(),
+                     [this](char e1, char e2) { return codeLen[e1] < codeLen[e2]; });
+
+    lenCount.assign(HUFF_MAX_CODE_LEN + 1, 0);
+    for (const auto &symbol : symbols) lenCount[codeLen[symbol]]++;
+
+    uint16_t nextCode = 0;
+    uint8_t  len      = 0;
+    for (const auto &symbol : symbols)
+    {
+        while (len < codeLen[symbol])
+        {
+            nextCode <<= 1;
+            len++;
+        }
+
+        code[symbol] = nextCode++;
+    }
+}
+
+void HuffEncoder::process()
+{
+    if (encodings.empty()) return;
+
+    calculateCodeLengths();
+    limitCodeLengths();
+    assignCodes();
+
+    // Encode the strings: bit stream (MSB first), terminated by the 0x00 symbol and padded with zeros;
+    // no length byte is needed, the decoder stops on the end symbol and continues from the next byte
+
+    for (size_t idx = 0; idx < encodings.size(); idx++)
+    {
+        StringEncoded bitStream;
+        uint8_t       bitCount = 0;
+
+        auto pushCode = [&](char character)
+        {
+            for (int8_t bit = codeLen[character] - 1; bit >= 0; bit--)
+            {
+                if (bitCount % 8 == 0) bitStream.push_back(0);
+                if ((code[character] >> bit) & 1) bitStream.back() |= 0x80 >> (bitCount % 8);
+                bitCount++;
+            }
+        };
+
+        for (const auto &character : plainStrings[idx]) pushCode(character);
+        pushCode('\0');
+
+        if (bitStream.size() > 255) ERROR("packed string too long for Huffman compression");
+
+        encodings[idx]->assign(bitStream.begin(), bitStream.end());
+    }
+}
+
+size_t HuffEncoder::tablesSize() const
+{
+    return empty() ? 0 : (symbols.size() + 3 * HUFF_MAX_CODE_LEN);
+}
+
+double HuffEncoder::bitsPerSymbol() const
+{
+    uint64_t bits    = 0;
+    uint64_t symbols = 0;
+
+    for (const auto &freqEntry : freqMap)
+    {
+        bits    += (uint64_t) freqEntry.second * codeLen.at(freqEntry.first);
+        symbols += freqEntry.second;
+    }
+
+    return symbols ? ((double) bits / symbols) : 0.0;
+}
+
+void HuffEncoder::prepareOutput(std::ostringstream &stream) const
+{
+    if (empty()) return;
+
+    // Export the decoder specification - for every code length: number of codes, first code,
+    // index of the first symbol with the given code length
+
+    stream << std::endl << "!set HUFF__MAX_CODE_LEN  = " << std::dec << +HUFF_MAX_CODE_LEN << std::endl;
+
+    auto putTable = [&stream](const std::string &name, const std::string &comment, const std::vector<uint8_t> &table)
+    {
+        stream << std::endl << "!macro " << name << " { ; " << comment << std::endl << std::endl << "\t!byte ";
+        for (size_t idx = 1; idx < table.size(); idx++)
+        {
+            stream << ((idx == 1) ? "$" : ", $") << std::uppercase << std::hex <<
+                      std::setfill('0') << std::setw(2) << +table[idx];
+        }
+        stream << std::endl << "}" << std::endl;
+    };
+
+    std::vector<uint8_t> firstCode(HUFF_MAX_CODE_LEN + 1, 0);
+    std::vector<uint8_t> firstIndex(HUFF_MAX_CODE_LEN + 1, 0);
+
+    uint16_t nextCode  = 0;
+    uint16_t nextIndex = 0;
+    for (uint8_t len = 1; len <= HUFF_MAX_CODE_LEN; len++)
+    {
+        firstCode[len]  = nextCode;
+        firstIndex[len] = nextIndex;
+
+        nextCode   = (nextCode + lenCount[len]) << 1;
+        nextIndex += lenCount[len];
+    }
+
+    putTable("PUT_HUFF_LEN_COUNT",   "number of codes of length 1, 2, ...",        lenCount);
+    putTable("PUT_HUFF_FIRST_CODE",  "first code of length 1, 2, ...",             firstCode);
+    putTable("PUT_HUFF_FIRST_INDEX", "index of first symbol of length 1, 2, ...",  firstIndex);
+
+    // Export the symbols, in canonical order
+
+    stream << std::endl << "!macro PUT_HUFF_SYMBOLS { ; symbols in canonical order" << std::endl << std::endl;
+
+    uint8_t idx = 0;
+    for (const auto &symbol : symbols)
+    {
+        stream << "\t!byte $" << std::uppercase << std::hex << std::setfill('0') << std::setw(2) << +symbol <<
+                  "    ; " << std::setfill(' ') << std::setw(2) << std::dec << +(idx++) <<
+                  ", code length " << +codeLen.at(symbol) << std::endl;
+    }
+
+    stream << "}" << std::endl;
 }
 
 bool DataSet::isCompressionLvl2(const StringEntryList &list) const
 {
-    return (GLOBAL_ConfigOptions["COMPRESSION_LVL_2"] && list.type == ListType::STRINGS_BASIC);
+    return (compressionLvl == 2 && list.type == ListType::STRINGS_BASIC);
+}
+
+bool DataSet::isCompressionLvl3(const StringEntryList &list) const
+{
+    return (compressionLvl == 3 && list.type == ListType::STRINGS_BASIC);
 }
 
 void DataSet::addStrings(const StringEntryList &stringList)
@@ -1120,53 +1540,224 @@ void DataSet::addStrings(const StringEntryList &stringList)
     outFileContent.clear();
 }
 
-void DataSet::process()
+void DataSet::addCatalogue(const std::vector<StringEntryList> &catalogue)
 {
-    std::cout << "processing file '" << CMD_cnfFile << "', layout '" << layoutName() << "'" << std::endl;
+    // Import every list which has at least one string relevant for the current configuration
+
+    for (const auto &stringList : catalogue)
+    {
+        if (std::none_of(stringList.list.begin(), stringList.list.end(),
+                         [this](const StringEntry &entry) { return isRelevant(entry); })) continue;
+
+        addStrings(stringList);
+    }
+}
 
+void DataSet::process()
+{
     generateConfigDepStrings();
     validateLists();
     encodeStringsDict();
+    encodeStringsHuff();
     calculateFrequencies();
     encodeStringsFreq();   
     prepareOutput();
 }
 
-const std::string &DataSet::getOutput()
+size_t DataSet::listPackedSize(size_t idx) const
 {
-    if (outFileContent.empty())
-    {
-        process();
-    }
+    const auto &stringEntryList   = stringEntryLists[idx];
+    const auto &stringEncodedList = stringEncodedLists[idx];
 
-    return outFileContent;
+    if (stringEncodedList.empty()) return 0;
+
+    // Skipped strings still occupy a single byte
+
+    size_t packedSize = 0;
+    for (const auto &stringEncoded : stringEncodedList) packedSize += std::max(stringEncoded.size(), (size_t) 1);
+
+    if (stringEntryList.type == ListType::KEYWORDS) packedSize += 2; // end of keyword list mark
+
+    return packedSize;
 }
 
-void DataSet::generateConfigDepStrings()
+size_t DataSet::packedSize() const
 {
-    // Generate string to show the build features
-   
-    std::string featureStr;
-    std::string featureStrM65 = "\r";
+    // Nibble encoding tables and Huffman decoder specification are part of the packed data too
 
-    // Tape support features
-   
-    if (GLOBAL_ConfigOptions["TAPE_NORMAL"] && GLOBAL_ConfigOptions["TAPE_TURBO"])
+    size_t packedSize = as1n.size() + as3n.size() + huffEncoder.tablesSize();
+    for (size_t idx = 0; idx < stringEntryLists.size(); idx++) packedSize += listPackedSize(idx);
+
+    return packedSize;
+}
+
+void DataSet::packedListSizes(std::vector<std::pair<std::string, size_t>> &listSizes) const
+{
+    listSizes.clear();
+
+    for (size_t idx = 0; idx < stringEntryLists.size(); idx++)
     {
-        featureStr    += "TAPE LOAD NORMAL TURBO\r";
-        featureStrM65 += "TAPE     : LOAD NORMAL TURBO\r";
+        if (stringEncodedLists[idx].empty()) continue;
+        listSizes.push_back(std::make_pair(stringEntryLists[idx].name, listPackedSize(idx)));
     }
-    else if (GLOBAL_ConfigOptions["TAPE_NORMAL"])
+}
+
+double DataSet::decodeCyclesPerChar() const
+{
+    // Estimate the average cost of decoding a single character of the BASIC strings (not keywords),
+    // for the compression level currently selected
+
+    auto freqCost = [this](char character)
     {
-        featureStr    += "TAPE LOAD NORMAL\r";
-        featureStrM65 += "TAPE     : LOAD NORMAL\r";
-    }
-    else if (GLOBAL_ConfigOptions["TAPE_TURBO"])
+        return (std::find(as1n.begin(), as1n.end(), character) != as1n.end()) ? CYCLES_1N : CYCLES_3N;
+    };
+
+    const StringEntryList *dictionary = nullptr;
+    const StringEntryList *keywords   = nullptr;
+    for (const auto &stringEntryList : stringEntryLists)
     {
-        featureStr    += "TAPE LOAD TURBO\r";
-        featureStrM65 += "TAPE     : LOAD TURBO\r";
+        if (stringEntryList.type == ListType::DICTIONARY && !stringEntryList.list.empty()) dictionary = &stringEntryList;
+        if (stringEntryList.type == ListType::KEYWORDS && stringEntryList.name == "keywords_V2") keywords = &stringEntryList;
     }
-   
+
+    double cycles  = 0.0;
+    size_t chars   = 0;
+    size_t strings = 0;
+
+    for (size_t idx = 0; idx < stringEntryLists.size(); idx++)
+    {
+        const auto &stringEntryList   = stringEntryLists[idx];
+        const auto &stringEncodedList = stringEncodedLists[idx];
+
+        if (stringEntryList.type != ListType::STRINGS_BASIC) continue;
+
+        for (size_t idxString = 0; idxString < stringEncodedList.size(); idxString++)
+        {
+            const auto &stringEntry = stringEntryList.list[idxString];
+            if (!isRelevant(stringEntry)) continue;
+
+            chars += stringEntry.string.length();
+            strings++;
+
+            if (isCompressionLvl3(stringEntryList)) continue; // computed below, for all the strings at once
+
+            if (isCompressionLvl2(stringEntryList) && dictionary != nullptr)
+            {
+                for (const auto &byte : stringEncodedList[idxString])
+                {
+                    if (byte == 0) break;
+
+                    const auto &word = (byte >= 0x80) ? keywords->list[byte - 0x80].string :
+                                                        dictionary->list[byte - 1].string;
+
+                    cycles += CYCLES_DICT_WORD;
+                    for (const auto &character : word) cycles += freqCost(character);
+                }
+            }
+            else
+            {
+                for (const auto &character : stringEntry.string) cycles += freqCost(character);
+            }
+        }
+    }
+
+    if (!huffEncoder.empty())
+    {
+        const double symbols = chars + strings; // every string is terminated by a separate symbol
+        cycles += symbols * (huffEncoder.bitsPerSymbol() * CYCLES_HUFF_BIT + CYCLES_HUFF_SYMBOL);
+    }
+
+    return chars ? (cycles / chars) : 0.0;
+}
+
+void DataSet::printStatistics() const
+{
+    // Report the compression ratio - for every list, and for the whole catalogue
+
+    std::cout << "compression statistics, catalogue '" << (CMD_catFile.empty() ? "<built-in>" : CMD_catFile) <<
+                 "', level " << +compressionLvl << std::endl;
+
+    auto printLine = [](const std::string &name, size_t strings, size_t plainSize, size_t packedSize)
+    {
+        std::cout << "    " << std::left << std::setw(16) << std::setfill(' ') << name << std::right <<
+                     std::setw(5) << strings << " strings, " <<
+                     std::setw(6) << plainSize << " -> " << std::setw(6) << packedSize << " bytes";
+        if (plainSize != 0)
+        {
+            std::cout << ", ratio " << std::fixed << std::setprecision(1) << std::setw(5) <<
+                         (100.0 * packedSize / plainSize) << "%";
+        }
+        std::cout << std::endl;
+    };
+
+    size_t totalStrings = 0;
+    size_t totalPlain   = 0;
+
+    for (size_t idx = 0; idx < stringEntryLists.size(); idx++)
+    {
+        const auto &stringEntryList   = stringEntryLists[idx];
+        const auto &stringEncodedList = stringEncodedLists[idx];
+
+        if (stringEncodedList.empty()) continue;
+
+        // Dictionary strings are not separate messages - count only their packed size
+
+        size_t strings   = 0;
+        size_t plainSize = 0;
+
+        for (size_t idxString = 0; idxString < stringEncodedList.size(); idxString++)
+        {
+            const auto &stringEntry = stringEntryList.list[idxString];
+            if (stringEntryList.type == ListType::DICTIONARY || !isRelevant(stringEntry)) continue;
+
+            strings++;
+            plainSize += stringEntry.string.length() + 1;
+        }
+
+        printLine(stringEntryList.name, strings, plainSize, listPackedSize(idx));
+
+        totalStrings += strings;
+        totalPlain   += plainSize;
+    }
+
+    printLine("TOTAL", totalStrings, totalPlain, packedSize());
+}
+
+const std::string &DataSet::getOutput()
+{
+    if (outFileContent.empty())
+    {
+        process();
+    }
+
+    return outFileContent;
+}
+
+void DataSet::generateConfigDepStrings()
+{
+    // Generate string to show the build features
+   
+    std::string featureStr;
+    std::string featureStrM65 = "\r";
+
+    // Tape support features
+   
+    if (GLOBAL_ConfigOptions["TAPE_NORMAL"] && GLOBAL_ConfigOptions["TAPE_TURBO"])
+    {
+        featureStr    += "TAPE LOAD NORMAL TURBO\r";
+        featureStrM65 += "TAPE     : LOAD NORMAL TURBO\r";
+    }
+    else if (GLOBAL_ConfigOptions["TAPE_NORMAL"])
+    {
+        featureStr    += "TAPE LOAD NORMAL\r";
+        featureStrM65 += "TAPE     : LOAD NORMAL\r";
+    }
+    else if (GLOBAL_ConfigOptions["TAPE_TURBO"])
+    {
+        featureStr    += "TAPE LOAD TURBO\r";
+        featureStrM65 += "TAPE     : LOAD TURBO\r";
+    }
+   
     // IEC support features
    
     if (GLOBAL_ConfigOptions["IEC"])
@@ -1280,6 +1871,24 @@ void DataSet::validateLists()
 {
     for (const auto &stringEntryList : stringEntryLists)
     {
+        // Check for maximum allowed number of strings - the index has to fit in a single byte
+        if (stringEntryList.list.size() > 255)
+        {
+            ERROR(std::string("list '") + stringEntryList.name + "' cannot contain more than 255 strings");
+        }
+
+        // Check that every additional alias refers to an existing string
+        for (const auto &stringAlias : stringEntryList.aliases)
+        {
+            if (std::none_of(stringEntryList.list.begin(), stringEntryList.list.end(),
+                             [&stringAlias](const StringEntry &entry) { return entry.alias == stringAlias.target; }))
+            {
+                ERROR(std::string("alias '") + stringAlias.alias + "' refers to unknown string '" + stringAlias.target + "'");
+            }
+
+            maxAliasLen = std::max(maxAliasLen, stringAlias.alias.length());
+        }
+
         for (const auto &stringEntry : stringEntryList.list)
         {
             // Check for maximum allowed string length
@@ -1328,6 +1937,20 @@ void DataSet::encodeStringsDict()
         }
     }
 
+    // If requested, allow referencing BASIC V2 keywords from the dictionary strings, by token
+
+    for (const auto &stringEntryList : stringEntryLists)
+    {
+        if (!crossList || compressionLvl != 2) break;
+        if (stringEntryList.type != ListType::KEYWORDS || stringEntryList.name != "keywords_V2") continue;
+
+        for (uint8_t idxEntry = 0; idxEntry < stringEntryList.list.size() && idxEntry < 0x80; idxEntry++)
+        {
+            if (!isRelevant(stringEntryList.list[idxEntry])) continue;
+            dictEncoder.addFragment(stringEntryList.list[idxEntry].string, 0x80 + idxEntry);
+        }
+    }
+
     // Perform the compression
 
     StringEntryList dictionary;
@@ -1339,6 +1962,35 @@ void DataSet::encodeStringsDict()
     stringEncodedLists.emplace_back();
 }
 
+void DataSet::encodeStringsHuff()
+{
+    // Add strings for Huffman compression
+
+    for (uint8_t idx = 0; idx < stringEntryLists.size(); idx++)
+    {
+        const auto &stringEntryList = stringEntryLists[idx];
+        auto &stringEncodedList     = stringEncodedLists[idx];
+
+        // Skip lists not to be encoded using Huffman codes
+        if (!isCompressionLvl3(stringEntryList)) continue;
+
+        // Skipped strings are stored as empty ones - a single end symbol, so that the decoder
+        // can step over them like over any other string
+
+        stringEncodedList.resize(stringEntryList.list.size());
+        for (uint8_t idxEntry = 0; idxEntry < stringEntryList.list.size(); idxEntry++)
+        {
+            const auto &stringEntry = stringEntryList.list[idxEntry];
+            huffEncoder.addString(isRelevant(stringEntry) ? stringEntry.string : std::string(),
+                                  &stringEncodedList[idxEntry]);
+        }
+    }
+
+    // Perform the compression
+
+    huffEncoder.process();
+}
+
 void DataSet::calculateFrequencies()
 {
     as1n.clear();
@@ -1351,8 +2003,8 @@ void DataSet::calculateFrequencies()
 
     for (const auto &stringEntryList : stringEntryLists)
     {
-        // Skip lists encoded by the dictionary
-        if (isCompressionLvl2(stringEntryList)) continue;
+        // Skip lists encoded by the dictionary or Huffman codes
+        if (isCompressionLvl2(stringEntryList) || isCompressionLvl3(stringEntryList)) continue;
 
         for (const auto &stringEntry : stringEntryList.list)
         {
@@ -1494,8 +2146,8 @@ void DataSet::encodeStringsFreq()
         const auto &stringEntryList = stringEntryLists[idx];
         auto &stringEncodedList = stringEncodedLists[idx];
 
-        // Skip lists encoded by the dictionary
-        if (isCompressionLvl2(stringEntryList)) continue;
+        // Skip lists encoded by the dictionary or Huffman codes
+        if (isCompressionLvl2(stringEntryList) || isCompressionLvl3(stringEntryList)) continue;
 
         // Perform frequency encoding of the list
 
@@ -1592,6 +2244,21 @@ void DataSet::prepareOutput_labels(std::ostringstream &stream,
                       std::uppercase << std::hex << std::setfill('0') << std::setw(2) << +idx << std::endl;
         }
     }
+
+    // Additional aliases share the index with the string they refer to
+
+    for (const auto &stringAlias : stringEntryList.aliases)
+    {
+        for (uint8_t idx = 0; idx < stringEncodedList.size(); idx++)
+        {
+            if (stringEntryList.list[idx].alias != stringAlias.target || stringEncodedList[idx].empty()) continue;
+
+            stream << "!set IDX__" << stringAlias.alias <<
+                      std::string(maxAliasLen - stringAlias.alias.length(), ' ') << " = $" <<
+                      std::uppercase << std::hex << std::setfill('0') << std::setw(2) << +idx << std::endl;
+            break;
+        }
+    }
 }
 
 void DataSet::prepareOutput_packed(std::ostringstream &stream,
@@ -1602,6 +2269,10 @@ void DataSet::prepareOutput_packed(std::ostringstream &stream,
     {
         stream << std::endl << "!macro PUT_PACKED_DICT_";
     }
+    else if (isCompressionLvl3(stringEntryList))
+    {
+        stream << std::endl << "!macro PUT_PACKED_HUFF_";
+    }
     else
     {
         stream << std::endl << "!macro PUT_PACKED_FREQ_";           
@@ -1614,12 +2285,17 @@ void DataSet::prepareOutput_packed(std::ostringstream &stream,
     {
         const auto &stringEncoded = stringEncodedList[idxString];
 
-        if (stringEncoded.empty())
+        if (stringEncoded.empty() || !isRelevant(stringEntryList.list[idxString]))
         {
             if (stringEntryList.type == ListType::DICTIONARY) ERROR("internal error"); // should never happen
 
+            // Huffman encoded lists contain the end symbol for skipped strings, the others - a $00 byte
+
+            const uint8_t skipByte = stringEncoded.empty() ? 0 : stringEncoded.front();
+
             if (lastStr == LastStr::WRITTEN) stream << std::endl;
-            stream << "\t!byte $00    ; skipped " << stringEntryList.list[idxString].alias << std::endl;
+            stream << "\t!byte $" << std::uppercase << std::hex << std::setfill('0') << std::setw(2) << +skipByte <<
+                      "    ; skipped " << stringEntryList.list[idxString].alias << std::endl;
             lastStr = LastStr::SKIPPED;
         }
         else
@@ -1703,6 +2379,10 @@ void DataSet::prepareOutput()
     stream << std::endl << "!set TK__PACKED_AS_3N    = $" << std::hex << +tk__packed_as_3n <<
               std::endl << "!set TK__MAX_KEYWORD_LEN = "  << std::dec << +tk__max_keyword_len << std::endl;
 
+    // Export Huffman decoder specification, if needed
+
+    huffEncoder.prepareOutput(stream);
+
     // Export encoded strings
 
     for (uint8_t idx = 0; idx < stringEntryLists.size(); idx++)
@@ -1797,10 +2477,223 @@ void parseConfigFile()
     cnfFile.close();
 }
 
+void parseCatalogueFile()
+{
+    /*
+      String catalogue is a line-oriented text file, processed in a streaming way, line by line.
+      Everything after ';' (outside of quotes) is a comment. Supported lines:
+
+        #LIST   <name> <KEYWORDS|STRINGS_BASIC>         - starts a new list of strings
+        #SET    <set name> <layout> [<layout> ...]      - defines a named set of layouts
+        #ALIAS  <alias> <existing alias>                - additional label for an already defined string
+        <alias> <layouts> "<string>" [<abbrev len>]     - string entry, for the current list
+
+      Layouts can be given as comma separated list of STD, CRT, M65, U64, X16 or named sets,
+      '*' means all the layouts, '-' means none. Strings accept '\r', '\"', '\'', '\\' and '\xHH' escapes.
+    */
+
+    GLOBAL_Catalogue.clear();
+
+    std::map<std::string, StringEntry> layoutSets;
+
+    layoutSets["*"]   = { true,  true,  true,  true,  true,  "", "" };
+    layoutSets["-"]   = { false, false, false, false, false, "", "" };
+    layoutSets["STD"] = { true,  false, false, false, false, "", "" };
+    layoutSets["CRT"] = { false, true,  false, false, false, "", "" };
+    layoutSets["M65"] = { false, false, true,  false, false, "", "" };
+    layoutSets["U64"] = { false, false, false, true,  false, "", "" };
+    layoutSets["X16"] = { false, false, false, false, true,  "", "" };
+
+    // Open the catalogue file
+
+    std::ifstream catFile;
+    catFile.open(CMD_catFile);
+    if (!catFile.good()) ERROR("unable to open catalogue file");
+
+    size_t lineNum = 0;
+
+    auto errorLine = [&lineNum](const std::string &message)
+    {
+        ERROR(std::string("error parsing catalogue file - line ") + std::to_string(lineNum) + ", " + message);
+    };
+
+    auto parseLayouts = [&layoutSets, &errorLine](const std::string &layouts, StringEntry &entry)
+    {
+        entry.enabledSTD = entry.enabledCRT = entry.enabledM65 = entry.enabledU64 = entry.enabledX16 = false;
+
+        std::istringstream layoutStream(layouts);
+        std::string layout;
+        while (std::getline(layoutStream, layout, ','))
+        {
+            auto iter = layoutSets.find(layout);
+            if (iter == layoutSets.end()) errorLine(std::string("unknown layout '") + layout + "'");
+
+            entry.enabledSTD |= iter->second.enabledSTD;
+            entry.enabledCRT |= iter->second.enabledCRT;
+            entry.enabledM65 |= iter->second.enabledM65;
+            entry.enabledU64 |= iter->second.enabledU64;
+            entry.enabledX16 |= iter->second.enabledX16;
+        }
+    };
+
+    // Parse the file
+
+    std::string workStr;
+    while (std::getline(catFile, workStr))
+    {
+        lineNum++;
+
+        // Split the line into tokens, handle quoted strings and comments
+
+        std::vector<std::string> tokens;
+        std::string token;
+        bool inToken  = false;
+        bool inQuotes = false;
+
+        for (size_t pos = 0; pos < workStr.size(); pos++)
+        {
+            const char character = workStr[pos];
+
+            if (inQuotes)
+            {
+                if (character == '"')
+                {
+                    inQuotes = false;
+                }
+                else if (character != '\\')
+                {
+                    token += character;
+                }
+                else if (++pos >= workStr.size())
+                {
+                    errorLine("unterminated escape sequence");
+                }
+                else switch (workStr[pos])
+                {
+                    case 'r':  token += '\r'; break;
+                    case '"':  token += '"';  break;
+                    case '\'': token += '\''; break;
+                    case '\\': token += '\\'; break;
+                    case 'x':
+                        if (pos + 2 >= workStr.size() || !isxdigit(workStr[pos + 1]) || !isxdigit(workStr[pos + 2]))
+                        {
+                            errorLine("malformed '\\x' escape sequence");
+                        }
+                        token += (char) std::stoi(workStr.substr(pos + 1, 2), nullptr, 16);
+                        pos += 2;
+                        break;
+                    default: errorLine("unknown escape sequence");
+                }
+            }
+            else if (character == ';')
+            {
+                break;
+            }
+            else if (character == ' ' || character == '\t' || character == '\r')
+            {
+                if (inToken) tokens.push_back(token);
+                token.clear();
+                inToken = false;
+            }
+            else
+            {
+                if (character == '"') inQuotes = true; else token += character;
+                inToken = true;
+            }
+        }
+
+        if (inQuotes) errorLine("unterminated string");
+        if (inToken) tokens.push_back(token);
+        if (tokens.empty()) continue;
+
+        // Interpret the tokens
+
+        if (tokens[0] == "#LIST")
+        {
+            if (tokens.size() != 3) errorLine("'#LIST' expects name and type");
+
+            GLOBAL_Catalogue.emplace_back();
+            GLOBAL_Catalogue.back().name = tokens[1];
+
+            if (tokens[2] == "KEYWORDS")
+            {
+                GLOBAL_Catalogue.back().type = ListType::KEYWORDS;
+            }
+            else if (tokens[2] == "STRINGS_BASIC")
+            {
+                GLOBAL_Catalogue.back().type = ListType::STRINGS_BASIC;
+            }
+            else
+            {
+                errorLine(std::string("unknown list type '") + tokens[2] + "'");
+            }
+        }
+        else if (tokens[0] == "#SET")
+        {
+            if (tokens.size() < 3) errorLine("'#SET' expects name and at least one layout");
+            if (layoutSets.count(tokens[1])) errorLine(std::string("layout set '") + tokens[1] + "' already defined");
+
+            StringEntry setEntry = { false, false, false, false, false, "", "" };
+            std::string layouts;
+            for (size_t idx = 2; idx < tokens.size(); idx++)
+            {
+                if (!layouts.empty()) layouts += ",";
+                layouts += tokens[idx];
+            }
+            parseLayouts(layouts, setEntry);
+            layoutSets[tokens[1]] = setEntry;
+        }
+        else if (tokens[0] == "#ALIAS")
+        {
+            if (tokens.size() != 3) errorLine("'#ALIAS' expects alias and existing alias");
+            if (GLOBAL_Catalogue.empty()) errorLine("'#ALIAS' outside of a list");
+
+            GLOBAL_Catalogue.back().aliases.push_back({ tokens[1], tokens[2] });
+        }
+        else if (tokens[0][0] == '#')
+        {
+            errorLine(std::string("unknown directive '") + tokens[0] + "'");
+        }
+        else
+        {
+            if (tokens.size() < 3 || tokens.size() > 4) errorLine("string entry expects alias, layouts, string and optional abbreviation length");
+            if (GLOBAL_Catalogue.empty()) errorLine("string entry outside of a list");
+
+            StringEntry newEntry = { false, false, false, false, false, tokens[0], tokens[2] };
+            parseLayouts(tokens[1], newEntry);
+
+            if (tokens.size() == 4)
+            {
+                if (tokens[3].find_first_not_of("0123456789") != std::string::npos || tokens[3].size() > 2)
+                {
+                    errorLine("invalid abbreviation length");
+                }
+                newEntry.abbrevLen = std::stoi(tokens[3]);
+            }
+
+            GLOBAL_Catalogue.back().list.push_back(newEntry);
+        }
+    }
+
+    if (catFile.bad()) ERROR("error reading catalogue file");
+    catFile.close();
+
+    // Make sure the catalogue makes sense
+
+    if (GLOBAL_Catalogue.empty()) ERROR("catalogue file contains no lists");
+    for (const auto &stringEntryList : GLOBAL_Catalogue)
+    {
+        if (stringEntryList.list.empty()) ERROR(std::string("catalogue list '") + stringEntryList.name + "' is empty");
+    }
+}
+
 void printUsage()
 {
     std::cout << "\n" <<
-        "usage: generate_strings [-o <out file>] [-c <configuration file>]" << "\n\n";
+        "usage: generate_strings [-o <out file>] [-c <configuration file>] [-s <string catalogue file>] [-r]" << "\n" <<
+        "       generate_strings -c <configuration file> -b <benchmark results file> [-p <baseline file>]" << "\n\n" <<
+        "  -r  report packed size and decoding cost for every layout and compression level" << "\n" <<
+        "  -b  run benchmark instead of generating strings, -p checks results for packed size regressions" << "\n\n";
 }
 
 void printBanner()
@@ -1816,103 +2709,310 @@ void parseCommandLine(int argc, char **argv)
 
     // Retrieve command line options
 
-    while ((opt = getopt(argc, argv, "o:c:")) != -1)
+    while ((opt = getopt(argc, argv, "o:c:s:rb:p:")) != -1)
     {
         switch(opt)
         {
             case 'o': CMD_outFile   = optarg; break;
             case 'c': CMD_cnfFile   = optarg; break;
+            case 's': CMD_catFile   = optarg; break;
+            case 'r': CMD_report    = true;   break;
+            case 'b': CMD_bchFile   = optarg; break;
+            case 'p': CMD_basFile   = optarg; break;
             default: printUsage(); ERROR();
         }
     }
 }
 
-void writeStrings()
+const std::vector<std::string> LAYOUT_NAMES = { "STD", "CRT", "M65", "U64", "X16" };
+
+typedef struct CompressionMode
 {
-    std::string outputString;
-   
-    if (GLOBAL_ConfigOptions["PLATFORM_COMMANDER_X16"])
+    uint8_t     level;
+    bool        crossList;
+    std::string name;
+} CompressionMode;
+
+const std::vector<CompressionMode> COMPRESSION_MODES = { { 1, false, "LVL_1"   },
+                                                         { 2, false, "LVL_2"   },
+                                                         { 2, true,  "LVL_2+X" },
+                                                         { 3, false, "LVL_3"   } };
+
+std::unique_ptr<DataSet> createDataSet(const std::string &layout)
+{
+    if (layout == "STD") return std::unique_ptr<DataSet>(new DataSetSTD);
+    if (layout == "CRT") return std::unique_ptr<DataSet>(new DataSetCRT);
+    if (layout == "M65") return std::unique_ptr<DataSet>(new DataSetM65);
+    if (layout == "U64") return std::unique_ptr<DataSet>(new DataSetU64);
+    if (layout == "X16") return std::unique_ptr<DataSet>(new DataSetX16);
+
+    ERROR(std::string("unknown layout '") + layout + "'");
+    return nullptr;
+}
+
+std::string configLayout()
+{
+    if (GLOBAL_ConfigOptions["PLATFORM_COMMANDER_X16"])                        return "X16";
+    if (GLOBAL_ConfigOptions["PLATFORM_COMMODORE_64"] && GLOBAL_ConfigOptions["MB_M65"])  return "M65";
+    if (GLOBAL_ConfigOptions["PLATFORM_COMMODORE_64"] && GLOBAL_ConfigOptions["ROM_CRT"]) return "CRT";
+    if (GLOBAL_ConfigOptions["PLATFORM_COMMODORE_64"] && GLOBAL_ConfigOptions["MB_U64"])  return "U64";
+    if (GLOBAL_ConfigOptions["PLATFORM_COMMODORE_64"])                         return "STD";
+
+    ERROR("unable to determine string set");
+    return "";
+}
+
+uint8_t configCompressionLvl()
+{
+    if (GLOBAL_ConfigOptions["COMPRESSION_LVL_3"]) return 3;
+    if (GLOBAL_ConfigOptions["COMPRESSION_LVL_2"]) return 2;
+
+    return 1;
+}
+
+void useBuiltInCatalogue()
+{
+    // Lists without strings relevant for the given layout are skipped later
+
+    GLOBAL_Catalogue = { GLOBAL_Keywords_V2,
+                         GLOBAL_Keywords_01,
+                         GLOBAL_Keywords_04,
+                         GLOBAL_Keywords_06,
+                         GLOBAL_Errors,
+                         GLOBAL_MiscStrings };
+}
+
+void reportCompressionLevels()
+{
+    // Compress the catalogue for every layout and every compression level, to help selecting the best one
+
+    std::cout << std::endl << "compression levels, catalogue '" << (CMD_catFile.empty() ? "<built-in>" : CMD_catFile) << "'" << std::endl;
+    std::cout << "    layout";
+    for (const auto &mode : COMPRESSION_MODES) std::cout << std::setw(11) << std::setfill(' ') << mode.name << " bytes  cycles/char";
+    std::cout << std::endl;
+
+    for (const auto &layout : LAYOUT_NAMES)
     {
-        DataSetX16 dataSetX16;
+        std::cout << "    " << layout << "   ";
 
-        // Add input data to computation objects
-       
-        dataSetX16.addStrings(GLOBAL_Keywords_V2);
-        dataSetX16.addStrings(GLOBAL_Keywords_01);
-        dataSetX16.addStrings(GLOBAL_Errors);
-        dataSetX16.addStrings(GLOBAL_MiscStrings);
+        for (const auto &mode : COMPRESSION_MODES)
+        {
+            auto dataSet = createDataSet(layout);
+            dataSet->setCompressionLvl(mode.level);
+            dataSet->setCrossList(mode.crossList);
+            dataSet->addCatalogue(GLOBAL_Catalogue);
+            dataSet->getOutput();
+
+            std::cout << std::setw(17) << std::setfill(' ') << dataSet->packedSize() << "  " <<
+                         std::setw(11) << std::fixed << std::setprecision(1) << dataSet->decodeCyclesPerChar();
+        }
 
-        // Retrieve the results
-       
-        outputString = dataSetX16.getOutput();
+        std::cout << std::endl;
     }
-    else if (GLOBAL_ConfigOptions["PLATFORM_COMMODORE_64"] && GLOBAL_ConfigOptions["MB_M65"])
+
+    std::cout << std::endl;
+}
+
+std::vector<StringEntryList> syntheticCatalogue(uint8_t lists, uint8_t stringsPerList, uint32_t seed)
+{
+    // Deterministic set of messages built from words typical for BASIC and KERNAL messages;
+    // only raw generator output is used, as the distributions are implementation specific
+
+    const std::vector<std::string> words = { "FILE", "NOT", "FOUND", "OPEN", "DEVICE", "PRESENT", "MISSING", "NAME",
+                                             "LOAD", "VERIFY", "SAVE", "ERROR", "OUT", "OF", "MEMORY", "DATA",
+                                             "ILLEGAL", "QUANTITY", "TYPE", "MISMATCH", "STRING", "TOO", "LONG",
+                                             "SYNTAX", "BREAK", "READY.", "BYTES", "FREE", "DISK", "TAPE", "PRESS",
+                                             "PLAY", "ON", "RECORD", "SEARCHING", "FOR", "LOADING", "VERIFYING",
+                                             "DIVISION", "BY", "ZERO", "UNDEF'D", "FUNCTION", "CAN'T", "CONTINUE" };
+
+    std::mt19937 generator(seed);
+    std::vector<StringEntryList> catalogue = { GLOBAL_Keywords_V2, GLOBAL_Keywords_01, GLOBAL_Errors };
+
+    for (uint8_t idxList = 0; idxList < lists; idxList++)
     {
-        DataSetM65 dataSetM65;
+        std::ostringstream listName;
+        listName << "synthetic_" << std::setfill('0') << std::setw(2) << +idxList;
+        catalogue.push_back({ ListType::STRINGS_BASIC, listName.str(), {} });
 
-        // Add input data to computation objects
+        for (uint8_t idxString = 0; idxString < stringsPerList; idxString++)
+        {
+            std::ostringstream alias;
+            alias << "SYN_" << std::setfill('0') << std::setw(2) << +idxList << "_" << std::setw(3) << +idxString;
 
-        dataSetM65.addStrings(GLOBAL_Keywords_V2);
-        dataSetM65.addStrings(GLOBAL_Keywords_01);
-        dataSetM65.addStrings(GLOBAL_Keywords_04);
-        dataSetM65.addStrings(GLOBAL_Keywords_06);
-        dataSetM65.addStrings(GLOBAL_Errors);
-        dataSetM65.addStrings(GLOBAL_MiscStrings);
-       
-        // Retrieve the results
-       
-        outputString = dataSetM65.getOutput();
+            std::string string;
+            const uint32_t wordCount = 1 + generator() % 5;
+            for (uint32_t idxWord = 0; idxWord < wordCount; idxWord++)
+            {
+                if (!string.empty()) string += " ";
+                string += words[generator() % words.size()];
+            }
+            if (generator() % 4 == 0) string += "\r";
+
+            // Last string of the list is always enabled, the other ones are enabled randomly
+
+            const uint32_t enabled = (idxString + 1 == stringsPerList) ? 0x1F : generator();
+            catalogue.back().list.push_back({ (enabled & 0x01) != 0, (enabled & 0x02) != 0, (enabled & 0x04) != 0,
+                                              (enabled & 0x08) != 0, (enabled & 0x10) != 0, alias.str(), string });
+        }
     }
-    else if (GLOBAL_ConfigOptions["PLATFORM_COMMODORE_64"] && GLOBAL_ConfigOptions["ROM_CRT"])
+
+    return catalogue;
+}
+
+void runBenchmark()
+{
+    // Compress the built-in lists and synthetic catalogues, for every layout and compression mode;
+    // store the packed sizes and the runtime in a stable, machine-readable format
+
+    typedef struct Corpus
     {
-        DataSetCRT dataSetCRT;
+        std::string                  name;
+        std::vector<StringEntryList> catalogue;
+    } Corpus;
 
-        // Add input data to computation objects
+    useBuiltInCatalogue();
 
-        dataSetCRT.addStrings(GLOBAL_Keywords_V2);
-        dataSetCRT.addStrings(GLOBAL_Keywords_01);
-        dataSetCRT.addStrings(GLOBAL_Errors);
-        dataSetCRT.addStrings(GLOBAL_MiscStrings);
+    const std::vector<Corpus> corpora = { { "builtin",         GLOBAL_Catalogue                    },
+                                          { "synthetic_small", syntheticCatalogue(2,  40,  0x0C64) },
+                                          { "synthetic_large", syntheticCatalogue(16, 250, 0x0C65) } };
 
-        // Retrieve the results
+    std::ostringstream results;
+    results << "# generate_strings benchmark, format: <corpus>.<layout>.<mode>.<metric> <value>" << std::endl;
 
-        outputString = dataSetCRT.getOutput();   
-    }
-    else if (GLOBAL_ConfigOptions["PLATFORM_COMMODORE_64"] && GLOBAL_ConfigOptions["MB_U64"])
+    const auto timeStart = std::chrono::steady_clock::now();
+
+    for (const auto &corpus : corpora)
     {
-        DataSetU64 dataSetU64;
+        std::cout << "benchmarking corpus '" << corpus.name << "'" << std::endl;
 
-        // Add input data to computation objects
+        for (const auto &layout : LAYOUT_NAMES)
+        {
+            for (const auto &mode : COMPRESSION_MODES)
+            {
+                const auto timeMode = std::chrono::steady_clock::now();
 
-        dataSetU64.addStrings(GLOBAL_Keywords_V2);
-        dataSetU64.addStrings(GLOBAL_Keywords_01);
-        dataSetU64.addStrings(GLOBAL_Errors);
-        dataSetU64.addStrings(GLOBAL_MiscStrings);
-       
-        // Retrieve the results
-       
-        outputString = dataSetU64.getOutput();
+                auto dataSet = createDataSet(layout);
+                dataSet->setCompressionLvl(mode.level);
+                dataSet->setCrossList(mode.crossList);
+                dataSet->addCatalogue(corpus.catalogue);
+                dataSet->getOutput();
+
+                const std::chrono::duration<double, std::milli> duration = std::chrono::steady_clock::now() - timeMode;
+                const std::string prefix = corpus.name + "." + layout + "." + mode.name + ".";
+
+                std::vector<std::pair<std::string, size_t>> listSizes;
+                dataSet->packedListSizes(listSizes);
+
+                results << prefix << "bytes.TOTAL " << dataSet->packedSize() << std::endl;
+                for (const auto &listSize : listSizes)
+                {
+                    results << prefix << "bytes." << listSize.first << " " << listSize.second << std::endl;
+                }
+                results << prefix << "runtime_ms " << std::fixed << std::setprecision(2) << duration.count() << std::endl;
+            }
+        }
     }
-    else if (GLOBAL_ConfigOptions["PLATFORM_COMMODORE_64"])
+
+    const std::chrono::duration<double, std::milli> duration = std::chrono::steady_clock::now() - timeStart;
+    results << "all.runtime_ms " << std::fixed << std::setprecision(2) << duration.count() << std::endl;
+
+    std::cout << "benchmark finished in " << std::fixed << std::setprecision(2) << duration.count() << " ms" << std::endl;
+
+    // Write down the results
+
+    std::ofstream bchFile(CMD_bchFile, std::fstream::out | std::fstream::trunc);
+    if (!bchFile.good()) ERROR(std::string("can't open benchmark file '") + CMD_bchFile + "'");
+    bchFile << results.str();
+    bchFile.close();
+
+    std::cout << "benchmark results written to: '" << CMD_bchFile << "'" << std::endl;
+}
+
+void checkBenchmark()
+{
+    // Compare packed sizes against the baseline - runtime is too noisy to be checked automatically,
+    // and machine dependent, so the baseline is expected to contain packed sizes only
+
+    auto readResults = [](const std::string &fileName, std::map<std::string, std::string> &results)
     {
-        DataSetSTD dataSetSTD;
+        std::ifstream inFile(fileName);
+        if (!inFile.good()) ERROR(std::string("unable to open benchmark file '") + fileName + "'");
 
-        // Add input data to computation objects
+        std::string line;
+        while (std::getline(inFile, line))
+        {
+            if (line.empty() || line[0] == '#') continue;
+
+            std::istringstream lineStream(line);
+            std::string key, value;
+            lineStream >> key >> value;
+            if (key.empty() || value.empty()) ERROR(std::string("malformed line in benchmark file '") + fileName + "'");
+
+            results[key] = value;
+        }
+    };
 
-        dataSetSTD.addStrings(GLOBAL_Keywords_V2);
-        dataSetSTD.addStrings(GLOBAL_Keywords_01);
-        dataSetSTD.addStrings(GLOBAL_Errors);
-        dataSetSTD.addStrings(GLOBAL_MiscStrings);
+    std::map<std::string, std::string> baseline;
+    std::map<std::string, std::string> current;
 
-        // Retrieve the results
+    readResults(CMD_basFile, baseline);
+    readResults(CMD_bchFile, current);
 
-        outputString = dataSetSTD.getOutput();   
+    uint32_t regressions  = 0;
+    uint32_t improvements = 0;
+
+    for (const auto &entry : baseline)
+    {
+        if (entry.first.find(".bytes.") == std::string::npos) continue;
+
+        if (current.find(entry.first) == current.end())
+        {
+            std::cout << "missing result: " << entry.first << std::endl;
+            regressions++;
+            continue;
+        }
+
+        const auto valBaseline = std::stoul(entry.second);
+        const auto valCurrent  = std::stoul(current[entry.first]);
+
+        if (valCurrent > valBaseline)
+        {
+            std::cout << "REGRESSION: " << entry.first << " " << valBaseline << " -> " << valCurrent << std::endl;
+            regressions++;
+        }
+        else if (valCurrent < valBaseline)
+        {
+            improvements++;
+        }
     }
-    else
+
+    if (improvements != 0)
     {
-        ERROR("unable to determine string set");
+        std::cout << improvements << " packed sizes improved, consider updating the baseline '" << CMD_basFile <<
+                     "' (without the runtime_ms lines)" << std::endl;
     }
-   
+
+    if (regressions != 0) ERROR(std::to_string(regressions) + " packed size regressions against baseline '" + CMD_basFile + "'");
+
+    std::cout << "no packed size regressions against baseline '" << CMD_basFile << "'" << std::endl;
+}
+
+void writeStrings()
+{
+    // Select the layout and compression level, add input data to computation object
+
+    auto dataSet = createDataSet(configLayout());
+    dataSet->setCompressionLvl(configCompressionLvl());
+    dataSet->setCrossList(GLOBAL_ConfigOptions["COMPRESSION_CROSS_LIST"]);
+    dataSet->addCatalogue(GLOBAL_Catalogue);
+
+    // Retrieve the results
+
+    std::cout << "processing file '" << CMD_cnfFile << "', layout '" << dataSet->layoutName() << "'" << std::endl;
+
+    const std::string &outputString = dataSet->getOutput();
+    dataSet->printStatistics();
+
     // Remove old file
 
     unlink(CMD_outFile.c_str());
@@ -1950,6 +3050,17 @@ int main(int argc, char **argv)
 
     parseConfigFile();
 
+    if (!CMD_bchFile.empty())
+    {
+        runBenchmark();
+        if (!CMD_basFile.empty()) checkBenchmark();
+
+        return 0;
+    }
+
+    if (CMD_catFile.empty()) useBuiltInCatalogue(); else parseCatalogueFile();
+
+    if (CMD_report) reportCompressionLevels();
     writeStrings();
 
     return 0;
@@ -0,0 +1,119 @@
+//
+// Utility to run the ROMs on a headless machine model, without an emulator
+//
+
+#include "common.h"
+#include "headless_c64.h"
+
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+
+//
+// Command line settings
+//
+
+std::string CMD_basic   = "./build/basic_generic.rom";
+std::string CMD_kernal  = "./build/kernal_generic.rom";
+std::string CMD_chargen = "";
+std::string CMD_type    = "";
+double      CMD_seconds = 3.0;
+bool        CMD_ntsc    = false;
+
+//
+// Common helper functions
+//
+
+void printUsage()
+{
+    std::cout << "\n" <<
+        "usage: headless [-b <BASIC ROM>] [-k <KERNAL ROM>] [-c <CHARGEN ROM>]" << "\n" <<
+        "                [-s <emulated seconds>] [-t <text to type>] [-n]" << "\n\n" <<
+        "  -n  NTSC machine (default is PAL)" << "\n\n";
+}
+
+void parseCommandLine(int argc, char **argv)
+{
+    int opt;
+
+    while ((opt = getopt(argc, argv, "b:k:c:s:t:n")) != -1)
+    {
+        switch(opt)
+        {
+            case 'b': CMD_basic   = optarg;              break;
+            case 'k': CMD_kernal  = optarg;              break;
+            case 'c': CMD_chargen = optarg;              break;
+            case 's': CMD_seconds = strtod(optarg, nullptr); break;
+            case 't': CMD_type    = optarg;              break;
+            case 'n': CMD_ntsc    = true;                break;
+            default: printUsage(); ERROR();
+        }
+    }
+
+    if (optind != argc)     { printUsage(); ERROR("unexpected parameters"); }
+    if (CMD_seconds <= 0.0) { printUsage(); ERROR("run time has to be positive"); }
+}
+
+void printBanner()
+{
+    printBannerLineTop();
+    std::cout << "// Running ROMs on a headless machine" << "\n";
+    printBannerLineBottom();
+}
+
+//
+// Main function
+//
+
+int main(int argc, char **argv)
+{
+    parseCommandLine(argc, argv);
+    printBanner();
+
+    C64Machine machine(CMD_ntsc ? C64Machine::VideoSystem::NTSC : C64Machine::VideoSystem::PAL);
+
+    if (!machine.loadBasic(CMD_basic))   ERROR(std::string("unable to load BASIC ROM '") + CMD_basic + "'");
+    if (!machine.loadKernal(CMD_kernal)) ERROR(std::string("unable to load KERNAL ROM '") + CMD_kernal + "'");
+    if (!CMD_chargen.empty() && !machine.loadChargen(CMD_chargen))
+    {
+        ERROR(std::string("unable to load CHARGEN ROM '") + CMD_chargen + "'");
+    }
+
+    // Text is typed as soon as the machine is running
+
+    std::string typeText = CMD_type;
+    std::replace(typeText.begin(), typeText.end(), '|', '\n');
+
+    machine.reset();
+    machine.typeText(typeText);
+
+    const uint64_t numCycles = uint64_t(CMD_seconds * machine.clockHz());
+
+    auto timeStart = std::chrono::steady_clock::now();
+    machine.run(numCycles);
+    auto timeEnd   = std::chrono::steady_clock::now();
+
+    if (machine.cpu.jammed)
+    {
+        char buf[64];
+        snprintf(buf, sizeof(buf), "CPU jammed at $%04X", machine.cpu.pc);
+        std::cout << buf << "\n\n";
+    }
+
+    // Print out screen content and statistics
+
+    std::cout << machine.screenText() << "\n";
+
+    const double hostSeconds = std::chrono::duration<double>(timeEnd - timeStart).count();
+
+    char buf[256];
+    snprintf(buf, sizeof(buf),
+             "emulated: %llu cycles, %.3f s (%s)\n"
+             "host:     %.3f s, %.1f MHz equivalent\n",
+             (unsigned long long) machine.cycles, machine.cycles / machine.clockHz(), CMD_ntsc ? "NTSC" : "PAL",
+             hostSeconds, machine.cycles / hostSeconds / 1e6);
+    std::cout << buf << "\n";
+
+    return 0;
+}
@@ -0,0 +1,663 @@
+//
+// Headless C64 machine model, for running the Open ROMs images on the host
+// without an emulator GUI - the base for in-tree performance measurements.
+//
+// Contains the 6510 CPU port memory banking, stub VIC-II (raster counter,
+// raster interrupt, badline cycle stealing), two CIAs with timers and
+// interrupts (CIA1 keyboard matrix, CIA2 serial bus lines with no devices
+// attached), a Datasette feeding pulses to the CIA1 FLAG input, and a SID
+// which ignores writes. No video or sound is produced.
+//
+// Only C64 compatible targets are supported; the MEGA65 ROM needs a 45GS02
+// CPU and the MEGA65 memory mapper, which are not modeled.
+//
+
+#ifndef HEADLESS_C64_H
+#define HEADLESS_C64_H
+
+#include "cpu_6502.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <vector>
+
+class C64Machine
+{
+public:
+
+    enum class VideoSystem { PAL, NTSC };
+
+    C64Machine(VideoSystem videoSystem = VideoSystem::PAL) :
+        cpu(*this),
+        cycles(0),
+        traceAll(false),
+        videoSystem(videoSystem)
+    {
+        memset(ram,      0, sizeof(ram));
+        memset(colorRam, 0, sizeof(colorRam));
+        memset(basic,    0, sizeof(basic));
+        memset(kernal,   0, sizeof(kernal));
+        memset(chargen,  0, sizeof(chargen));
+        memset(traps,    0, sizeof(traps));
+
+        // Typical power-on RAM pattern
+
+        for (unsigned idx = 0; idx < sizeof(ram); idx++) ram[idx] = (idx & 0x40) ? 0xFF : 0x00;
+
+        cpuPortDir  = 0x00;
+        cpuPortData = 0x3F;
+        updateMemoryMap();
+    }
+
+    // ROM images; chargen is optional, it is only needed by code reading the font
+
+    bool loadBasic(const std::string &fileName)   { return loadFile(fileName, basic,   sizeof(basic));   }
+    bool loadKernal(const std::string &fileName)  { return loadFile(fileName, kernal,  sizeof(kernal));  }
+    bool loadChargen(const std::string &fileName) { return loadFile(fileName, chargen, sizeof(chargen)); }
+
+    bool loadRoms(const std::string &basicFile, const std::string &kernalFile, std::string &error)
+    {
+        if (!loadBasic(basicFile))   { error = "unable to load BASIC ROM '"  + basicFile  + "'"; return false; }
+        if (!loadKernal(kernalFile)) { error = "unable to load KERNAL ROM '" + kernalFile + "'"; return false; }
+        return true;
+    }
+
+    void reset()
+    {
+        memset(&vic,  0, sizeof(vic));
+        memset(&cia1, 0, sizeof(cia1));
+        memset(&cia2, 0, sizeof(cia2));
+        memset(sid,   0, sizeof(sid));
+
+        cia1.timerA = cia1.latchA = cia1.timerB = cia1.latchB = 0xFFFF;
+        cia2.timerA = cia2.latchA = cia2.timerB = cia2.latchB = 0xFFFF;
+
+        cpuPortDir  = 0x00;
+        cpuPortData = 0x3F;
+        updateMemoryMap();
+
+        vic.cyclesPerLine = (videoSystem == VideoSystem::PAL) ? 63  : 65;
+        vic.linesPerFrame = (videoSystem == VideoSystem::PAL) ? 312 : 263;
+
+        nmiLine     = false;
+        stopRequest = false;
+        skipTrap    = false;
+
+        cpu.reset();
+    }
+
+    // Run for the given number of cycles; returns earlier if stopped by a trap
+    // handler or by calling 'stop()'. Returns the number of cycles executed.
+
+    uint64_t run(uint64_t numCycles)
+    {
+        const uint64_t startCycles  = cycles;
+        const uint64_t targetCycles = cycles + numCycles;
+
+        stopRequest = false;
+
+        while (cycles < targetCycles && !stopRequest)
+        {
+            if ((traceAll || traps[cpu.pc]) && !skipTrap)
+            {
+                if (trapHandler && !trapHandler(cpu.pc))
+                {
+                    skipTrap = true;  // do not trap again at the same place when resuming
+                    break;
+                }
+            }
+            skipTrap = false;
+
+            if (cpu.jammed) break;
+
+            tick(cpu.step());
+        }
+
+        return cycles - startCycles;
+    }
+
+    void stop() { stopRequest = true; }
+
+    // Traps - 'trapHandler' is called before executing an instruction at the marked
+    // address (or at any address, if 'traceAll' is set); returning false stops 'run()'
+
+    void setTrap(uint16_t addr, bool enable = true) { traps[addr] = enable ? 1 : 0; }
+    void clearTraps()                                { memset(traps, 0, sizeof(traps)); }
+
+    std::function<bool(uint16_t pc)> trapHandler;
+
+    // Side-effect free memory access, as seen by the CPU (I/O reads return the register state)
+
+    uint8_t peek(uint16_t addr) const
+    {
+        if (readMap[addr >> 8] != nullptr) return readMap[addr >> 8][addr & 0xFF];
+        if (addr < 0x0002)                 return (addr == 0) ? cpuPortDir : cpuPortRead();
+        return ioPeek(addr);
+    }
+
+    void poke(uint16_t addr, uint8_t value) { ram[addr] = value; }
+
+    uint16_t peek16(uint16_t addr) const { return peek(addr) | (peek(addr + 1) << 8); }
+
+    // Keyboard - either type text through the KERNAL keyboard buffer (ASCII, letters
+    // become unshifted PETSCII), or press keys directly in the matrix (column 0-7, row 0-7)
+
+    void typeText(const std::string &text)
+    {
+        for (char c : text)
+        {
+            if      (c == '\n')            pendingKeys.push_back(0x0D);
+            else if (c >= 'a' && c <= 'z') pendingKeys.push_back(c - 'a' + 'A');
+            else                           pendingKeys.push_back(c);
+        }
+    }
+
+    bool keysPending() const { return !pendingKeys.empty() || ram[ADDR_NDX] != 0; }
+
+    void setKey(unsigned column, unsigned row, bool pressed)
+    {
+        if (pressed) cia1.keyMatrix[column & 7] |=  (1 << (row & 7));
+        else         cia1.keyMatrix[column & 7] &= ~(1 << (row & 7));
+    }
+
+    // Address of the screen matrix, as seen by the VIC-II
+
+    uint16_t screenAddress() const
+    {
+        const uint16_t vicBank = (3 - ((cia2.pra | ~cia2.ddra) & 3)) * 0x4000;
+        return vicBank + (vic.regs[0x18] >> 4) * 0x400;
+    }
+
+    // Screen content as ASCII text, one line per row
+
+    std::string screenText() const
+    {
+        const uint16_t screenBase = screenAddress();
+
+        std::string result;
+        for (unsigned row = 0; row < 25; row++)
+        {
+            std::string line;
+            for (unsigned col = 0; col < 40; col++)
+            {
+                const uint8_t code = ram[screenBase + row * 40 + col] & 0x7F;
+
+                if      (code == 0x00)                 line += '@';
+                else if (code <= 0x1A)                 line += char('A' + code - 1);
+                else if (code == 0x1B)                 line += '[';
+                else if (code == 0x1D)                 line += ']';
+                else if (code >= 0x20 && code <= 0x3F) line += char(code);
+                else                                   line += '.';
+            }
+
+            while (!line.empty() && line.back() == ' ') line.pop_back();
+            result += line + "\n";
+        }
+
+        return result;
+    }
+
+    // Datasette - inserting a tape presses PLAY; while the motor is on, the pulses (lengths
+    // in CPU cycles) are played, each one ends with a falling edge on the CIA1 FLAG input
+
+    void tapeInsert(const std::vector<uint32_t> &pulses)
+    {
+        tape.pulses    = pulses;
+        tape.position  = 0;
+        tape.remaining = pulses.empty() ? 0 : pulses[0];
+        tape.inserted  = true;
+    }
+
+    void tapeEject() { tape = Tape(); }
+
+    size_t tapePosition() const { return tape.position; }
+    bool   tapeEnd()      const { return tape.position >= tape.pulses.size(); }
+
+    bool motorOn() const { return (cpuPortDir & 0x20) && !(cpuPortData & 0x20); }
+
+    // Timing
+
+    double clockHz() const { return (videoSystem == VideoSystem::PAL) ? 985248.0 : 1022727.0; }
+    double frameHz() const { return clockHz() / (vic.cyclesPerLine * vic.linesPerFrame); }
+
+    uint16_t rasterLine() const { return vic.rasterLine; }
+
+    // Bus interface, for the CPU
+
+    uint8_t read(uint16_t addr)
+    {
+        const uint8_t *page = readMap[addr >> 8];
+        if (page != nullptr) return page[addr & 0xFF];
+        if (addr < 0x0002)   return (addr == 0) ? cpuPortDir : cpuPortRead();
+        return ioRead(addr);
+    }
+
+    void write(uint16_t addr, uint8_t value)
+    {
+        if (!writeSpecial[addr >> 8])
+        {
+            ram[addr] = value;
+            return;
+        }
+
+        if (addr < 0x0002)
+        {
+            if (addr == 0) cpuPortDir = value; else cpuPortData = value;
+            updateMemoryMap();
+            ram[addr] = value;   // the RAM below is written too
+        }
+        else if (addr >= 0xD000 && addr < 0xE000 && ioVisible)
+        {
+            ioWrite(addr, value);
+        }
+        else
+        {
+            ram[addr] = value;
+        }
+    }
+
+    bool irqLine() const
+    {
+        return (cia1.icr & cia1.icrMask & 0x1F) || (vic.regs[0x19] & vic.regs[0x1A] & 0x0F);
+    }
+
+    // Public state
+
+    CPU6502<C64Machine> cpu;
+
+    uint64_t cycles;
+    bool     traceAll;
+
+    uint8_t  ram[0x10000];
+    uint8_t  basic[0x2000];
+    uint8_t  kernal[0x2000];
+    uint8_t  chargen[0x1000];
+
+private:
+
+    static const uint16_t ADDR_NDX  = 0x00C6;  // number of characters in keyboard buffer
+    static const uint16_t ADDR_KEYD = 0x0277;  // keyboard buffer
+    static const uint8_t  KEYD_SIZE = 10;
+
+    struct CIA
+    {
+        uint8_t  pra, prb, ddra, ddrb;
+        uint16_t timerA, latchA, timerB, latchB;
+        uint8_t  cra, crb;
+        uint8_t  icr, icrMask;
+        uint8_t  tod[4], sdr;
+        uint8_t  keyMatrix[8];  // CIA1 only - pressed keys, bit per row
+    };
+
+    struct Tape
+    {
+        std::vector<uint32_t> pulses;
+        size_t                position  = 0;
+        uint32_t              remaining = 0;   // cycles till the end of the current pulse
+        bool                  inserted  = false;
+    };
+
+    struct VIC
+    {
+        uint8_t  regs[0x40];
+        uint16_t rasterLine;
+        uint16_t rasterCompare;
+        unsigned lineCycle;
+        unsigned cyclesPerLine;
+        unsigned linesPerFrame;
+        bool     denLatched;    // display enabled at line $30, allows badlines
+    };
+
+    VideoSystem videoSystem;
+
+    VIC     vic;
+    CIA     cia1, cia2;
+    Tape    tape;
+    uint8_t sid[0x20];
+    uint8_t colorRam[0x400];
+
+    uint8_t cpuPortDir, cpuPortData;
+    bool    ioVisible;
+    bool    nmiLine;
+    bool    stopRequest;
+    bool    skipTrap;
+
+    const uint8_t *readMap[0x100];
+    bool           writeSpecial[0x100];
+    uint8_t        traps[0x10000];
+
+    std::string    pendingKeys;
+
+    static bool loadFile(const std::string &fileName, uint8_t *buffer, size_t size)
+    {
+        std::ifstream inFile(fileName, std::ios::in | std::ios::binary | std::ios::ate);
+        if (!inFile.good() || size_t(inFile.tellg()) != size) return false;
+
+        inFile.seekg(0, inFile.beg);
+        inFile.read((char *) buffer, size);
+
+        return inFile.good();
+    }
+
+    uint8_t cpuPortRead() const
+    {
+        // Bits 0-2 have pull-ups, bit 4 is cassette sense (low if PLAY is pressed)
+
+        const uint8_t inputs = tape.inserted ? 0x07 : 0x17;
+        return (cpuPortData & cpuPortDir) | (inputs & ~cpuPortDir);
+    }
+
+    void updateMemoryMap()
+    {
+        const uint8_t port   = (cpuPortData | ~cpuPortDir) & 0x07;
+        const bool    loram  = port & 0x01;
+        const bool    hiram  = port & 0x02;
+        const bool    charen = port & 0x04;
+
+        for (unsigned page = 0; page < 0x100; page++)
+        {
+            readMap[page]      = &ram[page << 8];
+            writeSpecial[page] = false;
+        }
+
+        readMap[0x00]      = nullptr;   // CPU port
+        writeSpecial[0x00] = true;
+
+        if (loram && hiram)
+        {
+            for (unsigned page = 0xA0; page < 0xC0; page++) readMap[page] = &basic[(page - 0xA0) << 8];
+        }
+
+        if (hiram)
+        {
+            for (unsigned page = 0xE0; page < 0x100; page++) readMap[page] = &kernal[(page - 0xE0) << 8];
+        }
+
+        ioVisible = (loram || hiram) && charen;
+        if (loram || hiram)
+        {
+            for (unsigned page = 0xD0; page < 0xE0; page++)
+            {
+                readMap[page]      = ioVisible ? nullptr : &chargen[(page - 0xD0) << 8 & 0x0FFF];
+                writeSpecial[page] = ioVisible;
+            }
+        }
+    }
+
+    // I/O area
+
+    uint8_t ioPeek(uint16_t addr) const
+    {
+        if (addr < 0x0100) return ram[addr];
+
+        switch (addr & 0xFF00)
+        {
+            case 0xD000: case 0xD100: case 0xD200: case 0xD300:
+            {
+                const uint8_t reg = addr & 0x3F;
+                if (reg == 0x11) return (vic.regs[0x11] & 0x7F) | ((vic.rasterLine & 0x100) ? 0x80 : 0);
+                if (reg == 0x12) return vic.rasterLine & 0xFF;
+                if (reg == 0x19) return vic.regs[0x19] | ((vic.regs[0x19] & vic.regs[0x1A] & 0x0F) ? 0x80 : 0) | 0x70;
+                if (reg >= 0x2F) return 0xFF;
+                return vic.regs[reg];
+            }
+            case 0xD400: case 0xD500: case 0xD600: case 0xD700:
+                return 0x00;
+            case 0xD800: case 0xD900: case 0xDA00: case 0xDB00:
+                return colorRam[addr & 0x3FF] | 0xF0;
+            case 0xDC00:
+                return ciaPeek(cia1, addr & 0x0F, true);
+            case 0xDD00:
+                return ciaPeek(cia2, addr & 0x0F, false);
+            default:
+                return 0xFF;  // open bus, no cartridge I/O
+        }
+    }
+
+    uint8_t ioRead(uint16_t addr)
+    {
+        if (addr < 0x0100) return ram[addr];
+
+        const uint8_t value = ioPeek(addr);
+
+        // Reading the interrupt control register acknowledges the interrupts
+
+        if ((addr & 0xFF0F) == 0xDC0D) cia1.icr = 0;
+        if ((addr & 0xFF0F) == 0xDD0D) { cia2.icr = 0; nmiLine = false; }
+
+        return value;
+    }
+
+    void ioWrite(uint16_t addr, uint8_t value)
+    {
+        switch (addr & 0xFF00)
+        {
+            case 0xD000: case 0xD100: case 0xD200: case 0xD300:
+            {
+                const uint8_t reg = addr & 0x3F;
+                if (reg == 0x19) { vic.regs[0x19] &= ~value; return; }  // acknowledge
+                if (reg == 0x11) vic.rasterCompare = (vic.rasterCompare & 0xFF) | ((value & 0x80) << 1);
+                if (reg == 0x12) { vic.rasterCompare = (vic.rasterCompare & 0x100) | value; return; }
+                vic.regs[reg] = value;
+                return;
+            }
+            case 0xD400: case 0xD500: case 0xD600: case 0xD700:
+                sid[addr & 0x1F] = value;
+                return;
+            case 0xD800: case 0xD900: case 0xDA00: case 0xDB00:
+                colorRam[addr & 0x3FF] = value & 0x0F;
+                return;
+            case 0xDC00:
+                ciaWrite(cia1, addr & 0x0F, value);
+                return;
+            case 0xDD00:
+                ciaWrite(cia2, addr & 0x0F, value);
+                updateNmi();
+                return;
+            default:
+                return;
+        }
+    }
+
+    uint8_t ciaPeek(const CIA &cia, uint8_t reg, bool isCia1) const
+    {
+        switch (reg)
+        {
+            case 0x00:
+            {
+                if (isCia1) return cia.pra | ~cia.ddra;
+
+                // Serial bus: no devices, so CLK/DATA inputs only reflect our own (inverted) outputs
+
+                const uint8_t out = cia.pra | ~cia.ddra;
+                return (out & 0x3F) | ((out & 0x10) ? 0x00 : 0x40) | ((out & 0x20) ? 0x00 : 0x80);
+            }
+            case 0x01:
+            {
+                uint8_t value = (cia.prb | ~cia.ddrb);
+                if (isCia1)
+                {
+                    const uint8_t columns = cia.pra | ~cia.ddra;
+                    for (unsigned col = 0; col < 8; col++)
+                    {
+                        if (!(columns & (1 << col))) value &= ~cia.keyMatrix[col];
+                    }
+                }
+                return value;
+            }
+            case 0x02: return cia.ddra;
+            case 0x03: return cia.ddrb;
+            case 0x04: return cia.timerA & 0xFF;
+            case 0x05: return cia.timerA >> 8;
+            case 0x06: return cia.timerB & 0xFF;
+            case 0x07: return cia.timerB >> 8;
+            case 0x08: case 0x09: case 0x0A: case 0x0B:
+                return cia.tod[reg - 0x08];
+            case 0x0C: return cia.sdr;
+            case 0x0D: return cia.icr | ((cia.icr & cia.icrMask & 0x1F) ? 0x80 : 0);
+            case 0x0E: return cia.cra & ~0x10;
+            case 0x0F: return cia.crb & ~0x10;
+        }
+
+        return 0xFF;
+    }
+
+    void ciaWrite(CIA &cia, uint8_t reg, uint8_t value)
+    {
+        switch (reg)
+        {
+            case 0x00: cia.pra  = value; break;
+            case 0x01: cia.prb  = value; break;
+            case 0x02: cia.ddra = value; break;
+            case 0x03: cia.ddrb = value; break;
+            case 0x04: cia.latchA = (cia.latchA & 0xFF00) | value; break;
+            case 0x05:
+                cia.latchA = (cia.latchA & 0x00FF) | (value << 8);
+                if (!(cia.cra & 0x01)) cia.timerA = cia.latchA;
+                break;
+            case 0x06: cia.latchB = (cia.latchB & 0xFF00) | value; break;
+            case 0x07:
+                cia.latchB = (cia.latchB & 0x00FF) | (value << 8);
+                if (!(cia.crb & 0x01)) cia.timerB = cia.latchB;
+                break;
+            case 0x08: case 0x09: case 0x0A: case 0x0B:
+                cia.tod[reg - 0x08] = value;
+                break;
+            case 0x0C: cia.sdr = value; break;
+            case 0x0D:
+                if (value & 0x80) cia.icrMask |= (value & 0x1F); else cia.icrMask &= ~(value & 0x1F);
+                break;
+            case 0x0E:
+                if (value & 0x10) cia.timerA = cia.latchA;
+                cia.cra = value & ~0x10;
+                break;
+            case 0x0F:
+                if (value & 0x10) cia.timerB = cia.latchB;
+                cia.crb = value & ~0x10;
+                break;
+        }
+    }
+
+    void tickCIA(CIA &cia, unsigned numCycles)
+    {
+        unsigned underflowsA = 0;
+
+        if (cia.cra & 0x01)
+        {
+            unsigned left = numCycles;
+            while (left > cia.timerA)
+            {
+                left -= cia.timerA + 1;
+                underflowsA++;
+                cia.icr |= 0x01;
+                cia.timerA = cia.latchA;
+                if (cia.cra & 0x08)
+                {
+                    cia.cra &= ~0x01;  // one-shot mode
+                    left = 0;
+                    break;
+                }
+            }
+            cia.timerA -= left;
+        }
+
+        if (cia.crb & 0x01)
+        {
+            const uint8_t mode   = (cia.crb >> 5) & 0x03;
+            unsigned      counts = (mode == 0) ? numCycles : (mode >= 2 ? underflowsA : 0);
+
+            while (counts > cia.timerB)
+            {
+                counts -= cia.timerB + 1;
+                cia.icr |= 0x02;
+                cia.timerB = cia.latchB;
+                if (cia.crb & 0x08)
+                {
+                    cia.crb &= ~0x01;
+                    counts = 0;
+                    break;
+                }
+            }
+            cia.timerB -= counts;
+        }
+    }
+
+    void tickTape(unsigned numCycles)
+    {
+        while (tape.position < tape.pulses.size())
+        {
+            if (numCycles < tape.remaining)
+            {
+                tape.remaining -= numCycles;
+                return;
+            }
+
+            numCycles -= tape.remaining;
+            cia1.icr  |= 0x10;
+            if (++tape.position < tape.pulses.size()) tape.remaining = tape.pulses[tape.position];
+        }
+    }
+
+    void updateNmi()
+    {
+        const bool line = (cia2.icr & cia2.icrMask & 0x1F) != 0;
+        if (line && !nmiLine) cpu.nmi();  // edge triggered
+        nmiLine = line;
+    }
+
+    void tick(unsigned numCycles)
+    {
+        // VIC-II raster, steals cycles on badlines
+
+        unsigned stolenCycles = 0;
+
+        vic.lineCycle += numCycles;
+        while (vic.lineCycle >= vic.cyclesPerLine)
+        {
+            vic.lineCycle -= vic.cyclesPerLine;
+            if (++vic.rasterLine >= vic.linesPerFrame)
+            {
+                vic.rasterLine = 0;
+                feedKeyboardBuffer();
+            }
+
+            if (vic.rasterLine == vic.rasterCompare) vic.regs[0x19] |= 0x01;
+            if (vic.rasterLine == 0x30) vic.denLatched = (vic.regs[0x11] & 0x10) != 0;
+
+            if (vic.denLatched && vic.rasterLine >= 0x30 && vic.rasterLine <= 0xF7 &&
+                (vic.rasterLine & 0x07) == (vic.regs[0x11] & 0x07))
+            {
+                stolenCycles  += 40;
+                vic.lineCycle += 40;
+            }
+        }
+
+        numCycles += stolenCycles;
+        cycles    += numCycles;
+
+        if (tape.inserted && motorOn()) tickTape(numCycles);
+
+        tickCIA(cia1, numCycles);
+        tickCIA(cia2, numCycles);
+        if (cia2.icr & cia2.icrMask & 0x1F) updateNmi();
+    }
+
+    void feedKeyboardBuffer()
+    {
+        // Emulates typing - refill the KERNAL keyboard buffer once it is empty
+
+        if (pendingKeys.empty() || ram[ADDR_NDX] != 0) return;
+
+        const size_t count = std::min(pendingKeys.size(), size_t(KEYD_SIZE));
+        memcpy(&ram[ADDR_KEYD], pendingKeys.data(), count);
+        ram[ADDR_NDX] = count;
+        pendingKeys.erase(0, count);
+    }
+};
+
+#endif // HEADLESS_C64_H
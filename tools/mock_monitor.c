@@ -0,0 +1,387 @@
+/*
+  Mock VICE binary monitor, replaying a canned session - for testing
+  collect_data without an emulator.
+
+  Session file lines ('#' starts a comment):
+
+    mem  <address> <byte> ...          - put bytes into the memory (hex)
+    regs <pc> <sp> <line> <cycle>      - set registers (pc/sp hex, raster position decimal)
+    stop <pc> <sp> <line> <cycle>      - CPU reaches this place; reported as a checkpoint
+                                         hit if an enabled execution checkpoint covers it,
+                                         skipped otherwise
+
+  Lines are processed in order: everything up to the first 'stop' is applied at
+  start, the remaining lines are consumed each time the client resumes the CPU.
+  The connection is closed when the session ends.
+
+  Checkpoints follow the client requests like in VICE: only enabled ones are hit,
+  and only those set to 'stop when hit' stop the CPU. With '-v' every stop and
+  every skipped place is logged, so a test can check which checkpoints the client
+  had enabled at the time.
+*/
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <string.h>
+#include <stdlib.h>
+#include <getopt.h>
+
+#include "binmon.h"
+
+/* Registers, as announced to the client */
+
+enum { REG_A = 0x00, REG_X = 0x01, REG_Y = 0x02, REG_PC = 0x03, REG_SP = 0x04, REG_LIN = 0x35, REG_CYC = 0x36 };
+
+typedef struct mock_register {
+  uint8_t     id;
+  uint8_t     bits;
+  const char *name;
+} mock_register;
+
+const mock_register registers[] = {
+  { REG_A, 8, "A" }, { REG_X, 8, "X" }, { REG_Y, 8, "Y" }, { REG_PC, 16, "PC" }, { REG_SP, 8, "SP" },
+  { REG_LIN, 16, "LIN" }, { REG_CYC, 16, "CYC" }
+};
+
+#define NUM_REGISTERS (sizeof(registers) / sizeof(registers[0]))
+
+unsigned reg_values[256];
+
+/* Checkpoints */
+
+#define MAX_CHECKPOINTS 64
+
+typedef struct mock_checkpoint {
+  unsigned start, end;
+  int      enabled;
+  int      stop;
+  uint8_t  op;
+  uint32_t hits;
+  int      used;
+} mock_checkpoint;
+
+mock_checkpoint checkpoints[MAX_CHECKPOINTS];
+
+/* Session */
+
+unsigned char memory[0x10000];
+
+FILE *session;
+int session_line = 0;
+
+binmon_conn conn;
+binmon_packet packet;
+
+int verbose = 0;
+
+/* Process session lines until the next 'stop' (returns 1) or the end (returns 0); with
+   'peek' set the 'stop' line is left unprocessed */
+
+int session_advance(int peek)
+{
+  char line[1024];
+  long pos_line;
+
+  while ((pos_line = ftell(session)) >= 0 && fgets(line, sizeof(line), session)) {
+    char *comment = strchr(line, '#');
+    char cmd[16];
+    unsigned pc, sp, lin, cyc;
+    int pos;
+
+    session_line++;
+    if (comment) *comment = 0;
+    if (sscanf(line, "%15s%n", cmd, &pos) < 1) continue;
+
+    if (!strcmp(cmd, "mem")) {
+      unsigned addr, value;
+      int n;
+      if (sscanf(line + pos, "%x%n", &addr, &n) < 1) goto malformed;
+      pos += n;
+      while (sscanf(line + pos, "%x%n", &value, &n) == 1) {
+        memory[addr++ & 0xffff] = value;
+        pos += n;
+      }
+    } else if (!strcmp(cmd, "regs") || !strcmp(cmd, "stop")) {
+      if (peek && !strcmp(cmd, "stop")) {
+        fseek(session, pos_line, SEEK_SET);
+        session_line--;
+        return 1;
+      }
+      if (sscanf(line + pos, "%x %x %u %u", &pc, &sp, &lin, &cyc) != 4) goto malformed;
+      reg_values[REG_PC] = pc;
+      reg_values[REG_SP] = sp;
+      reg_values[REG_LIN] = lin;
+      reg_values[REG_CYC] = cyc;
+      if (!strcmp(cmd, "stop")) return 1;
+    } else {
+      goto malformed;
+    }
+  }
+  return 0;
+
+malformed:
+  fprintf(stderr, "mock: malformed session line %d\n", session_line);
+  exit(-1);
+}
+
+void send_checkpoint_info(int number, uint32_t id, int hit)
+{
+  const mock_checkpoint *cp = &checkpoints[number];
+  unsigned char body[22];
+
+  binmon_put32(body, number);
+  body[4] = hit;
+  binmon_put16(body + 5, cp->start);
+  binmon_put16(body + 7, cp->end);
+  body[9] = cp->stop;
+  body[10] = cp->enabled;
+  body[11] = cp->op;
+  body[12] = 0;
+  binmon_put32(body + 13, cp->hits);
+  binmon_put32(body + 17, 0);
+  body[21] = 0;
+  binmon_send_response(&conn, BINMON_RSP_CHECKPOINT_INFO, 0, id, body, sizeof(body));
+}
+
+void send_registers(uint32_t id)
+{
+  unsigned char body[2 + NUM_REGISTERS * 4];
+
+  binmon_put16(body, NUM_REGISTERS);
+  for (unsigned i = 0; i < NUM_REGISTERS; i++) {
+    body[2 + i * 4] = 3;
+    body[3 + i * 4] = registers[i].id;
+    binmon_put16(body + 4 + i * 4, reg_values[registers[i].id]);
+  }
+  binmon_send_response(&conn, BINMON_RSP_REGISTER_INFO, 0, id, body, sizeof(body));
+}
+
+/* Run until the next session 'stop' covered by an enabled checkpoint; returns 0 at the end */
+
+int run_cpu(void)
+{
+  unsigned char body[2];
+
+  binmon_put16(body, reg_values[REG_PC]);
+  binmon_send_response(&conn, BINMON_RSP_RESUMED, 0, BINMON_EVENT_ID, body, sizeof(body));
+
+  while (session_advance(0)) {
+    int stop = 0;
+    for (int i = 0; i < MAX_CHECKPOINTS; i++) {
+      mock_checkpoint *cp = &checkpoints[i];
+      if (!cp->used || !cp->enabled || !(cp->op & BINMON_OP_EXEC)) continue;
+      if (reg_values[REG_PC] < cp->start || reg_values[REG_PC] > cp->end) continue;
+
+      cp->hits++;
+      if (!cp->stop) continue;
+      send_checkpoint_info(i, BINMON_EVENT_ID, 1);
+      stop = 1;
+    }
+    if (!stop) {
+      if (verbose) fprintf(stderr, "mock: skipped $%04x\n", reg_values[REG_PC]);
+      continue;
+    }
+
+    if (verbose) fprintf(stderr, "mock: stop at $%04x\n", reg_values[REG_PC]);
+    send_registers(BINMON_EVENT_ID);
+    binmon_put16(body, reg_values[REG_PC]);
+    binmon_send_response(&conn, BINMON_RSP_STOPPED, 0, BINMON_EVENT_ID, body, sizeof(body));
+    return 1;
+  }
+  return 0;
+}
+
+/* Handle a request; returns 0 when the connection should be closed */
+
+int handle_request(const binmon_packet *p)
+{
+  const unsigned char *b = p->body;
+  static unsigned char body[BINMON_BUF_SIZE];
+
+  switch (p->type) {
+  case BINMON_CMD_REGISTERS_AVAILABLE: {
+    unsigned len = 2;
+    binmon_put16(body, NUM_REGISTERS);
+    for (unsigned i = 0; i < NUM_REGISTERS; i++) {
+      unsigned name_len = strlen(registers[i].name);
+      body[len] = 3 + name_len;
+      body[len + 1] = registers[i].id;
+      body[len + 2] = registers[i].bits;
+      body[len + 3] = name_len;
+      memcpy(body + len + 4, registers[i].name, name_len);
+      len += 4 + name_len;
+    }
+    binmon_send_response(&conn, BINMON_RSP_REGISTERS_AVAILABLE, 0, p->id, body, len);
+    break;
+  }
+
+  case BINMON_CMD_REGISTERS_GET:
+    send_registers(p->id);
+    break;
+
+  case BINMON_CMD_MEM_GET: {
+    unsigned start = binmon_get16(b + 1), end = binmon_get16(b + 3);
+    unsigned len = ((end - start) & 0xffff) + 1;
+    binmon_put16(body, len);
+    for (unsigned i = 0; i < len; i++) body[2 + i] = memory[(start + i) & 0xffff];
+    binmon_send_response(&conn, BINMON_RSP_MEM_GET, 0, p->id, body, 2 + len);
+    break;
+  }
+
+  case BINMON_CMD_MEM_SET: {
+    unsigned start = binmon_get16(b + 1), end = binmon_get16(b + 3);
+    unsigned len = ((end - start) & 0xffff) + 1;
+    if (p->length < 8 + len) {
+      binmon_send_response(&conn, BINMON_RSP_MEM_SET, 0x80, p->id, NULL, 0);
+      break;
+    }
+    for (unsigned i = 0; i < len; i++) memory[(start + i) & 0xffff] = b[8 + i];
+    if (verbose) fprintf(stderr, "mock: memory set $%04x-$%04x\n", start, end);
+    binmon_send_response(&conn, BINMON_RSP_MEM_SET, 0, p->id, NULL, 0);
+    break;
+  }
+
+  case BINMON_CMD_CHECKPOINT_SET: {
+    int number = 1;
+    while (number < MAX_CHECKPOINTS && checkpoints[number].used) number++;
+    if (number >= MAX_CHECKPOINTS) {
+      binmon_send_response(&conn, BINMON_RSP_CHECKPOINT_INFO, 0x8f, p->id, NULL, 0);
+      break;
+    }
+    mock_checkpoint *cp = &checkpoints[number];
+    cp->used = 1;
+    cp->start = binmon_get16(b);
+    cp->end = binmon_get16(b + 2);
+    cp->stop = b[4];
+    cp->enabled = b[5];
+    cp->op = b[6];
+    cp->hits = 0;
+    send_checkpoint_info(number, p->id, 0);
+    break;
+  }
+
+  case BINMON_CMD_CHECKPOINT_DELETE:
+  case BINMON_CMD_CHECKPOINT_TOGGLE: {
+    uint32_t number = binmon_get32(b);
+    if (number >= MAX_CHECKPOINTS || !checkpoints[number].used) {
+      binmon_send_response(&conn, p->type, 0x01, p->id, NULL, 0);
+      break;
+    }
+    if (p->type == BINMON_CMD_CHECKPOINT_DELETE) checkpoints[number].used = 0;
+    else checkpoints[number].enabled = b[4];
+    binmon_send_response(&conn, p->type, 0, p->id, NULL, 0);
+    break;
+  }
+
+  case BINMON_CMD_KEYBOARD_FEED:
+    fprintf(stderr, "mock: keyboard feed, %u characters\n", b[0]);
+    binmon_send_response(&conn, BINMON_RSP_KEYBOARD_FEED, 0, p->id, NULL, 0);
+    break;
+
+  case BINMON_CMD_RESET:
+    binmon_send_response(&conn, BINMON_RSP_RESET, 0, p->id, NULL, 0);
+    break;
+
+  case BINMON_CMD_EXIT:
+    binmon_send_response(&conn, BINMON_RSP_EXIT, 0, p->id, NULL, 0);
+    if (!run_cpu()) {
+      fprintf(stderr, "mock: end of session\n");
+      return 0;
+    }
+    break;
+
+  case BINMON_CMD_QUIT:
+    binmon_send_response(&conn, BINMON_RSP_QUIT, 0, p->id, NULL, 0);
+    return 0;
+
+  default:
+    fprintf(stderr, "mock: unsupported command $%02x\n", p->type);
+    binmon_send_response(&conn, p->type, 0x83, p->id, NULL, 0);
+    break;
+  }
+
+  return 1;
+}
+
+int main(int argc, char *argv[])
+{
+  int port = 6502;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "p:v")) != -1) {
+    switch (opt) {
+    case 'p':
+      port = atoi(optarg);
+      break;
+    case 'v':
+      verbose = 1;
+      break;
+    default:
+      fprintf(stderr, "Usage: %s [-p <port>] [-v] <session file>\n", argv[0]);
+      exit(-1);
+    }
+  }
+
+  if (optind + 1 != argc) {
+    fprintf(stderr, "Usage: %s [-p <port>] [-v] <session file>\n", argv[0]);
+    exit(-1);
+  }
+
+  session = fopen(argv[optind], "r");
+  if (!session) {
+    perror(argv[optind]);
+    exit(-1);
+  }
+
+  /* Wait for a single client */
+
+  int listenfd = socket(AF_INET, SOCK_STREAM, 0);
+  int reuse = 1;
+  struct sockaddr_in addr;
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = htons(port);
+
+  setsockopt(listenfd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+  if (listenfd < 0 || bind(listenfd, (struct sockaddr *) &addr, sizeof(addr)) < 0 || listen(listenfd, 1) < 0) {
+    perror("mock: cannot listen");
+    exit(-1);
+  }
+
+  int fd = accept(listenfd, NULL, NULL);
+  if (fd < 0) {
+    perror("mock: accept");
+    exit(-1);
+  }
+  close(listenfd);
+
+  binmon_init(&conn, fd);
+
+  /* Apply everything before the first stop, then serve requests */
+
+  session_advance(1);
+
+  int running = 1;
+  while (running) {
+    long n = binmon_fill(&conn);
+    if (n <= 0 && n != -2) break;
+
+    int status;
+    while (running && (status = binmon_take(&conn, &packet, 1)) == 1) running = handle_request(&packet);
+    if (running && status < 0) {
+      fprintf(stderr, "mock: malformed request\n");
+      break;
+    }
+    if (binmon_flush(&conn) < 0) break;
+  }
+
+  binmon_flush(&conn);
+  close(fd);
+  fclose(session);
+  return 0;
+}
@@ -0,0 +1,604 @@
+//
+// Utility to profile the ROMs - runs a workload on the headless machine model
+// and attributes every CPU cycle to the routine being executed, using the
+// address ranges from the symbol files
+//
+
+#include "common.h"
+#include "headless_c64.h"
+#include "symbols.h"
+
+#include <unistd.h>
+
+#include <cstdio>
+#include <list>
+#include <unordered_map>
+
+//
+// Command line settings
+//
+
+std::string CMD_basic     = "./build/basic_generic.rom";
+std::string CMD_kernal    = "./build/kernal_generic.rom";
+std::string CMD_type      = "";
+std::string CMD_flatFile  = "";
+std::string CMD_foldFile  = "";
+std::string CMD_plcFile   = "";
+double      CMD_seconds   = 3.0;
+bool        CMD_ntsc      = false;
+bool        CMD_afterBoot = false;
+unsigned    CMD_maxLines  = 40;
+
+std::list<std::string> CMD_symDirs;
+std::list<std::string> CMD_vsFiles;
+
+//
+// Common helper functions
+//
+
+void printUsage()
+{
+    std::cout << "\n" <<
+        "usage: profiler [-b <BASIC ROM>] [-k <KERNAL ROM>] [-y <symbol dir>]... [-v <VICE label file>]..." << "\n" <<
+        "                [-s <emulated seconds>] [-t <text to type>] [-n] [-r] [-l <lines>]" << "\n" <<
+        "                [-f <flat profile file>] [-o <collapsed stacks file>] [-p <placement profile file>]" << "\n\n" <<
+        "  -y  directory with '*_combined.sym' files, routine ranges are taken from there" << "\n" <<
+        "  -v  VICE label file, for ROMs built without routine markers" << "\n" <<
+        "  -n  NTSC machine (default is PAL)" << "\n" <<
+        "  -r  start profiling when the READY. prompt appears, skip the boot process" << "\n" <<
+        "  -l  number of routines to print, 0 = all" << "\n" <<
+        "  -p  profile for the 'build_segment' routine placement, needs routine ranges from '-y'" << "\n\n";
+}
+
+void parseCommandLine(int argc, char **argv)
+{
+    int opt;
+
+    while ((opt = getopt(argc, argv, "b:k:y:v:s:t:nrl:f:o:p:")) != -1)
+    {
+        switch(opt)
+        {
+            case 'b': CMD_basic     = optarg;                  break;
+            case 'k': CMD_kernal    = optarg;                  break;
+            case 'y': CMD_symDirs.push_back(optarg);           break;
+            case 'v': CMD_vsFiles.push_back(optarg);           break;
+            case 's': CMD_seconds   = strtod(optarg, nullptr); break;
+            case 't': CMD_type      = optarg;                  break;
+            case 'n': CMD_ntsc      = true;                    break;
+            case 'r': CMD_afterBoot = true;                    break;
+            case 'l': CMD_maxLines  = strtoul(optarg, nullptr, 10); break;
+            case 'f': CMD_flatFile  = optarg;                  break;
+            case 'o': CMD_foldFile  = optarg;                  break;
+            case 'p': CMD_plcFile   = optarg;                  break;
+            default: printUsage(); ERROR();
+        }
+    }
+
+    if (optind != argc)     { printUsage(); ERROR("unexpected parameters"); }
+    if (CMD_seconds <= 0.0) { printUsage(); ERROR("run time has to be positive"); }
+}
+
+void printBanner()
+{
+    printBannerLineTop();
+    std::cout << "// Profiling ROMs on a headless machine" << "\n";
+    printBannerLineBottom();
+}
+
+//
+// Profiler - keeps a shadow call stack, following JSR and interrupts, unwinding
+// whenever the stack pointer moves above a frame (RTS, RTI, or stack cleanup by
+// routines which do not return to the caller). Cycles are accumulated in a tree
+// of call paths, flat and collapsed stack profiles are derived from it.
+//
+// For the routine placement, page crossings which cost an extra cycle (taken
+// branches, indexed reads) are recorded as offsets within the routine - this way
+// 'build_segment' can tell the cost of any other routine start address.
+//
+
+class Profiler
+{
+public:
+
+    Profiler(C64Machine &machine, const SymbolTable &symbols) : machine(machine), symbols(symbols)
+    {
+        nodes.push_back({ 0, intern("(root)"), 0, {} });
+
+        // Cache routine for every ROM address; RAM content can change, RAM code
+        // is attributed to the routine which called it
+
+        std::vector<std::pair<uint16_t, std::string>> romLabels;
+        for (const auto &label : symbols.labels)
+        {
+            if (isRom(label.second)) romLabels.emplace_back(label.second, label.first);
+        }
+        std::sort(romLabels.begin(), romLabels.end());
+
+        auto labelIter = romLabels.begin();
+        for (uint32_t addr = 0; addr < 0x10000; addr++)
+        {
+            pcRoutine[addr]    = NONE;
+            pcSymRoutine[addr] = NONE;
+            if (!isRom(addr)) continue;
+
+            const auto routine = symbols.routineAt(addr);
+            if (routine != nullptr)
+            {
+                pcRoutine[addr]    = intern(routine->name);
+                pcSymRoutine[addr] = routine - symbols.routines.data();
+                continue;
+            }
+
+            // No routine markers - fall back to the closest preceding label
+
+            while (labelIter != romLabels.end() && labelIter->first <= addr) labelIter++;
+            if (labelIter != romLabels.begin() && isRom((labelIter - 1)->first) &&
+                (labelIter - 1)->first >= (addr & 0xE000))
+            {
+                pcRoutine[addr] = intern((labelIter - 1)->second);
+            }
+        }
+    }
+
+    // Start profiling from the current machine state
+
+    void start()
+    {
+        frames.clear();
+        frames.push_back({ 0x1FF, ROOT, ROOT, ROOT, machine.cycles });
+
+        lastCycles = machine.cycles;
+        currentNode = leafNode(machine.cpu.pc);
+        remember(machine.cpu.pc);
+
+        machine.traceAll    = true;
+        machine.trapHandler = [this](uint16_t pc) -> bool { step(pc); return true; };
+    }
+
+    void stop()
+    {
+        step(machine.cpu.pc);
+
+        // Routines still running get their cycles so far
+
+        for (auto frame = frames.begin() + 1; frame < frames.end(); frame++)
+        {
+            edges[std::make_pair(frame->caller, frame->routine)].cycles += machine.cycles - frame->startCycles;
+        }
+
+        machine.traceAll    = false;
+        machine.trapHandler = nullptr;
+    }
+
+    // Flat profile
+
+    typedef struct
+    {
+        std::string name;
+        uint64_t    selfCycles;
+        uint64_t    inclCycles;
+        uint64_t    calls;
+
+    } FlatEntry;
+
+    std::vector<FlatEntry> flatProfile() const
+    {
+        std::vector<FlatEntry> result(names.size());
+        for (unsigned idx = 0; idx < names.size(); idx++) result[idx] = { names[idx], 0, 0, 0 };
+
+        // Inclusive time counts every routine once per call path, also for recursion - so only
+        // the subtrees of the outermost nodes of the given routine are added
+
+        std::vector<unsigned> onPath(names.size(), 0);
+        std::function<uint64_t(unsigned)> walk = [&](unsigned nodeIdx) -> uint64_t
+        {
+            const Node &node = nodes[nodeIdx];
+
+            onPath[node.routine]++;
+            uint64_t subtreeCycles = node.selfCycles;
+            for (const auto &child : node.children) subtreeCycles += walk(child.second);
+            onPath[node.routine]--;
+
+            result[node.routine].selfCycles += node.selfCycles;
+            if (onPath[node.routine] == 0) result[node.routine].inclCycles += subtreeCycles;
+
+            return subtreeCycles;
+        };
+        walk(0);
+
+        for (const auto &edge : edges) result[edge.first.second].calls += edge.second.calls;
+
+        result.erase(std::remove_if(result.begin(), result.end(),
+                                    [](const FlatEntry &entry) -> bool { return entry.inclCycles == 0; }),
+                     result.end());
+        std::sort(result.begin(), result.end(),
+                  [](const FlatEntry &a, const FlatEntry &b) -> bool { return a.selfCycles > b.selfCycles; });
+
+        return result;
+    }
+
+    // Collapsed stacks, one 'routine;routine;...;routine <cycles>' line per call path
+
+    void writeCollapsed(std::ostream &outStream) const
+    {
+        std::function<void(unsigned, const std::string &)> walk = [&](unsigned nodeIdx, const std::string &path)
+        {
+            const Node &node = nodes[nodeIdx];
+            const std::string nodePath = path.empty() ? names[node.routine] : path + ";" + names[node.routine];
+
+            if (node.selfCycles != 0) outStream << nodePath << " " << node.selfCycles << "\n";
+            for (const auto &child : node.children) walk(child.second, nodePath);
+        };
+        walk(0, "");
+    }
+
+    // Call edges - caller, callee, number of calls, cycles spent in the callee
+
+    typedef struct
+    {
+        uint64_t calls;
+        uint64_t cycles;
+
+    } Edge;
+
+    std::map<std::pair<unsigned, unsigned>, Edge> edges;
+    std::vector<std::string>                      names;
+
+    uint64_t totalCycles() const { return lastCycles - startCycles(); }
+
+    // Placement profile, for 'build_segment'; only routines known from the symbol files are included
+
+    void writePlacementProfile(std::ostream &outStream) const
+    {
+        outStream << "# placement profile, lines:" << "\n" <<
+                     "#     routine <segment> <routine> <self cycles> <inclusive cycles> <calls>" << "\n" <<
+                     "#     pair    <segment> <caller> <callee> <calls>" << "\n" <<
+                     "#     cross   <segment> <routine> <offset> <offset> <count>" << "\n";
+
+        std::map<std::string, const SymbolTable::Routine *> symRoutines;
+        for (const auto &routine : symbols.routines) symRoutines.emplace(routine.name, &routine);
+
+        for (const auto &entry : flatProfile())
+        {
+            const auto iter = symRoutines.find(entry.name);
+            if (iter == symRoutines.end()) continue;
+
+            outStream << "routine " << iter->second->segment << " " << entry.name << " " << entry.selfCycles <<
+                         " " << entry.inclCycles << " " << entry.calls << "\n";
+        }
+
+        for (const auto &edge : edges)
+        {
+            const auto caller = symRoutines.find(names[edge.first.first]);
+            const auto callee = symRoutines.find(names[edge.first.second]);
+            if (caller == symRoutines.end() || callee == symRoutines.end()) continue;
+            if (caller->second->segment != callee->second->segment)         continue;
+
+            outStream << "pair " << caller->second->segment << " " << caller->first << " " << callee->first <<
+                         " " << edge.second.calls << "\n";
+        }
+
+        for (const auto &crossing : crossings)
+        {
+            const auto &routine = symbols.routines[crossing.first >> 32];
+            outStream << "cross " << routine.segment << " " << routine.name << " " <<
+                         ((crossing.first >> 16) & 0xFFFF) << " " << (crossing.first & 0xFFFF) << " " <<
+                         crossing.second << "\n";
+        }
+    }
+
+private:
+
+    static const int32_t  NONE = -1;
+    static const unsigned ROOT = 0;     // both the root node and its routine name
+
+    typedef struct
+    {
+        unsigned                     parent;
+        unsigned                     routine;
+        uint64_t                     selfCycles;
+        std::map<unsigned, unsigned> children;
+
+    } Node;
+
+    typedef struct
+    {
+        unsigned stackPointer;   // as after the call; frame is gone once the stack is above it
+        unsigned routine;
+        unsigned caller;
+        unsigned node;
+        uint64_t startCycles;
+
+    } Frame;
+
+    static bool isRom(uint32_t addr) { return (addr >= 0xA000 && addr < 0xC000) || addr >= 0xE000; }
+
+    uint64_t startCycles() const { return frames.empty() ? lastCycles : frames.front().startCycles; }
+
+    unsigned intern(const std::string &name)
+    {
+        const auto iter = nameIds.find(name);
+        if (iter != nameIds.end()) return iter->second;
+
+        nameIds[name] = names.size();
+        names.push_back(name);
+        return names.size() - 1;
+    }
+
+    unsigned childNode(unsigned parent, unsigned routine)
+    {
+        const auto iter = nodes[parent].children.find(routine);
+        if (iter != nodes[parent].children.end()) return iter->second;
+
+        nodes.push_back({ parent, routine, 0, {} });
+        nodes[parent].children[routine] = nodes.size() - 1;
+        return nodes.size() - 1;
+    }
+
+    // Routine executing the code at 'pc' - either known from symbols, or the innermost called one
+
+    unsigned routineAt(uint16_t pc) const
+    {
+        return (pcRoutine[pc] != NONE) ? pcRoutine[pc] : frames.back().routine;
+    }
+
+    unsigned leafNode(uint16_t pc)
+    {
+        const Frame &frame = frames.back();
+        const unsigned routine = routineAt(pc);
+        return (routine == nodes[frame.node].routine) ? frame.node : childNode(frame.node, routine);
+    }
+
+    void addCrossing(int32_t symRoutine, uint32_t offset1, uint32_t offset2)
+    {
+        crossings[(uint64_t(symRoutine) << 32) | (offset1 << 16) | offset2]++;
+    }
+
+    // Record the instructions which take an extra cycle when crossing a page
+
+    void recordCrossings(uint16_t pc)
+    {
+        const int32_t symRoutine = pcSymRoutine[pc];
+        if (symRoutine == NONE) return;
+
+        const uint16_t start = symbols.routines[symRoutine].start;
+
+        if ((lastOpcode & 0x1F) == 0x10 && pc != uint16_t(lastPc + 2) && pcSymRoutine[lastPc] == symRoutine)
+        {
+            // Taken branch, from the next instruction address
+
+            addCrossing(symRoutine, lastPc + 2 - start, pc - start);
+        }
+
+        uint8_t index;
+        switch (machine.peek(pc))
+        {
+            case 0x19: case 0x39: case 0x59: case 0x79: case 0xB9: case 0xBE: case 0xD9: case 0xF9:
+                index = machine.cpu.y; break;   // absolute,Y reads
+            case 0x1D: case 0x3D: case 0x5D: case 0x7D: case 0xBD: case 0xBC: case 0xDD: case 0xFD:
+                index = machine.cpu.x; break;   // absolute,X reads
+            default:
+                return;
+        }
+
+        const uint16_t base = machine.peek16(pc + 1);
+        if (base >= start && base < symbols.routines[symRoutine].end)
+        {
+            addCrossing(symRoutine, base - start, base - start + index);
+        }
+    }
+
+    unsigned calleeRoutine(uint16_t pc, const char *prefix)
+    {
+        if (pcRoutine[pc] != NONE) return pcRoutine[pc];
+
+        char buf[16];
+        snprintf(buf, sizeof(buf), "%s$%04X", prefix, pc);
+        return intern(buf);
+    }
+
+    void remember(uint16_t pc)
+    {
+        lastPc       = pc;
+        lastStackPtr = machine.cpu.s;
+        lastOpcode   = machine.peek(pc);
+    }
+
+    void pushFrame(unsigned routine)
+    {
+        const unsigned caller = nodes[currentNode].routine;
+        frames.push_back({ machine.cpu.s, routine, caller, childNode(currentNode, routine), machine.cycles });
+        edges[std::make_pair(caller, routine)].calls++;
+    }
+
+    void step(uint16_t pc)
+    {
+        // Previous instruction (or interrupt sequence) cycles go to the current call path
+
+        nodes[currentNode].selfCycles += machine.cycles - lastCycles;
+        lastCycles = machine.cycles;
+
+        const uint8_t stackPtr = machine.cpu.s;
+
+        while (frames.size() > 1 && stackPtr > frames.back().stackPointer)
+        {
+            const Frame &frame = frames.back();
+            edges[std::make_pair(frame.caller, frame.routine)].cycles += machine.cycles - frame.startCycles;
+            frames.pop_back();
+        }
+
+        if (lastOpcode == 0x20 && stackPtr == uint8_t(lastStackPtr - 2) && pc == machine.peek16(lastPc + 1))
+        {
+            pushFrame(calleeRoutine(pc, ""));
+        }
+        else if (stackPtr == uint8_t(lastStackPtr - 3) && pc != uint16_t(lastPc + 1))
+        {
+            // Interrupt or BRK - the only ways to push 3 bytes between two instructions
+
+            if      (pc == machine.peek16(0xFFFE)) pushFrame(calleeRoutine(pc, "irq "));
+            else if (pc == machine.peek16(0xFFFA)) pushFrame(calleeRoutine(pc, "nmi "));
+        }
+
+        recordCrossings(pc);
+
+        currentNode = leafNode(pc);
+        remember(pc);
+    }
+
+    C64Machine        &machine;
+    const SymbolTable &symbols;
+
+    int32_t pcRoutine[0x10000];
+    int32_t pcSymRoutine[0x10000];
+
+    std::unordered_map<uint64_t, uint64_t> crossings;   // routine index, offset, offset -> count
+
+    std::map<std::string, unsigned> nameIds;
+    std::vector<Node>               nodes;
+    std::vector<Frame>              frames;
+
+    unsigned currentNode  = 0;
+    uint64_t lastCycles   = 0;
+    uint16_t lastPc       = 0;
+    uint8_t  lastStackPtr = 0;
+    uint8_t  lastOpcode   = 0;
+};
+
+//
+// Output
+//
+
+void writeFlatProfile(std::ostream &outStream, const Profiler &profiler, unsigned maxLines)
+{
+    const auto     flat  = profiler.flatProfile();
+    const uint64_t total = std::max(profiler.totalCycles(), uint64_t(1));
+
+    char buf[256];
+    snprintf(buf, sizeof(buf), "%12s %7s %12s %7s %9s  %s\n",
+             "self", "self%", "inclusive", "incl%", "calls", "routine");
+    outStream << buf;
+
+    unsigned lines = 0;
+    for (const auto &entry : flat)
+    {
+        if (maxLines != 0 && lines++ >= maxLines) break;
+
+        snprintf(buf, sizeof(buf), "%12llu %6.2f%% %12llu %6.2f%% %9llu  %s\n",
+                 (unsigned long long) entry.selfCycles, 100.0 * entry.selfCycles / total,
+                 (unsigned long long) entry.inclCycles, 100.0 * entry.inclCycles / total,
+                 (unsigned long long) entry.calls, entry.name.c_str());
+        outStream << buf;
+    }
+
+    outStream << "\n";
+
+    // Call edges, most expensive first
+
+    std::vector<std::pair<std::pair<unsigned, unsigned>, Profiler::Edge>> edges(profiler.edges.begin(),
+                                                                                profiler.edges.end());
+    std::sort(edges.begin(), edges.end(),
+              [](const decltype(edges)::value_type &a, const decltype(edges)::value_type &b) -> bool
+              { return a.second.cycles > b.second.cycles; });
+
+    snprintf(buf, sizeof(buf), "%12s %9s  %s\n", "cycles", "calls", "caller -> callee");
+    outStream << buf;
+
+    lines = 0;
+    for (const auto &edge : edges)
+    {
+        if (maxLines != 0 && lines++ >= maxLines) break;
+
+        snprintf(buf, sizeof(buf), "%12llu %9llu  %s -> %s\n",
+                 (unsigned long long) edge.second.cycles, (unsigned long long) edge.second.calls,
+                 profiler.names[edge.first.first].c_str(), profiler.names[edge.first.second].c_str());
+        outStream << buf;
+    }
+
+    outStream << "\n";
+}
+
+//
+// Main function
+//
+
+int main(int argc, char **argv)
+{
+    parseCommandLine(argc, argv);
+    printBanner();
+
+    SymbolTable symbols;
+    for (const auto &symDir : CMD_symDirs)
+    {
+        if (symbols.loadDir(symDir) == 0) ERROR(std::string("no symbol files found in '") + symDir + "'");
+    }
+    for (const auto &vsFile : CMD_vsFiles)
+    {
+        if (!symbols.loadViceFile(vsFile)) ERROR(std::string("unable to read VICE label file '") + vsFile + "'");
+    }
+
+    C64Machine machine(CMD_ntsc ? C64Machine::VideoSystem::NTSC : C64Machine::VideoSystem::PAL);
+
+    if (!machine.loadBasic(CMD_basic))   ERROR(std::string("unable to load BASIC ROM '") + CMD_basic + "'");
+    if (!machine.loadKernal(CMD_kernal)) ERROR(std::string("unable to load KERNAL ROM '") + CMD_kernal + "'");
+
+    std::string typeText = CMD_type;
+    std::replace(typeText.begin(), typeText.end(), '|', '\n');
+
+    machine.reset();
+    machine.typeText(typeText);
+
+    Profiler profiler(machine, symbols);
+
+    // Optionally skip the boot process
+
+    if (CMD_afterBoot)
+    {
+        const uint64_t maxCycles = uint64_t(10.0 * machine.clockHz());
+        while (machine.screenText().find("READY.") == std::string::npos)
+        {
+            if (machine.cycles >= maxCycles || machine.cpu.jammed) ERROR("READY. prompt not reached");
+            machine.run(1000);
+        }
+    }
+
+    profiler.start();
+    machine.run(uint64_t(CMD_seconds * machine.clockHz()));
+    profiler.stop();
+
+    if (machine.cpu.jammed)
+    {
+        char buf[64];
+        snprintf(buf, sizeof(buf), "CPU jammed at $%04X", machine.cpu.pc);
+        std::cout << buf << "\n\n";
+    }
+
+    std::cout << "profiled " << profiler.totalCycles() << " cycles" <<
+                 (symbols.empty() ? ", no symbols - routines are named after call addresses" : "") << "\n\n";
+
+    writeFlatProfile(std::cout, profiler, CMD_maxLines);
+
+    if (!CMD_flatFile.empty())
+    {
+        std::ofstream outFile(CMD_flatFile, std::ios::out | std::ios::trunc);
+        writeFlatProfile(outFile, profiler, 0);
+        if (!outFile.good()) ERROR(std::string("unable to write flat profile '") + CMD_flatFile + "'");
+    }
+
+    if (!CMD_foldFile.empty())
+    {
+        std::ofstream outFile(CMD_foldFile, std::ios::out | std::ios::trunc);
+        profiler.writeCollapsed(outFile);
+        if (!outFile.good()) ERROR(std::string("unable to write collapsed stacks '") + CMD_foldFile + "'");
+    }
+
+    if (!CMD_plcFile.empty())
+    {
+        if (symbols.routines.empty()) ERROR("placement profile needs symbol files with routine ranges");
+
+        std::ofstream outFile(CMD_plcFile, std::ios::out | std::ios::trunc);
+        profiler.writePlacementProfile(outFile);
+        if (!outFile.good()) ERROR(std::string("unable to write placement profile '") + CMD_plcFile + "'");
+    }
+
+    return 0;
+}
@@ -5,15 +5,25 @@
 
 #include "common.h"
 
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <time.h>
 #include <unistd.h>
 
 #include <algorithm>
+#include <array>
 #include <cstring>
 #include <fstream>
 #include <ios>
 #include <list>
+#include <map>
+#include <sstream>
+#include <thread>
+#include <utility>
 #include <vector>
 
 typedef struct
@@ -83,14 +93,28 @@ const std::vector<uint8_t> STR_DOSDATE  = { 0x4F, 0x58, 0x58, 0x58, 0x58, 0x58,
 const std::string STR_DEV   = "DEV.";
 const std::string STR_BLOCK = "DO NOT DISTRIBUTE";
 
+const std::string STR_TMP      = ".tmp";
+const std::string STR_MANIFEST = "manifest.txt";
+const std::string STR_ROUTINES = "routines.txt";
+const std::string STR_RDELTA   = "routines_delta.txt";
+const std::string STR_SYM      = "_combined.sym";
+
+// Labels placed by 'build_segment' around each routine
+
+const std::string LAB_START    = "__routine_START_";
+const std::string LAB_END      = "__routine_END_";
+
 //
 // Command and enviroment line settings
 //
 
 std::string CMD_inDir   = "./build";
 std::string CMD_outDir  = "./bin";
+std::string CMD_diffDir = "";         // empty = same as input directory
+std::string CMD_patch   = "";         // if set, apply/verify the given patch file
 
 std::list<std::string> CMD_fileList;
+std::list<std::string> CMD_symDirList;
 
 std::string ENV_developerId;
 std::string ENV_dateString;
@@ -104,13 +128,376 @@ void printUsage()
 {
     std::cout << "\n" <<
         "usage: release [-i <input (build) directory>] [-o <output (release) directory>]" << "\n" <<
-        "               <file list>" << "\n\n";
+        "               [-d <binary diff directory>] [-s <symbol directory>]..." << "\n" <<
+        "               <file list>" << "\n" <<
+        "       release -a <patch file> <previous ROM image> [<output ROM image>]" << "\n\n";
+}
+
+typedef std::vector<std::pair<uint32_t, uint32_t>> RangeList; // start, length
+typedef std::array<uint8_t, 32>                    Hash;      // SHA-256
+
+typedef struct
+{
+    uint32_t address;
+    uint32_t size;
+
+} RoutineInfo;
+
+typedef std::map<std::string, RoutineInfo> RoutineMap; // key: "<target> <segment> <routine>"
+
+Hash computeHash(const uint8_t *data, size_t size)
+{
+    static const uint32_t K[64] =
+    {
+        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+        0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+        0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+        0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+        0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+        0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+        0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+        0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+    };
+
+    uint32_t H[8] =
+    {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+
+    auto rotr = [](uint32_t x, int n) -> uint32_t { return (x >> n) | (x << (32 - n)); };
+
+    auto processBlock = [&](const uint8_t *block)
+    {
+        uint32_t W[64];
+        for (int i = 0; i < 16; i++)
+        {
+            W[i] = (uint32_t(block[4 * i]) << 24) | (uint32_t(block[4 * i + 1]) << 16) |
+                   (uint32_t(block[4 * i + 2]) << 8) | uint32_t(block[4 * i + 3]);
+        }
+        for (int i = 16; i < 64; i++)
+        {
+            const uint32_t s0 = rotr(W[i - 15], 7) ^ rotr(W[i - 15], 18) ^ (W[i - 15] >> 3);
+            const uint32_t s1 = rotr(W[i - 2], 17) ^ rotr(W[i - 2], 19)  ^ (W[i - 2] >> 10);
+            W[i] = W[i - 16] + s0 + W[i - 7] + s1;
+        }
+
+        uint32_t a = H[0], b = H[1], c = H[2], d = H[3], e = H[4], f = H[5], g = H[6], h = H[7];
+        for (int i = 0; i < 64; i++)
+        {
+            const uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + K[i] + W[i];
+            const uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+            h = g; g = f; f = e; e = d + t1;
+            d = c; c = b; b = a; a = t1 + t2;
+        }
+
+        H[0] += a; H[1] += b; H[2] += c; H[3] += d; H[4] += e; H[5] += f; H[6] += g; H[7] += h;
+    };
+
+    size_t idx = 0;
+    for (; idx + 64 <= size; idx += 64) processBlock(data + idx);
+
+    // Padding: 0x80 marker, zeroes, 64-bit big endian message length in bits
+
+    uint8_t tail[128] = {};
+    const size_t tailLen    = size - idx;
+    const size_t tailBlocks = (tailLen + 9 > 64) ? 2 : 1;
+    const uint64_t bitLen   = uint64_t(size) * 8;
+
+    if (tailLen != 0) memcpy(tail, data + idx, tailLen);
+    tail[tailLen] = 0x80;
+    for (int i = 0; i < 8; i++) tail[tailBlocks * 64 - 1 - i] = (bitLen >> (8 * i)) & 0xFF;
+
+    processBlock(tail);
+    if (tailBlocks == 2) processBlock(tail + 64);
+
+    Hash hash;
+    for (int i = 0; i < 8; i++)
+    {
+        hash[4 * i]     = (H[i] >> 24) & 0xFF;
+        hash[4 * i + 1] = (H[i] >> 16) & 0xFF;
+        hash[4 * i + 2] = (H[i] >> 8)  & 0xFF;
+        hash[4 * i + 3] =  H[i]        & 0xFF;
+    }
+
+    return hash;
+}
+
+std::string hashToString(const Hash &hash)
+{
+    std::string result;
+
+    for (auto byte : hash)
+    {
+        char buf[3];
+        snprintf(buf, sizeof(buf), "%02x", byte);
+        result += buf;
+    }
+
+    return result;
+}
+
+RangeList findChangedRanges(const uint8_t *src, const uint8_t *dst, const RangeList &areas, uint32_t maxGap = 0)
+{
+    // Determine exact address ranges which differ within the given areas; memcmp
+    // skips quickly over identical blocks. Changes separated by no more than
+    // 'maxGap' unchanged bytes are reported as a single range
+
+    const size_t BLOCK_SIZE = 64;
+
+    RangeList result;
+
+    for (auto &area : areas)
+    {
+        const size_t areaEnd = area.first + area.second;
+        size_t idx = area.first;
+
+        while (idx < areaEnd)
+        {
+            const size_t blockLen = std::min(BLOCK_SIZE, areaEnd - idx);
+            if (memcmp(src + idx, dst + idx, blockLen) == 0)
+            {
+                idx += blockLen;
+                continue;
+            }
+
+            while (src[idx] == dst[idx]) idx++;
+
+            const size_t changeStart = idx;
+            while (idx < areaEnd && src[idx] != dst[idx]) idx++;
+
+            if (!result.empty() && result.back().first + result.back().second + maxGap >= changeStart)
+            {
+                result.back().second = idx - result.back().first;
+            }
+            else
+            {
+                result.emplace_back(changeStart, idx - changeStart);
+            }
+        }
+    }
+
+    return result;
+}
+
+void appendU32(std::vector<uint8_t> &buffer, uint32_t value)
+{
+    for (int shift = 0; shift < 32; shift += 8) buffer.push_back((value >> shift) & 0xFF);
+}
+
+uint32_t fetchU32(const std::vector<uint8_t> &buffer, size_t &offset)
+{
+    if (offset + 4 > buffer.size()) ERROR("malformed patch file");
+
+    uint32_t value = 0;
+    for (int shift = 0; shift < 32; shift += 8) value |= uint32_t(buffer[offset++]) << shift;
+
+    return value;
+}
+
+bool writeTempFile(const std::string &fileNamePath, const uint8_t *data, size_t size)
+{
+    // Write the content to a temporary file and flush it to the disk; does not
+    // report errors by itself, so that it can be used from worker threads
+
+    int fd = open((fileNamePath + STR_TMP).c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+
+    while (size > 0)
+    {
+        ssize_t written = write(fd, data, size);
+        if (written <= 0)
+        {
+            close(fd);
+            return false;
+        }
+
+        data += written;
+        size -= written;
+    }
+
+    bool retVal = (fsync(fd) == 0);
+    if (close(fd) != 0) retVal = false;
+
+    return retVal;
+}
+
+void commitTempFile(const std::string &fileNamePath)
+{
+    // Atomically replace the destination file with the temporary one
+
+    if (rename((fileNamePath + STR_TMP).c_str(), fileNamePath.c_str()) != 0)
+    {
+        ERROR(std::string("unable to write file '") + fileNamePath + "'");
+    }
+}
+
+void syncDirectory(const std::string &dirName)
+{
+    // Make sure the renames are stored on the disk too
+
+    int fd = open(dirName.c_str(), O_RDONLY);
+    if (fd < 0) return;
+
+    fsync(fd);
+    close(fd);
+}
+
+void writeFile(const std::string &fileNamePath, const uint8_t *data, size_t size)
+{
+    if (!writeTempFile(fileNamePath, data, size))
+    {
+        unlink((fileNamePath + STR_TMP).c_str());
+        ERROR(std::string("unable to write file '") + fileNamePath + "'");
+    }
+
+    commitTempFile(fileNamePath);
+}
+
+//
+// Release output - every file (images, diffs, patches, reports, manifest) is staged
+// first, then all of them are written to temporary files in parallel; the previous
+// release is only replaced once every temporary file is safely stored on the disk
+//
+
+const std::string STR_OLD = ".old";
+
+typedef struct
+{
+    std::string          fileNamePath;
+    std::vector<uint8_t> content;
+    bool                 tempSaved;
+    bool                 hasBackup;     // previous version hard-linked under the '.old' name
+    bool                 committed;
+} StagedFile;
+
+std::list<StagedFile> GLOBAL_stagedFiles;
+
+void stageFile(const std::string &fileNamePath, const uint8_t *data, size_t size)
+{
+    GLOBAL_stagedFiles.push_back({ fileNamePath, std::vector<uint8_t>(data, data + size), false, false, false });
+}
+
+void rollbackStagedFiles()
+{
+    // Put back the previous versions of already replaced files, drop everything else
+
+    for (auto &file : GLOBAL_stagedFiles)
+    {
+        if (file.committed)
+        {
+            if (file.hasBackup) rename((file.fileNamePath + STR_OLD).c_str(), file.fileNamePath.c_str());
+            else                unlink(file.fileNamePath.c_str());
+        }
+        else
+        {
+            if (file.hasBackup) unlink((file.fileNamePath + STR_OLD).c_str());
+            unlink((file.fileNamePath + STR_TMP).c_str());
+        }
+    }
+}
+
+void writeStagedFiles()
+{
+    // Write all the temporary files in parallel
+
+    std::vector<std::thread> workers;
+    for (auto &file : GLOBAL_stagedFiles)
+    {
+        workers.emplace_back([&file]()
+        {
+            file.tempSaved = writeTempFile(file.fileNamePath, file.content.data(), file.content.size());
+        });
+    }
+    for (auto &worker : workers) worker.join();
+
+    for (auto &file : GLOBAL_stagedFiles)
+    {
+        if (file.tempSaved) continue;
+
+        rollbackStagedFiles();
+        ERROR(std::string("unable to write file '") + file.fileNamePath + "'");
+    }
+
+    // Keep the previous versions under a second name, so that a failed rename
+    // can still be undone - a release is either fully replaced or not at all
+
+    for (auto &file : GLOBAL_stagedFiles)
+    {
+        const std::string backupPath = file.fileNamePath + STR_OLD;
+
+        unlink(backupPath.c_str());
+        if (link(file.fileNamePath.c_str(), backupPath.c_str()) == 0)
+        {
+            file.hasBackup = true;
+        }
+        else if (errno != ENOENT)
+        {
+            rollbackStagedFiles();
+            ERROR(std::string("unable to back up file '") + file.fileNamePath + "'");
+        }
+    }
+
+    // Replace the files, in the staging order - manifest is expected to be the last one
+
+    for (auto &file : GLOBAL_stagedFiles)
+    {
+        if (rename((file.fileNamePath + STR_TMP).c_str(), file.fileNamePath.c_str()) != 0)
+        {
+            rollbackStagedFiles();
+            ERROR(std::string("unable to write file '") + file.fileNamePath + "'");
+        }
+
+        file.committed = true;
+    }
+
+    std::list<std::string> dirNames;
+    for (auto &file : GLOBAL_stagedFiles)
+    {
+        const std::string dirName = file.fileNamePath.substr(0, file.fileNamePath.rfind(DIR_SEPARATOR));
+        if (std::find(dirNames.begin(), dirNames.end(), dirName) == dirNames.end()) dirNames.push_back(dirName);
+    }
+    for (auto &dirName : dirNames) syncDirectory(dirName);
+
+    for (auto &file : GLOBAL_stagedFiles)
+    {
+        if (file.hasBackup) unlink((file.fileNamePath + STR_OLD).c_str());
+    }
+
+    GLOBAL_stagedFiles.clear();
 }
 
 //
 // Class definitions
 //
 
+class MappedFile
+{
+public:
+
+    // Private, copy-on-write mapping - content can be modified in memory
+    // without touching the file on disk
+
+    MappedFile() : ptr(nullptr), len(0) {}
+    ~MappedFile() { clear(); }
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    bool open(const std::string &fileNamePath);
+    void clear();
+
+    bool    empty() const { return len == 0; }
+    size_t  size()  const { return len; }
+    uint8_t *data()       { return ptr; }
+
+    uint8_t &operator[](size_t idx) { return ptr[idx]; }
+
+private:
+
+    uint8_t *ptr;
+    size_t   len;
+};
+
 class ROMFile
 {
 public:
@@ -118,7 +505,11 @@ public:
     ROMFile(const std::string &baseFileName);
 
     void embedRevisionStr(const std::string &newRevisionStr, const std::string &newRevisionStrDOS);
-    void save();
+    void save();        // only stages the files, see 'writeStagedFiles'
+
+    std::string manifestEntry(const std::string &revisionStr, size_t fileNameWidth) const;
+
+    const std::string &getFileName() const { return baseFileName; }
 
     const ROMTypeDescriptionEntry *descPtr;
 
@@ -136,10 +527,18 @@ private:
     void dropUnmatchingDst();
     void analyzeContent();
 
+    void saveDiff();
+    void savePatch();
+
     std::string baseFileName;
 
-    std::vector<uint8_t> srcFileContent;
-    std::vector<uint8_t> dstFileContent;
+    MappedFile srcFileContent;
+    MappedFile dstFileContent;
+
+    RangeList  comparedRanges;  // file areas outside of the revision strings
+    RangeList  changedRanges;
+
+    Hash       hash;            // of the released image
 };
 
 //
@@ -159,12 +558,15 @@ void parseCommandLine(int argc, char **argv)
 
     // Retrieve command line options
 
-    while ((opt = getopt(argc, argv, "i:o:")) != -1)
+    while ((opt = getopt(argc, argv, "i:o:d:a:s:")) != -1)
     {
         switch(opt)
         {
             case 'i': CMD_inDir    = optarg; break;
             case 'o': CMD_outDir   = optarg; break;
+            case 'd': CMD_diffDir  = optarg; break;
+            case 'a': CMD_patch    = optarg; break;
+            case 's': CMD_symDirList.push_back(optarg); break;
             default: printUsage(); ERROR();
         }
     }
@@ -177,6 +579,9 @@ void parseCommandLine(int argc, char **argv)
     }
 
     if (CMD_fileList.empty()) { printUsage(); ERROR("empty file list"); }
+    if (!CMD_patch.empty() && CMD_fileList.size() > 2) { printUsage(); ERROR("too many files for patch mode"); }
+
+    if (CMD_diffDir.empty()) CMD_diffDir = CMD_inDir;
 }
 
 void getDeveloperId()
@@ -236,7 +641,7 @@ void printBanner()
 
 void readFiles()
 {
-    for (auto &fileName : CMD_fileList) GLOBAL_ROMFiles.push_back(ROMFile(fileName));
+    for (auto &fileName : CMD_fileList) GLOBAL_ROMFiles.emplace_back(fileName);
 }
 
 void decideIfUpdate()
@@ -266,6 +671,225 @@ void decideIfUpdate()
     }
 }
 
+RoutineMap readSymbolDir(const std::string &symDir)
+{
+    // Retrieve routine addresses and sizes from all the '*_combined.sym' files within the directory
+
+    RoutineMap routines;
+
+    std::string target = symDir;
+    while (target.length() > 1 && target.back() == DIR_SEPARATOR[0]) target.pop_back();
+    target = target.substr(target.rfind(DIR_SEPARATOR[0]) + 1);
+
+    DIR *dirHandle = opendir(symDir.c_str());
+    if (!dirHandle) ERROR(std::string("unable to open directory '") + symDir + "'");
+
+    struct dirent *dirEntry;
+    while ((dirEntry = readdir(dirHandle)) != nullptr)
+    {
+        const std::string fileName = dirEntry->d_name;
+
+        if (fileName.length() <= STR_SYM.length()) continue;
+        if (fileName.substr(fileName.length() - STR_SYM.length()) != STR_SYM) continue;
+
+        const std::string segment = fileName.substr(0, fileName.length() - STR_SYM.length());
+
+        std::ifstream symFile;
+        symFile.open(symDir + DIR_SEPARATOR + fileName);
+        if (!symFile.good()) ERROR(std::string("unable to open symbol file '") + fileName + "'");
+
+        std::map<std::string, uint32_t> routineStarts, routineEnds;
+
+        std::string line;
+        while (std::getline(symFile, line))
+        {
+            // Lines are in the form: '<label> = $<address>', possibly followed by a comment
+
+            auto eqPos  = line.find('=');
+            auto hexPos = line.find('$');
+            if (eqPos == std::string::npos || hexPos == std::string::npos || hexPos < eqPos) continue;
+
+            std::istringstream labelStream(line.substr(0, eqPos));
+            std::string label;
+            labelStream >> label;
+
+            const uint32_t address = strtoul(line.c_str() + hexPos + 1, nullptr, 16);
+
+            if (0 == label.compare(0, LAB_START.size(), LAB_START))
+            {
+                routineStarts[label.substr(LAB_START.size())] = address;
+            }
+            else if (0 == label.compare(0, LAB_END.size(), LAB_END))
+            {
+                routineEnds[label.substr(LAB_END.size())] = address;
+            }
+        }
+
+        symFile.close();
+
+        for (auto &routineStart : routineStarts)
+        {
+            auto routineEnd = routineEnds.find(routineStart.first);
+            if (routineEnd == routineEnds.end() || routineEnd->second < routineStart.second) continue;
+
+            std::string routine = routineStart.first;
+            if (routine.length() > 2 && routine.substr(routine.length() - 2) == "_s") routine.resize(routine.length() - 2);
+
+            routines[target + " " + segment + " " + routine] =
+                { routineStart.second, routineEnd->second - routineStart.second };
+        }
+    }
+
+    closedir(dirHandle);
+
+    return routines;
+}
+
+RoutineMap readRoutineList(const std::string &fileNamePath)
+{
+    // Retrieve routine list stored with the previous release, if any
+
+    RoutineMap routines;
+
+    std::ifstream inFile;
+    inFile.open(fileNamePath);
+    if (!inFile.good()) return routines;
+
+    std::string line;
+    while (std::getline(inFile, line))
+    {
+        if (line.empty() || line.front() == '#') continue;
+
+        std::istringstream lineStream(line);
+        std::string target, segment, routine, address;
+        uint32_t size;
+
+        if (!(lineStream >> target >> segment >> routine >> address >> size) || address.front() != '$') continue;
+
+        routines[target + " " + segment + " " + routine] = { uint32_t(strtoul(address.c_str() + 1, nullptr, 16)), size };
+    }
+
+    return routines;
+}
+
+void saveRoutineReport(const std::string &newRevStr)
+{
+    const std::string routineListPath = CMD_outDir + DIR_SEPARATOR + STR_ROUTINES;
+
+    RoutineMap oldRoutines = readRoutineList(routineListPath);
+    RoutineMap newRoutines;
+
+    for (auto &symDir : CMD_symDirList)
+    {
+        auto dirRoutines = readSymbolDir(symDir);
+        newRoutines.insert(dirRoutines.begin(), dirRoutines.end());
+    }
+
+    if (newRoutines.empty()) ERROR("no routine symbols found in the symbol directories");
+
+    auto formatLine = [](const char *format, auto... args) -> std::string
+    {
+        char buf[256];
+        snprintf(buf, sizeof(buf), format, args...);
+        return buf;
+    };
+
+    // Store the routine list for the next release
+
+    std::string routineList = "# Open ROMs release " + newRevStr + "\n" +
+                              "# target, segment, routine, address, size\n";
+    for (auto &routine : newRoutines)
+    {
+        routineList += routine.first + formatLine(" $%04X %u\n", routine.second.address, routine.second.size);
+    }
+
+    // Collect differences: added, removed, resized or moved routines
+
+    struct DeltaEntry
+    {
+        std::string        name;
+        const RoutineInfo *oldInfo;
+        const RoutineInfo *newInfo;
+        int32_t            sizeDelta;
+    };
+
+    std::vector<DeltaEntry> deltas;
+    std::map<std::string, int32_t> segmentDeltas;
+
+    for (auto &routine : newRoutines)
+    {
+        auto oldRoutine = oldRoutines.find(routine.first);
+        const RoutineInfo *oldInfo = (oldRoutine == oldRoutines.end()) ? nullptr : &oldRoutine->second;
+
+        if (oldInfo != nullptr && oldInfo->address == routine.second.address && oldInfo->size == routine.second.size) continue;
+
+        const int32_t sizeDelta = int32_t(routine.second.size) - (oldInfo ? int32_t(oldInfo->size) : 0);
+        deltas.push_back({ routine.first, oldInfo, &routine.second, sizeDelta });
+    }
+
+    for (auto &routine : oldRoutines)
+    {
+        if (newRoutines.count(routine.first) != 0) continue;
+        deltas.push_back({ routine.first, &routine.second, nullptr, -int32_t(routine.second.size) });
+    }
+
+    for (auto &delta : deltas)
+    {
+        segmentDeltas[delta.name.substr(0, delta.name.rfind(' '))] += delta.sizeDelta;
+    }
+
+    // Biggest size changes first, then moved routines
+
+    std::stable_sort(deltas.begin(), deltas.end(), [](const DeltaEntry &a, const DeltaEntry &b) -> bool
+    {
+        return std::abs(a.sizeDelta) > std::abs(b.sizeDelta);
+    });
+
+    std::string report = "# Routine changes for release " + newRevStr + "\n" +
+                         formatLine("# %-60s %-8s %-8s %8s %8s %8s\n",
+                                    "target, segment, routine", "old addr", "new addr", "old size", "new size", "delta");
+    for (auto &delta : deltas)
+    {
+        const std::string oldAddr = delta.oldInfo ? formatLine("$%04X", delta.oldInfo->address) : "-";
+        const std::string newAddr = delta.newInfo ? formatLine("$%04X", delta.newInfo->address) : "-";
+        const std::string oldSize = delta.oldInfo ? std::to_string(delta.oldInfo->size) : "-";
+        const std::string newSize = delta.newInfo ? std::to_string(delta.newInfo->size) : "-";
+
+        report += formatLine("  %-60s %-8s %-8s %8s %8s %+8d\n", delta.name.c_str(),
+                             oldAddr.c_str(), newAddr.c_str(), oldSize.c_str(), newSize.c_str(), delta.sizeDelta);
+    }
+
+    stageFile(CMD_diffDir + DIR_SEPARATOR + STR_RDELTA, (const uint8_t *) report.data(), report.size());
+    stageFile(routineListPath, (const uint8_t *) routineList.data(), routineList.size());
+
+    // Print out a summary
+
+    std::cout << "\n";
+
+    if (oldRoutines.empty())
+    {
+        std::cout << "No routine list from the previous release, size report skipped.\n";
+        return;
+    }
+
+    std::cout << "Code size changes per segment:\n\n";
+    for (auto &segmentDelta : segmentDeltas)
+    {
+        if (segmentDelta.second == 0) continue;
+        std::cout << formatLine("    %-40s %+6d\n", segmentDelta.first.c_str(), segmentDelta.second);
+    }
+
+    const size_t MAX_PRINTED = 16;
+
+    std::cout << "\nBiggest routine size changes:\n\n";
+    for (size_t idx = 0; idx < deltas.size() && idx < MAX_PRINTED && deltas[idx].sizeDelta != 0; idx++)
+    {
+        std::cout << formatLine("    %-60s %+6d\n", deltas[idx].name.c_str(), deltas[idx].sizeDelta);
+    }
+
+    std::cout << "\nFull report: " << CMD_diffDir + DIR_SEPARATOR + STR_RDELTA << "\n";
+}
+
 void saveFiles()
 {
     // Determine a daily revision sequence ID
@@ -297,12 +921,121 @@ void saveFiles()
 
     std::cout << "Files for release '" << newRevStr << "':\n\n";
 
-    // Save the files
+    // Stage the images, diffs and patches
 
     for (auto &file : GLOBAL_ROMFiles)
     {
         file.save();
     }
+
+    // Compare routine sizes and addresses with the previous release
+
+    if (!CMD_symDirList.empty()) saveRoutineReport(newRevStr);
+
+    // Write the manifest - for deploy tools, to verify images without reading them
+
+    std::string manifest = "# Open ROMs release " + newRevStr + "\n" +
+                           "# file, size, SHA-256, revision\n";
+    for (auto &file : GLOBAL_ROMFiles)
+    {
+        manifest += file.manifestEntry(newRevStr, GLOBAL_maxFileNameLen);
+    }
+
+    stageFile(CMD_outDir + DIR_SEPARATOR + STR_MANIFEST, (const uint8_t *) manifest.data(), manifest.size());
+
+    // Nothing was touched so far - now write everything
+
+    writeStagedFiles();
+}
+
+//
+// Patch mode
+//
+
+void applyPatch()
+{
+    printBannerLineTop();
+    std::cout << "// Applying ROM patch" << "\n";
+    printBannerLineBottom();
+
+    // Read the patch file
+
+    std::ifstream patchFile;
+    patchFile.open(CMD_patch, std::ios::in | std::ios::binary | std::ios::ate);
+
+    if (!patchFile.good()) ERROR(std::string("unable to open patch file '") + CMD_patch + "'");
+
+    std::vector<uint8_t> patchContent(patchFile.tellg());
+    patchFile.seekg(0, patchFile.beg);
+    patchFile.read((char *) patchContent.data(), patchContent.size());
+
+    if (!patchFile.good()) ERROR(std::string("unable to read patch file '") + CMD_patch + "'");
+    patchFile.close();
+
+    if (patchContent.size() < 4 || memcmp(patchContent.data(), "ORPT", 4) != 0)
+    {
+        ERROR(std::string("'") + CMD_patch + "' is not a ROM patch file");
+    }
+
+    size_t offset = 4;
+    const uint32_t fileSize = fetchU32(patchContent, offset);
+
+    if (offset + 2 * sizeof(Hash) > patchContent.size()) ERROR("malformed patch file");
+
+    Hash oldHash, newHash;
+    memcpy(oldHash.data(), &patchContent[offset], sizeof(Hash)); offset += sizeof(Hash);
+    memcpy(newHash.data(), &patchContent[offset], sizeof(Hash)); offset += sizeof(Hash);
+
+    // Check the previous image
+
+    const std::string &oldFileNamePath = CMD_fileList.front();
+
+    MappedFile oldFile;
+    if (!oldFile.open(oldFileNamePath)) ERROR(std::string("unable to read ROM file '") + oldFileNamePath + "'");
+
+    if (oldFile.size() != fileSize ||
+        computeHash(oldFile.data(), oldFile.size()) != oldHash)
+    {
+        ERROR(std::string("patch does not apply to '") + oldFileNamePath + "'");
+    }
+
+    // Apply the patch records
+
+    std::vector<uint8_t> newContent(oldFile.data(), oldFile.data() + oldFile.size());
+
+    const uint32_t numRecords = fetchU32(patchContent, offset);
+    for (uint32_t idx = 0; idx < numRecords; idx++)
+    {
+        const uint32_t start  = fetchU32(patchContent, offset);
+        const uint32_t length = fetchU32(patchContent, offset);
+
+        if (start > fileSize || length > fileSize - start || length > patchContent.size() - offset)
+        {
+            ERROR("malformed patch file");
+        }
+
+        memcpy(&newContent[start], &patchContent[offset], length);
+        offset += length;
+    }
+
+    if (offset != patchContent.size()) ERROR("malformed patch file");
+
+    // Verify the result
+
+    if (computeHash(newContent.data(), newContent.size()) != newHash)
+    {
+        ERROR("hash mismatch after applying the patch");
+    }
+
+    std::cout << "    " << numRecords << " record(s) applied, result verified, SHA-256 " << hashToString(newHash) << "\n";
+
+    if (CMD_fileList.size() > 1)
+    {
+        writeFile(CMD_fileList.back(), newContent.data(), newContent.size());
+        std::cout << "    written to '" << CMD_fileList.back() << "'\n";
+    }
+
+    std::cout << "\n";
 }
 
 //
@@ -312,6 +1045,13 @@ void saveFiles()
 int main(int argc, char **argv)
 {
     parseCommandLine(argc, argv);
+
+    if (!CMD_patch.empty())
+    {
+        applyPatch();
+        return 0;
+    }
+
     getDeveloperId();
     getDate();
 
@@ -326,6 +1066,43 @@ int main(int argc, char **argv)
     return 0;
 }
 
+//
+// Class 'MappedFile'
+//
+
+bool MappedFile::open(const std::string &fileNamePath)
+{
+    clear();
+
+    int fd = ::open(fileNamePath.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0 || uint64_t(st.st_size) > MAX_FILE_SIZE)
+    {
+        close(fd);
+        return false;
+    }
+
+    void *mapped = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (mapped == MAP_FAILED) return false;
+
+    ptr = (uint8_t *) mapped;
+    len = st.st_size;
+
+    return true;
+}
+
+void MappedFile::clear()
+{
+    if (ptr != nullptr) munmap(ptr, len);
+
+    ptr = nullptr;
+    len = 0;
+}
+
 //
 // Class 'ROMFile'
 //
@@ -354,29 +1131,23 @@ void ROMFile::readSrcFile()
 
     const std::string srcFileNamePath = CMD_inDir + DIR_SEPARATOR + baseFileName;
 
-    std::ifstream srcFile;
-    srcFile.open(srcFileNamePath, std::ios::in | std::ios::binary | std::ios::ate);
-
-    if (!srcFile.good()) ERROR(std::string("unable to open ROM file '") + srcFileNamePath + "'");
-
-    auto srcSize = srcFile.tellg();
-    if (srcSize > MAX_FILE_SIZE) ERROR(std::string("incorrect size of ROM file '") + srcFileNamePath + "'");
-
-    srcFileContent.resize(srcSize);
-    srcFile.seekg (0, srcFile.beg);
-    srcFile.read((char *) srcFileContent.data(), srcFileContent.size());
+    struct stat st;
+    if (stat(srcFileNamePath.c_str(), &st) != 0) ERROR(std::string("unable to open ROM file '") + srcFileNamePath + "'");
+    if (st.st_size <= 0 || uint64_t(st.st_size) > MAX_FILE_SIZE)
+    {
+        ERROR(std::string("incorrect size of ROM file '") + srcFileNamePath + "'");
+    }
 
-    if (!srcFile.good()) ERROR(std::string("unable to read ROM file '") + srcFileNamePath + "'");
-    srcFile.close();   
+    if (!srcFileContent.open(srcFileNamePath)) ERROR(std::string("unable to read ROM file '") + srcFileNamePath + "'");
 
     // Check if it is OK to distribute the file
 
-    for (size_t idx = 0; idx < srcFileContent.size() - STR_BLOCK.size(); idx++)
+    const uint8_t *begin = srcFileContent.data();
+    const uint8_t *end   = begin + srcFileContent.size();
+
+    if (std::search(begin, end, STR_BLOCK.begin(), STR_BLOCK.end()) != end)
     {
-        if (memcmp(&srcFileContent[idx], STR_BLOCK.c_str(), STR_BLOCK.size()) == 0)
-        {
-            ERROR(std::string("not allowed to distribute ROM file '") + srcFileNamePath + "'");
-        }
+        ERROR(std::string("not allowed to distribute ROM file '") + srcFileNamePath + "'");
     }
 }
 
@@ -386,22 +1157,10 @@ void ROMFile::readDstFile()
 
     const std::string dstFileNamePath = CMD_outDir + DIR_SEPARATOR + baseFileName;
 
-    std::ifstream dstFile;
-    dstFile.open(dstFileNamePath, std::ios::in | std::ios::binary | std::ios::ate);
-
-    bool continueReading = dstFile.good();
-
-    if (continueReading && dstFile.tellg() != unsigned(srcFileContent.size())) continueReading = false;
-
-    if (continueReading)
+    if (dstFileContent.open(dstFileNamePath) && dstFileContent.size() != srcFileContent.size())
     {
-        dstFileContent.resize(srcFileContent.size());
-        dstFile.seekg (0, dstFile.beg);
-        dstFile.read((char *) dstFileContent.data(), dstFileContent.size());       
+        dstFileContent.clear();
     }
-
-    if (!dstFile.good()) dstFileContent.clear();
-    dstFile.close();
 }
 
 void ROMFile::recognizeSrcFile()
@@ -532,6 +1291,23 @@ void ROMFile::analyzeContent()
         return;
     }
 
+    // Determine file areas which are not part of the revision strings
+
+    std::vector<size_t> maskStarts;
+    for (auto revOffset : { revOffset1, revOffset2, revOffset3 })
+    {
+        if (revOffset != 0) maskStarts.push_back(revOffset);
+    }
+    std::sort(maskStarts.begin(), maskStarts.end());
+
+    size_t rangeStart = 0;
+    for (auto maskStart : maskStarts)
+    {
+        if (maskStart > rangeStart) comparedRanges.emplace_back(rangeStart, maskStart - rangeStart);
+        rangeStart = std::max(rangeStart, maskStart + 0x10);
+    }
+    if (rangeStart < descPtr->fileSize) comparedRanges.emplace_back(rangeStart, descPtr->fileSize - rangeStart);
+
     if (dstFileContent.empty())
     {
         return;
@@ -548,24 +1324,9 @@ void ROMFile::analyzeContent()
     // Check if meaningful file content is really different
 
     sameContent = true;
-    for (uint32_t idx = 0; idx < descPtr->fileSize; idx++)
+    for (auto &range : comparedRanges)
     {
-        if (revOffset1 != 0 && idx - revOffset1 < 0x10)
-        {
-            continue;
-        }
-
-        if (revOffset2 != 0 && idx - revOffset2 < 0x10)
-        {
-            continue;
-        }
-
-        if (revOffset3 != 0 && idx - revOffset3 < 0x10)
-        {
-            continue;
-        }
-
-        if (srcFileContent[idx] != dstFileContent[idx])
+        if (memcmp(&srcFileContent[range.first], &dstFileContent[range.first], range.second) != 0)
         {
             sameContent = false;
             break;
@@ -665,15 +1426,115 @@ void ROMFile::save()
         std::cout << spacing << "(unchanged)";
     }
 
+    // Describe the changes since the previous release
+
+    if (!dstFileContent.empty() && !sameContent)
+    {
+        changedRanges = findChangedRanges(srcFileContent.data(), dstFileContent.data(), comparedRanges);
+        saveDiff();
+
+        const size_t MAX_PRINTED = 8;
+
+        std::cout << "\n        changed ranges:";
+        for (size_t idx = 0; idx < changedRanges.size() && idx < MAX_PRINTED; idx++)
+        {
+            char buf[32];
+            auto &range = changedRanges[idx];
+            if (range.second == 1)
+            {
+                snprintf(buf, sizeof(buf), " $%05X", range.first);
+            }
+            else
+            {
+                snprintf(buf, sizeof(buf), " $%05X-$%05X", range.first, range.first + range.second - 1);
+            }
+            std::cout << buf;
+        }
+        if (changedRanges.size() > MAX_PRINTED) std::cout << " ... (" << changedRanges.size() << " in total)";
+    }
+
+    // Delta against the previous release, for updating over slow links
+
+    if (!dstFileContent.empty())
+    {
+        savePatch();
+    }
+
     std::cout << "\n";
 
-    std::ofstream outFile;
-    outFile.open(outFileNamePath, std::ios::out | std::ios::binary | std::ios::trunc);
+    // The previous release will be overwritten - drop the mapping first
 
-    if (!outFile.good()) ERROR(std::string("unable to open output file '") + outFileNamePath + "'");
+    dstFileContent.clear();
+
+    // The image itself
+
+    hash = computeHash(srcFileContent.data(), srcFileContent.size());
+    stageFile(outFileNamePath, srcFileContent.data(), srcFileContent.size());
+}
+
+std::string ROMFile::manifestEntry(const std::string &revisionStr, size_t fileNameWidth) const
+{
+    std::string spacing;
+    spacing.resize(fileNameWidth + 4 - baseFileName.length(), ' ');
+
+    std::string sizeStr = std::to_string(srcFileContent.size());
+    sizeStr.resize(std::max(sizeStr.length(), size_t(8)), ' ');
+
+    return baseFileName + spacing + sizeStr + hashToString(hash) + "    " + revisionStr + "\n";
+}
+
+void ROMFile::saveDiff()
+{
+    // Binary diff format, all numbers are 32-bit little endian:
+    // 'ORDF', file size, number of ranges, then (start, length) for each changed range
+
+    const std::string diffFileNamePath = CMD_diffDir + DIR_SEPARATOR + baseFileName + ".diff";
+
+    std::vector<uint8_t> diffContent = { 'O', 'R', 'D', 'F' };
+
+    appendU32(diffContent, srcFileContent.size());
+    appendU32(diffContent, changedRanges.size());
+    for (auto &range : changedRanges)
+    {
+        appendU32(diffContent, range.first);
+        appendU32(diffContent, range.second);
+    }
+
+    stageFile(diffFileNamePath, diffContent.data(), diffContent.size());
+}
+
+void ROMFile::savePatch()
+{
+    // Patch format, all numbers are 32-bit little endian:
+    // 'ORPT', file size, SHA-256 of the previous image, SHA-256 of the new image,
+    // number of records, then (start, length, new content) for each record
+
+    const std::string patchFileNamePath = CMD_diffDir + DIR_SEPARATOR + baseFileName + ".patch";
+
+    // Record header takes 8 bytes - it is cheaper to resend a few unchanged bytes than to start a new record
+
+    const RangeList wholeFile = { { 0, srcFileContent.size() } };
+    const RangeList records   = findChangedRanges(srcFileContent.data(), dstFileContent.data(), wholeFile, 8);
+
+    const Hash dstHash = computeHash(dstFileContent.data(), dstFileContent.size());
+    const Hash srcHash = computeHash(srcFileContent.data(), srcFileContent.size());
+
+    std::vector<uint8_t> patchContent = { 'O', 'R', 'P', 'T' };
+
+    appendU32(patchContent, srcFileContent.size());
+    patchContent.insert(patchContent.end(), dstHash.begin(), dstHash.end());
+    patchContent.insert(patchContent.end(), srcHash.begin(), srcHash.end());
+    appendU32(patchContent, records.size());
+    for (auto &record : records)
+    {
+        appendU32(patchContent, record.first);
+        appendU32(patchContent, record.second);
+        patchContent.insert(patchContent.end(),
+                            srcFileContent.data() + record.first,
+                            srcFileContent.data() + record.first + record.second);
+    }
 
-    outFile.write((char *) srcFileContent.data(), srcFileContent.size());
+    stageFile(patchFileNamePath, patchContent.data(), patchContent.size());
 
-    if (!outFile.good()) ERROR(std::string("unable to write file '") + outFileNamePath + "'");
-    outFile.close();   
+    std::cout << "\n        patch: " << patchContent.size() << " bytes";
 }
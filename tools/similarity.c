@@ -3,6 +3,33 @@
   and report on the statistics of their lengths, and show the
   longer ones. Used to defend against copyright infringement
   claims.
+
+  Two matching engines are available:
+  - suffix   (default) - builds a generalised suffix array with LCP
+                         array over both files, and enumerates the
+                         maximal matches in near-linear time
+  - diagonal           - the original scan, which compares every
+                         offset of file 1 against every offset of
+                         file 2
+  Both report exactly the same matches, in the same order.
+
+  The 'diagonal' engine and the lookup of explanations run on all the
+  available CPUs, use 'threads=<n>' to change this; the report does not
+  depend on the number of threads.
+
+  The 'diagonal' engine compares 16 bytes at once if the CPU supports
+  SSE2, use 'kernel=scalar|sse2|avx2' to force the choice; 'benchmark'
+  directive measures all the supported kernels instead of printing
+  the report.
+
+  Batch mode, 'similarity batch <references> <targets>', indexes the
+  comma separated list of reference images once, then compares all the
+  target images against them, printing one combined report.
+
+  Explanations are loaded once, from the 'strings' directory by default
+  (skipped if there is none in the current directory); use 'whitelist=<directory or file>' to read them from elsewhere, for
+  instance from a single file with lines like:
+    A9008D2003 Clearing the border colour, trivial.
 */
 
 #include <stdio.h>
@@ -14,266 +41,1154 @@
 #include <sys/types.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <pthread.h>
+#include <dirent.h>
 
-#define MAX_SIZE 65536
-int matches[MAX_SIZE];
+#include "cpu_opcodes.h"
+#include <time.h>
 
-int phase_mask[MAX_SIZE+MAX_SIZE];
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_X86_KERNELS
+#endif
 
-int main(int argc,char **argv)
+// Shortest match worth reporting
+#define MIN_MATCH 3
+
+int verbose=0;
+int threads=1;
+
+unsigned char *f1,*f2;
+int s1,s2;
+
+int *matches;
+
+// Number of identical bytes starting at the given offset of file 1
+int *same_run;
+
+typedef struct match {
+  int i,j,k;
+  const char *explanation; // NULL if the match is unexplained
+} match;
+
+typedef struct match_list {
+  match *items;
+  int count,size;
+} match_list;
+
+unsigned char *map_file(const char *name,int *size)
+{
+  struct stat st;
+  int fd;
+  unsigned char *f;
+
+  fd = open(name, O_RDONLY, 0);
+  if (fd==-1) {
+    fprintf(stderr,"Could not read '%s'\n",name);
+    exit(-1);
+  }
+  stat(name, &st);
+  *size=st.st_size;
+  f = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+  if (f == MAP_FAILED) {
+    fprintf(stderr,"Could not mmap '%s'\n",name);
+    exit(-1);
+  }
+  close(fd);
+  return f;
+}
+
+// Opcode classes used to recognise trivial matches
+#define FRAG_BRANCH   0x01    // 8-bit relative branch
+#define FRAG_COMMON   0x02    // very common 2-byte instruction
+#define FRAG_LOAD_IMM 0x04    // loading register with immediate value
+#define FRAG_STORE    0x08    // storing register, zero page or absolute
+
+unsigned char fragment_flags[256];
+
+int has_mnemonic(const cpu_opcode *opcode,const char *mnemonics)
+{
+  // 'mnemonics' is a space separated list
+  const char *found=strstr(mnemonics,opcode->mnemonic);
+  return found&&strlen(opcode->mnemonic)==3&&(found[3]==' '||!found[3]);
+}
+
+void init_fragment_flags(void)
+{
+  // Classify opcodes of both the 6502 and 45GS02, undocumented 6502 opcodes
+  // are not used in any of the ROMs, so they are not considered
+
+  for(int op=0;op<256;op++) {
+    const cpu_opcode *cpus[2]={ &CPU_OPCODES_6502[op], &CPU_OPCODES_45GS02[op] };
+    fragment_flags[op]=0;
+    for(int c=0;c<2;c++) {
+      const cpu_opcode *opcode=cpus[c];
+      if (opcode->undocumented) continue;
+      if (opcode->mode==CPU_MODE_REL) fragment_flags[op]|=FRAG_BRANCH;
+      if (opcode->mode==CPU_MODE_IMM&&has_mnemonic(opcode,"LDA LDX LDY ADC CMP")) fragment_flags[op]|=FRAG_COMMON;
+      if (opcode->mode==CPU_MODE_ZP&&has_mnemonic(opcode,"LDA STA")) fragment_flags[op]|=FRAG_COMMON;
+      if (opcode->mode==CPU_MODE_IZY&&has_mnemonic(opcode,"STA")) fragment_flags[op]|=FRAG_COMMON;
+      if (opcode->mode==CPU_MODE_IMM&&has_mnemonic(opcode,"LDA LDX LDY LDZ")) fragment_flags[op]|=FRAG_LOAD_IMM;
+      if ((opcode->mode==CPU_MODE_ZP||opcode->mode==CPU_MODE_ABS)&&has_mnemonic(opcode,"STA STX STY STZ")) fragment_flags[op]|=FRAG_STORE;
+    }
+  }
+}
+
+int is_single_instruction(const unsigned char *m,int k)
+{
+  if (!CPU_OPCODES_6502[m[0]].undocumented&&cpu_6502_length(m,k)==k) return 1;
+  return cpu_45gs02_length(m,k)==k;
+}
+
+int is_common_fragment(int i,int k)
+{
+  const unsigned char *m=&f1[i];
+
+  // Ignore matches that are all the same byte
+  if (same_run[i]>=k) return 1;
+
+  // A single CPU instruction can't be copyrighted, whatever its length
+  if (is_single_instruction(m,k)) return 1;
+
+  // LDA #$xx / STA $nn, LDX #$xx / STX $nnnn, etc.
+  if (k>2&&(fragment_flags[m[0]]&FRAG_LOAD_IMM)&&
+      (fragment_flags[m[2]]&FRAG_STORE)&&is_single_instruction(&m[2],k-2)) return 1;
+
+  if (k==3) {
+    // Branch followed by any opcode, any single byte followed
+    // by a branch, or any 2-byte opcode followed by a branch
+    if ((fragment_flags[m[0]]|fragment_flags[m[1]]|fragment_flags[m[2]])&FRAG_BRANCH) return 1;
+
+    // Common 2-byte instructions followed by any single byte are
+    // very common and not copyrightable; similarly for random byte
+    // before such instructions
+    if ((fragment_flags[m[0]]|fragment_flags[m[1]])&FRAG_COMMON) return 1;
+  }
+  return 0;
+}
+
+//
+// Whitelist - explanations of the matches, either a directory with one
+// file per byte sequence (named by the sequence in hex, first line
+// is the explanation), or a single file with '<hex> <explanation>' lines
+//
+
+typedef struct whitelist_entry {
+  unsigned char *bytes;
+  int len;
+  char *explanation;
+} whitelist_entry;
+
+whitelist_entry *whitelist;
+int whitelist_size;     // always a power of 2
+int whitelist_count;
+
+unsigned int hash_bytes(const unsigned char *bytes,int len)
+{
+  // FNV-1a
+  unsigned int hash=2166136261u;
+  for(int b=0;b<len;b++) {
+    hash^=bytes[b];
+    hash*=16777619u;
+  }
+  return hash;
+}
+
+int parse_hex(const char *hex,int hex_len,unsigned char *bytes)
 {
-  int verbose=0;
-  
-  if (argc<3) {
-    fprintf(stderr,"usage: similarity <file1> <file2> [verbose]\n");
+  // Returns number of bytes, or -1 if not a valid sequence
+  if (!hex_len||(hex_len&1)) return -1;
+  for(int c=0;c<hex_len;c++) {
+    if (!strchr("0123456789ABCDEF",hex[c])||!hex[c]) return -1;
+    int nibble=(hex[c]<='9')?hex[c]-'0':hex[c]-'A'+10;
+    if (c&1) bytes[c/2]|=nibble; else bytes[c/2]=nibble<<4;
+  }
+  return hex_len/2;
+}
+
+void whitelist_add(const char *hex,int hex_len,const char *explanation)
+{
+  unsigned char *bytes=malloc(hex_len/2+1);
+  if (!bytes) {
+    fprintf(stderr,"Out of memory\n");
     exit(-1);
   }
-  if (argc==4) {
-    if (!strcmp(argv[3],"verbose")) verbose=1;
-    else {
-      fprintf(stderr,"Unrecognised directive.\n");
+  int len=parse_hex(hex,hex_len,bytes);
+  if (len<0) {
+    free(bytes);
+    return;
+  }
+
+  if (2*(whitelist_count+1)>whitelist_size) {
+    // Grow and rehash, keep the load factor below 1/2
+    whitelist_entry *old=whitelist;
+    int old_size=whitelist_size;
+    whitelist_size=whitelist_size?whitelist_size*2:1024;
+    whitelist=calloc(whitelist_size,sizeof(whitelist_entry));
+    if (!whitelist) {
+      fprintf(stderr,"Out of memory\n");
       exit(-1);
-    }    
+    }
+    for(int e=0;e<old_size;e++) {
+      if (!old[e].bytes) continue;
+      unsigned int slot=hash_bytes(old[e].bytes,old[e].len)&(whitelist_size-1);
+      while (whitelist[slot].bytes) slot=(slot+1)&(whitelist_size-1);
+      whitelist[slot]=old[e];
+    }
+    free(old);
   }
 
-  for(int i=0;i<MAX_SIZE;i++) matches[i]=0;
-  bzero(phase_mask,sizeof(phase_mask));
-  
-  unsigned char *f1,*f2;
-  int s1,s2;
-  struct stat st;
-  int fd;
+  unsigned int slot=hash_bytes(bytes,len)&(whitelist_size-1);
+  while (whitelist[slot].bytes) {
+    if (whitelist[slot].len==len&&!memcmp(whitelist[slot].bytes,bytes,len)) {
+      // Duplicate, first one wins
+      free(bytes);
+      return;
+    }
+    slot=(slot+1)&(whitelist_size-1);
+  }
+  whitelist[slot].bytes=bytes;
+  whitelist[slot].len=len;
+  whitelist[slot].explanation=strdup(explanation);
+  if (!whitelist[slot].explanation) {
+    fprintf(stderr,"Out of memory\n");
+    exit(-1);
+  }
+  whitelist_count++;
+}
 
-  fd = open(argv[1], O_RDONLY, 0);
-  if (fd==-1) {
-    fprintf(stderr,"Could not read '%s'\n",argv[1]);
+void strip_line_end(char *line)
+{
+  while (line[0]&&line[strlen(line)-1]=='\r') line[strlen(line)-1]=0;
+  while (line[0]&&line[strlen(line)-1]=='\n') line[strlen(line)-1]=0;
+}
+
+void load_whitelist_dir(const char *dir_name)
+{
+  DIR *dir=opendir(dir_name);
+  if (!dir) {
+    fprintf(stderr,"Could not read directory '%s'\n",dir_name);
     exit(-1);
   }
-  stat(argv[1], &st);
-  s1=st.st_size;
-  f1 = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
-  if (f1== MAP_FAILED) {
-    fprintf(stderr,"Could not mmap '%s'\n",argv[1]);
+
+  struct dirent *de;
+  while ((de=readdir(dir))!=NULL) {
+    unsigned char dummy[sizeof(de->d_name)];
+    if (parse_hex(de->d_name,strlen(de->d_name),dummy)<0) continue;
+
+    char file_name[1024];
+    snprintf(file_name,sizeof(file_name),"%s/%s",dir_name,de->d_name);
+    FILE *f=fopen(file_name,"r");
+    if (!f) continue;
+
+    // Get explanation why this match is irrelevant
+    char line[1024]; line[0]=0;
+    if (0 == fgets(line,1024,f)) fprintf(stderr,"Warning: no explanation in '%s'\n",file_name);
+    strip_line_end(line);
+    fclose(f);
+
+    whitelist_add(de->d_name,strlen(de->d_name),line);
+  }
+  closedir(dir);
+}
+
+void load_whitelist_file(const char *file_name)
+{
+  FILE *f=fopen(file_name,"r");
+  if (!f) {
+    fprintf(stderr,"Could not read '%s'\n",file_name);
     exit(-1);
   }
-  fd = open(argv[2], O_RDONLY, 0);
-  if (fd==-1) {
-    fprintf(stderr,"Could not read '%s'\n",argv[2]);
+
+  // Explanations longer than the buffer are truncated
+  char line[65536];
+  int line_no=0;
+  while (fgets(line,sizeof(line),f)) {
+    line_no++;
+    strip_line_end(line);
+    if (!line[0]||line[0]==';'||line[0]=='#') continue;
+
+    int hex_len=strcspn(line," \t");
+    char *explanation=&line[hex_len];
+    while (*explanation==' '||*explanation=='\t') explanation++;
+
+    unsigned char dummy[sizeof(line)/2];
+    if (parse_hex(line,hex_len,dummy)<0) {
+      fprintf(stderr,"Invalid byte sequence in '%s', line %d\n",file_name,line_no);
+      exit(-1);
+    }
+    whitelist_add(line,hex_len,explanation);
+  }
+  fclose(f);
+}
+
+// A missing default location just means no explanations; an explicitly
+// given one has to exist
+void load_whitelist(const char *name,int required)
+{
+  struct stat st;
+  if (stat(name,&st)) {
+    if (!required) return;
+    fprintf(stderr,"Could not read '%s'\n",name);
     exit(-1);
   }
-  stat(argv[2], &st);
-  s2=st.st_size;
-  f2 = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
-  if (f2 == MAP_FAILED) {
-    fprintf(stderr,"Could not mmap '%s'\n",argv[2]);
+  if (S_ISDIR(st.st_mode)) load_whitelist_dir(name); else load_whitelist_file(name);
+}
+
+const char *get_explanation(int i,int k)
+{
+  if (!whitelist_count) return NULL;
+
+  unsigned int slot=hash_bytes(&f1[i],k)&(whitelist_size-1);
+  while (whitelist[slot].bytes) {
+    if (whitelist[slot].len==k&&!memcmp(whitelist[slot].bytes,&f1[i],k)) return whitelist[slot].explanation;
+    slot=(slot+1)&(whitelist_size-1);
+  }
+  return NULL;
+}
+
+void add_match(match_list *list,int i,int j,int k)
+{
+  // Drop the common fragments early, self-similar areas produce lots of them
+  if (k<MIN_MATCH||is_common_fragment(i,k)) return;
+
+  if (list->count==list->size) {
+    list->size=list->size?list->size*2:1024;
+    list->items=realloc(list->items,list->size*sizeof(match));
+    if (!list->items) {
+      fprintf(stderr,"Out of memory\n");
+      exit(-1);
+    }
+  }
+  list->items[list->count].i=i;
+  list->items[list->count].j=j;
+  list->items[list->count].k=k;
+  list->items[list->count].explanation=NULL;
+  list->count++;
+}
+
+void run_threads(void *(*func)(void *),void *jobs,size_t job_size)
+{
+  // Runs 'func' once for each of the 'threads' jobs
+
+  if (threads==1) {
+    func(jobs);
+    return;
+  }
+
+  pthread_t *ids=malloc(threads*sizeof(pthread_t));
+  if (!ids) {
+    fprintf(stderr,"Out of memory\n");
     exit(-1);
   }
+  for(int t=0;t<threads;t++) {
+    if (pthread_create(&ids[t],NULL,func,(char *)jobs+t*job_size)) {
+      fprintf(stderr,"Could not create thread\n");
+      exit(-1);
+    }
+  }
+  for(int t=0;t<threads;t++) pthread_join(ids[t],NULL);
+  free(ids);
+}
 
-  fprintf(stderr,"Searching files for similarities...\n");
-  
-  for(int i=0;i<s1;i++) {
-    for(int j=0;j<s2;j++) {
-      int k,l;
+//
+// Kernels for the 'diagonal' engine - return the length of the run of
+// equal (or unequal) bytes, at most 'max'
+//
 
-      int phase=s2+i-j;
+typedef int (*run_length_func)(const unsigned char *a,const unsigned char *b,int max,int equal);
 
-      if (phase<0) {
-	fprintf(stderr,"Phase < 0 : %04x %04x -> %d\n",i,j,phase);
-	exit(-1);
-      }
+int run_length_scalar(const unsigned char *a,const unsigned char *b,int max,int equal)
+{
+  int k;
+  for(k=0;k<max;k++)
+    if ((a[k]==b[k])!=equal) break;
+  return k;
+}
 
-      if (phase>=(MAX_SIZE+MAX_SIZE)) {
-	fprintf(stderr,"Phase too large : %04x %04x -> %d\n",i,j,phase);
-	exit(-1);
-      }
-      
-      if (phase_mask[phase]) {
-	phase_mask[phase]--;
-	continue;
-      }
-      
-      for(k=0;((i+k)<s1)&&((j+k)<s2);k++)
-	if (f1[i+k]!=f2[j+k]) break;
+#ifdef HAVE_X86_KERNELS
+
+__attribute__((target("sse2")))
+int run_length_sse2(const unsigned char *a,const unsigned char *b,int max,int equal)
+{
+  const unsigned int flip=equal?0xFFFF:0;
+  int k;
+  for(k=0;k+16<=max;k+=16) {
+    __m128i va=_mm_loadu_si128((const __m128i *)&a[k]);
+    __m128i vb=_mm_loadu_si128((const __m128i *)&b[k]);
+    unsigned int mask=(unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(va,vb))^flip;
+    if (mask) return k+__builtin_ctz(mask);
+  }
+  return k+run_length_scalar(&a[k],&b[k],max-k,equal);
+}
+
+__attribute__((target("avx2")))
+int run_length_avx2(const unsigned char *a,const unsigned char *b,int max,int equal)
+{
+  const unsigned int flip=equal?0xFFFFFFFF:0;
+  int k;
+  for(k=0;k+32<=max;k+=32) {
+    __m256i va=_mm256_loadu_si256((const __m256i *)&a[k]);
+    __m256i vb=_mm256_loadu_si256((const __m256i *)&b[k]);
+    unsigned int mask=(unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(va,vb))^flip;
+    if (mask) return k+__builtin_ctz(mask);
+  }
+  if (k+16<=max) {
+    __m128i va=_mm_loadu_si128((const __m128i *)&a[k]);
+    __m128i vb=_mm_loadu_si128((const __m128i *)&b[k]);
+    unsigned int mask=((unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(va,vb))^flip)&0xFFFF;
+    if (mask) return k+__builtin_ctz(mask);
+    k+=16;
+  }
+  return k+run_length_scalar(&a[k],&b[k],max-k,equal);
+}
+
+#endif
+
+// AVX2 kernel is not selected automatically - runs in ROM images are short,
+// and on the real ROM pairs it was measured to be slower than SSE2
+typedef struct kernel {
+  const char *name;
+  run_length_func func;
+  int supported;
+  int automatic;
+} kernel;
+
+kernel kernels[]={
+  { "scalar", run_length_scalar, 1, 1 },
+#ifdef HAVE_X86_KERNELS
+  { "sse2",   run_length_sse2,   0, 1 },
+  { "avx2",   run_length_avx2,   0, 0 },
+#endif
+};
+
+#define KERNEL_COUNT ((int)(sizeof(kernels)/sizeof(kernels[0])))
+
+run_length_func run_length=run_length_scalar;
 
-      // When we find a match, we should then mask off this region,
+int select_kernel(const char *name)
+{
+  // Without name, selects the best supported kernel
+
+#ifdef HAVE_X86_KERNELS
+  __builtin_cpu_init();
+  kernels[1].supported=__builtin_cpu_supports("sse2");
+  kernels[2].supported=__builtin_cpu_supports("avx2");
+#endif
+
+  for(int n=KERNEL_COUNT-1;n>=0;n--) {
+    if (!kernels[n].supported) continue;
+    if (name&&strcmp(name,kernels[n].name)) continue;
+    if (!name&&!kernels[n].automatic) continue;
+    run_length=kernels[n].func;
+    return n;
+  }
+  return -1;
+}
+
+//
+// Engine 'diagonal' - compare every offset of file 1 with every offset of file 2
+//
+
+typedef struct diagonal_job {
+  int first;            // diagonals are interleaved between the threads
+  match_list found;
+} diagonal_job;
+
+void *search_diagonal_thread(void *arg)
+{
+  diagonal_job *job=arg;
+
+  // Diagonal 'd' compares offset i of file 1 with offset i-d of file 2
+
+  for(int d=job->first-(s2-1);d<s1;d+=threads) {
+    int i=(d>0)?d:0;
+    int j=i-d;
+    int len=(s1-i<s2-j)?s1-i:s2-j;
+    int n=0;
+    while (n<len) {
+      // Skip the mismatching bytes
+      n+=run_length(&f1[i+n],&f2[j+n],len-n,0);
+      if (n>=len) break;
+
+      int k=run_length(&f1[i+n],&f2[j+n],len-n,1);
+      add_match(&job->found,i+n,j+n,k);
+
+      // When we find a match, we should then skip this region,
       // so that we don't find all the sub-sets of the matches.
       // e.g. matching BASIC at $100 will result in a match of ASIC at $101
       // and SIC at $102 etc.  These are all the same match, so should be
       // suppressed.
-      phase_mask[phase]=k;
-      
-      // Ignore matches that are all the same byte
-      for(l=1;l<k;l++) if (f1[i+l]!=f1[i]) break;
-      if (l<k) {
-	// Ignore matches of no more than 3 bytes,
-	// since that is the max length of a 6502 instruction
-	int single_instruction=0;
-	if (k==5) {
-	  if (f1[i]==0xa9&&f1[i+2]==0x8d) break; // LDA #$xx / STA $nnnn
-	}
-	if (k==4) {
-	  if (f1[i]==0xa9&&f1[i+2]==0x85) break; // LDA #$xx / STA $nn
-	}
-	if (k==3) {
-	  // Reject some very common instruction fragments
-
-
-	  // Branch followed by any opcode
-	  if (f1[i]==0xd0) break;
-	  if (f1[i]==0xf0) break;
-	  if (f1[i]==0xb0) break;
-	  if (f1[i]==0x90) break;
-	  if (f1[i]==0x10) break;
-	  // Any single byte followed by a branch
-	  if (f1[i+1]==0xd0) break;
-	  if (f1[i+1]==0xf0) break;
-	  if (f1[i+1]==0xb0) break;
-	  if (f1[i+1]==0x90) break;
-	  if (f1[i+1]==0x10) break;
-	  // Any 2-byte opcode followed by a branch
-	  if (f1[i+2]==0xd0) break;
-	  if (f1[i+2]==0xf0) break;
-	  if (f1[i+2]==0xb0) break;
-	  if (f1[i+2]==0x90) break;
-	  if (f1[i+2]==0x10) break;
-
-	  
-	  // Common 2-byte instructions followed by
-	  // any single byte are very common and not
-	  // copyrightable.
-	  if (f1[i]==0x85) break;
-	  if (f1[i]==0xa2) break; // LDX #$xx
-	  if (f1[i]==0xa9) break; // LDA #$xx
-	  if (f1[i]==0xa5) break; // LDA $xx
-	  if (f1[i]==0xa0) break; // LDY #$xx
-	  if (f1[i]==0x69) break; // ORA #$xx ?
-	  if (f1[i]==0xc9) break; // CMP #$xx
-	  if (f1[i]==0x91) break; // STA ($nn),Y
-	  // Similarly for random byte before such instructions
-	  if (f1[i+1]==0x85) break;
-	  if (f1[i+1]==0xa9) break; // LDA #$xx
-	  if (f1[i+1]==0xa2) break; // LDX $xx
-	  if (f1[i+1]==0xa5) break; // LDA $xx
-	  if (f1[i+1]==0xa0) break; // LDY #$xx
-	  if (f1[i+1]==0x69) break; // ADC #$xx
-	  if (f1[i+1]==0xc9) break; // CMP #$xx
-	  
-	  // Filter out all 3 byte instructions
-	  switch(f1[i]) {
-	  case 0x0C: //   TSB $nnnn
-	  case 0x0D: //   ORA $nnnn
-	  case 0x0E: //   ASL $nnnn
-	  case 0x19: //   ORA $nnnn,Y
-	  case 0x1C: //   TRB $nnnn
-	  case 0x1D: //   ORA $nnnn,X
-	  case 0x1E: //   ASL $nnnn,X
-	  case 0x20: //   JSR $nnnn
-	  case 0x22: //   JSR ($nnnn)
-	  case 0x23: //   JSR ($nnnn,X)
-	  case 0x2C: //   BIT $nnnn
-	  case 0x2D: //   AND $nnnn
-	  case 0x2E: //   ROL $nnnn
-	  case 0x39: //   AND $nnnn,Y
-	  case 0x3C: //   BIT $nnnn,X
-	  case 0x3D: //   AND $nnnn,X
-	  case 0x3E: //   ROL $nnnn,X
-	  case 0x4C: //   JMP $nnnn
-	  case 0x4D: //   EOR $nnnn
-	  case 0x4E: //   LSR $nnnn
-	  case 0x59: //   EOR $nnnn,Y
-	  case 0x5D: //   EOR $nnnn,X
-	  case 0x5E: //   LSR $nnnn,X
-	  case 0x6C: //   JMP ($nnnn)
-	  case 0x6D: //   ADC $nnnn
-	  case 0x6E: //   ROR $nnnn
-	  case 0x79: //   ADC $nnnn,Y
-	  case 0x7C: //   JMP ($nnnn,X)
-	  case 0x7D: //   ADC $nnnn,X
-	  case 0x7E: //   ROR $nnnn,X
-	  case 0x8B: //   STY $nnnn,X
-	  case 0x8C: //   STY $nnnn
-	  case 0x8D: //   STA $nnnn
-	  case 0x8E: //   STX $nnnn
-	  case 0x99: //   STA $nnnn,Y
-	  case 0x9B: //   STX $nnnn,Y
-	  case 0x9C: //   STZ $nnnn
-	  case 0x9D: //   STA $nnnn,X
-	  case 0x9E: //   STZ $nnnn,X
-	  case 0xAB: //   LDZ $nnnn
-	  case 0xAC: //   LDY $nnnn
-	  case 0xAD: //   LDA $nnnn
-	  case 0xAE: //   LDX $nnnn
-	  case 0xB9: //   LDA $nnnn,Y
-	  case 0xBB: //   LDZ $nnnn,X
-	  case 0xBC: //   LDY $nnnn,X
-	  case 0xBD: //   LDA $nnnn,X
-	  case 0xBE: //   LDX $nnnn,Y
-	  case 0xCB: //   ASW $nnnn
-	  case 0xCC: //   CPY $nnnn
-	  case 0xCD: //   CMP $nnnn
-	  case 0xCE: //   DEC $nnnn
-	  case 0xD9: //   CMP $nnnn,Y
-	  case 0xDC: //   CPZ $nnnn
-	  case 0xDD: //   CMP $nnnn,X
-	  case 0xDE: //   DEC $nnnn,X
-	  case 0xEB: //   ROW $nnnn
-	  case 0xEC: //   CPX $nnnn
-	  case 0xED: //   SBC $nnnn
-	  case 0xEE: //   INC $nnnn
-	  case 0xF4: //   PHW #$nnnn
-	  case 0xF9: //   SBC $nnnn,Y
-	  case 0xFC: //   PHW $nnnn
-	  case 0xFD: //   SBC $nnnn,X
-	  case 0xFE: //   INC $nnnn,X
-	    
-	    single_instruction=1;
-	    break;
-	  }
-	}
-	if (single_instruction) break;
-	    
-
-	if (k>2) {
-	  char similarity_name[MAX_SIZE];
-	  snprintf(similarity_name,MAX_SIZE,"strings/");
-	  int offset=strlen(similarity_name);
-	  for(int b=0;b<k;b++) {
-	    snprintf(&similarity_name[offset],MAX_SIZE-offset,"%02X",f1[i+b]);
-	    offset+=2;
-	  }
-	  FILE *f=fopen(similarity_name,"r");
-	  if (f) {
-	    // Get explanation why this match is irrelevant
-	    char line[1024]; line[0]=0;
-	    if (0 == fgets(line,1024,f)) fprintf(stderr,"Warning: null fgets result\n");
-	    while (line[0]&&line[strlen(line)-1]=='\r') line[strlen(line)-1]=0;
-	    while (line[0]&&line[strlen(line)-1]=='\n') line[strlen(line)-1]=0;
-	    if (verbose)
-	      fprintf(stderr,"Ignoring $%04X = $%04X + %d (%s)\n",
-		      i,j,k,line);
-	    break;
-	    fclose(f);
-	  }
-
-	  // Otherwise, the match is unexplained.
-	  matches[k]++;
-	  
-	  // Display particularly long matches
-	  printf("$%04X = $%04X :",i,j);
-	  for(int b=0;b<k;b++) {
-	    printf(" %02X",f1[i+b]);
-	  }
-	  printf("\n");
-	  
+      n+=k;
+    }
+  }
+
+  return NULL;
+}
+
+void search_diagonal(match_list *found)
+{
+  diagonal_job *jobs=calloc(threads,sizeof(diagonal_job));
+  if (!jobs) {
+    fprintf(stderr,"Out of memory\n");
+    exit(-1);
+  }
+  for(int t=0;t<threads;t++) jobs[t].first=t;
+
+  run_threads(search_diagonal_thread,jobs,sizeof(diagonal_job));
+
+  for(int t=0;t<threads;t++) {
+    for(int m=0;m<jobs[t].found.count;m++)
+      add_match(found,jobs[t].found.items[m].i,jobs[t].found.items[m].j,jobs[t].found.items[m].k);
+    free(jobs[t].found.items);
+  }
+  free(jobs);
+}
+
+//
+// Engine 'suffix' - generalised suffix array and LCP array
+//
+
+// Text is: file 1, separator, file 2, sentinel; bytes are shifted by 1,
+// so that the sentinel is the smallest symbol and occurs only once
+#define SYM_SENTINEL  0
+#define SYM_SEPARATOR 257
+#define SYM_COUNT     258
+
+// Left context class of a position, for positions at the file start
+#define CLASS_START   256
+
+int *build_suffix_array(const int *text,int n)
+{
+  // Prefix doubling on cyclic shifts, with counting sort
+
+  int *p=malloc(n*sizeof(int));
+  int *c=malloc(n*sizeof(int));
+  int *pn=malloc(n*sizeof(int));
+  int *cn=malloc(n*sizeof(int));
+  int *cnt=calloc((n>SYM_COUNT)?n:SYM_COUNT,sizeof(int));
+  if (!p||!c||!pn||!cn||!cnt) {
+    fprintf(stderr,"Out of memory\n");
+    exit(-1);
+  }
+
+  for(int i=0;i<n;i++) cnt[text[i]]++;
+  for(int i=1;i<SYM_COUNT;i++) cnt[i]+=cnt[i-1];
+  for(int i=n-1;i>=0;i--) p[--cnt[text[i]]]=i;
+  int classes=1;
+  c[p[0]]=0;
+  for(int i=1;i<n;i++) {
+    if (text[p[i]]!=text[p[i-1]]) classes++;
+    c[p[i]]=classes-1;
+  }
+
+  for(int h=1;h<n&&classes<n;h<<=1) {
+    for(int i=0;i<n;i++) {
+      pn[i]=p[i]-h;
+      if (pn[i]<0) pn[i]+=n;
+    }
+    memset(cnt,0,classes*sizeof(int));
+    for(int i=0;i<n;i++) cnt[c[pn[i]]]++;
+    for(int i=1;i<classes;i++) cnt[i]+=cnt[i-1];
+    for(int i=n-1;i>=0;i--) p[--cnt[c[pn[i]]]]=pn[i];
+    classes=1;
+    cn[p[0]]=0;
+    for(int i=1;i<n;i++) {
+      int a=p[i]+h,b=p[i-1]+h;
+      if (a>=n) a-=n;
+      if (b>=n) b-=n;
+      if (c[p[i]]!=c[p[i-1]]||c[a]!=c[b]) classes++;
+      cn[p[i]]=classes-1;
+    }
+    int *tmp=c; c=cn; cn=tmp;
+  }
+
+  free(c); free(pn); free(cn); free(cnt);
+  return p;
+}
+
+int *build_lcp_array(const int *text,const int *sa,int n)
+{
+  // Kasai algorithm; lcp[i] is the common prefix length of sa[i-1] and sa[i]
+
+  int *rank=malloc(n*sizeof(int));
+  int *lcp=calloc(n+1,sizeof(int));
+  if (!rank||!lcp) {
+    fprintf(stderr,"Out of memory\n");
+    exit(-1);
+  }
+
+  for(int i=0;i<n;i++) rank[sa[i]]=i;
+  int h=0;
+  for(int i=0;i<n;i++) {
+    if (rank[i]==0) { h=0; continue; }
+    int j=sa[rank[i]-1];
+    while (i+h<n&&j+h<n&&text[i+h]==text[j+h]&&text[i+h]!=SYM_SEPARATOR&&text[i+h]!=SYM_SENTINEL) h++;
+    lcp[rank[i]]=h;
+    if (h>0) h--;
+  }
+
+  free(rank);
+  return lcp;
+}
+
+// Set of suffixes within an LCP interval, grouped into buckets by the file
+// and the preceding byte; only pairs from different files with different
+// preceding bytes are maximal
+typedef struct bucket {
+  int file,cls;
+  int head,tail;        // list of text positions, linked via 'next_pos'
+  int next;             // next bucket in the set, -1 = end
+} bucket;
+
+bucket *buckets;
+int *next_pos;
+
+int merge_sets(match_list *found,int parent,int child,int depth)
+{
+  // Report all maximal pairs between the two sets, then join them
+
+  if (parent<0) return child;
+  if (child<0) return parent;
+
+  for(int cb=child;cb>=0;cb=buckets[cb].next) {
+    for(int pb=parent;pb>=0;pb=buckets[pb].next) {
+      if (buckets[cb].file==buckets[pb].file) continue;
+      if (buckets[cb].cls==buckets[pb].cls&&buckets[cb].cls!=CLASS_START) continue;
+      for(int a=buckets[cb].head;a>=0;a=next_pos[a]) {
+	for(int b=buckets[pb].head;b>=0;b=next_pos[b]) {
+	  if (a<s1) add_match(found,a,b-s1-1,depth);
+	  else add_match(found,b,a-s1-1,depth);
 	}
       }
     }
   }
 
-  for(int i=0;i<MAX_SIZE;i++) {
+  int cb=child;
+  while (cb>=0) {
+    int cb_next=buckets[cb].next;
+    int pb;
+    for(pb=parent;pb>=0;pb=buckets[pb].next)
+      if (buckets[pb].file==buckets[cb].file&&buckets[pb].cls==buckets[cb].cls) break;
+    if (pb>=0) {
+      next_pos[buckets[pb].tail]=buckets[cb].head;
+      buckets[pb].tail=buckets[cb].tail;
+    } else {
+      buckets[cb].next=parent;
+      parent=cb;
+    }
+    cb=cb_next;
+  }
+
+  return parent;
+}
+
+void search_suffix(match_list *found)
+{
+  int n=s1+s2+2;
+  int *text=malloc(n*sizeof(int));
+  if (!text) {
+    fprintf(stderr,"Out of memory\n");
+    exit(-1);
+  }
+  for(int i=0;i<s1;i++) text[i]=f1[i]+1;
+  text[s1]=SYM_SEPARATOR;
+  for(int j=0;j<s2;j++) text[s1+1+j]=f2[j]+1;
+  text[n-1]=SYM_SENTINEL;
+
+  int *sa=build_suffix_array(text,n);
+  int *lcp=build_lcp_array(text,sa,n);
+
+  // Every suffix of file 1 or file 2 starts as a single bucket set
+
+  buckets=malloc(n*sizeof(bucket));
+  next_pos=malloc(n*sizeof(int));
+  int *stack_depth=malloc((n+1)*sizeof(int));
+  int *stack_set=malloc((n+1)*sizeof(int));
+  if (!buckets||!next_pos||!stack_depth||!stack_set) {
+    fprintf(stderr,"Out of memory\n");
+    exit(-1);
+  }
+  for(int p=0;p<n;p++) {
+    next_pos[p]=-1;
+    buckets[p].head=buckets[p].tail=p;
+    buckets[p].next=-1;
+    if (p<s1) {
+      buckets[p].file=1;
+      buckets[p].cls=p?f1[p-1]:CLASS_START;
+    } else if (p>s1&&p<n-1) {
+      buckets[p].file=2;
+      buckets[p].cls=(p>s1+1)?f2[p-s1-2]:CLASS_START;
+    } else buckets[p].file=0;
+  }
+
+  // Bottom-up traversal of the LCP interval tree; pairs are reported in the
+  // interval whose depth is their common prefix length, which makes them
+  // right-maximal, bucket grouping makes them left-maximal
+
+  int top=0;
+  stack_depth[0]=0;
+  stack_set[0]=-1;
+  int cur=(buckets[sa[0]].file)?sa[0]:-1;
+  for(int i=1;i<=n;i++) {
+    int h=(i<n)?lcp[i]:0;
+    while (h<stack_depth[top]) {
+      if (stack_depth[top]>=MIN_MATCH) cur=merge_sets(found,stack_set[top],cur,stack_depth[top]);
+      else cur=-1;
+      top--;
+    }
+    // Sets are not needed in intervals too shallow to contain a match
+    if (h<MIN_MATCH) cur=-1;
+    if (h>stack_depth[top]) {
+      top++;
+      stack_depth[top]=h;
+      stack_set[top]=cur;
+    } else if (h>=MIN_MATCH) {
+      stack_set[top]=merge_sets(found,stack_set[top],cur,h);
+    }
+    if (i<n) cur=(buckets[sa[i]].file)?sa[i]:-1;
+  }
+
+  free(stack_depth); free(stack_set);
+  free(buckets); free(next_pos);
+  free(lcp); free(sa); free(text);
+
+}
+
+int compare_matches(const void *a,const void *b)
+{
+  const match *m1=a,*m2=b;
+  if (m1->i!=m2->i) return (m1->i<m2->i)?-1:1;
+  if (m1->j!=m2->j) return (m1->j<m2->j)?-1:1;
+  return 0;
+}
+
+//
+// Report
+//
+
+typedef struct explain_job {
+  int first,last;       // range of matches to look up
+  int *histogram;
+} explain_job;
+
+match_list found;
+
+void *explain_thread(void *arg)
+{
+  explain_job *job=arg;
+
+  for(int m=job->first;m<job->last;m++) {
+    found.items[m].explanation=get_explanation(found.items[m].i,found.items[m].k);
+    // Otherwise, the match is unexplained.
+    if (!found.items[m].explanation) job->histogram[found.items[m].k]++;
+  }
+
+  return NULL;
+}
+
+void report_matches(int histogram_size)
+{
+  // Look up explanations in parallel, each thread with its own histogram
+
+  qsort(found.items,found.count,sizeof(match),compare_matches);
+
+  explain_job *jobs=calloc(threads,sizeof(explain_job));
+  if (!jobs) {
+    fprintf(stderr,"Out of memory\n");
+    exit(-1);
+  }
+  for(int t=0;t<threads;t++) {
+    jobs[t].first=(long long)found.count*t/threads;
+    jobs[t].last=(long long)found.count*(t+1)/threads;
+    jobs[t].histogram=calloc(histogram_size,sizeof(int));
+    if (!jobs[t].histogram) {
+      fprintf(stderr,"Out of memory\n");
+      exit(-1);
+    }
+  }
+
+  run_threads(explain_thread,jobs,sizeof(explain_job));
+
+  for(int t=0;t<threads;t++) {
+    for(int k=0;k<histogram_size;k++) matches[k]+=jobs[t].histogram[k];
+    free(jobs[t].histogram);
+  }
+  free(jobs);
+
+  // Print the report in the address order
+
+  for(int m=0;m<found.count;m++) {
+    match *item=&found.items[m];
+    if (item->explanation) {
+      if (verbose)
+	fprintf(stderr,"Ignoring $%04X = $%04X + %d (%s)\n",
+		item->i,item->j,item->k,item->explanation);
+      continue;
+    }
+
+    // Display particularly long matches
+    printf("$%04X = $%04X :",item->i,item->j);
+    for(int b=0;b<item->k;b++) {
+      printf(" %02X",f1[item->i+b]);
+    }
+    printf("\n");
+  }
+  free(found.items);
+  memset(&found,0,sizeof(found));
+}
+
+void print_histogram(int histogram_size)
+{
+  for(int i=0;i<histogram_size;i++) {
     if (matches[i])
       printf("%6d unexplained matches of %d bytes\n",matches[i],i);
   }
-  
+}
+
+int *compute_same_run(const unsigned char *data,int size)
+{
+  int *run=malloc((size+1)*sizeof(int));
+  if (!run) {
+    fprintf(stderr,"Out of memory\n");
+    exit(-1);
+  }
+  run[size]=0;
+  for(int i=size-1;i>=0;i--)
+    run[i]=(i+1<size&&data[i+1]==data[i])?run[i+1]+1:1;
+  return run;
+}
+
+//
+// Batch mode - index the reference images once, then compare every
+// target image with all of them
+//
+
+// Index is keyed by the first MIN_MATCH bytes of every offset
+typedef struct seed_slot {
+  int key;              // -1 = free slot
+  int start,count;      // range in 'positions'
+} seed_slot;
+
+typedef struct reference {
+  const char *name;
+  unsigned char *data;
+  int size;
+  int *same_run;
+  int *positions;       // offsets, sorted by their seed, then by offset
+  seed_slot *slots;
+  int slot_mask;
+} reference;
+
+int seed_key(const unsigned char *data)
+{
+  return (data[0]<<16)|(data[1]<<8)|data[2];
+}
+
+int compare_seeds(const void *a,const void *b)
+{
+  const int *p1=a,*p2=b;
+  const unsigned char *data=f1;
+  int k1=seed_key(&data[*p1]),k2=seed_key(&data[*p2]);
+  if (k1!=k2) return (k1<k2)?-1:1;
+  return (*p1<*p2)?-1:(*p1>*p2);
+}
+
+const seed_slot *find_seed(const reference *ref,int key)
+{
+  int slot=(key*2654435761u)&ref->slot_mask;
+  while (ref->slots[slot].key!=-1) {
+    if (ref->slots[slot].key==key) return &ref->slots[slot];
+    slot=(slot+1)&ref->slot_mask;
+  }
+  return NULL;
+}
+
+void index_reference(reference *ref)
+{
+  ref->data=map_file(ref->name,&ref->size);
+  ref->same_run=compute_same_run(ref->data,ref->size);
+
+  int count=(ref->size>=MIN_MATCH)?ref->size-MIN_MATCH+1:0;
+  ref->positions=malloc((count+1)*sizeof(int));
+  int slots=1024;
+  while (slots<2*count) slots*=2;
+  ref->slots=malloc(slots*sizeof(seed_slot));
+  ref->slot_mask=slots-1;
+  if (!ref->positions||!ref->slots) {
+    fprintf(stderr,"Out of memory\n");
+    exit(-1);
+  }
+  for(int e=0;e<slots;e++) ref->slots[e].key=-1;
+
+  for(int i=0;i<count;i++) ref->positions[i]=i;
+  f1=ref->data;
+  qsort(ref->positions,count,sizeof(int),compare_seeds);
+
+  for(int p=0;p<count;) {
+    int key=seed_key(&ref->data[ref->positions[p]]);
+    int q=p;
+    while (q<count&&seed_key(&ref->data[ref->positions[q]])==key) q++;
+    int slot=(key*2654435761u)&ref->slot_mask;
+    while (ref->slots[slot].key!=-1) slot=(slot+1)&ref->slot_mask;
+    ref->slots[slot].key=key;
+    ref->slots[slot].start=p;
+    ref->slots[slot].count=q-p;
+    p=q;
+  }
+}
+
+typedef struct index_job {
+  const reference *ref;
+  int first,last;       // range of target offsets
+  match_list found;
+} index_job;
+
+void *search_index_thread(void *arg)
+{
+  index_job *job=arg;
+  const reference *ref=job->ref;
+
+  for(int j=job->first;j<job->last;j++) {
+    const seed_slot *seed=find_seed(ref,seed_key(&f2[j]));
+    if (!seed) continue;
+    for(int p=seed->start;p<seed->start+seed->count;p++) {
+      int i=ref->positions[p];
+      // Only the start of the match is interesting
+      if (i&&j&&f1[i-1]==f2[j-1]) continue;
+      int len=(s1-i<s2-j)?s1-i:s2-j;
+      int k=MIN_MATCH+run_length(&f1[i+MIN_MATCH],&f2[j+MIN_MATCH],len-MIN_MATCH,1);
+      add_match(&job->found,i,j,k);
+    }
+  }
+
+  return NULL;
+}
+
+void search_index(const reference *ref,match_list *found)
+{
+  index_job *jobs=calloc(threads,sizeof(index_job));
+  if (!jobs) {
+    fprintf(stderr,"Out of memory\n");
+    exit(-1);
+  }
+  int count=(s2>=MIN_MATCH)?s2-MIN_MATCH+1:0;
+  for(int t=0;t<threads;t++) {
+    jobs[t].ref=ref;
+    jobs[t].first=(long long)count*t/threads;
+    jobs[t].last=(long long)count*(t+1)/threads;
+  }
+
+  run_threads(search_index_thread,jobs,sizeof(index_job));
+
+  for(int t=0;t<threads;t++) {
+    for(int m=0;m<jobs[t].found.count;m++)
+      add_match(found,jobs[t].found.items[m].i,jobs[t].found.items[m].j,jobs[t].found.items[m].k);
+    free(jobs[t].found.items);
+  }
+  free(jobs);
+}
+
+void batch(char *references,char **targets,int target_count)
+{
+  // References are given as a comma separated list
+
+  reference refs[16];
+  int ref_count=0;
+  for(char *name=strtok(references,",");name;name=strtok(NULL,",")) {
+    if (ref_count==16) {
+      fprintf(stderr,"Too many reference images\n");
+      exit(-1);
+    }
+    refs[ref_count].name=name;
+    index_reference(&refs[ref_count]);
+    ref_count++;
+  }
+
+  int *summary_count=calloc(ref_count*target_count,sizeof(int));
+  int *summary_longest=calloc(ref_count*target_count,sizeof(int));
+  if (!summary_count||!summary_longest) {
+    fprintf(stderr,"Out of memory\n");
+    exit(-1);
+  }
+
+  fprintf(stderr,"Searching %d files for similarities...\n",target_count);
+
+  for(int t=0;t<target_count;t++) {
+    f2=map_file(targets[t],&s2);
+    for(int r=0;r<ref_count;r++) {
+      f1=refs[r].data;
+      s1=refs[r].size;
+      same_run=refs[r].same_run;
+
+      int histogram_size=((s1<s2)?s1:s2)+1;
+      matches=calloc(histogram_size,sizeof(int));
+      if (!matches) {
+	fprintf(stderr,"Out of memory\n");
+	exit(-1);
+      }
+
+      printf("\nComparing '%s' with '%s'\n\n",refs[r].name,targets[t]);
+      search_index(&refs[r],&found);
+      report_matches(histogram_size);
+      print_histogram(histogram_size);
+
+      for(int i=0;i<histogram_size;i++) {
+	summary_count[t*ref_count+r]+=matches[i];
+	if (matches[i]) summary_longest[t*ref_count+r]=i;
+      }
+      free(matches);
+    }
+    munmap(f2,s2);
+  }
+
+  printf("\nSummary of unexplained matches:\n\n");
+  printf("%8s %8s  %s\n","matches","longest","reference / target");
+  int total=0;
+  for(int t=0;t<target_count;t++) {
+    for(int r=0;r<ref_count;r++) {
+      printf("%8d %8d  %s / %s\n",summary_count[t*ref_count+r],summary_longest[t*ref_count+r],refs[r].name,targets[t]);
+      total+=summary_count[t*ref_count+r];
+    }
+  }
+  printf("%8d %8s  total\n",total,"");
+
+  free(summary_count);
+  free(summary_longest);
+}
+
+//
+// Benchmark
+//
+
+double time_ms(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC,&ts);
+  return ts.tv_sec*1000.0+ts.tv_nsec/1000000.0;
+}
+
+void benchmark(void)
+{
+  // Best of several runs for every supported kernel, results must be identical
+
+  const int repeat=3;
+  match_list reference={0};
+  double time_scalar=0;
+
+  printf("%-10s %10s %10s %8s\n","kernel","time [ms]","speedup","matches");
+  for(int n=0;n<KERNEL_COUNT;n++) {
+    if (select_kernel(kernels[n].name)!=n) continue;
+    double best=0;
+    match_list result={0};
+    for(int r=0;r<repeat;r++) {
+      free(result.items);
+      memset(&result,0,sizeof(result));
+      double start=time_ms();
+      search_diagonal(&result);
+      double duration=time_ms()-start;
+      if (!r||duration<best) best=duration;
+    }
+    qsort(result.items,result.count,sizeof(match),compare_matches);
+    if (!n) {
+      reference=result;
+      time_scalar=best;
+    } else {
+      if (result.count!=reference.count) {
+	fprintf(stderr,"Kernel '%s' found different matches\n",kernels[n].name);
+	exit(-1);
+      }
+      for(int m=0;m<result.count;m++) {
+        if (compare_matches(&result.items[m],&reference.items[m])||result.items[m].k!=reference.items[m].k) {
+	  fprintf(stderr,"Kernel '%s' found different matches\n",kernels[n].name);
+	  exit(-1);
+        }
+      }
+      free(result.items);
+    }
+    printf("%-10s %10.2f %9.2fx %8d\n",kernels[n].name,best,time_scalar/best,reference.count);
+  }
+  free(reference.items);
+
+  double start=time_ms();
+  match_list result={0};
+  search_suffix(&result);
+  double duration=time_ms()-start;
+  printf("%-10s %10.2f %9.2fx %8d\n","(suffix)",duration,time_scalar/duration,result.count);
+  free(result.items);
+}
+
+int main(int argc,char **argv)
+{
+  int diagonal=0;
+  int bench=0;
+  const char *kernel_name=NULL;
+  const char *whitelist_name="strings";
+  int whitelist_given=0;
+  char *files[argc];
+  int file_count=0;
+
+  threads=sysconf(_SC_NPROCESSORS_ONLN);
+  if (threads<1) threads=1;
+
+  for(int a=1;a<argc;a++) {
+    if (!strcmp(argv[a],"verbose")) verbose=1;
+    else if (!strcmp(argv[a],"diagonal")) diagonal=1;
+    else if (!strncmp(argv[a],"threads=",8)&&atoi(&argv[a][8])>0) threads=atoi(&argv[a][8]);
+    else if (!strncmp(argv[a],"kernel=",7)) kernel_name=&argv[a][7];
+    else if (!strcmp(argv[a],"benchmark")) bench=1;
+    else if (!strncmp(argv[a],"whitelist=",10)) {
+      whitelist_name=&argv[a][10];
+      whitelist_given=1;
+    }
+    else files[file_count++]=argv[a];
+  }
+
+  int batch_mode=(file_count>=3&&!strcmp(files[0],"batch"));
+  if ((file_count!=2&&!batch_mode)||(batch_mode&&(bench||diagonal))) {
+    fprintf(stderr,"usage: similarity <file1> <file2> [verbose] [diagonal] [threads=<n>] [kernel=<name>] [benchmark] [whitelist=<path>]\n");
+    fprintf(stderr,"       similarity batch <reference>[,<reference>...] <target> [<target>...] [verbose] [threads=<n>] [kernel=<name>] [whitelist=<path>]\n");
+    exit(-1);
+  }
+
+  if (select_kernel(kernel_name)<0) {
+    fprintf(stderr,"Kernel '%s' is not supported\n",kernel_name);
+    exit(-1);
+  }
+
+  init_fragment_flags();
+
+  if (batch_mode) {
+    load_whitelist(whitelist_name,whitelist_given);
+    batch(files[1],&files[2],file_count-2);
+    return 0;
+  }
+
+  f1=map_file(files[0],&s1);
+  f2=map_file(files[1],&s2);
+
+  // Longest possible match is the size of the smaller file
+  int histogram_size=((s1<s2)?s1:s2)+1;
+  matches=calloc(histogram_size,sizeof(int));
+  if (!matches) {
+    fprintf(stderr,"Out of memory\n");
+    exit(-1);
+  }
+
+  same_run=compute_same_run(f1,s1);
+
+  if (bench) {
+    benchmark();
+    return 0;
+  }
+
+  load_whitelist(whitelist_name,whitelist_given);
+
+  fprintf(stderr,"Searching files for similarities...\n");
+
+  if (diagonal) search_diagonal(&found); else search_suffix(&found);
+  report_matches(histogram_size);
+  print_histogram(histogram_size);
+
   return 0;
 }
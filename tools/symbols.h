@@ -0,0 +1,173 @@
+//
+// Reader for the symbol files written by the assembler ('*_combined.sym',
+// '*.vs'), for the tools analysing the built ROMs
+//
+
+#ifndef SYMBOLS_H
+#define SYMBOLS_H
+
+#include <dirent.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+class SymbolTable
+{
+public:
+
+    typedef struct
+    {
+        std::string name;       // source file based label, without the '_s' suffix
+        std::string segment;
+        uint16_t    start;
+        uint16_t    end;        // first address after the routine
+
+    } Routine;
+
+    // Load all the '*_combined.sym' files from the directory, returns number of files read
+
+    unsigned loadDir(const std::string &dirName)
+    {
+        unsigned numFiles = 0;
+
+        DIR *dirHandle = opendir(dirName.c_str());
+        if (!dirHandle) return 0;
+
+        std::vector<std::string> fileNames;
+        struct dirent *dirEntry;
+        while ((dirEntry = readdir(dirHandle)) != nullptr)
+        {
+            const std::string fileName = dirEntry->d_name;
+            if (fileName.length() <= STR_SYM.length()) continue;
+            if (fileName.compare(fileName.length() - STR_SYM.length(), STR_SYM.length(), STR_SYM) != 0) continue;
+
+            fileNames.push_back(fileName);
+        }
+        closedir(dirHandle);
+
+        std::sort(fileNames.begin(), fileNames.end());
+        for (const auto &fileName : fileNames)
+        {
+            const std::string segment = fileName.substr(0, fileName.length() - STR_SYM.length());
+            if (loadFile(dirName + "/" + fileName, segment)) numFiles++;
+        }
+
+        return numFiles;
+    }
+
+    // Load a single symbol file; lines are in the form '<label> = $<address>', possibly with a comment
+
+    bool loadFile(const std::string &fileName, const std::string &segment)
+    {
+        std::ifstream symFile(fileName);
+        if (!symFile.good()) return false;
+
+        std::map<std::string, uint16_t> routineStarts, routineEnds;
+
+        std::string line;
+        while (std::getline(symFile, line))
+        {
+            auto eqPos  = line.find('=');
+            auto hexPos = line.find('$');
+            if (eqPos == std::string::npos || hexPos == std::string::npos || hexPos < eqPos) continue;
+
+            std::istringstream labelStream(line.substr(0, eqPos));
+            std::string label;
+            labelStream >> label;
+            if (label.empty()) continue;
+
+            const uint16_t address = strtoul(line.c_str() + hexPos + 1, nullptr, 16);
+
+            if (label.compare(0, LAB_START.size(), LAB_START) == 0)
+            {
+                routineStarts[label.substr(LAB_START.size())] = address;
+            }
+            else if (label.compare(0, LAB_END.size(), LAB_END) == 0)
+            {
+                routineEnds[label.substr(LAB_END.size())] = address;
+            }
+            else
+            {
+                // Segments import symbols from each other - first definition wins
+                labels.emplace(label, address);
+            }
+        }
+
+        for (const auto &routineStart : routineStarts)
+        {
+            auto routineEnd = routineEnds.find(routineStart.first);
+            if (routineEnd == routineEnds.end() || routineEnd->second < routineStart.second) continue;
+
+            std::string name = routineStart.first;
+            if (name.length() > 2 && name.compare(name.length() - 2, 2, "_s") == 0) name.resize(name.length() - 2);
+
+            routines.push_back({ name, segment, routineStart.second, routineEnd->second });
+        }
+
+        std::sort(routines.begin(), routines.end(),
+                  [](const Routine &a, const Routine &b) -> bool { return a.start < b.start; });
+
+        return true;
+    }
+
+    // Load a VICE label file ('*.vs'); lines are in the form 'al C:<address> .<label>'
+
+    bool loadViceFile(const std::string &fileName)
+    {
+        std::ifstream vsFile(fileName);
+        if (!vsFile.good()) return false;
+
+        std::string line;
+        while (std::getline(vsFile, line))
+        {
+            std::istringstream lineStream(line);
+            std::string command, address, label;
+            if (!(lineStream >> command >> address >> label)) continue;
+            if (command != "al" || address.size() < 3 || label.size() < 2 || label[0] != '.') continue;
+
+            labels.emplace(label.substr(1), strtoul(address.c_str() + 2, nullptr, 16));
+        }
+
+        return true;
+    }
+
+    bool find(const std::string &label, uint16_t &address) const
+    {
+        auto iter = labels.find(label);
+        if (iter == labels.end()) return false;
+
+        address = iter->second;
+        return true;
+    }
+
+    // Routine containing the address, or nullptr
+
+    const Routine *routineAt(uint16_t address) const
+    {
+        auto iter = std::upper_bound(routines.begin(), routines.end(), address,
+                                     [](uint16_t addr, const Routine &routine) -> bool { return addr < routine.start; });
+        if (iter == routines.begin()) return nullptr;
+
+        --iter;
+        return (address < iter->end) ? &(*iter) : nullptr;
+    }
+
+    bool empty() const { return labels.empty() && routines.empty(); }
+
+    std::map<std::string, uint16_t> labels;
+    std::vector<Routine>            routines;   // sorted by start address
+
+private:
+
+    const std::string STR_SYM   = "_combined.sym";
+    const std::string LAB_START = "__routine_START_";
+    const std::string LAB_END   = "__routine_END_";
+};
+
+#endif // SYMBOLS_H
@@ -0,0 +1,90 @@
+/*
+  Converts program traces (see trace_format.h) between the text and the
+  binary format. By default, the output uses the format the input does not.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+
+#include "trace_format.h"
+
+void usage(const char *name)
+{
+  fprintf(stderr, "Usage: %s [-b | -t] <input trace> <output trace>\n"
+          "  -b  write binary trace\n"
+          "  -t  write text trace\n"
+          "  use '-' for standard input / output\n",
+          name);
+  exit(-1);
+}
+
+int main(int argc, char *argv[])
+{
+  int out_format = -1;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "bt")) != -1) {
+    switch (opt) {
+    case 'b':
+      out_format = 1;
+      break;
+    case 't':
+      out_format = 0;
+      break;
+    default:
+      usage(argv[0]);
+    }
+  }
+
+  if (optind + 2 != argc) usage(argv[0]);
+
+  const char *in_name = argv[optind], *out_name = argv[optind + 1];
+
+  FILE *in = strcmp(in_name, "-") ? fopen(in_name, "rb") : stdin;
+  if (!in) {
+    perror(in_name);
+    exit(-1);
+  }
+
+  trace_stream src, dst;
+  if (trace_open(&src, in) < 0) {
+    fprintf(stderr, "%s: malformed trace header\n", in_name);
+    exit(-1);
+  }
+  if (out_format < 0) out_format = !src.binary;
+
+  FILE *out = strcmp(out_name, "-") ? fopen(out_name, "wb") : stdout;
+  if (!out) {
+    perror(out_name);
+    exit(-1);
+  }
+
+  static char out_buf[1 << 20];
+  setvbuf(out, out_buf, _IOFBF, sizeof(out_buf));
+
+  trace_init(&dst, out, out_format);
+  trace_write_header(&dst);
+
+  trace_entry entry;
+  int status;
+  while ((status = trace_read(&src, &entry)) == 1) trace_write(&dst, &entry);
+
+  if (status < 0) {
+    fprintf(stderr, "%s: malformed trace after %llu entries\n", in_name, (unsigned long long) src.count);
+    exit(-1);
+  }
+
+  if (fflush(out) != 0 || ferror(out)) {
+    perror(out_name);
+    exit(-1);
+  }
+
+  fprintf(stderr, "Converted %llu entries to %s format\n", (unsigned long long) dst.count,
+          out_format ? "binary" : "text");
+
+  if (in != stdin) fclose(in);
+  if (out != stdout) fclose(out);
+  return 0;
+}
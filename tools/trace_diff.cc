@@ -0,0 +1,433 @@
+//
+// Utility to compare two program traces (see 'trace_format.h'), for example
+// collected on the original ROMs and on the Open ROMs - reports where the
+// sequences of ROM entries diverge and how the time between the entries
+// differs, per entry point. Traces are streamed, memory use does not depend
+// on their length.
+//
+
+#include "common.h"
+#include "symbols.h"
+#include "trace_format.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <deque>
+#include <list>
+
+//
+// Command line settings
+//
+
+std::string CMD_traceA   = "";
+std::string CMD_traceB   = "";
+bool        CMD_irq      = false;
+unsigned    CMD_window   = 4096;
+unsigned    CMD_maxDivs  = 20;
+unsigned    CMD_maxLines = 40;
+
+std::list<std::string> CMD_vsFiles;
+
+//
+// Names of the official KERNAL entry points
+//
+
+const std::map<uint16_t, std::string> KERNAL_JUMP_TABLE =
+{
+    { 0xFF81, "CINT"   }, { 0xFF84, "IOINIT" }, { 0xFF87, "RAMTAS" }, { 0xFF8A, "RESTOR" },
+    { 0xFF8D, "VECTOR" }, { 0xFF90, "SETMSG" }, { 0xFF93, "SECOND" }, { 0xFF96, "TKSA"   },
+    { 0xFF99, "MEMTOP" }, { 0xFF9C, "MEMBOT" }, { 0xFF9F, "SCNKEY" }, { 0xFFA2, "SETTMO" },
+    { 0xFFA5, "ACPTR"  }, { 0xFFA8, "CIOUT"  }, { 0xFFAB, "UNTLK"  }, { 0xFFAE, "UNLSN"  },
+    { 0xFFB1, "LISTEN" }, { 0xFFB4, "TALK"   }, { 0xFFB7, "READST" }, { 0xFFBA, "SETLFS" },
+    { 0xFFBD, "SETNAM" }, { 0xFFC0, "OPEN"   }, { 0xFFC3, "CLOSE"  }, { 0xFFC6, "CHKIN"  },
+    { 0xFFC9, "CHKOUT" }, { 0xFFCC, "CLRCHN" }, { 0xFFCF, "CHRIN"  }, { 0xFFD2, "CHROUT" },
+    { 0xFFD5, "LOAD"   }, { 0xFFD8, "SAVE"   }, { 0xFFDB, "SETTIM" }, { 0xFFDE, "RDTIM"  },
+    { 0xFFE1, "STOP"   }, { 0xFFE4, "GETIN"  }, { 0xFFE7, "CLALL"  }, { 0xFFEA, "UDTIM"  },
+    { 0xFFED, "SCREEN" }, { 0xFFF0, "PLOT"   }, { 0xFFF3, "IOBASE" },
+};
+
+std::map<uint16_t, std::string> GLOBAL_names;
+
+//
+// Common helper functions
+//
+
+void printUsage()
+{
+    std::cout << "\n" <<
+        "usage: trace_diff [-i] [-w <window>] [-d <divergences>] [-l <lines>] [-v <VICE label file>]..." << "\n" <<
+        "                  <trace A> <trace B>" << "\n\n" <<
+        "  -i  include interrupts (timing dependent, skipped by default)" << "\n" <<
+        "  -w  look-ahead window (entries) for re-synchronizing diverged traces" << "\n" <<
+        "  -d  number of divergences to print, 0 = all" << "\n" <<
+        "  -l  number of entry points to print, 0 = all" << "\n" <<
+        "  -v  VICE label file, for naming the entry points" << "\n\n" <<
+        "  traces can be either in text or in binary format; exit code is 1 if they diverge" << "\n\n";
+}
+
+void parseCommandLine(int argc, char **argv)
+{
+    int opt;
+
+    while ((opt = getopt(argc, argv, "iw:d:l:v:")) != -1)
+    {
+        switch(opt)
+        {
+            case 'i': CMD_irq      = true;                 break;
+            case 'w': CMD_window   = atoi(optarg);         break;
+            case 'd': CMD_maxDivs  = atoi(optarg);         break;
+            case 'l': CMD_maxLines = atoi(optarg);         break;
+            case 'v': CMD_vsFiles.push_back(optarg);       break;
+            default: printUsage(); ERROR();
+        }
+    }
+
+    if (optind + 2 != argc) { printUsage(); ERROR("two traces have to be given"); }
+
+    CMD_traceA = argv[optind];
+    CMD_traceB = argv[optind + 1];
+
+    if (CMD_window == 0) { printUsage(); ERROR("window has to be at least 1"); }
+}
+
+void printBanner()
+{
+    printBannerLineTop();
+    std::cout << "// Comparing program traces" << "\n";
+    printBannerLineBottom();
+}
+
+std::string entryName(const trace_entry &entry)
+{
+    char buf[8];
+    snprintf(buf, sizeof(buf), "$%04X", entry.pc);
+
+    std::string name = buf;
+    const auto iter = GLOBAL_names.find(entry.pc);
+    if (iter != GLOBAL_names.end()) name += " " + iter->second;
+    if (entry.kind == TRACE_KIND_INTERRUPT) name += " (irq)";
+
+    return name;
+}
+
+//
+// Trace reader with a bounded look-ahead buffer
+//
+
+class TraceWindow
+{
+public:
+
+    TraceWindow(const std::string &fileName) : fileName(fileName)
+    {
+        file = fopen(fileName.c_str(), "rb");
+        if (file == nullptr) ERROR(std::string("unable to open trace '") + fileName + "'");
+
+        static char buf[2][1 << 20];
+        static unsigned bufIdx = 0;
+        setvbuf(file, buf[bufIdx++ % 2], _IOFBF, sizeof(buf[0]));
+
+        if (trace_open(&stream, file) < 0) ERROR(std::string("malformed trace '") + fileName + "'");
+    }
+
+    ~TraceWindow() { fclose(file); }
+
+    // Makes sure entry 'idx' is buffered, returns false if the trace is shorter
+
+    bool fill(size_t idx)
+    {
+        while (buffer.size() <= idx && !finished)
+        {
+            trace_entry entry;
+            const int status = trace_read(&stream, &entry);
+
+            if (status < 0) ERROR(std::string("malformed trace '") + fileName + "'");
+            if (status == 0) { finished = true; break; }
+
+            if (entry.kind == TRACE_KIND_INTERRUPT && !CMD_irq) { skipped++; continue; }
+            buffer.push_back(entry);
+        }
+
+        return idx < buffer.size();
+    }
+
+    const trace_entry &operator[](size_t idx) const { return buffer[idx]; }
+
+    void pop()
+    {
+        buffer.pop_front();
+        position++;
+    }
+
+    uint64_t position = 0;    // index of the first buffered entry
+    uint64_t skipped  = 0;    // interrupts, when not compared
+
+private:
+
+    std::string             fileName;
+    FILE                   *file     = nullptr;
+    trace_stream            stream;
+    std::deque<trace_entry> buffer;
+    bool                    finished = false;
+};
+
+//
+// Comparison
+//
+
+typedef struct
+{
+    uint64_t calls      = 0;   // matched in both traces
+    uint64_t cyclesA    = 0;   // till the next matched entry
+    uint64_t cyclesB    = 0;
+    uint64_t onlyA      = 0;
+    uint64_t onlyB      = 0;
+    uint64_t callerDiff = 0;
+
+    int64_t delta() const { return int64_t(cyclesB) - int64_t(cyclesA); }
+
+} EntryStats;
+
+class TraceDiff
+{
+public:
+
+    TraceDiff(TraceWindow &traceA, TraceWindow &traceB) : traceA(traceA), traceB(traceB) {}
+
+    void run()
+    {
+        while (true)
+        {
+            const bool hasA = traceA.fill(0);
+            const bool hasB = traceB.fill(0);
+
+            if (!hasA && !hasB) break;
+
+            if (hasA && hasB && sameEntry(traceA[0], traceB[0]))
+            {
+                match();
+                continue;
+            }
+
+            // Diverged - find the nearest common entry within the window
+
+            size_t skipA = 0, skipB = 0;
+            if (!resync(skipA, skipB))
+            {
+                // No common entry in the window, or one of the traces ended
+
+                skipA = hasA ? std::min<size_t>(CMD_window, countBuffered(traceA)) : 0;
+                skipB = hasB ? std::min<size_t>(CMD_window, countBuffered(traceB)) : 0;
+            }
+
+            reportDivergence(skipA, skipB);
+
+            for (size_t idx = 0; idx < skipA; idx++) { stats[key(traceA[0])].onlyA++; traceA.pop(); }
+            for (size_t idx = 0; idx < skipB; idx++) { stats[key(traceB[0])].onlyB++; traceB.pop(); }
+        }
+    }
+
+    void printSummary() const
+    {
+        std::cout << "Entries compared: A " << traceA.position << ", B " << traceB.position;
+        if (!CMD_irq) std::cout << " (interrupts skipped: A " << traceA.skipped << ", B " << traceB.skipped << ")";
+        std::cout << "\n";
+        std::cout << "Matched: " << matched << ", divergences: " << divergences <<
+                     ", only in A: " << onlyA << ", only in B: " << onlyB << "\n";
+        if (matched != 0)
+        {
+            std::cout << "Cycle offset B - A at the last matched entry: " << lastOffset << "\n";
+        }
+        std::cout << "\n";
+
+        // Entry points sorted by the absolute cycle difference, then by mismatches
+
+        std::vector<std::pair<uint32_t, EntryStats>> sorted(stats.begin(), stats.end());
+        std::sort(sorted.begin(), sorted.end(),
+                  [](const std::pair<uint32_t, EntryStats> &a, const std::pair<uint32_t, EntryStats> &b) -> bool
+                  {
+                      const int64_t deltaA = std::abs(a.second.delta()), deltaB = std::abs(b.second.delta());
+                      if (deltaA != deltaB) return deltaA > deltaB;
+                      return a.second.onlyA + a.second.onlyB > b.second.onlyA + b.second.onlyB;
+                  });
+
+        std::cout << "    entry point                 calls     cycles A     cycles B        delta  delta/call" <<
+                     "   only A   only B  callers" << "\n";
+
+        unsigned lines = 0;
+        for (const auto &item : sorted)
+        {
+            if (CMD_maxLines != 0 && lines++ >= CMD_maxLines) break;
+
+            const EntryStats &entry = item.second;
+            trace_entry te = { uint8_t(item.first >> 16), uint16_t(item.first & 0xFFFF), 0, 0 };
+
+            char buf[256];
+            snprintf(buf, sizeof(buf), "    %-22s %10llu %12llu %12llu %12lld %11.1f %8llu %8llu %8llu\n",
+                     entryName(te).c_str(), (unsigned long long) entry.calls,
+                     (unsigned long long) entry.cyclesA, (unsigned long long) entry.cyclesB,
+                     (long long) entry.delta(), entry.calls ? double(entry.delta()) / entry.calls : 0.0,
+                     (unsigned long long) entry.onlyA, (unsigned long long) entry.onlyB,
+                     (unsigned long long) entry.callerDiff);
+            std::cout << buf;
+        }
+        std::cout << "\n" << "cycles A/B - from the entry to the next entry present in both traces" << "\n\n";
+    }
+
+    uint64_t divergences = 0;
+
+private:
+
+    static uint32_t key(const trace_entry &entry) { return (uint32_t(entry.kind) << 16) | entry.pc; }
+
+    static bool sameEntry(const trace_entry &a, const trace_entry &b)
+    {
+        // Callers are not compared - they are in the ROM for some entries, and the ROMs differ
+
+        return a.kind == b.kind && a.pc == b.pc;
+    }
+
+    static size_t countBuffered(TraceWindow &trace)
+    {
+        size_t count = 0;
+        while (count < CMD_window && trace.fill(count)) count++;
+        return count;
+    }
+
+    void match()
+    {
+        // Time since the previous match is attributed to the previous entry point
+
+        if (matched != 0)
+        {
+            EntryStats &prev = stats[key(prevA)];
+            prev.cyclesA += traceA[0].cycle - prevA.cycle;
+            prev.cyclesB += traceB[0].cycle - prevB.cycle;
+        }
+
+        EntryStats &current = stats[key(traceA[0])];
+        current.calls++;
+        if (traceA[0].caller != traceB[0].caller) current.callerDiff++;
+
+        prevA = traceA[0];
+        prevB = traceB[0];
+        lastOffset = int64_t(prevB.cycle) - int64_t(prevA.cycle);
+        matched++;
+
+        traceA.pop();
+        traceB.pop();
+    }
+
+    bool resync(size_t &skipA, size_t &skipB)
+    {
+        // Find the common entry with the smallest skipA + skipB: first occurrence of each
+        // entry key in window B is indexed, then window A is scanned
+
+        generation++;
+        if (generation == 0)
+        {
+            std::fill(seenGen.begin(), seenGen.end(), 0);
+            generation = 1;
+        }
+
+        for (size_t idx = 0; idx < CMD_window && traceB.fill(idx); idx++)
+        {
+            const uint32_t k = key(traceB[idx]);
+            if (seenGen[k] == generation) continue;
+            seenGen[k] = generation;
+            seenIdx[k] = idx;
+        }
+
+        size_t best = SIZE_MAX;
+        for (size_t idx = 0; idx < CMD_window && idx < best && traceA.fill(idx); idx++)
+        {
+            const uint32_t k = key(traceA[idx]);
+            if (seenGen[k] != generation || idx + seenIdx[k] >= best) continue;
+
+            best  = idx + seenIdx[k];
+            skipA = idx;
+            skipB = seenIdx[k];
+        }
+
+        return best != SIZE_MAX;
+    }
+
+    void reportDivergence(size_t skipA, size_t skipB)
+    {
+        divergences++;
+        onlyA += skipA;
+        onlyB += skipB;
+
+        if (CMD_maxDivs != 0 && divergences > CMD_maxDivs)
+        {
+            if (divergences == CMD_maxDivs + 1) std::cout << "... (further divergences not printed)" << "\n\n";
+            return;
+        }
+
+        std::cout << "Divergence #" << divergences << " at entry A " << traceA.position <<
+                     ", B " << traceB.position << "\n";
+
+        auto printSide = [](const char *side, TraceWindow &trace, size_t count)
+        {
+            const size_t MAX_PRINT = 8;
+            for (size_t idx = 0; idx < count && idx < MAX_PRINT; idx++)
+            {
+                char buf[128];
+                snprintf(buf, sizeof(buf), "    %s  %-22s from $%04X @ cycle %llu\n", side,
+                         entryName(trace[idx]).c_str(), trace[idx].caller, (unsigned long long) trace[idx].cycle);
+                std::cout << buf;
+            }
+            if (count > MAX_PRINT) std::cout << "    " << side << "  ... " << count - MAX_PRINT << " more" << "\n";
+        };
+
+        printSide("A", traceA, skipA);
+        printSide("B", traceB, skipB);
+        std::cout << "\n";
+    }
+
+    TraceWindow &traceA;
+    TraceWindow &traceB;
+
+    std::map<uint32_t, EntryStats> stats;   // bounded - by the number of distinct entry points
+
+    trace_entry prevA, prevB;
+    uint64_t    matched    = 0;
+    uint64_t    onlyA      = 0;
+    uint64_t    onlyB      = 0;
+    int64_t     lastOffset = 0;
+
+    // Look-up of entry keys (kind and PC) in window B, valid if marked with the current generation
+
+    uint32_t              generation = 0;
+    std::vector<uint32_t> seenGen    = std::vector<uint32_t>(0x20000, 0);
+    std::vector<size_t>   seenIdx    = std::vector<size_t>(0x20000, 0);
+};
+
+//
+// Main function
+//
+
+int main(int argc, char **argv)
+{
+    parseCommandLine(argc, argv);
+    printBanner();
+
+    GLOBAL_names = KERNAL_JUMP_TABLE;
+    for (const auto &vsFile : CMD_vsFiles)
+    {
+        SymbolTable symbols;
+        if (!symbols.loadViceFile(vsFile)) ERROR(std::string("unable to read label file '") + vsFile + "'");
+        for (const auto &label : symbols.labels) GLOBAL_names.emplace(label.second, label.first);
+    }
+
+    TraceWindow traceA(CMD_traceA);
+    TraceWindow traceB(CMD_traceB);
+
+    TraceDiff diff(traceA, traceB);
+    diff.run();
+    diff.printSummary();
+
+    return (diff.divergences != 0) ? 1 : 0;
+}
@@ -0,0 +1,190 @@
+/*
+  Program trace formats - ROM entries collected by collect_data, one entry
+  per ROM call or interrupt. Shared by collect_data, trace_convert and
+  trace_diff.
+
+  Text format (one entry per line, other lines are ignored):
+
+    $ff9c called from $e403 @ cycle 2163111
+    $ff48 called from via interrupt @ cycle 2162254
+
+  For an entry by JSR the caller is the address of the JSR instruction. For
+  other entries (JMP, RTS, RTI into the ROM) it is the address where the CPU
+  was last seen outside the ROM - usually where it last came back from the
+  ROM, not the instruction which jumped in. Old single stepping collectors
+  reported the last instruction before the entry instead, so the callers of
+  such entries differ between traces collected by the old and the new tools.
+
+  Binary format: magic "ORTRACE1", then one record per entry:
+
+    kind      u8       TRACE_KIND_*
+    pc        varint   zigzag encoded difference to the previous entry PC
+    caller    varint   zigzag encoded difference to the previous call caller, only for calls
+    cycle     varint   zigzag encoded difference to the previous entry cycle
+
+  Varints are little endian base-128 (7 bits per byte, bit 7 set if more bytes
+  follow). A typical entry takes 5-8 bytes, compared to 40 bytes as text.
+*/
+
+#ifndef TRACE_FORMAT_H
+#define TRACE_FORMAT_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#define TRACE_MAGIC          "ORTRACE1"
+#define TRACE_MAGIC_SIZE     8
+
+#define TRACE_KIND_CALL      0
+#define TRACE_KIND_INTERRUPT 1
+
+typedef struct trace_entry {
+  uint8_t   kind;
+  uint16_t  pc;
+  uint16_t  caller;               /* calls only */
+  uint64_t  cycle;
+} trace_entry;
+
+typedef struct trace_stream {
+  FILE        *f;
+  int          binary;
+  trace_entry  last;              /* previous entry, base for the deltas */
+  uint64_t     count;             /* entries read or written so far */
+} trace_stream;
+
+static inline void trace_init(trace_stream *s, FILE *f, int binary)
+{
+  memset(s, 0, sizeof(*s));
+  s->f = f;
+  s->binary = binary;
+}
+
+/* Varint helpers */
+
+static inline void trace_put_varint(FILE *f, uint64_t value)
+{
+  while (value >= 0x80) {
+    fputc((int) (value & 0x7f) | 0x80, f);
+    value >>= 7;
+  }
+  fputc((int) value, f);
+}
+
+static inline int trace_get_varint(FILE *f, uint64_t *value)
+{
+  *value = 0;
+  for (unsigned shift = 0; shift < 64; shift += 7) {
+    int c = fgetc(f);
+    if (c == EOF) return 0;
+    *value |= (uint64_t) (c & 0x7f) << shift;
+    if (!(c & 0x80)) return 1;
+  }
+  return 0;
+}
+
+static inline uint64_t trace_zigzag(int64_t value)
+{
+  return ((uint64_t) value << 1) ^ (uint64_t) (value >> 63);
+}
+
+static inline int64_t trace_unzigzag(uint64_t value)
+{
+  return (int64_t) (value >> 1) ^ -(int64_t) (value & 1);
+}
+
+/* Writing - header first (binary only), then the entries */
+
+static inline void trace_write_header(trace_stream *s)
+{
+  if (s->binary) fwrite(TRACE_MAGIC, 1, TRACE_MAGIC_SIZE, s->f);
+}
+
+static inline void trace_write(trace_stream *s, const trace_entry *e)
+{
+  if (!s->binary) {
+    if (e->kind == TRACE_KIND_INTERRUPT)
+      fprintf(s->f, "$%04x called from via interrupt @ cycle %llu\n", e->pc, (unsigned long long) e->cycle);
+    else
+      fprintf(s->f, "$%04x called from $%04x @ cycle %llu\n", e->pc, e->caller, (unsigned long long) e->cycle);
+  } else {
+    fputc(e->kind, s->f);
+    trace_put_varint(s->f, trace_zigzag((int16_t) (e->pc - s->last.pc)));
+    if (e->kind == TRACE_KIND_CALL) {
+      trace_put_varint(s->f, trace_zigzag((int16_t) (e->caller - s->last.caller)));
+      s->last.caller = e->caller;
+    }
+    trace_put_varint(s->f, trace_zigzag((int64_t) (e->cycle - s->last.cycle)));
+    s->last.pc = e->pc;
+    s->last.cycle = e->cycle;
+  }
+  s->count++;
+}
+
+/* Reading - trace_open detects the format, returns -1 if the header is malformed */
+
+static inline int trace_open(trace_stream *s, FILE *f)
+{
+  // Text traces never start with the magic first character - one character of
+  // look-ahead is enough, so that pipes work too
+
+  int c = fgetc(f);
+  if (c != EOF) ungetc(c, f);
+
+  trace_init(s, f, c == TRACE_MAGIC[0]);
+  if (s->binary) {
+    char magic[TRACE_MAGIC_SIZE];
+    if (fread(magic, 1, sizeof(magic), f) != sizeof(magic) || memcmp(magic, TRACE_MAGIC, TRACE_MAGIC_SIZE)) return -1;
+  }
+  return 0;
+}
+
+/* Returns 1 if an entry was read, 0 at the end, -1 if data is malformed */
+
+static inline int trace_read(trace_stream *s, trace_entry *e)
+{
+  if (s->binary) {
+    uint64_t pc, caller = 0, cycle;
+    int kind = fgetc(s->f);
+    if (kind == EOF) return 0;
+    if (kind != TRACE_KIND_CALL && kind != TRACE_KIND_INTERRUPT) return -1;
+
+    if (!trace_get_varint(s->f, &pc)) return -1;
+    if (kind == TRACE_KIND_CALL && !trace_get_varint(s->f, &caller)) return -1;
+    if (!trace_get_varint(s->f, &cycle)) return -1;
+
+    e->kind = kind;
+    e->pc = s->last.pc + (uint16_t) trace_unzigzag(pc);
+    e->caller = (kind == TRACE_KIND_CALL) ? (uint16_t) (s->last.caller + trace_unzigzag(caller)) : 0;
+    e->cycle = s->last.cycle + (uint64_t) trace_unzigzag(cycle);
+
+    s->last.pc = e->pc;
+    if (kind == TRACE_KIND_CALL) s->last.caller = e->caller;
+    s->last.cycle = e->cycle;
+    s->count++;
+    return 1;
+  }
+
+  char line[256];
+  while (fgets(line, sizeof(line), s->f)) {
+    unsigned pc, caller;
+    unsigned long long cycle;
+
+    if (sscanf(line, "$%x called from via interrupt @ cycle %llu", &pc, &cycle) == 2) {
+      e->kind = TRACE_KIND_INTERRUPT;
+      e->caller = 0;
+    } else if (sscanf(line, "$%x called from $%x @ cycle %llu", &pc, &caller, &cycle) == 3) {
+      e->kind = TRACE_KIND_CALL;
+      e->caller = caller;
+    } else {
+      continue;
+    }
+    e->pc = pc;
+    e->cycle = cycle;
+    s->count++;
+    return 1;
+  }
+  return 0;
+}
+
+#endif /* TRACE_FORMAT_H */